@@ -0,0 +1,45 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+
+class Mesh;
+
+// --------------------------------------------------------
+// A mesh or texture that may still be loading (see
+// AssetRegistry::LoadMeshAsync() and LoadTextureAsync())
+//
+// - Get() hands back a placeholder until the registry's
+//   Update() finishes the asset on the main thread, and the
+//   real thing from then on, so holders can keep calling it
+//   every frame
+// - IsReady() turns true once loading is over; an asset
+//   that failed to load keeps its placeholder
+// - Only touched on the main thread, so no locking
+// --------------------------------------------------------
+template<typename Handle>
+class AssetFuture
+{
+public:
+	explicit AssetFuture(Handle placeholder) : value(placeholder) {}
+
+	bool IsReady() { return ready; }
+	Handle Get() { return value; }
+
+private:
+	friend class AssetRegistry;
+
+	Handle value;
+	bool ready = false;
+
+	void Finish(Handle loaded)
+	{
+		if (loaded)
+			value = loaded;
+		ready = true;
+	}
+};
+
+typedef AssetFuture<std::shared_ptr<Mesh>> MeshFuture;
+typedef AssetFuture<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> TextureFuture;
@@ -0,0 +1,507 @@
+#include "AssetRegistry.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "WorkerPool.h"
+
+#include <chrono>
+#include <vector>
+
+#ifdef _WIN32
+#include <wincodec.h>
+#pragma comment(lib, "windowscodecs.lib")
+#endif
+
+namespace
+{
+	unsigned int CountReferences(const std::shared_ptr<Mesh>& mesh)
+	{
+		return (unsigned int)mesh.use_count() - 1;
+	}
+
+	// COM only reports its count through AddRef() and Release()
+	unsigned int CountReferences(const Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& texture)
+	{
+		texture->AddRef();
+		return (unsigned int)texture->Release() - 1;
+	}
+
+	// --------------------------------------------------------
+	// Decodes an image file's bytes to tightly packed RGBA8
+	// with WIC.  Touches no device, so any thread can call it;
+	// each one sets up COM for itself.
+	// --------------------------------------------------------
+	bool DecodeImage(const void* data, size_t size, unsigned int& width, unsigned int& height, std::vector<unsigned char>& pixels)
+	{
+#ifdef _WIN32
+		HRESULT com = CoInitializeEx(0, COINIT_MULTITHREADED);
+		bool decoded = false;
+		{
+			Microsoft::WRL::ComPtr<IWICImagingFactory> factory;
+			Microsoft::WRL::ComPtr<IWICStream> stream;
+			Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
+			Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
+			Microsoft::WRL::ComPtr<IWICFormatConverter> converter;
+
+			if (SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, 0, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()))) &&
+				SUCCEEDED(factory->CreateStream(stream.GetAddressOf())) &&
+				SUCCEEDED(stream->InitializeFromMemory((BYTE*)data, (DWORD)size)) &&
+				SUCCEEDED(factory->CreateDecoderFromStream(stream.Get(), 0, WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf())) &&
+				SUCCEEDED(decoder->GetFrame(0, frame.GetAddressOf())) &&
+				SUCCEEDED(frame->GetSize(&width, &height)) &&
+				SUCCEEDED(factory->CreateFormatConverter(converter.GetAddressOf())) &&
+				SUCCEEDED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, 0, 0.0, WICBitmapPaletteTypeCustom)))
+			{
+				pixels.resize((size_t)width * height * 4);
+				decoded = SUCCEEDED(converter->CopyPixels(0, width * 4, (UINT)pixels.size(), pixels.data()));
+			}
+		}
+		if (SUCCEEDED(com))
+			CoUninitialize();
+
+		if (!decoded)
+			pixels.clear();
+		return decoded;
+#else
+		return false;
+#endif
+	}
+}
+
+AssetRegistry::AssetRegistry(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<GeometryPool> geometryPool)
+	: device(device), context(context), geometryPool(geometryPool)
+{
+}
+
+AssetRegistry::~AssetRegistry()
+{
+	// Workers may still be reading; their results have nowhere to go
+	for (PendingMesh& pending : this->pendingMeshes)
+		pending.Work.wait();
+	for (PendingTexture& pending : this->pendingTextures)
+		pending.Work.wait();
+}
+
+// --------------------------------------------------------
+// Path lookup, then a load that's already underway, then
+// an actual load on this thread
+// --------------------------------------------------------
+std::shared_ptr<Mesh> AssetRegistry::LoadMesh(const std::wstring& path)
+{
+	this->report.Requests++;
+
+	std::wstring key = NormalizeAssetPath(path);
+	std::shared_ptr<Mesh> mesh;
+	if (!FindLoaded(this->meshes, key, mesh))
+	{
+		size_t pending = FindPending(this->pendingMeshes, key);
+		if (pending < this->pendingMeshes.size())
+		{
+			LoadedMesh loaded = this->pendingMeshes[pending].Work.get();
+			mesh = FinishMesh(loaded, key);
+			this->pendingMeshes[pending].Future->Finish(mesh);
+			this->pendingMeshes.erase(this->pendingMeshes.begin() + pending);
+		}
+		else
+		{
+			LoadedMesh loaded = ReadMesh(path, this->buildMeshBvhs);
+			mesh = FinishMesh(loaded, key);
+		}
+	}
+
+	// A missing file still gets an (empty) mesh, as constructing one
+	// directly would, so entities using it simply draw nothing
+	return mesh ? mesh : std::make_shared<Mesh>(path, this->geometryPool);
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetRegistry::LoadTexture(const std::wstring& path)
+{
+	this->report.Requests++;
+
+	std::wstring key = NormalizeAssetPath(path);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> texture;
+	if (FindLoaded(this->textures, key, texture))
+		return texture;
+
+	size_t pending = FindPending(this->pendingTextures, key);
+	if (pending < this->pendingTextures.size())
+	{
+		DecodedTexture decoded = this->pendingTextures[pending].Work.get();
+		texture = FinishTexture(decoded, key);
+		this->pendingTextures[pending].Future->Finish(texture);
+		this->pendingTextures.erase(this->pendingTextures.begin() + pending);
+		return texture;
+	}
+
+	DecodedTexture decoded = ReadTexture(path);
+	return FinishTexture(decoded, key);
+}
+
+// --------------------------------------------------------
+// A second request for a path that's still loading shares
+// the first one's future rather than starting over
+// --------------------------------------------------------
+std::shared_ptr<MeshFuture> AssetRegistry::LoadMeshAsync(const std::wstring& path)
+{
+	this->report.Requests++;
+
+	std::wstring key = NormalizeAssetPath(path);
+	std::shared_ptr<Mesh> mesh;
+	if (FindLoaded(this->meshes, key, mesh))
+	{
+		std::shared_ptr<MeshFuture> future = std::make_shared<MeshFuture>(mesh);
+		future->Finish(mesh);
+		return future;
+	}
+
+	size_t pending = FindPending(this->pendingMeshes, key);
+	if (pending < this->pendingMeshes.size())
+	{
+		this->report.PathHits++;
+		this->pendingMeshes[pending].Waiting++;
+		return this->pendingMeshes[pending].Future;
+	}
+
+	PendingMesh load;
+	load.Key = key;
+	load.Future = std::make_shared<MeshFuture>(GetPlaceholderMesh());
+	bool buildBvh = this->buildMeshBvhs;
+	load.Work = WorkerPool::GetInstance().Submit([path, buildBvh]() { return ReadMesh(path, buildBvh); });
+	this->pendingMeshes.push_back(std::move(load));
+	return this->pendingMeshes.back().Future;
+}
+
+std::shared_ptr<TextureFuture> AssetRegistry::LoadTextureAsync(const std::wstring& path, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> placeholder)
+{
+	this->report.Requests++;
+
+	std::wstring key = NormalizeAssetPath(path);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> texture;
+	if (FindLoaded(this->textures, key, texture))
+	{
+		std::shared_ptr<TextureFuture> future = std::make_shared<TextureFuture>(texture);
+		future->Finish(texture);
+		return future;
+	}
+
+	size_t pending = FindPending(this->pendingTextures, key);
+	if (pending < this->pendingTextures.size())
+	{
+		this->report.PathHits++;
+		this->pendingTextures[pending].Waiting++;
+		return this->pendingTextures[pending].Future;
+	}
+
+	if (!placeholder)
+	{
+		if (!this->placeholderTexture)
+			this->placeholderTexture = CreateSolidTexture(128, 128, 128, 255);
+		placeholder = this->placeholderTexture;
+	}
+
+	PendingTexture load;
+	load.Key = key;
+	load.Future = std::make_shared<TextureFuture>(placeholder);
+	load.Work = WorkerPool::GetInstance().Submit([path]() { return ReadTexture(path); });
+	this->pendingTextures.push_back(std::move(load));
+	return this->pendingTextures.back().Future;
+}
+
+// --------------------------------------------------------
+// Only polls, so a frame never waits on a worker
+// --------------------------------------------------------
+unsigned int AssetRegistry::Update()
+{
+	unsigned int finished = 0;
+
+	for (size_t i = 0; i < this->pendingMeshes.size();)
+	{
+		PendingMesh& pending = this->pendingMeshes[i];
+		if (pending.Work.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			i++;
+			continue;
+		}
+
+		LoadedMesh loaded = pending.Work.get();
+		std::shared_ptr<Mesh> mesh = FinishMesh(loaded, pending.Key);
+		if (mesh)
+			this->report.BytesSaved += pending.Waiting * loaded.Bytes;
+		pending.Future->Finish(mesh);
+		this->pendingMeshes.erase(this->pendingMeshes.begin() + i);
+		finished++;
+	}
+
+	for (size_t i = 0; i < this->pendingTextures.size();)
+	{
+		PendingTexture& pending = this->pendingTextures[i];
+		if (pending.Work.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			i++;
+			continue;
+		}
+
+		DecodedTexture decoded = pending.Work.get();
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> texture = FinishTexture(decoded, pending.Key);
+		if (texture)
+			this->report.BytesSaved += pending.Waiting * decoded.Bytes;
+		pending.Future->Finish(texture);
+		this->pendingTextures.erase(this->pendingTextures.begin() + i);
+		finished++;
+	}
+
+	return finished;
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetRegistry::CreateSolidTexture(unsigned char r, unsigned char g, unsigned char b, unsigned char a)
+{
+	unsigned char pixel[4] = { r, g, b, a };
+	return CreateTexture(1, 1, pixel);
+}
+
+unsigned int AssetRegistry::GetReferenceCount(const std::wstring& path)
+{
+	std::wstring key = NormalizeAssetPath(path);
+
+	auto mesh = this->meshes.FindPath(key);
+	if (mesh)
+		return CountReferences(mesh->Value);
+
+	auto texture = this->textures.FindPath(key);
+	if (texture)
+		return CountReferences(texture->Value);
+
+	return 0;
+}
+
+std::vector<AssetReferences> AssetRegistry::GetReferenceCounts()
+{
+	std::vector<AssetReferences> list;
+	ListReferences(this->meshes, list);
+	ListReferences(this->textures, list);
+	return list;
+}
+
+unsigned int AssetRegistry::EvictUnused()
+{
+	unsigned int evicted = Evict(this->meshes) + Evict(this->textures);
+	this->report.Evictions += evicted;
+	return evicted;
+}
+
+// --------------------------------------------------------
+// Worker side: everything short of the device.  The mesh
+// is parsed (or its cache mapped) and left staged, along
+// with its BVH if asked for.
+// --------------------------------------------------------
+AssetRegistry::LoadedMesh AssetRegistry::ReadMesh(const std::wstring& path, bool buildBvh)
+{
+	LoadedMesh loaded;
+	{
+		MappedFile source(path);
+		if (!source.IsOpen())
+			return loaded;
+
+		loaded.Hash = HashContents(source.GetData(), source.GetSize());
+		loaded.Bytes = source.GetSize();
+	}
+
+	loaded.Value = std::make_shared<Mesh>(path);
+	if (buildBvh)
+		loaded.Value->BuildBvh();
+	return loaded;
+}
+
+// --------------------------------------------------------
+// Worker side: hashes and decodes straight from the same
+// mapping, so the file is only read once
+// --------------------------------------------------------
+AssetRegistry::DecodedTexture AssetRegistry::ReadTexture(const std::wstring& path)
+{
+	DecodedTexture decoded;
+	MappedFile source(path);
+	if (!source.IsOpen())
+		return decoded;
+
+	decoded.Hash = HashContents(source.GetData(), source.GetSize());
+	decoded.Bytes = source.GetSize();
+	DecodeImage(source.GetData(), source.GetSize(), decoded.Width, decoded.Height, decoded.Pixels);
+	return decoded;
+}
+
+// --------------------------------------------------------
+// Main thread side.  Content that's already loaded under
+// another path skips the device work entirely.
+// --------------------------------------------------------
+std::shared_ptr<Mesh> AssetRegistry::FinishMesh(LoadedMesh& loaded, const std::wstring& key)
+{
+	if (!loaded.Value)
+		return 0;
+
+	std::shared_ptr<Mesh> mesh;
+	if (FindContent(this->meshes, key, loaded.Hash, loaded.Bytes, mesh))
+		return mesh;
+
+	if (!loaded.Value->Upload(this->geometryPool))
+		return 0;
+
+	Register(this->meshes, key, loaded.Hash, loaded.Bytes, loaded.Value);
+	return loaded.Value;
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetRegistry::FinishTexture(DecodedTexture& decoded, const std::wstring& key)
+{
+	if (decoded.Pixels.empty())
+		return 0;
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> texture;
+	if (FindContent(this->textures, key, decoded.Hash, decoded.Bytes, texture))
+		return texture;
+
+	texture = CreateTexture(decoded.Width, decoded.Height, decoded.Pixels.data());
+	if (!texture)
+		return 0;
+
+	Register(this->textures, key, decoded.Hash, decoded.Bytes, texture);
+	return texture;
+}
+
+// --------------------------------------------------------
+// A full mip chain generated from the top level.  UNORM,
+// not SRGB: the pixel shaders linearize albedo themselves.
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetRegistry::CreateTexture(unsigned int width, unsigned int height, const unsigned char* pixels)
+{
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = width;
+	desc.Height = height;
+	desc.MipLevels = 0;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;	// GenerateMips() renders into the lower levels
+	desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> view;
+	if (FAILED(this->device->CreateTexture2D(&desc, 0, texture.GetAddressOf())) ||
+		FAILED(this->device->CreateShaderResourceView(texture.Get(), 0, view.GetAddressOf())))
+		return 0;
+
+	this->context->UpdateSubresource(texture.Get(), 0, 0, pixels, width * 4, 0);
+	this->context->GenerateMips(view.Get());
+	return view;
+}
+
+// --------------------------------------------------------
+// A plain unit cube, built once, for meshes still loading
+// --------------------------------------------------------
+std::shared_ptr<Mesh> AssetRegistry::GetPlaceholderMesh()
+{
+	if (this->placeholderMesh)
+		return this->placeholderMesh;
+
+	// Each face: its normal, and the tangent that runs along U
+	const float faces[6][6] =
+	{
+		{  1, 0, 0,   0, 0, -1 },
+		{ -1, 0, 0,   0, 0,  1 },
+		{  0, 1, 0,   1, 0,  0 },
+		{  0,-1, 0,   1, 0,  0 },
+		{  0, 0, 1,  -1, 0,  0 },
+		{  0, 0,-1,   1, 0,  0 },
+	};
+	const float corners[4][2] = { { -1, 1 }, { 1, 1 }, { 1, -1 }, { -1, -1 } };
+
+	Vertex vertices[24];
+	unsigned int indices[36];
+	for (int face = 0; face < 6; face++)
+	{
+		DirectX::XMVECTOR normal = DirectX::XMVectorSet(faces[face][0], faces[face][1], faces[face][2], 0);
+		DirectX::XMVECTOR tangent = DirectX::XMVectorSet(faces[face][3], faces[face][4], faces[face][5], 0);
+		DirectX::XMVECTOR bitangent = DirectX::XMVector3Cross(normal, tangent);
+
+		for (int corner = 0; corner < 4; corner++)
+		{
+			Vertex& vertex = vertices[face * 4 + corner];
+			DirectX::XMVECTOR position = DirectX::XMVectorAdd(normal, DirectX::XMVectorAdd(
+				DirectX::XMVectorScale(tangent, corners[corner][0]),
+				DirectX::XMVectorScale(bitangent, corners[corner][1])));
+			DirectX::XMStoreFloat3(&vertex.Position, DirectX::XMVectorScale(position, 0.5f));
+			DirectX::XMStoreFloat3(&vertex.Normal, normal);
+			DirectX::XMStoreFloat4(&vertex.Tangent, DirectX::XMVectorSetW(tangent, 1.0f));
+			vertex.UV = DirectX::XMFLOAT2(corners[corner][0] * 0.5f + 0.5f, 0.5f - corners[corner][1] * 0.5f);
+		}
+
+		// Clockwise seen from outside
+		unsigned int base = face * 4;
+		unsigned int faceIndices[6] = { base, base + 1, base + 2, base, base + 2, base + 3 };
+		for (int i = 0; i < 6; i++)
+			indices[face * 6 + i] = faceIndices[i];
+	}
+
+	this->placeholderMesh = std::make_shared<Mesh>(vertices, 24, indices, 36, this->geometryPool);
+	return this->placeholderMesh;
+}
+
+template<typename Handle>
+bool AssetRegistry::FindLoaded(AssetTable<Handle>& table, const std::wstring& key, Handle& value)
+{
+	typename AssetTable<Handle>::Asset* asset = table.FindPath(key);
+	if (!asset)
+		return false;
+
+	this->report.PathHits++;
+	this->report.BytesSaved += asset->Bytes;
+	value = asset->Value;
+	return true;
+}
+
+// --------------------------------------------------------
+// Another path's asset with the same bytes, which this path
+// then leads to as well
+// --------------------------------------------------------
+template<typename Handle>
+bool AssetRegistry::FindContent(AssetTable<Handle>& table, const std::wstring& key, uint64_t hash, size_t bytes, Handle& value)
+{
+	typename AssetTable<Handle>::Asset* existing = table.FindContent(key, hash, bytes);
+	if (!existing)
+		return false;
+
+	this->report.ContentHits++;
+	this->report.BytesSaved += bytes;
+	value = existing->Value;
+	return true;
+}
+
+template<typename Handle>
+void AssetRegistry::Register(AssetTable<Handle>& table, const std::wstring& key, uint64_t hash, size_t bytes, Handle value)
+{
+	table.Add(key, hash, bytes, value);
+	this->report.Loads++;
+	this->report.BytesLoaded += bytes;
+}
+
+// Index of the load underway for this path, or the count if there isn't one
+template<typename Pending>
+size_t AssetRegistry::FindPending(std::vector<Pending>& pending, const std::wstring& key)
+{
+	size_t i = 0;
+	while (i < pending.size() && pending[i].Key != key)
+		i++;
+	return i;
+}
+
+// Appends every asset in the table, as AssetTable::List() orders them
+template<typename Handle>
+void AssetRegistry::ListReferences(AssetTable<Handle>& table, std::vector<AssetReferences>& list)
+{
+	for (const auto& asset : table.List())
+		list.push_back({ asset.first, CountReferences(asset.second->Value) });
+}
+
+template<typename Handle>
+unsigned int AssetRegistry::Evict(AssetTable<Handle>& table)
+{
+	return table.Evict([](const Handle& value) { return CountReferences(value) == 0; });
+}
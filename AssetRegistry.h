@@ -0,0 +1,160 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Mesh.h"
+#include "GeometryPool.h"
+#include "AssetFuture.h"
+#include "AssetTable.h"
+
+// What the registry has saved so far
+struct AssetRegistryReport
+{
+	unsigned int Requests = 0;
+	unsigned int PathHits = 0;		// The same file, asked for again
+	unsigned int ContentHits = 0;	// A different file with bytes already loaded
+	unsigned int Loads = 0;
+	unsigned int Evictions = 0;
+	size_t BytesLoaded = 0;			// Source bytes actually decoded
+	size_t BytesSaved = 0;			// Source bytes the hits didn't read or decode again
+};
+
+// One loaded asset and the handles to it held outside the registry
+struct AssetReferences
+{
+	std::wstring Path;				// Normalized; the first, if several lead to it
+	unsigned int References;
+};
+
+// --------------------------------------------------------
+// Loads each mesh and texture once and hands out shared
+// handles to it
+//
+// - Keyed by normalized path first, so asking for a file
+//   again is a single lookup; a new path is then hashed
+//   (see HashContents()) and matched against everything
+//   loaded, so copies of a file under other names are free
+//   as well
+// - An asset's reference count is the handles held outside
+//   the registry; EvictUnused() drops the assets nobody
+//   else holds anymore
+// - The Async loads read, decode and parse on the
+//   WorkerPool and return a future right away.  Only the
+//   device work (uploading a mesh, creating a texture) is
+//   left for Update() on the main thread.
+// --------------------------------------------------------
+class AssetRegistry
+{
+public:
+	AssetRegistry(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, std::shared_ptr<GeometryPool> geometryPool);
+	~AssetRegistry();
+
+	// An unreadable file gives an empty texture handle, or a mesh with no
+	// geometry.  Either waits for the file if it's already loading.
+	std::shared_ptr<Mesh> LoadMesh(const std::wstring& path);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> LoadTexture(const std::wstring& path);
+
+	// Futures that stand in a placeholder until the asset is ready.  A null
+	// texture placeholder means plain mid grey.
+	std::shared_ptr<MeshFuture> LoadMeshAsync(const std::wstring& path);
+	std::shared_ptr<TextureFuture> LoadTextureAsync(const std::wstring& path, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> placeholder = 0);
+
+	// Finishes every asset the workers are done with, returning how many.
+	// Call it once a frame, on the thread that owns the device context.
+	unsigned int Update();
+	unsigned int GetPendingCount() { return (unsigned int)(pendingMeshes.size() + pendingTextures.size()); }
+
+	// Meshes loaded from here on also get a BVH for raycasts, built on the
+	// worker along with the rest of the mesh
+	void SetBuildMeshBvhs(bool build) { buildMeshBvhs = build; }
+
+	// A 1x1 texture of one color, for placeholders
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateSolidTexture(unsigned char r, unsigned char g, unsigned char b, unsigned char a);
+
+	// Handles to an asset held outside the registry (0 if it isn't loaded)
+	unsigned int GetReferenceCount(const std::wstring& path);
+
+	// The same for every loaded asset, meshes first, each sorted by path
+	std::vector<AssetReferences> GetReferenceCounts();
+
+	// Forgets every asset with no references, returning how many.  Their
+	// memory goes once the registry's own handle was the last one.
+	unsigned int EvictUnused();
+
+	unsigned int GetAssetCount() { return meshes.GetAssetCount() + textures.GetAssetCount(); }
+	AssetRegistryReport GetReport() { return report; }
+
+private:
+	// What a worker hands back: the file's hash and size, and the asset
+	// with everything but its device work done
+	struct LoadedMesh
+	{
+		uint64_t Hash = 0;
+		size_t Bytes = 0;
+		std::shared_ptr<Mesh> Value;	// Staged, not uploaded; null if the file couldn't be read
+	};
+
+	struct DecodedTexture
+	{
+		uint64_t Hash = 0;
+		size_t Bytes = 0;
+		unsigned int Width = 0;
+		unsigned int Height = 0;
+		std::vector<unsigned char> Pixels;	// RGBA8, empty if decoding failed
+	};
+
+	template<typename Loaded, typename Handle>
+	struct PendingAsset
+	{
+		std::wstring Key;
+		std::future<Loaded> Work;
+		std::shared_ptr<AssetFuture<Handle>> Future;
+		unsigned int Waiting = 0;	// Further requests for the path while it loaded
+	};
+
+	typedef PendingAsset<LoadedMesh, std::shared_ptr<Mesh>> PendingMesh;
+	typedef PendingAsset<DecodedTexture, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> PendingTexture;
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	std::shared_ptr<GeometryPool> geometryPool;
+
+	AssetTable<std::shared_ptr<Mesh>> meshes;
+	AssetTable<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textures;
+	std::vector<PendingMesh> pendingMeshes;
+	std::vector<PendingTexture> pendingTextures;
+	std::shared_ptr<Mesh> placeholderMesh;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> placeholderTexture;
+	AssetRegistryReport report;
+	bool buildMeshBvhs = false;
+
+	static LoadedMesh ReadMesh(const std::wstring& path, bool buildBvh);
+	static DecodedTexture ReadTexture(const std::wstring& path);
+	std::shared_ptr<Mesh> FinishMesh(LoadedMesh& loaded, const std::wstring& key);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> FinishTexture(DecodedTexture& decoded, const std::wstring& key);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateTexture(unsigned int width, unsigned int height, const unsigned char* pixels);
+	std::shared_ptr<Mesh> GetPlaceholderMesh();
+
+	template<typename Handle>
+	bool FindLoaded(AssetTable<Handle>& table, const std::wstring& key, Handle& value);
+
+	template<typename Handle>
+	bool FindContent(AssetTable<Handle>& table, const std::wstring& key, uint64_t hash, size_t bytes, Handle& value);
+
+	template<typename Handle>
+	void Register(AssetTable<Handle>& table, const std::wstring& key, uint64_t hash, size_t bytes, Handle value);
+
+	template<typename Pending>
+	size_t FindPending(std::vector<Pending>& pending, const std::wstring& key);
+
+	template<typename Handle>
+	unsigned int Evict(AssetTable<Handle>& table);
+
+	template<typename Handle>
+	void ListReferences(AssetTable<Handle>& table, std::vector<AssetReferences>& list);
+};
@@ -0,0 +1,48 @@
+#include "AssetTable.h"
+
+#include <cwctype>
+
+// --------------------------------------------------------
+// Splits on either separator and rebuilds the path with
+// backslashes, dropping "." and resolving ".." as it goes.
+// A ".." with nothing before it to cancel is kept.
+// --------------------------------------------------------
+std::wstring NormalizeAssetPath(const std::wstring& path)
+{
+	size_t leadingSeparators = 0;
+	while (leadingSeparators < path.size() && (path[leadingSeparators] == L'\\' || path[leadingSeparators] == L'/'))
+		leadingSeparators++;
+
+	std::vector<std::wstring> segments;
+	std::wstring segment;
+	for (size_t i = leadingSeparators; i <= path.size(); i++)
+	{
+		if (i < path.size() && path[i] != L'\\' && path[i] != L'/')
+		{
+			segment += (wchar_t)std::towlower(path[i]);
+			continue;
+		}
+
+		if (segment == L"..")
+		{
+			if (!segments.empty() && segments.back() != L"..")
+				segments.pop_back();
+			else
+				segments.push_back(segment);
+		}
+		else if (!segment.empty() && segment != L".")
+		{
+			segments.push_back(segment);
+		}
+		segment.clear();
+	}
+
+	std::wstring normalized(leadingSeparators, L'\\');
+	for (size_t i = 0; i < segments.size(); i++)
+	{
+		if (i > 0)
+			normalized += L'\\';
+		normalized += segments[i];
+	}
+	return normalized;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Lower case, one kind of separator and no "." or ".." segments, so
+// every spelling of a file's path maps to the same key
+std::wstring NormalizeAssetPath(const std::wstring& path);
+
+// --------------------------------------------------------
+// The loaded assets of one kind, as AssetRegistry keeps
+// them: normalized paths lead to a hash of the file's bytes,
+// and the hash to the one asset made from them
+//
+// - Several paths can lead to the same asset, once
+//   FindContent() has matched a new path's bytes
+// - Evict() drops an asset together with every path to it
+// - Touches no device; the registry does the loading and
+//   keeps the counts
+// --------------------------------------------------------
+template<typename Handle>
+class AssetTable
+{
+public:
+	struct Asset
+	{
+		Handle Value;
+		size_t Bytes;
+	};
+
+	// The asset a path leads to, or null
+	Asset* FindPath(const std::wstring& key)
+	{
+		auto known = paths.find(key);
+		return known != paths.end() ? &assets[known->second] : 0;
+	}
+
+	// --------------------------------------------------------
+	// An asset already made from these bytes under another
+	// path, or null.  The path then leads to it as well.
+	// --------------------------------------------------------
+	Asset* FindContent(const std::wstring& key, uint64_t hash, size_t bytes)
+	{
+		auto existing = assets.find(hash);
+		if (existing == assets.end() || existing->second.Bytes != bytes)
+			return 0;
+
+		paths[key] = hash;
+		return &existing->second;
+	}
+
+	void Add(const std::wstring& key, uint64_t hash, size_t bytes, Handle value)
+	{
+		paths[key] = hash;
+		assets[hash] = { value, bytes };
+	}
+
+	// --------------------------------------------------------
+	// Drops every asset isUnused(handle) is true for, along
+	// with every path that led to it, returning how many
+	// --------------------------------------------------------
+	template<typename IsUnused>
+	unsigned int Evict(IsUnused isUnused)
+	{
+		unsigned int evicted = 0;
+		for (auto asset = assets.begin(); asset != assets.end();)
+		{
+			if (!isUnused(asset->second.Value))
+			{
+				++asset;
+				continue;
+			}
+
+			for (auto path = paths.begin(); path != paths.end();)
+			{
+				if (path->second == asset->first)
+					path = paths.erase(path);
+				else
+					++path;
+			}
+
+			asset = assets.erase(asset);
+			evicted++;
+		}
+		return evicted;
+	}
+
+	// Every asset under the first of the paths that lead to it, in path order
+	std::vector<std::pair<std::wstring, Asset*>> List()
+	{
+		std::unordered_map<uint64_t, const std::wstring*> firstPaths;
+		for (const auto& path : paths)
+		{
+			const std::wstring*& first = firstPaths[path.second];
+			if (!first || path.first < *first)
+				first = &path.first;
+		}
+
+		std::vector<std::pair<std::wstring, Asset*>> list;
+		for (const auto& asset : firstPaths)
+			list.push_back({ *asset.second, &assets[asset.first] });
+		std::sort(list.begin(), list.end(), [](const std::pair<std::wstring, Asset*>& a, const std::pair<std::wstring, Asset*>& b) { return a.first < b.first; });
+		return list;
+	}
+
+	unsigned int GetAssetCount() { return (unsigned int)assets.size(); }
+	unsigned int GetPathCount() { return (unsigned int)paths.size(); }
+
+private:
+	std::unordered_map<std::wstring, uint64_t> paths;	// Normalized path to content hash
+	std::unordered_map<uint64_t, Asset> assets;			// Content hash to the loaded asset
+};
@@ -10,17 +10,15 @@ SamplerState BasicSampler	: register(s0);
 SamplerState ClampSampler	: register(s1);
 SamplerComparisonState ShadowSampler : register(s2);
 
-cbuffer ExternalData : register(b0)
+// Set by the Material; cameraPosition and lights are in PerFrame
+cbuffer PerMaterial : register(b5)
 {
 	float4 colorTint;
 	// float roughness;
-	float3 cameraPosition;
 	int gammaCorrection;
 	int usingAlbedo;
 	int usingSpecularMap;
 	float3 ambient;
-
-	Light lights[5]; // 3 directional, 2 point IN THAT ORDER; MUST BE EXACT
 }
 
 float4 main(VertexToPixel input) : SV_TARGET
@@ -35,7 +33,7 @@ float4 main(VertexToPixel input) : SV_TARGET
 	float shadowAmount = ShadowMap.SampleCmpLevelZero(ShadowSampler, shadowUV, distToLight).r;
 
 	input.normal = normalize(input.normal);
-	input.tangent = normalize(input.tangent);
+	input.tangent.xyz = normalize(input.tangent.xyz);
 
 	// Specular Reflections (Task 7)
 	float3 viewVector = normalize(cameraPosition - input.worldPosition); // V
@@ -1,8 +1,13 @@
 #include "ShaderIncludes.hlsli"
 
-cbuffer ExternalData : register(b0)
+// Set by the Material
+cbuffer PerMaterial : register(b5)
 {
 	float4 colorTint;
+}
+
+cbuffer ExternalData : register(b0)
+{
 	float time;
 	float timer;
 }
@@ -1,5 +1,6 @@
 #include "DXCore.h"
 #include "Input.h"
+#include "WorkerPool.h"
 
 #include <dxgi1_5.h>
 #include <WindowsX.h>
@@ -84,6 +85,10 @@ DXCore::~DXCore()
 
 	// Delete input manager singleton
 	delete& Input::GetInstance();
+
+	// And the worker pool, which has to outlive Game, since its
+	// AssetRegistry may have had loads running on the pool's threads
+	delete& WorkerPool::GetInstance();
 }
 
 // --------------------------------------------------------
@@ -70,7 +70,11 @@ void Game::Init()
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
 	LoadShaders();
+	this->dynamicConstantsSupported = ISimpleShader::EnableDynamicConstants(this->device, this->context);
+	this->dynamicConstants = this->dynamicConstantsSupported;
 
+	this->geometryPool = std::make_shared<GeometryPool>(this->device, this->context);
+	this->assets = std::make_shared<AssetRegistry>(this->device, this->context, this->geometryPool);
 	CreateGeometry();
 	
 	// Set initial graphics API state
@@ -235,12 +239,21 @@ void Game::LoadShaders()
 	}
 	*/
 
+	// These are set through SimpleSharedBuffers instead of each shader's
+	// own copy, so they're uploaded once however many shaders read them
+	ISimpleShader::AddExternalBuffer("PerFrame");
+	ISimpleShader::AddExternalBuffer("PerPass");
+	ISimpleShader::AddExternalBuffer("PerObject");
+	ISimpleShader::AddExternalBuffer("PerMaterial");
+
 	this->vertexShader = std::make_shared<SimpleVertexShader>(this->device, this->context, FixPath(L"VertexShader.cso").c_str());
+	this->compactVertexShader = std::make_shared<SimpleVertexShader>(this->device, this->context, FixPath(L"VertexShaderCompact.cso").c_str());
 	this->pixelShader = std::make_shared<SimplePixelShader>(this->device, this->context, FixPath(L"PixelShader.cso").c_str());
 	this->customPShader = std::make_shared<SimplePixelShader>(this->device, this->context, FixPath(L"CustomPS.cso").c_str());
 
 	// Assignment 9
 	this->skyVertexShader = std::make_shared<SimpleVertexShader>(this->device, this->context, FixPath(L"SkyVertexShader.cso").c_str());
+	this->skyCompactVertexShader = std::make_shared<SimpleVertexShader>(this->device, this->context, FixPath(L"SkyVertexShaderCompact.cso").c_str());
 	this->skyPixelShader = std::make_shared<SimplePixelShader>(this->device, this->context, FixPath(L"SkyPixelShader.cso").c_str());
 
 	// Assignment 10
@@ -248,9 +261,18 @@ void Game::LoadShaders()
 
 	// Assignment 11
 	this->shadowVertexShader = std::make_shared<SimpleVertexShader>(this->device, this->context, FixPath(L"ShadowVertexShader.cso").c_str());
+	this->shadowCompactVertexShader = std::make_shared<SimpleVertexShader>(this->device, this->context, FixPath(L"ShadowVertexShaderCompact.cso").c_str());
 
 	// Assignment 12
 	this->celShadedPixelShader = std::make_shared<SimplePixelShader>(this->device, this->context, FixPath(L"CelShadingPixelShader.cso").c_str());
+	this->insideOutVertexShader = std::make_shared<SimpleVertexShader>(this->device, this->context, FixPath(L"InsideOutVertexShader.cso").c_str());
+	this->insideOutCompactVertexShader = std::make_shared<SimpleVertexShader>(this->device, this->context, FixPath(L"InsideOutVertexShaderCompact.cso").c_str());
+	this->solidColorPixelShader = std::make_shared<SimplePixelShader>(this->device, this->context, FixPath(L"SolidColorPixelShader.cso").c_str());
+
+	// Any shader that reads them has their layouts
+	this->perFrameBuffer = std::make_shared<SimpleSharedBuffer>(this->pixelShader, "PerFrame");
+	this->shadowPassBuffer = std::make_shared<SimpleSharedBuffer>(this->vertexShader, "PerPass");
+	this->mainPassBuffer = std::make_shared<SimpleSharedBuffer>(this->vertexShader, "PerPass");
 }
 
 
@@ -357,30 +379,34 @@ void Game::CreateGeometry()
 	// Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> asphaltSpecularSRV;
 	// CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/brokentiles.png").c_str(), 0, tileSRV.GetAddressOf());
 	// CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/brokentiles_specular.png").c_str(), 0, tileSpecularSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/metalfloor_albedo.png").c_str(), 0, metalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/metalfloor_specular.png").c_str(), 0, metalSpecularSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/metalfloor_normals.png").c_str(), 0, metalNormalSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/cobblestone_albedo.png").c_str(), 0, cobblestoneSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/cobblestone_roughness.png").c_str(), 0, cobblestoneSpecularSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/cobblestone_normals.png").c_str(), 0, cobblestoneNormalSRV.GetAddressOf());
+	// Everything loads on the worker pool, standing in a placeholder until
+	// it's ready: flat for normal maps, black for metalness and grey otherwise
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> flatNormal = this->assets->CreateSolidTexture(128, 128, 255, 255);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> black = this->assets->CreateSolidTexture(0, 0, 0, 255);
+	this->metalSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/metalfloor_albedo.png"));
+	this->metalSpecularSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/metalfloor_specular.png"));
+	this->metalNormalSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/metalfloor_normals.png"), flatNormal);
+	this->cobblestoneSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/cobblestone_albedo.png"));
+	this->cobblestoneSpecularSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/cobblestone_roughness.png"));
+	this->cobblestoneNormalSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/cobblestone_normals.png"), flatNormal);
 
 	// Assignment 10
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/metalfloor_albedo.png").c_str(), 0, metalAlbedoSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/metalfloor_roughness.png").c_str(), 0, metalRoughnessSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/metalfloor_metalness.png").c_str(), 0, metalMetalnessSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/cobblestone_metal.png").c_str(), 0, cobblestoneMetalnessSRV.GetAddressOf());
+	this->metalAlbedoSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/metalfloor_albedo.png"));
+	this->metalRoughnessSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/metalfloor_roughness.png"));
+	this->metalMetalnessSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/metalfloor_metalness.png"), black);
+	this->cobblestoneMetalnessSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/cobblestone_metal.png"), black);
 
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/woodfloor_albedo.png").c_str(), 0, woodAlbedoSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/woodfloor_roughness.png").c_str(), 0, woodRoughnessSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/woodfloor_normals.png").c_str(), 0, woodNormalSRV.GetAddressOf());
+	this->woodAlbedoSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/woodfloor_albedo.png"));
+	this->woodRoughnessSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/woodfloor_roughness.png"));
+	this->woodNormalSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/woodfloor_normals.png"), flatNormal);
 
 	// Assignment 12
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/black.png").c_str(), 0, blackSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/red.png").c_str(), 0, redSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/flat_normals.png").c_str(), 0, flatNormalsSRV.GetAddressOf());
+	this->blackSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/black.png"));
+	this->redSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/red.png"));
+	this->flatNormalsSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/flat_normals.png"), flatNormal);
 
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/toonRamp1.png").c_str(), 0, celRampSRV.GetAddressOf());
-	CreateWICTextureFromFile(device.Get(), context.Get(), FixPath(L"../../Assets/Textures/toonRampSpecular.png").c_str(), 0, celRampSpecularSRV.GetAddressOf());
+	this->celRampSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/toonRamp1.png"));
+	this->celRampSpecularSRV = this->assets->LoadTextureAsync(FixPath(L"../../Assets/Textures/toonRampSpecular.png"));
 
 	// AddressU, V, W should be something other than 0, but within 0 - 1 range
 
@@ -471,6 +497,11 @@ void Game::CreateGeometry()
 	materials[9]->AddTextureSRV("NormalMap", this->flatNormalsSRV);
 	materials[9]->AddTextureSRV("RoughnessMap", this->blackSRV);
 
+	// Every material above uses the standard vertex shader, so they all
+	// share its compact variant for meshes using CompactVertex
+	for (std::shared_ptr<Material>& m : materials)
+		m->SetCompactVertexShader(this->compactVertexShader);
+
 	/*
 	// colors for meshes
 	XMFLOAT4 red = XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f);
@@ -540,13 +571,16 @@ void Game::CreateGeometry()
 	entities.push_back(entity5);
 	*/
 
-	meshes[0] = std::make_shared<Mesh>(FixPath(L"../../Assets/Models/quad.obj").c_str(), this->device);
-	meshes[1] = std::make_shared<Mesh>(FixPath(L"../../Assets/Models/torus.obj").c_str(), this->device);
-	meshes[2] = std::make_shared<Mesh>(FixPath(L"../../Assets/Models/helix.obj").c_str(), this->device);
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/sphere.obj").c_str(), this->device));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/cylinder.obj").c_str(), this->device));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/cube.obj").c_str(), this->device));
-	meshes.push_back(std::make_shared<Mesh>(FixPath(L"../../Assets/Models/quad_double_sided.obj").c_str(), this->device));
+	// Entities can be picked with the mouse, which needs a BVH per mesh
+	this->assets->SetBuildMeshBvhs(true);
+
+	meshes[0] = this->assets->LoadMeshAsync(FixPath(L"../../Assets/Models/quad.obj"));
+	meshes[1] = this->assets->LoadMeshAsync(FixPath(L"../../Assets/Models/torus.obj"));
+	meshes[2] = this->assets->LoadMeshAsync(FixPath(L"../../Assets/Models/helix.obj"));
+	meshes.push_back(this->assets->LoadMeshAsync(FixPath(L"../../Assets/Models/sphere.obj")));
+	meshes.push_back(this->assets->LoadMeshAsync(FixPath(L"../../Assets/Models/cylinder.obj")));
+	meshes.push_back(this->assets->LoadMeshAsync(FixPath(L"../../Assets/Models/cube.obj")));
+	meshes.push_back(this->assets->LoadMeshAsync(FixPath(L"../../Assets/Models/quad_double_sided.obj")));
 
 
 	std::shared_ptr<GameEntity> entity1 = std::make_shared<GameEntity>(meshes[0], materials[4]);
@@ -580,8 +614,8 @@ void Game::CreateGeometry()
 	entities.push_back(floor);
 
 	// Assignment 9
-	this->skyMesh = std::make_shared<Mesh>(FixPath(L"../../Assets/Models/cube.obj").c_str(), this->device);
-	this->sky = std::make_shared<Sky>(skyMesh, this->samplerState, this->device, this->context, this->skyPixelShader, this->skyVertexShader,
+	this->skyMesh = this->assets->LoadMeshAsync(FixPath(L"../../Assets/Models/cube.obj")); // Shared with meshes[5]
+	this->sky = std::make_shared<Sky>(skyMesh->Get(), this->samplerState, this->device, this->context, this->skyPixelShader, this->skyVertexShader, this->skyCompactVertexShader,
 		FixPath(L"../../Assets/Textures/Clouds Pink/right.png").c_str(), FixPath(L"../../Assets/Textures/Clouds Pink/left.png").c_str(), 
 		FixPath(L"../../Assets/Textures/Clouds Pink/up.png").c_str(), FixPath(L"../../Assets/Textures/Clouds Pink/down.png").c_str(),
 		FixPath(L"../../Assets/Textures/Clouds Pink/front.png").c_str(), FixPath(L"../../Assets/Textures/Clouds Pink/back.png").c_str());
@@ -604,11 +638,52 @@ void Game::OnResize()
 	}
 }
 
+// --------------------------------------------------------
+// Casts a ray from the active camera through the cursor and
+// selects the closest entity it hits, or none at all
+// --------------------------------------------------------
+void Game::PickEntity(int mouseX, int mouseY)
+{
+	std::shared_ptr<Camera> camera = this->cameras[this->activeCamera];
+	XMFLOAT4X4 view = camera->GetView();
+	XMFLOAT4X4 projection = camera->GetProjection();
+	XMMATRIX screenToWorld = XMMatrixInverse(0, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+
+	// The cursor on the near and far planes
+	float x = mouseX * 2.0f / this->windowWidth - 1.0f;
+	float y = 1.0f - mouseY * 2.0f / this->windowHeight;
+	XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(x, y, 0.0f, 1.0f), screenToWorld);
+	XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(x, y, 1.0f, 1.0f), screenToWorld);
+
+	XMFLOAT3 origin;
+	XMFLOAT3 direction;
+	XMStoreFloat3(&origin, nearPoint);
+	XMStoreFloat3(&direction, XMVector3Normalize(farPoint - nearPoint));
+
+	// Each hit shortens the ray for the entities after it
+	this->selectedEntity = -1;
+	this->selectionHit = RayHit();
+	for (int i = 0; i < entities.size(); i++)
+	{
+		if (entities[i]->Raycast(origin, direction, FLT_MAX, this->selectionHit))
+			this->selectedEntity = i;
+	}
+	this->selectionChanged = true;
+}
+
 // --------------------------------------------------------
 // Update your game here - user input, move objects, AI, etc.
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
+	// Hand whatever finished loading to the entities waiting on it
+	this->assets->Update();
+	if (this->skyMesh && this->skyMesh->IsReady())
+	{
+		this->sky->SetMesh(this->skyMesh->Get());
+		this->skyMesh.reset();
+	}
+
 	// feed fresh input data to ImGui
 	ImGuiIO& io = ImGui::GetIO();
 	io.DeltaTime = deltaTime;
@@ -625,6 +700,9 @@ void Game::Update(float deltaTime, float totalTime)
 	input.SetKeyboardCapture(io.WantCaptureKeyboard);
 	input.SetMouseCapture(io.WantCaptureMouse);
 
+	if (input.MouseRightPress())
+		PickEntity(input.GetMouseX(), input.GetMouseY());
+
 	// show demo window
 	ImGui::ShowDemoWindow();
 
@@ -645,8 +723,104 @@ void Game::Update(float deltaTime, float totalTime)
 	// only one tint for now. will change all meshes
 	ImGui::ColorEdit4("Color Tint", &this->colorTint.x);
 
+	if (ImGui::CollapsingHeader("Assets"))
+	{
+		AssetRegistryReport report = this->assets->GetReport();
+		ImGui::Text("%u assets loaded from %u requests", this->assets->GetAssetCount(), report.Requests);
+		ImGui::Text("Repeated: %u by path, %u by content", report.PathHits, report.ContentHits);
+		ImGui::Text("Source bytes: %zu loaded, %zu saved", report.BytesLoaded, report.BytesSaved);
+		ImGui::Text("%u still loading", this->assets->GetPendingCount());
+		if (ImGui::TreeNode("References"))
+		{
+			// Just the file names, which are plain ASCII for everything in Assets
+			for (const AssetReferences& asset : this->assets->GetReferenceCounts())
+			{
+				std::string name;
+				for (size_t c = asset.Path.find_last_of(L'\\') + 1; c < asset.Path.size(); c++)
+					name += asset.Path[c] < 128 ? (char)asset.Path[c] : '?';
+				ImGui::BulletText("%s: %u", name.c_str(), asset.References);
+			}
+			ImGui::TreePop();
+		}
+		if (ImGui::Button("Evict unused"))
+			this->assets->EvictUnused();
+		ImGui::SameLine();
+		ImGui::Text("%u evicted", report.Evictions);
+	}
+
 	if (ImGui::CollapsingHeader("Meshes"))
 	{
+		// Index memory across all meshes, against what 32-bit indices would need
+		unsigned int indexBytes = 0;
+		unsigned int fullIndexBytes = 0;
+		for (std::shared_ptr<MeshFuture>& future : meshes)
+		{
+			if (!future->IsReady())
+				continue;
+
+			std::shared_ptr<Mesh> mesh = future->Get();
+			indexBytes += mesh->GetIndexBufferBytes();
+			const MeshLod& lastLod = mesh->GetLods().back();
+			fullIndexBytes += (lastLod.StartIndex + lastLod.IndexCount) * sizeof(unsigned int);
+		}
+		ImGui::Text("Index memory: %u bytes (%u with 32-bit indices)", indexBytes, fullIndexBytes);
+
+		// Pool occupancy, and how often consecutive draws shared its buffers
+		std::vector<GeometryPoolBufferStats> vertexPools;
+		std::vector<GeometryPoolBufferStats> indexPools;
+		this->geometryPool->GetStats(vertexPools, indexPools);
+		for (const GeometryPoolBufferStats& pool : vertexPools)
+		{
+			ImGui::Text("Vertex pool (%u-byte stride): %u / %u vertices, %u free ranges, fragmentation %.2f",
+				pool.ElementSize, pool.Used, pool.Capacity, pool.FreeRanges, pool.Fragmentation);
+		}
+		for (const GeometryPoolBufferStats& pool : indexPools)
+		{
+			if (pool.Capacity > 0)
+				ImGui::Text("Index pool (%u-bit): %u / %u indices, %u free ranges, fragmentation %.2f",
+					pool.ElementSize * 8, pool.Used, pool.Capacity, pool.FreeRanges, pool.Fragmentation);
+		}
+		ImGui::Text("Input assembler binds last frame: %u (%u skipped)",
+			this->geometryPool->GetBindCount(), this->geometryPool->GetSkippedBindCount());
+		const SimpleShaderUploadStats& uploads = ISimpleShader::GetUploadStats();
+		ImGui::Text("Constant buffer uploads last frame: %u, %u bytes (%u unchanged skipped, %u bytes)",
+			uploads.BuffersUploaded, (unsigned int)uploads.BytesUploaded, uploads.BuffersSkipped, (unsigned int)uploads.BytesSkipped);
+		if (this->dynamicConstantsSupported)
+		{
+			if (ImGui::Checkbox("Dynamic constant buffer", &this->dynamicConstants))
+			{
+				if (this->dynamicConstants)
+					ISimpleShader::EnableDynamicConstants(this->device, this->context);
+				else
+					ISimpleShader::DisableDynamicConstants();
+			}
+			if (this->dynamicConstants)
+			{
+				const ConstantAllocatorStats& slices = ISimpleShader::GetDynamicConstantStats();
+				ImGui::Text("Slices last frame: %u, %u of %u KB (%u discards, %u didn't fit)",
+					slices.Allocations, slices.BytesAllocated / 1024, ISimpleShader::GetDynamicConstantCapacity() / 1024, slices.Discards, slices.Overflows);
+			}
+		}
+		else
+		{
+			ImGui::Text("Dynamic constant buffer: needs D3D 11.1 constant buffer offsets");
+		}
+
+		ImGui::Checkbox("Meshlet culling", &this->meshletCulling);
+		if (this->meshletCulling)
+		{
+			ImGui::Text("Triangles rejected: %.1f%% (%u outside frustum, %u back-facing of %u)",
+				this->meshletCullingStats.GetRejectedShare() * 100.0f,
+				this->meshletCullingStats.TrianglesOutsideFrustum,
+				this->meshletCullingStats.TrianglesBackFacing,
+				this->meshletCullingStats.TrianglesTested);
+			ImGui::Text("Draw calls: %u", this->meshletCullingStats.DrawCalls);
+		}
+
+		ImGui::Checkbox("Automatic LOD", &this->automaticLod);
+		if (this->automaticLod)
+			ImGui::SliderFloat("LOD error (pixels)", &this->lodPixelError, 0.25f, 16.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+
 		// creates color/offset options for each mesh
 		// loops for each mesh
 		for (int i = 0; i < meshes.size(); i++)
@@ -654,11 +828,48 @@ void Game::Update(float deltaTime, float totalTime)
 			// unique labels are important to ensure only the individual editor is being changed
 			ImGui::PushID(i);
 
-			if (ImGui::TreeNode("Mesh Node", "Mesh #%i", i + 1))
+			if (ImGui::TreeNode("Mesh Node", "Mesh #%i%s", i + 1, meshes[i]->IsReady() ? "" : " (loading)"))
 			{
+				std::shared_ptr<Mesh> mesh = meshes[i]->Get();
 				// removed individual tint edit temporarily
 				// ImGui::ColorEdit4("Color Tint", &this->colorTints[i].x);
-				ImGui::Text("%d indices", meshes[i]->GetIndexCount());
+				ImGui::Text("%d indices", mesh->GetIndexCount());
+				ImGui::Text("%u index bytes (%s)", mesh->GetIndexBufferBytes(),
+					mesh->GetIndexFormat() == DXGI_FORMAT_R16_UINT ? "16-bit" : "32-bit");
+				MeshOptimizationStats stats = mesh->GetOptimizationStats();
+				ImGui::Text(mesh->IsLoadedFromCache() ? "Loaded from binary cache" : "Built from source");
+				ImGui::Text("%d vertices (%.2fx fewer after welding, %u split at mirror seams)", mesh->GetVertexCount(), stats.Weld.GetReductionRatio(), stats.MirroredVertexSplits);
+				ImGui::Text("ACMR %.3f -> %.3f", stats.CacheBefore.GetACMR(), stats.CacheAfter.GetACMR());
+				ImGui::Text("ATVR %.3f -> %.3f", stats.CacheBefore.GetATVR(), stats.CacheAfter.GetATVR());
+				ImGui::Text("Overdraw %.3f -> %.3f", stats.OverdrawBefore.GetOverdraw(), stats.OverdrawAfter.GetOverdraw());
+				ImGui::Text("Overfetch %.3f -> %.3f", stats.FetchBefore.GetOverfetch(), stats.FetchAfter.GetOverfetch());
+				const DirectX::BoundingBox& box = mesh->GetBoundingBox();
+				const DirectX::BoundingSphere& sphere = mesh->GetBoundingSphere();
+				ImGui::Text("Bounds: %.2f x %.2f x %.2f box, sphere radius %.2f", box.Extents.x * 2, box.Extents.y * 2, box.Extents.z * 2, sphere.Radius);
+				ImGui::Text("%u meshlets", (unsigned int)mesh->GetMeshlets().size());
+				if (mesh->HasPositionStream())
+					ImGui::Text("Shadow pass fetches %u of %u bytes per vertex (position stream)",
+						mesh->GetVertexLayout() == VertexLayout::Compact ? (unsigned int)sizeof(CompactVertex::Position) : (unsigned int)sizeof(Vertex::Position),
+						mesh->GetVertexLayout() == VertexLayout::Compact ? (unsigned int)sizeof(CompactVertex) : (unsigned int)sizeof(Vertex));
+
+				const std::vector<MeshLod>& lods = mesh->GetLods();
+				for (unsigned int l = 0; l < lods.size(); l++)
+					ImGui::BulletText("LOD %u: %u triangles, error %.4f", l, lods[l].IndexCount / 3, lods[l].Error);
+
+				const std::vector<MeshSubmesh>& submeshes = mesh->GetSubmeshes();
+				ImGui::Text("%u submeshes, sharing one pool allocation", (unsigned int)submeshes.size());
+				for (unsigned int s = 0; s < submeshes.size(); s++)
+				{
+					ImGui::BulletText("%s (material %s): %u triangles",
+						submeshes[s].Name.empty() ? "unnamed" : submeshes[s].Name.c_str(),
+						submeshes[s].Material.empty() ? "none" : submeshes[s].Material.c_str(),
+						mesh->GetSubmeshLod(s, 0).IndexCount / 3);
+				}
+
+				QuantizationReport quantization = mesh->GetQuantizationReport();
+				ImGui::Text("Vertex layout: %s", mesh->GetVertexLayout() == VertexLayout::Compact ? "compact (20 bytes)" : "full (48 bytes)");
+				ImGui::Text("Quantization error: position %.6f, normal %.3f deg", quantization.MaxPositionError, quantization.MaxNormalErrorDegrees);
+				ImGui::Text("                    tangent %.3f deg, uv %.6f", quantization.MaxTangentErrorDegrees, quantization.MaxUVError);
 
 				ImGui::TreePop();
 			}
@@ -669,9 +880,17 @@ void Game::Update(float deltaTime, float totalTime)
 		ImGui::Spacing();
 	}
 
+	// Picking an entity opens its node, once
+	if (this->selectionChanged && this->selectedEntity >= 0)
+		ImGui::SetNextItemOpen(true);
 	if (ImGui::CollapsingHeader("Scene Entities"))
 	{
-		
+		if (this->selectedEntity >= 0)
+			ImGui::Text("Selected: Entity #%i (triangle %u, %.2f away)", this->selectedEntity + 1, this->selectionHit.Triangle, this->selectionHit.Distance);
+		else
+			ImGui::Text("Right click an entity to select it");
+		ImGui::Spacing();
+
 		for (int i = 0; i < entities.size(); i++)
 		{
 			ImGui::PushID(i);
@@ -681,8 +900,21 @@ void Game::Update(float deltaTime, float totalTime)
 			XMFLOAT3 rotation = transform->GetPitchYawRoll();
 			XMFLOAT3 scale = transform->GetScale();
 
-			if (ImGui::TreeNode("Entity Node", "Entity #%i", i + 1))
+			if (this->selectionChanged)
+				ImGui::SetNextItemOpen(i == this->selectedEntity);
+			if (ImGui::TreeNode("Entity Node", "Entity #%i%s", i + 1, i == this->selectedEntity ? " (selected)" : ""))
 			{
+				std::shared_ptr<Mesh> mesh = entities[i]->GetMesh();
+				if (mesh->HasBvh())
+				{
+					const MeshBvh& bvh = mesh->GetBvh();
+					ImGui::Text("BVH: %u nodes, %u leaves, depth %u, %.1f KB", bvh.GetNodeCount(), bvh.GetLeafCount(), bvh.GetDepth(), bvh.GetMemoryBytes() / 1024.0f);
+				}
+				else
+				{
+					ImGui::Text("BVH: none (can't be picked)");
+				}
+
 				if (ImGui::DragFloat3("Position", &position.x, 0.01f))
 				{
 					transform->SetPosition(position);
@@ -705,6 +937,7 @@ void Game::Update(float deltaTime, float totalTime)
 
 		// ImGui::TreePop();
 	}
+	this->selectionChanged = false;
 
 	if (ImGui::CollapsingHeader("Lights"))
 	{
@@ -826,14 +1059,14 @@ void Game::Update(float deltaTime, float totalTime)
 		ImGui::Text("Texture 1: Cobblestone");
 		ImGui::Spacing();
 
-		ImGui::Image(this->cobblestoneSRV.Get(), ImVec2(200.0f, 200.0f));
+		ImGui::Image(this->cobblestoneSRV->Get().Get(), ImVec2(200.0f, 200.0f));
 
 		ImGui::Spacing();
 
 		ImGui::Text("Texture 2: Metal");
 		ImGui::Spacing();
 
-		ImGui::Image(this->metalSRV.Get(), ImVec2(200.0f, 200.0f));
+		ImGui::Image(this->metalSRV->Get().Get(), ImVec2(200.0f, 200.0f));
 
 		/*
 		if (ImGui::DragFloat("Roughness", &this->roughness, 0.01f))
@@ -1054,18 +1287,23 @@ void Game::RenderShadowMap()
 	viewport.MaxDepth = 1.0f;
 	context->RSSetViewports(1, &viewport);
 
-	shadowVertexShader->SetShader();
-	shadowVertexShader->SetMatrix4x4("view", shadowViewMatrix);
-	shadowVertexShader->SetMatrix4x4("projection", shadowProjectionMatrix);
+	// The light's view for the whole pass
+	this->shadowPassBuffer->SetMatrix4x4("view", shadowViewMatrix);
+	this->shadowPassBuffer->SetMatrix4x4("projection", shadowProjectionMatrix);
+	this->shadowPassBuffer->CopyBufferData();
+	this->shadowPassBuffer->Bind();
 
 	// Loop and draw all entities
 	for (auto& e : entities)
 	{
-		shadowVertexShader->SetMatrix4x4("world", e->GetTransform()->GetWorldMatrix());
-		shadowVertexShader->CopyAllBufferData();
-		// Draw the mesh directly to avoid the entity's material
-		// Note: Your code may differ significantly here!
-		e->GetMesh()->Draw(context);
+		// Pick the shadow shader matching the mesh's vertex layout
+		std::shared_ptr<SimpleVertexShader> vertexShader = e->GetMesh()->PrepareVertexShader(shadowVertexShader, shadowCompactVertexShader);
+		vertexShader->SetShader();
+		e->PrepareObjectBuffer(vertexShader);
+		vertexShader->CopyAllBufferData();
+		// Draw the mesh directly to avoid the entity's material, and from
+		// its position stream, since depth is all the shadow map needs
+		e->GetMesh()->DrawPositionOnly(context);
 	}
 
 	viewport.Width = (float)this->windowWidth;
@@ -1108,6 +1346,18 @@ void Game::Draw(float deltaTime, float totalTime)
 	// - These things should happen ONCE PER FRAME
 	// - At the beginning of Game::Draw() before drawing *anything*
 	{
+		// ImGui set its own buffers at the end of the last frame
+		this->geometryPool->BeginFrame();
+		ISimpleShader::BeginFrame();
+
+		// Lights, shadows and the camera, for every shader in both passes
+		this->perFrameBuffer->SetMatrix4x4("lightView", shadowViewMatrix);
+		this->perFrameBuffer->SetMatrix4x4("lightProjection", shadowProjectionMatrix);
+		this->perFrameBuffer->SetFloat3("cameraPosition", this->cameras[activeCamera]->GetTransform().GetPosition());
+		this->perFrameBuffer->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
+		this->perFrameBuffer->CopyBufferData();
+		this->perFrameBuffer->Bind();
+
 		// Clear the back buffer (erases what's on the screen)
 		const float bgColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f }; // Cornflower Blue
 		context->ClearRenderTargetView(backBufferRTV.Get(), bgColor);
@@ -1211,28 +1461,32 @@ void Game::Draw(float deltaTime, float totalTime)
 		{
 			// g->GetMaterial()->PrepareMaterial(g->GetMaterial()->GetRoughness(), this->cameras[activeCamera]->GetTransform().GetPosition());
 			// g->GetMaterial()->GetPixelShader()->SetFloat3("ambient", this->ambientColor);
-			g->GetMaterial()->GetPixelShader()->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
-
 			g->GetMaterial()->AddTextureSRV("ShadowMap", this->shadowSRV);
 			g->GetMaterial()->AddSampler("ShadowSampler", this->shadowSampler);
-
-			g->GetMaterial()->GetVertexShader()->SetMatrix4x4("lightView", shadowViewMatrix);
-			g->GetMaterial()->GetVertexShader()->SetMatrix4x4("lightProjection", shadowProjectionMatrix);
 			// materials[5]->AddTextureSRV("ShadowMap", this->shadowSRV);
 		}
 
+		// The camera's view for the main pass, and the sky after it
+		this->mainPassBuffer->SetMatrix4x4("view", this->cameras[activeCamera]->GetView());
+		this->mainPassBuffer->SetMatrix4x4("projection", this->cameras[activeCamera]->GetProjection());
+		this->mainPassBuffer->CopyBufferData();
+		this->mainPassBuffer->Bind();
+
 		// assignment 4 and now 12
+		this->meshletCullingStats = MeshletCullingStats();
 		for (std::shared_ptr<GameEntity> g : entities)
 		{
 			// XMFLOAT3 originalPos = g->GetTransform()->GetPosition();
 			// g->Draw(context, this->colorTint, this->cameras[activeCamera]);
 			if (g->GetMaterial()->GetPixelShader() == this->celShadedPixelShader)
 			{
-				g->GetMaterial()->GetPixelShader()->SetShaderResourceView("CelShadeRamp", this->celRampSRV);
-				g->GetMaterial()->GetPixelShader()->SetShaderResourceView("CelShadeSpecular", this->celRampSpecularSRV);
+				g->GetMaterial()->GetPixelShader()->SetShaderResourceView("CelShadeRamp", this->celRampSRV->Get());
+				g->GetMaterial()->GetPixelShader()->SetShaderResourceView("CelShadeSpecular", this->celRampSpecularSRV->Get());
 			}
 			
-			g->Draw(context, this->colorTint, this->cameras[activeCamera]);
+			g->Draw(context, this->colorTint, this->cameras[activeCamera],
+				this->meshletCulling ? &this->meshletCullingStats : 0,
+				this->automaticLod ? this->lodPixelError / this->windowHeight : 0.0f);
 			
 			// g->GetMaterial()->GetPixelShader()->SetShaderResourceView("ToonRamp", this->celRamp2SRV);
 			// g->GetTransform()->MoveAbsolute(XMFLOAT3(3.0f, 0.0f, 0.0f));
@@ -1246,15 +1500,14 @@ void Game::Draw(float deltaTime, float totalTime)
 
 			if (g->GetMaterial()->GetPixelShader() == this->celShadedPixelShader)
 			{
-				std::shared_ptr<SimpleVertexShader> insideOutVertexShader = std::make_shared<SimpleVertexShader>(this->device, this->context, FixPath(L"InsideOutVertexShader.cso").c_str());
-				std::shared_ptr<SimplePixelShader> insideOutPixelShader = std::make_shared<SimplePixelShader>(this->device, this->context, FixPath(L"SolidColorPixelShader.cso").c_str());
+				// The compact or full vertex shader, whichever the mesh's layout needs
+				std::shared_ptr<SimpleVertexShader> insideOutVertexShader = g->GetMesh()->PrepareVertexShader(this->insideOutVertexShader, this->insideOutCompactVertexShader);
+				std::shared_ptr<SimplePixelShader> insideOutPixelShader = this->solidColorPixelShader;
 
 				insideOutVertexShader->SetShader();
 				insideOutPixelShader->SetShader();
 
-				insideOutVertexShader->SetMatrix4x4("world", g->GetTransform()->GetWorldMatrix());
-				insideOutVertexShader->SetMatrix4x4("view", this->cameras[activeCamera]->GetView());
-				insideOutVertexShader->SetMatrix4x4("projection", this->cameras[activeCamera]->GetProjection());
+				g->PrepareObjectBuffer(insideOutVertexShader);
 				insideOutVertexShader->SetFloat("outlineSize", 0.01f);
 				insideOutVertexShader->CopyAllBufferData();
 
@@ -4,6 +4,7 @@
 #include <DirectXMath.h>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 #include "Mesh.h"
+#include "AssetRegistry.h"
 #include <memory>
 #include <vector>
 #include "GameEntity.h"
@@ -49,8 +50,14 @@ private:
 	// Microsoft::WRL::ComPtr<ID3D11VertexShader> vertexShader;
 	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
 
+	// Every mesh's vertices and indices, suballocated from shared buffers
+	std::shared_ptr<GeometryPool> geometryPool;
+
+	// Every mesh and texture loaded from a file, each loaded once
+	std::shared_ptr<AssetRegistry> assets;
+
 	// holds meshes
-	std::vector<std::shared_ptr<Mesh>> meshes{ std::shared_ptr<Mesh>(), std::shared_ptr<Mesh>(), std::shared_ptr<Mesh>()};
+	std::vector<std::shared_ptr<MeshFuture>> meshes{ std::shared_ptr<MeshFuture>(), std::shared_ptr<MeshFuture>(), std::shared_ptr<MeshFuture>()};
 
 	// Assignment 3
 	// Removed for assignment 6
@@ -77,6 +84,7 @@ private:
 
 	// Assignment 6
 	std::shared_ptr<SimpleVertexShader> vertexShader;
+	std::shared_ptr<SimpleVertexShader> compactVertexShader;
 	std::shared_ptr<SimplePixelShader> pixelShader;
 	std::vector<std::shared_ptr<Material>> materials;
 	std::shared_ptr<SimplePixelShader> customPShader;
@@ -100,33 +108,34 @@ private:
 
 	// Assignment 8
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalSpecularSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalNormalSRV;
+	std::shared_ptr<TextureFuture> metalSRV;
+	std::shared_ptr<TextureFuture> metalSpecularSRV;
+	std::shared_ptr<TextureFuture> metalNormalSRV;
 
 	// previously asphalt, now cobblestone for assignment 9
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneSpecularSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneNormalSRV;
+	std::shared_ptr<TextureFuture> cobblestoneSRV;
+	std::shared_ptr<TextureFuture> cobblestoneSpecularSRV;
+	std::shared_ptr<TextureFuture> cobblestoneNormalSRV;
 	float roughness = 0.5f;
 
 	// Assignment 9
 	std::shared_ptr<Sky> sky;
-	std::shared_ptr<Mesh> skyMesh;
+	std::shared_ptr<MeshFuture> skyMesh;	// Until it has loaded and the sky has it
 	std::shared_ptr<SimpleVertexShader> skyVertexShader;
+	std::shared_ptr<SimpleVertexShader> skyCompactVertexShader;
 	std::shared_ptr<SimplePixelShader> skyPixelShader;
 
 	// Assignment 10
 	std::shared_ptr<SimplePixelShader> PBRPixelShader;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalAlbedoSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalRoughnessSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> metalMetalnessSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> cobblestoneMetalnessSRV;
+	std::shared_ptr<TextureFuture> metalAlbedoSRV;
+	std::shared_ptr<TextureFuture> metalRoughnessSRV;
+	std::shared_ptr<TextureFuture> metalMetalnessSRV;
+	std::shared_ptr<TextureFuture> cobblestoneMetalnessSRV;
 
 	// Assignment 11
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodAlbedoSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodRoughnessSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> woodNormalSRV;
+	std::shared_ptr<TextureFuture> woodAlbedoSRV;
+	std::shared_ptr<TextureFuture> woodRoughnessSRV;
+	std::shared_ptr<TextureFuture> woodNormalSRV;
 
 	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> shadowDSV;
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> shadowSRV;
@@ -136,10 +145,36 @@ private:
 	DirectX::XMFLOAT4X4 shadowProjectionMatrix;
 
 	std::shared_ptr<SimpleVertexShader> shadowVertexShader;
+	std::shared_ptr<SimpleVertexShader> shadowCompactVertexShader;
+
+	// Constants shared by every shader, set once per frame or per pass
+	// rather than per draw (see ShaderIncludes.hlsli)
+	std::shared_ptr<SimpleSharedBuffer> perFrameBuffer;
+	std::shared_ptr<SimpleSharedBuffer> shadowPassBuffer;
+	std::shared_ptr<SimpleSharedBuffer> mainPassBuffer;
+
+	// Constant uploads through one mapped buffer (see
+	// ISimpleShader::EnableDynamicConstants()), where the device allows it
+	bool dynamicConstantsSupported = false;
+	bool dynamicConstants = false;
+
+	// Meshlet culling in the main pass; the stats cover the last frame drawn
+	bool meshletCulling = true;
+	MeshletCullingStats meshletCullingStats;
+
+	// Automatic level of detail selection in the main pass
+	bool automaticLod = true;
+	float lodPixelError = 1.0f;
 
 	bool helixForward = true;
 	bool cylinderUp = true;
 
+	// Right click picking against the entities' mesh BVHs
+	int selectedEntity = -1;
+	bool selectionChanged = false;
+	RayHit selectionHit;
+	void PickEntity(int mouseX, int mouseY);
+
 	void CreateShadowResources();
 	int shadowMapResolution = 1024;
 
@@ -148,14 +183,17 @@ private:
 	// Assignment 12 - Cel-Shading
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> clampSampler;
 
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> blackSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> redSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> flatNormalsSRV;
+	std::shared_ptr<TextureFuture> blackSRV;
+	std::shared_ptr<TextureFuture> redSRV;
+	std::shared_ptr<TextureFuture> flatNormalsSRV;
 
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> celRampSRV;
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> celRampSpecularSRV;
+	std::shared_ptr<TextureFuture> celRampSRV;
+	std::shared_ptr<TextureFuture> celRampSpecularSRV;
 
 	std::shared_ptr<SimplePixelShader> celShadedPixelShader;
+	std::shared_ptr<SimpleVertexShader> insideOutVertexShader;
+	std::shared_ptr<SimpleVertexShader> insideOutCompactVertexShader;
+	std::shared_ptr<SimplePixelShader> solidColorPixelShader;
 	Microsoft::WRL::ComPtr<ID3D11RasterizerState> insideOutRasterizer;
 };
 
@@ -8,6 +8,13 @@ GameEntity::GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> mat
 	this->material = material;
 }
 
+GameEntity::GameEntity(std::shared_ptr<MeshFuture> mesh, std::shared_ptr<Material> material)
+{
+	this->meshFuture = mesh;
+	this->transform = std::make_shared<Transform>();
+	this->material = material;
+}
+
 GameEntity::~GameEntity()
 {
 
@@ -15,7 +22,7 @@ GameEntity::~GameEntity()
 
 std::shared_ptr<Mesh> GameEntity::GetMesh()
 {
-	return this->mesh;
+	return this->meshFuture ? this->meshFuture->Get() : this->mesh;
 }
 
 std::shared_ptr<Transform> GameEntity::GetTransform()
@@ -33,9 +40,62 @@ void GameEntity::SetMaterial(std::shared_ptr<Material> newMaterial)
 	this->material = newMaterial;
 }
 
-void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, DirectX::XMFLOAT4 colorTint, std::shared_ptr<Camera> camera)
+// --------------------------------------------------------
+// Takes the ray into the mesh's local space instead of the
+// mesh into world space.  The direction isn't renormalized
+// afterwards, so distances along it come out the same in
+// either space.
+// --------------------------------------------------------
+bool GameEntity::Raycast(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, RayHit& hit)
+{
+	std::shared_ptr<Mesh> mesh = GetMesh();
+	if (!mesh || !mesh->HasBvh())
+		return false;
+
+	XMFLOAT4X4 world = this->transform->GetWorldMatrix();
+	XMMATRIX worldToLocal = XMMatrixInverse(0, XMLoadFloat4x4(&world));
+	return mesh->Raycast(
+		XMVector3TransformCoord(XMLoadFloat3(&origin), worldToLocal),
+		XMVector3TransformNormal(XMLoadFloat3(&direction), worldToLocal),
+		maxDistance, hit);
+}
+
+// --------------------------------------------------------
+// Inverts the world matrix once for the whole packet
+// --------------------------------------------------------
+unsigned int GameEntity::Raycast(const Ray* rays, unsigned int rayCount, RayHit* hits)
 {
-	this->material->GetVertexShader()->SetShader();
+	for (unsigned int i = 0; i < rayCount; i++)
+		hits[i] = RayHit();
+
+	std::shared_ptr<Mesh> mesh = GetMesh();
+	if (!mesh || !mesh->HasBvh())
+		return 0;
+
+	XMFLOAT4X4 world = this->transform->GetWorldMatrix();
+	XMMATRIX worldToLocal = XMMatrixInverse(0, XMLoadFloat4x4(&world));
+	const MeshBvh& bvh = mesh->GetBvh();
+	unsigned int hitCount = 0;
+	for (unsigned int i = 0; i < rayCount; i++)
+	{
+		if (bvh.Raycast(
+			XMVector3TransformCoord(XMLoadFloat3(&rays[i].Origin), worldToLocal),
+			XMVector3TransformNormal(XMLoadFloat3(&rays[i].Direction), worldToLocal),
+			rays[i].MaxDistance, hits[i]))
+			hitCount++;
+	}
+	return hitCount;
+}
+
+void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, DirectX::XMFLOAT4 colorTint, std::shared_ptr<Camera> camera, MeshletCullingStats* meshletStats, float maxLodScreenError)
+{
+	std::shared_ptr<Mesh> mesh = GetMesh();
+
+	// Compact meshes need the matching variant of the material's vertex shader
+	std::shared_ptr<SimpleVertexShader> vertexShader = mesh->PrepareVertexShader(
+		this->material->GetVertexShader(), this->material->GetCompactVertexShader());
+
+	vertexShader->SetShader();
 	this->material->GetPixelShader()->SetShader();
 
 	/*
@@ -49,18 +109,12 @@ void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Direc
 
 	this->material->SetColorTint(colorTint);
 
-	std::shared_ptr<SimpleVertexShader> vertexShader = this->material->GetVertexShader();
-	// vertexShader->SetFloat4("colorTint", this->material->GetColorTint());
-	vertexShader->SetMatrix4x4("world", this->transform->GetWorldMatrix());
-	vertexShader->SetMatrix4x4("view", camera->GetView());
-	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
-
-	// Assignment 7
-	// Normals & World Position (Task 5)
-	vertexShader->SetMatrix4x4("worldInverseTranspose", this->transform->GetWorldInverseTransposeMatrix());
+	// View, projection, lights and the like were bound once for the whole
+	// frame or pass; only the object's and the material's own constants
+	// are left, and each goes up only if it changed
+	PrepareObjectBuffer(vertexShader);
 
 	std::shared_ptr<SimplePixelShader> pixelShader = this->material->GetPixelShader();
-	pixelShader->SetFloat4("colorTint", this->material->GetColorTint());
 
 	/*
 	* commented out for Assignment 6
@@ -75,7 +129,36 @@ void GameEntity::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, Direc
 
 	pixelShader->CopyAllBufferData();
 
-	this->material->PrepareMaterial(this->material->GetRoughness(), camera->GetTransform().GetPosition());
+	this->material->PrepareMaterial();
+
+	// Meshlets only cover the full detail level
+	unsigned int lod = mesh->SelectLod(this->transform->GetWorldMatrix(), camera->GetView(), camera->GetProjection(), maxLodScreenError);
+	if (lod > 0)
+	{
+		mesh->Draw(context, lod);
+	}
+	else if (meshletStats)
+	{
+		MeshletCullingView view = GetMeshletCullingView(this->transform->GetWorldMatrix(), camera->GetView(), camera->GetProjection());
+		mesh->Draw(context, view, *meshletStats);
+	}
+	else
+	{
+		mesh->Draw(context);
+	}
+}
 
-	this->mesh->Draw(context);
+void GameEntity::PrepareObjectBuffer(std::shared_ptr<ISimpleShader> shader)
+{
+	if (!this->objectBuffer)
+	{
+		this->objectBuffer = std::make_shared<SimpleSharedBuffer>(shader, "PerObject");
+		this->worldParam = this->objectBuffer->GetParam("world");
+		this->worldInverseTransposeParam = this->objectBuffer->GetParam("worldInverseTranspose");
+	}
+
+	this->objectBuffer->SetMatrix4x4(this->worldParam, this->transform->GetWorldMatrix());
+	this->objectBuffer->SetMatrix4x4(this->worldInverseTransposeParam, this->transform->GetWorldInverseTransposeMatrix());
+	this->objectBuffer->CopyBufferData();
+	this->objectBuffer->Bind();
 }
\ No newline at end of file
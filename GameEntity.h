@@ -2,6 +2,7 @@
 
 #include "Transform.h"
 #include "Mesh.h"
+#include "AssetFuture.h"
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 #include "Camera.h"
 #include "Material.h"
@@ -12,6 +13,8 @@ class GameEntity
 {
 public:
 	GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material);
+	// Draws the future's placeholder until its mesh has loaded
+	GameEntity(std::shared_ptr<MeshFuture> mesh, std::shared_ptr<Material> material);
 	~GameEntity();
 
 	// getters
@@ -22,11 +25,31 @@ public:
 	// setters
 	void SetMaterial(std::shared_ptr<Material> newMaterial);
 
-	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, DirectX::XMFLOAT4 colorTint, std::shared_ptr<Camera> camera);
+	// Passing meshletStats turns on per-meshlet culling against the camera.
+	// A maxLodScreenError above 0 (a fraction of the screen's height) lets
+	// the mesh drop to a simplified level of detail.
+	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, DirectX::XMFLOAT4 colorTint, std::shared_ptr<Camera> camera, MeshletCullingStats* meshletStats = 0, float maxLodScreenError = 0.0f);
+
+	// Binds the entity's PerObject constants (its world matrices) for the
+	// next draw, uploading them first only if the entity moved since.  Any
+	// loaded shader that declares PerObject will do for "shader"; the
+	// buffer takes its layout from the first one.
+	void PrepareObjectBuffer(std::shared_ptr<ISimpleShader> shader);
+
+	// World space rays against the mesh's BVH (see Mesh::BuildBvh()), so
+	// always a miss for meshes without one.  Distances are in lengths of
+	// the ray's direction, as they would be against the world space mesh.
+	bool Raycast(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, RayHit& hit);
+	unsigned int Raycast(const Ray* rays, unsigned int rayCount, RayHit* hits);
 
 private:
 	std::shared_ptr<Transform> transform;
 	std::shared_ptr<Mesh> mesh;
+	std::shared_ptr<MeshFuture> meshFuture;
 	std::shared_ptr<Material> material;
+
+	std::shared_ptr<SimpleSharedBuffer> objectBuffer;
+	ShaderParam worldParam;
+	ShaderParam worldInverseTransposeParam;
 };
 
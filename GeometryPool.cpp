@@ -0,0 +1,215 @@
+#include "GeometryPool.h"
+
+GeometryPool::GeometryPool(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+	: device(device), context(context)
+{
+	shortIndexPool.ElementSize = sizeof(unsigned short);
+	shortIndexPool.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	intIndexPool.ElementSize = sizeof(unsigned int);
+	intIndexPool.BindFlags = D3D11_BIND_INDEX_BUFFER;
+}
+
+// --------------------------------------------------------
+// Finds (or starts) the vertex pools for these strides, then
+// carves every range out and uploads into them
+// --------------------------------------------------------
+bool GeometryPool::Allocate(const void* vertices, unsigned int vertexStride, unsigned int vertexCount, const void* indices, DXGI_FORMAT indexFormat, unsigned int indexCount, GeometryAllocation& allocation, const void* positions, unsigned int positionStride)
+{
+	GeometryAllocation result;
+	result.VertexPool = GetVertexPool(vertexStride);
+	result.VertexCount = vertexCount;
+	result.IndexFormat = indexFormat;
+	result.IndexCount = indexCount;
+
+	if (!AllocateRange(this->vertexPools[result.VertexPool], vertices, vertexCount, result.BaseVertex))
+		return false;
+
+	if (!AllocateRange(GetIndexPool(indexFormat), indices, indexCount, result.StartIndex))
+	{
+		this->vertexPools[result.VertexPool].Allocator.Free(result.BaseVertex, vertexCount);
+		return false;
+	}
+
+	if (positions)
+	{
+		result.HasPositionStream = true;
+		result.PositionPool = GetVertexPool(positionStride);
+		if (!AllocateRange(this->vertexPools[result.PositionPool], positions, vertexCount, result.PositionBaseVertex))
+		{
+			result.HasPositionStream = false;
+			Free(result);
+			return false;
+		}
+	}
+
+	allocation = result;
+	return true;
+}
+
+void GeometryPool::Free(const GeometryAllocation& allocation)
+{
+	if (allocation.VertexPool < this->vertexPools.size())
+		this->vertexPools[allocation.VertexPool].Allocator.Free(allocation.BaseVertex, allocation.VertexCount);
+	if (allocation.HasPositionStream)
+		this->vertexPools[allocation.PositionPool].Allocator.Free(allocation.PositionBaseVertex, allocation.VertexCount);
+	GetIndexPool(allocation.IndexFormat).Allocator.Free(allocation.StartIndex, allocation.IndexCount);
+}
+
+// --------------------------------------------------------
+// Only calls into the input assembler for the buffers (or
+// index format) that differ from the last Bind()
+// --------------------------------------------------------
+unsigned int GeometryPool::Bind(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const GeometryAllocation& allocation, bool positionsOnly)
+{
+	bool positionStream = positionsOnly && allocation.HasPositionStream;
+	const PoolBuffer& vertexPool = this->vertexPools[positionStream ? allocation.PositionPool : allocation.VertexPool];
+	if (vertexPool.Buffer.Get() != this->boundVertexBuffer)
+	{
+		UINT stride = vertexPool.ElementSize;
+		UINT offset = 0;
+		context->IASetVertexBuffers(0, 1, vertexPool.Buffer.GetAddressOf(), &stride, &offset);
+		this->boundVertexBuffer = vertexPool.Buffer.Get();
+		this->bindCount++;
+	}
+	else
+	{
+		this->skippedBindCount++;
+	}
+
+	const PoolBuffer& indexPool = GetIndexPool(allocation.IndexFormat);
+	if (indexPool.Buffer.Get() != this->boundIndexBuffer || allocation.IndexFormat != this->boundIndexFormat)
+	{
+		context->IASetIndexBuffer(indexPool.Buffer.Get(), allocation.IndexFormat, 0);
+		this->boundIndexBuffer = indexPool.Buffer.Get();
+		this->boundIndexFormat = allocation.IndexFormat;
+		this->bindCount++;
+	}
+	else
+	{
+		this->skippedBindCount++;
+	}
+
+	return positionStream ? allocation.PositionBaseVertex : allocation.BaseVertex;
+}
+
+void GeometryPool::BeginFrame()
+{
+	this->boundVertexBuffer = 0;
+	this->boundIndexBuffer = 0;
+	this->boundIndexFormat = DXGI_FORMAT_UNKNOWN;
+	this->bindCount = 0;
+	this->skippedBindCount = 0;
+}
+
+Microsoft::WRL::ComPtr<ID3D11Buffer> GeometryPool::GetVertexBuffer(const GeometryAllocation& allocation)
+{
+	return this->vertexPools[allocation.VertexPool].Buffer;
+}
+
+Microsoft::WRL::ComPtr<ID3D11Buffer> GeometryPool::GetIndexBuffer(const GeometryAllocation& allocation)
+{
+	return GetIndexPool(allocation.IndexFormat).Buffer;
+}
+
+void GeometryPool::GetStats(std::vector<GeometryPoolBufferStats>& vertexPools, std::vector<GeometryPoolBufferStats>& indexPools)
+{
+	auto describe = [](const PoolBuffer& pool)
+	{
+		GeometryPoolBufferStats stats;
+		stats.ElementSize = pool.ElementSize;
+		stats.Used = pool.Allocator.GetUsed();
+		stats.Capacity = pool.Allocator.GetCapacity();
+		stats.FreeRanges = pool.Allocator.GetFreeRangeCount();
+		stats.Fragmentation = pool.Allocator.GetFragmentation();
+		return stats;
+	};
+
+	vertexPools.clear();
+	for (const PoolBuffer& pool : this->vertexPools)
+		vertexPools.push_back(describe(pool));
+
+	indexPools.clear();
+	indexPools.push_back(describe(this->shortIndexPool));
+	indexPools.push_back(describe(this->intIndexPool));
+}
+
+// --------------------------------------------------------
+// (Re)creates a pool's buffer at the given capacity,
+// copying over everything the old one held so existing
+// allocations keep their offsets
+// --------------------------------------------------------
+bool GeometryPool::CreatePoolBuffer(PoolBuffer& pool, unsigned int capacity)
+{
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DEFAULT;	// Written by UpdateSubresource() as meshes arrive
+	desc.ByteWidth = capacity * pool.ElementSize;
+	desc.BindFlags = pool.BindFlags;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	if (FAILED(this->device->CreateBuffer(&desc, 0, buffer.GetAddressOf())))
+		return false;
+
+	if (pool.Buffer)
+		this->context->CopySubresourceRegion(buffer.Get(), 0, 0, 0, 0, pool.Buffer.Get(), 0, 0);
+
+	pool.Buffer = buffer;
+	pool.Allocator.Grow(capacity);
+
+	// The old buffer may still be bound
+	this->boundVertexBuffer = 0;
+	this->boundIndexBuffer = 0;
+	return true;
+}
+
+// --------------------------------------------------------
+// Finds room for "count" elements, doubling the buffer as
+// often as it takes, and uploads them there
+// --------------------------------------------------------
+bool GeometryPool::AllocateRange(PoolBuffer& pool, const void* data, unsigned int count, unsigned int& offset)
+{
+	if (count == 0)
+	{
+		offset = 0;
+		return true;
+	}
+
+	while (!pool.Allocator.Allocate(count, offset))
+	{
+		unsigned int capacity = pool.Allocator.GetCapacity();
+		unsigned int newCapacity = capacity > 0 ? capacity * 2 : (pool.BindFlags == D3D11_BIND_VERTEX_BUFFER ? GEOMETRY_POOL_INITIAL_VERTICES : GEOMETRY_POOL_INITIAL_INDICES);
+		if (newCapacity < capacity + count)
+			newCapacity = capacity + count;
+
+		if (!CreatePoolBuffer(pool, newCapacity))
+			return false;
+	}
+
+	D3D11_BOX box = {};
+	box.left = offset * pool.ElementSize;
+	box.right = (offset + count) * pool.ElementSize;
+	box.bottom = 1;
+	box.back = 1;
+	this->context->UpdateSubresource(pool.Buffer.Get(), 0, &box, data, 0, 0);
+	return true;
+}
+
+unsigned int GeometryPool::GetVertexPool(unsigned int stride)
+{
+	unsigned int vertexPool = 0;
+	while (vertexPool < this->vertexPools.size() && this->vertexPools[vertexPool].ElementSize != stride)
+		vertexPool++;
+
+	if (vertexPool == this->vertexPools.size())
+	{
+		PoolBuffer pool;
+		pool.ElementSize = stride;
+		pool.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		this->vertexPools.push_back(pool);
+	}
+	return vertexPool;
+}
+
+GeometryPool::PoolBuffer& GeometryPool::GetIndexPool(DXGI_FORMAT format)
+{
+	return format == DXGI_FORMAT_R16_UINT ? this->shortIndexPool : this->intIndexPool;
+}
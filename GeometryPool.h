@@ -0,0 +1,127 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+#include "RangeAllocator.h"
+
+// Starting sizes, in elements; pools double whenever they run out
+#define GEOMETRY_POOL_INITIAL_VERTICES 65536
+#define GEOMETRY_POOL_INITIAL_INDICES 262144
+
+// Where one mesh's geometry lives in the pool.  Draws pass
+// StartIndex (plus any offset within the mesh) and BaseVertex
+// straight to DrawIndexed().
+struct GeometryAllocation
+{
+	unsigned int VertexPool = 0;	// One vertex pool per vertex stride
+	unsigned int BaseVertex = 0;
+	unsigned int VertexCount = 0;
+
+	// Optional copy of just the positions, VertexCount of them, drawn
+	// with the same indices (see Bind())
+	bool HasPositionStream = false;
+	unsigned int PositionPool = 0;
+	unsigned int PositionBaseVertex = 0;
+
+	DXGI_FORMAT IndexFormat = DXGI_FORMAT_R32_UINT;
+	unsigned int StartIndex = 0;
+	unsigned int IndexCount = 0;
+};
+
+// How full one of the pool's buffers is
+struct GeometryPoolBufferStats
+{
+	unsigned int ElementSize = 0;	// Vertex stride, or index size
+	unsigned int Used = 0;			// In elements
+	unsigned int Capacity = 0;
+	unsigned int FreeRanges = 0;
+	float Fragmentation = 0.0f;		// See RangeAllocator::GetFragmentation()
+};
+
+// --------------------------------------------------------
+// Scene-wide vertex and index buffers that every Mesh is
+// suballocated from
+//
+// - One vertex buffer per vertex stride (base vertices are
+//   counted in whole vertices), and one index buffer each
+//   for 16- and 32-bit indices
+// - Buffers are DEFAULT usage and filled with
+//   UpdateSubresource(), so meshes can come and go; a full
+//   buffer is replaced by one twice the size, and its
+//   contents copied over on the GPU
+// - Bind() remembers what it last bound, so consecutive
+//   draws from the same buffers never touch the input
+//   assembler again
+// - Meshes may add a tightly packed position stream, so
+//   depth-only passes fetch a fraction of each vertex
+// --------------------------------------------------------
+class GeometryPool
+{
+public:
+	GeometryPool(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	// Copies a mesh's vertices and indices (16- or 32-bit, matching
+	// indexFormat) into the pool, along with its position stream if
+	// positions isn't null.  Returns false if a buffer couldn't grow.
+	bool Allocate(
+		const void* vertices,
+		unsigned int vertexStride,
+		unsigned int vertexCount,
+		const void* indices,
+		DXGI_FORMAT indexFormat,
+		unsigned int indexCount,
+		GeometryAllocation& allocation,
+		const void* positions = 0,
+		unsigned int positionStride = 0);
+
+	// Gives an allocation's ranges back
+	void Free(const GeometryAllocation& allocation);
+
+	// Sets the buffers an allocation lives in, unless they're already set,
+	// and returns the base vertex to draw with.  positionsOnly picks the
+	// position stream over the full vertices, when there is one.
+	unsigned int Bind(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, const GeometryAllocation& allocation, bool positionsOnly = false);
+
+	// Forgets what Bind() last set.  Call at the start of every frame, and
+	// after anything else (ImGui, for one) sets vertex or index buffers.
+	void BeginFrame();
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer(const GeometryAllocation& allocation);
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer(const GeometryAllocation& allocation);
+
+	// Input assembler changes Bind() made, and skipped, since BeginFrame()
+	unsigned int GetBindCount() { return bindCount; }
+	unsigned int GetSkippedBindCount() { return skippedBindCount; }
+
+	void GetStats(std::vector<GeometryPoolBufferStats>& vertexPools, std::vector<GeometryPoolBufferStats>& indexPools);
+
+private:
+	// One growable buffer and the ranges handed out from it
+	struct PoolBuffer
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> Buffer;
+		RangeAllocator Allocator;
+		unsigned int ElementSize = 0;
+		UINT BindFlags = 0;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+
+	std::vector<PoolBuffer> vertexPools;
+	PoolBuffer shortIndexPool;
+	PoolBuffer intIndexPool;
+
+	// What Bind() last set
+	ID3D11Buffer* boundVertexBuffer = 0;
+	ID3D11Buffer* boundIndexBuffer = 0;
+	DXGI_FORMAT boundIndexFormat = DXGI_FORMAT_UNKNOWN;
+	unsigned int bindCount = 0;
+	unsigned int skippedBindCount = 0;
+
+	bool CreatePoolBuffer(PoolBuffer& pool, unsigned int capacity);
+	unsigned int GetVertexPool(unsigned int stride);
+	bool AllocateRange(PoolBuffer& pool, const void* data, unsigned int count, unsigned int& offset);
+	PoolBuffer& GetIndexPool(DXGI_FORMAT format);
+};
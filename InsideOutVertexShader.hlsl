@@ -1,15 +1,14 @@
 #include "ShaderIncludes.hlsli"
 
+// world, view and projection are from the PerObject and PerPass buffers
 cbuffer ExternalData : register(b0)
 {
-	matrix world;
-	matrix view;
-	matrix projection;
 	float outlineSize;
 }
 
-VertexToPixel main(VertexShaderInput input)
+VertexToPixel main(MeshVertexInput meshInput)
 {
+	VertexShaderInput input = UnpackVertex(meshInput);
 	VertexToPixel output;
 
 	float3 worldPos = mul(world, float4(input.localPosition, 1.0f)).xyz;
@@ -0,0 +1,3 @@
+// Same as InsideOutVertexShader.hlsl, but reads the CompactVertex layout
+#define COMPACT_VERTEX_INPUT
+#include "InsideOutVertexShader.hlsl"
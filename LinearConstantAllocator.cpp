@@ -0,0 +1,60 @@
+#include "LinearConstantAllocator.h"
+
+LinearConstantAllocator::LinearConstantAllocator(unsigned int capacity)
+	: capacity(capacity / CONSTANT_SLICE_ALIGNMENT * CONSTANT_SLICE_ALIGNMENT)
+{
+}
+
+// --------------------------------------------------------
+// A new generation right away, not at the next discard:
+// anything checked against IsCurrent() before then has to
+// be written again too, or it would be bound to memory the
+// discard is about to throw away
+// --------------------------------------------------------
+void LinearConstantAllocator::BeginFrame()
+{
+	head = 0;
+	generation++;
+	discardNext = true;
+	stats = ConstantAllocatorStats();
+}
+
+bool LinearConstantAllocator::Allocate(unsigned int size, ConstantSlice& slice, ConstantMapMode& mapMode)
+{
+	if (size == 0 || size > CONSTANT_SLICE_MAX_SIZE)
+		return false;
+
+	unsigned int sliceSize = (size + CONSTANT_SLICE_ALIGNMENT - 1) / CONSTANT_SLICE_ALIGNMENT * CONSTANT_SLICE_ALIGNMENT;
+	if (sliceSize > capacity - head)
+	{
+		stats.Overflows++;
+		return false;
+	}
+
+	mapMode = discardNext ? ConstantMapMode::Discard : ConstantMapMode::NoOverwrite;
+	if (discardNext)
+	{
+		stats.Discards++;
+		discardNext = false;
+	}
+
+	slice.Offset = head;
+	slice.Size = sliceSize;
+	slice.Generation = generation;
+	head += sliceSize;
+
+	stats.Allocations++;
+	stats.BytesAllocated += sliceSize;
+	stats.BytesRequested += size;
+	return true;
+}
+
+void LinearConstantAllocator::Reset(unsigned int newCapacity)
+{
+	capacity = newCapacity / CONSTANT_SLICE_ALIGNMENT * CONSTANT_SLICE_ALIGNMENT;
+
+	// A new buffer starts out undefined, so the first write discards too
+	head = 0;
+	generation++;
+	discardNext = true;
+}
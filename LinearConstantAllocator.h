@@ -0,0 +1,88 @@
+#pragma once
+
+// Constant buffer offsets (D3D 11.1) count in blocks of 16 constants,
+// so every slice starts and ends on a 256-byte boundary
+#define CONSTANT_SLICE_ALIGNMENT 256
+
+// The most one binding can see: 4096 constants
+#define CONSTANT_SLICE_MAX_SIZE 65536
+
+// How the buffer should be mapped to write a new slice
+enum class ConstantMapMode
+{
+	Discard,		// The first slice of a frame: everything before it is the GPU's
+	NoOverwrite		// Later slices, which only ever go after earlier ones
+};
+
+// Where some constants were written, in bytes from the start of the
+// buffer.  Stays usable until the allocator's next frame.
+struct ConstantSlice
+{
+	unsigned int Offset = 0;
+	unsigned int Size = 0;
+	unsigned int Generation = 0;	// 0 if it was never allocated
+
+	// What VSSetConstantBuffers1() and friends take
+	unsigned int GetFirstConstant() const { return Offset / 16; }
+	unsigned int GetConstantCount() const { return Size / 16; }
+};
+
+// Since the last BeginFrame()
+struct ConstantAllocatorStats
+{
+	unsigned int Allocations = 0;
+	unsigned int Discards = 0;
+	unsigned int Overflows = 0;		// Allocations that didn't fit in what was left
+	unsigned int BytesAllocated = 0;
+	unsigned int BytesRequested = 0;	// Before rounding up to slices
+};
+
+// --------------------------------------------------------
+// Hands out a dynamic buffer front to back in 256-byte
+// aligned slices, starting over each frame
+//
+// - The first slice of a frame maps with discard, so the
+//   driver renames the buffer rather than waiting on the
+//   GPU; the rest map with no-overwrite, since they never
+//   touch anything already written this frame
+// - A frame that runs out fails the allocation (the caller
+//   falls back to its own buffer) instead of wrapping, as a
+//   mid-frame discard would throw away slices still bound;
+//   a bigger buffer (see Reset()) makes room next frame
+// - Slices carry the frame they belong to, so IsCurrent()
+//   tells whether one can still be bound or must be written
+//   again
+// - Pure bookkeeping with no Direct3D, so it can be run
+//   and tested anywhere
+// --------------------------------------------------------
+class LinearConstantAllocator
+{
+public:
+	explicit LinearConstantAllocator(unsigned int capacity = 0);
+
+	// Starts over at the front; every slice handed out so far expires
+	void BeginFrame();
+
+	// Finds room for "size" bytes.  Returns false (leaving slice and
+	// mapMode alone) if there's no room left this frame, or the size is
+	// zero or more than one binding can see.
+	bool Allocate(unsigned int size, ConstantSlice& slice, ConstantMapMode& mapMode);
+
+	// Moves to a new buffer of newCapacity bytes.  Expires every slice,
+	// since they were in the old buffer; generations keep counting up, so
+	// none of them can ever pass for current again.
+	void Reset(unsigned int newCapacity);
+
+	bool IsCurrent(const ConstantSlice& slice) const { return slice.Generation != 0 && slice.Generation == generation; }
+
+	unsigned int GetCapacity() const { return capacity; }
+	unsigned int GetUsed() const { return head; }
+	const ConstantAllocatorStats& GetStats() const { return stats; }
+
+private:
+	unsigned int capacity;
+	unsigned int head = 0;
+	unsigned int generation = 1;
+	bool discardNext = true;
+	ConstantAllocatorStats stats;
+};
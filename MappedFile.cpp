@@ -0,0 +1,110 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdlib>
+#endif
+
+// --------------------------------------------------------
+// Opens and maps the whole file.  Check IsOpen() afterwards,
+// as a missing or unreadable file simply leaves it closed.
+// --------------------------------------------------------
+MappedFile::MappedFile(const std::wstring& fileName)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileW(
+		fileName.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		0,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		0);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return;
+	}
+
+	this->fileHandle = file;
+	this->size = (size_t)fileSize.QuadPart;
+
+	// Zero-length files can't be mapped, but they are still valid (and empty)
+	if (this->size == 0)
+	{
+		this->data = "";
+		this->isOpen = true;
+		return;
+	}
+
+	this->mappingHandle = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (!this->mappingHandle)
+		return;
+
+	this->data = (const char*)MapViewOfFile(this->mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	this->isOpen = this->data != 0;
+#else
+	// Paths are wide strings everywhere else in the engine
+	std::string narrowName(fileName.size() * 4 + 1, '\0');
+	size_t length = wcstombs(&narrowName[0], fileName.c_str(), narrowName.size());
+	if (length == (size_t)-1)
+		return;
+	narrowName.resize(length);
+
+	int file = open(narrowName.c_str(), O_RDONLY);
+	if (file < 0)
+		return;
+
+	struct stat fileInfo = {};
+	if (fstat(file, &fileInfo) != 0)
+	{
+		close(file);
+		return;
+	}
+
+	this->size = (size_t)fileInfo.st_size;
+	if (this->size == 0)
+	{
+		close(file);
+		this->data = "";
+		this->isOpen = true;
+		return;
+	}
+
+	void* view = mmap(0, this->size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file); // The mapping keeps its own reference to the file
+	if (view == MAP_FAILED)
+		return;
+
+	madvise(view, this->size, MADV_SEQUENTIAL);
+	this->data = (const char*)view;
+	this->isOpen = true;
+#endif
+}
+
+// --------------------------------------------------------
+// Unmaps the view and releases the OS handles
+// --------------------------------------------------------
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (this->data && this->size > 0)
+		UnmapViewOfFile(this->data);
+	if (this->mappingHandle)
+		CloseHandle(this->mappingHandle);
+	if (this->fileHandle)
+		CloseHandle(this->fileHandle);
+#else
+	if (this->data && this->size > 0)
+		munmap((void*)this->data, this->size);
+#endif
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// --------------------------------------------------------
+// Read-only memory mapping of an entire file
+//
+// - The contents are exposed as a single contiguous range
+//   of bytes that stays valid for the lifetime of the object
+// - Nothing is copied; pages are faulted in by the OS as
+//   they are touched
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile(const std::wstring& fileName);
+	~MappedFile();
+
+	// Mappings own OS handles, so they cannot be copied
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool IsOpen() { return isOpen; }
+	const char* GetData() { return data; }
+	size_t GetSize() { return size; }
+
+private:
+	bool isOpen = false;
+	const char* data = 0;
+	size_t size = 0;
+
+#ifdef _WIN32
+	void* fileHandle = 0;
+	void* mappingHandle = 0;
+#endif
+};
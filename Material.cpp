@@ -6,6 +6,7 @@ Material::Material(XMFLOAT4 colorTint, std::shared_ptr<SimpleVertexShader> verte
 	this->vertexShader = vertexShader;
 	this->pixelShader = pixelShader;
 	this->roughness = roughness;
+	CreateMaterialBuffer();
 }
 
 XMFLOAT4 Material::GetColorTint()
@@ -18,6 +19,11 @@ std::shared_ptr<SimpleVertexShader> Material::GetVertexShader()
 	return this->vertexShader;
 }
 
+std::shared_ptr<SimpleVertexShader> Material::GetCompactVertexShader()
+{
+	return this->compactVertexShader;
+}
+
 std::shared_ptr<SimplePixelShader> Material::GetPixelShader()
 {
 	return this->pixelShader;
@@ -31,6 +37,7 @@ float Material::GetRoughness()
 void Material::SetColorTint(XMFLOAT4 newColorTint)
 {
 	this->colorTint = newColorTint;
+	this->materialBuffer->SetFloat4(this->colorTintParam, newColorTint);
 }
 
 void Material::SetVertexShader(std::shared_ptr<SimpleVertexShader> newVertexShader)
@@ -38,22 +45,31 @@ void Material::SetVertexShader(std::shared_ptr<SimpleVertexShader> newVertexShad
 	this->vertexShader = newVertexShader;
 }
 
+void Material::SetCompactVertexShader(std::shared_ptr<SimpleVertexShader> newCompactVertexShader)
+{
+	this->compactVertexShader = newCompactVertexShader;
+}
+
 void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> newPixelShader)
 {
 	this->pixelShader = newPixelShader;
+	CreateMaterialBuffer();
 }
 
-void Material::PrepareMaterial(float roughness, XMFLOAT3 cameraPosition)
+void Material::PrepareMaterial()
 {
-	this->roughness = roughness;
-	this->pixelShader->SetFloat("roughness", this->roughness);
-	this->pixelShader->SetFloat3("cameraPosition", cameraPosition);
+	this->materialBuffer->CopyBufferData();
+	this->materialBuffer->Bind();
 
 	// Assignment 8
 	for (auto& t : this->textureSRVs)
 	{
 		this->pixelShader->SetShaderResourceView(t.first.c_str(), t.second);
 	}
+	for (auto& t : this->textureFutures)
+	{
+		this->pixelShader->SetShaderResourceView(t.first.c_str(), t.second->Get());
+	}
 	for (auto& s : this->samplers)
 	{
 		this->pixelShader->SetSamplerState(s.first.c_str(), s.second);
@@ -92,19 +108,15 @@ void Material::PrepareMaterial(std::shared_ptr<Transform> transform, std::shared
 void Material::AddTextureSRV(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
 {
 	this->textureSRVs.insert({ shaderName, srv });
-	if (shaderName == "SpecularMap" || shaderName == "CelShadeSpecular")
-	{
-		this->pixelShader->SetInt("usingSpecularMap", 1);
-	}
-	else if (shaderName == "Albedo") // only albedo uses gamma correction so the gammaCorrection int can be determined here
-	{
-		this->pixelShader->SetInt("usingAlbedo", 1);
-		this->pixelShader->SetInt("gammaCorrection", 1);
-	}
-	else if (shaderName == "Metalness")
-	{
-		this->pixelShader->SetInt("usingMetal", 1);
-	}
+	SetTextureFlags(shaderName);
+}
+
+void Material::AddTextureSRV(std::string shaderName, std::shared_ptr<TextureFuture> texture)
+{
+	// Sets the same shader flags as a loaded texture would
+	AddTextureSRV(shaderName, texture->Get());
+	this->textureSRVs.erase(shaderName);
+	this->textureFutures.insert({ shaderName, texture });
 }
 
 void Material::AddSampler(std::string samplerName, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler)
@@ -115,4 +127,40 @@ void Material::AddSampler(std::string samplerName, Microsoft::WRL::ComPtr<ID3D11
 void Material::SetRoughness(float roughness)
 {
 	this->roughness = roughness;
+	this->materialBuffer->SetFloat(this->roughnessParam, roughness);
+}
+
+// Gives the material its own copy of the pixel shader's PerMaterial buffer,
+// filled with everything set so far.  Shaders without one get an empty
+// buffer that ignores whatever is set on it.
+void Material::CreateMaterialBuffer()
+{
+	this->materialBuffer = std::make_shared<SimpleSharedBuffer>(this->pixelShader, "PerMaterial");
+	this->colorTintParam = this->materialBuffer->GetParam("colorTint");
+	this->roughnessParam = this->materialBuffer->GetParam("roughness");
+
+	this->materialBuffer->SetFloat4(this->colorTintParam, this->colorTint);
+	this->materialBuffer->SetFloat(this->roughnessParam, this->roughness);
+	for (auto& t : this->textureSRVs)
+		SetTextureFlags(t.first);
+	for (auto& t : this->textureFutures)
+		SetTextureFlags(t.first);
+}
+
+// Tells the shader which optional textures it has
+void Material::SetTextureFlags(std::string shaderName)
+{
+	if (shaderName == "SpecularMap" || shaderName == "CelShadeSpecular")
+	{
+		this->materialBuffer->SetInt("usingSpecularMap", 1);
+	}
+	else if (shaderName == "Albedo") // only albedo uses gamma correction so the gammaCorrection int can be determined here
+	{
+		this->materialBuffer->SetInt("usingAlbedo", 1);
+		this->materialBuffer->SetInt("gammaCorrection", 1);
+	}
+	else if (shaderName == "Metalness")
+	{
+		this->materialBuffer->SetInt("usingMetal", 1);
+	}
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "SimpleShader.h"
+#include "AssetFuture.h"
 
 #include <DirectXMath.h>
 #include <memory>
@@ -16,28 +17,48 @@ public:
 	// getters
 	XMFLOAT4 GetColorTint();
 	std::shared_ptr<SimpleVertexShader> GetVertexShader();
+	std::shared_ptr<SimpleVertexShader> GetCompactVertexShader();
 	std::shared_ptr<SimplePixelShader> GetPixelShader();
 	float GetRoughness();
 
 	// setters
 	void SetColorTint(XMFLOAT4 newColorTint);
 	void SetVertexShader(std::shared_ptr<SimpleVertexShader> newVertexShader);
+	void SetCompactVertexShader(std::shared_ptr<SimpleVertexShader> newCompactVertexShader);
 	void SetPixelShader(std::shared_ptr<SimplePixelShader> newPixelShader);
 	void AddTextureSRV(std::string shaderName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
+	// Binds whatever the future holds each time the material is prepared,
+	// so the placeholder gets swapped out once the texture has loaded
+	void AddTextureSRV(std::string shaderName, std::shared_ptr<TextureFuture> texture);
 	void AddSampler(std::string samplerName, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
 	void SetRoughness(float roughness);
 
 	// helpers
-	void PrepareMaterial(float roughness, XMFLOAT3 cameraPosition);
+	// Uploads the material's constants if they changed since the last
+	// time, and binds them and the textures and samplers
+	void PrepareMaterial();
 
 private:
 	XMFLOAT4 colorTint;
 	std::shared_ptr<SimpleVertexShader> vertexShader;
 	std::shared_ptr<SimplePixelShader> pixelShader;
 	float roughness;
+
+	// Same as vertexShader, but for meshes using CompactVertex
+	std::shared_ptr<SimpleVertexShader> compactVertexShader;
+
+	// The pixel shader's PerMaterial buffer, one per material, so it only
+	// goes to the GPU when something about the material changes
+	std::shared_ptr<SimpleSharedBuffer> materialBuffer;
+	ShaderParam colorTintParam;
+	ShaderParam roughnessParam;
 	
 	// Assignment 8
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs;
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11SamplerState>> samplers;
+	std::unordered_map<std::string, std::shared_ptr<TextureFuture>> textureFutures;
+
+	void CreateMaterialBuffer();
+	void SetTextureFlags(std::string shaderName);
 };
 
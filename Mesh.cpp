@@ -1,21 +1,54 @@
 #include "Mesh.h"
 #include "Vertex.h"
-#include <fstream>
+#include "ObjParser.h"
+#include "MeshOptimizer.h"
+#include "MeshCache.h"
+#include "MappedFile.h"
+#include "VertexQuantization.h"
+#include "MeshSimplifier.h"
+#include "TangentGeneration.h"
+
+#include <algorithm>
+#include <cstring>
 
 using namespace DirectX;
 
+namespace
+{
+	// Runs a pass that reorders triangles on each submesh's range of
+	// the index list separately, so no triangle leaves its submesh
+	template<typename Pass>
+	void ForEachSubmeshRange(std::vector<unsigned int>& indices, const std::vector<ObjSubmesh>& submeshes, Pass pass)
+	{
+		if (submeshes.size() <= 1)
+		{
+			pass(indices);
+			return;
+		}
+
+		std::vector<unsigned int> range;
+		for (const ObjSubmesh& submesh : submeshes)
+		{
+			auto start = indices.begin() + submesh.StartIndex;
+			range.assign(start, start + submesh.IndexCount);
+			pass(range);
+			std::copy(range.begin(), range.end(), start);
+		}
+	}
+}
+
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer()
 {
 	// Microsoft::WRL::ComPtr<ID3D11Buffer>* vertexBuffer;
 	// vertexBuffer = &this->vertexBuffer;
-	return this->vertexBuffer;
+	return this->uploaded ? this->pool->GetVertexBuffer(this->geometry) : 0;
 }
 
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer()
 {
 	// Microsoft::WRL::ComPtr<ID3D11Buffer> *indexBuffer;
 	// indexBuffer = &this->indexBuffer;
-	return this->indexBuffer;
+	return this->uploaded ? this->pool->GetIndexBuffer(this->geometry) : 0;
 }
 
 int Mesh::GetIndexCount()
@@ -23,25 +56,297 @@ int Mesh::GetIndexCount()
 	return indicesCount;
 }
 
+int Mesh::GetVertexCount()
+{
+	return verticesCount;
+}
+
+MeshOptimizationStats Mesh::GetOptimizationStats()
+{
+	return optimizationStats;
+}
+
+DXGI_FORMAT Mesh::GetIndexFormat()
+{
+	return indexFormat;
+}
+
+unsigned int Mesh::GetIndexBufferBytes()
+{
+	return indexBufferBytes;
+}
+
+bool Mesh::IsLoadedFromCache()
+{
+	return loadedFromCache;
+}
+
+const DirectX::BoundingBox& Mesh::GetBoundingBox()
+{
+	return bounds.Box;
+}
+
+const DirectX::BoundingSphere& Mesh::GetBoundingSphere()
+{
+	return bounds.Sphere;
+}
+
+bool Mesh::HasBvh()
+{
+	return !bvh.IsEmpty();
+}
+
+const MeshBvh& Mesh::GetBvh()
+{
+	return bvh;
+}
+
+// --------------------------------------------------------
+// Casts a local space ray against the mesh's BVH; always
+// misses if BuildBvh() wasn't called
+// --------------------------------------------------------
+bool Mesh::Raycast(FXMVECTOR origin, FXMVECTOR direction, float maxDistance, RayHit& hit)
+{
+	return this->bvh.Raycast(origin, direction, maxDistance, hit);
+}
+
+VertexLayout Mesh::GetVertexLayout()
+{
+	return vertexLayout;
+}
+
+QuantizationReport Mesh::GetQuantizationReport()
+{
+	return quantizationReport;
+}
+
+const std::vector<Meshlet>& Mesh::GetMeshlets()
+{
+	return meshlets;
+}
+
+const std::vector<MeshLod>& Mesh::GetLods()
+{
+	return lods;
+}
+
+const std::vector<MeshSubmesh>& Mesh::GetSubmeshes()
+{
+	return submeshes;
+}
+
+// --------------------------------------------------------
+// The range of the index buffer one submesh draws at one
+// level of detail
+// --------------------------------------------------------
+const MeshLod& Mesh::GetSubmeshLod(unsigned int submesh, unsigned int lod)
+{
+	if (lod >= this->lods.size())
+		lod = 0;
+	return this->submeshLods[lod * this->submeshes.size() + submesh];
+}
+
+// --------------------------------------------------------
+// Picks the coarsest level whose error, projected to the
+// screen at the mesh's nearest point, stays within
+// maxScreenError (a fraction of the viewport's height)
+// --------------------------------------------------------
+unsigned int Mesh::SelectLod(const XMFLOAT4X4& world, const XMFLOAT4X4& view, const XMFLOAT4X4& projection, float maxScreenError)
+{
+	if (this->lods.size() < 2 || maxScreenError <= 0.0f)
+		return 0;
+
+	// Errors and the bounds stretch with the largest axis scale
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+	float scale = XMVectorGetX(XMVectorMax(
+		XMVector3Length(worldMatrix.r[0]),
+		XMVectorMax(XMVector3Length(worldMatrix.r[1]), XMVector3Length(worldMatrix.r[2]))));
+
+	XMVECTOR center = XMLoadFloat3(&this->bounds.Sphere.Center);
+	float radius = this->bounds.Sphere.Radius * scale;
+
+	// Projected size of one world unit, as a fraction of the screen's
+	// height (projection._22 is cot(fov / 2) for a perspective camera)
+	float unitSize = projection._22 * 0.5f;
+	if (projection._34 != 0.0f)
+	{
+		XMVECTOR viewCenter = XMVector3TransformCoord(center, XMMatrixMultiply(worldMatrix, XMLoadFloat4x4(&view)));
+		float depth = XMVectorGetZ(viewCenter) - radius;
+		if (depth <= 0.0f)
+			return 0;
+		unitSize /= depth;
+	}
+
+	unsigned int lod = 0;
+	for (unsigned int i = 1; i < this->lods.size(); i++)
+	{
+		if (this->lods[i].Error * scale * unitSize > maxScreenError)
+			break;
+		lod = i;
+	}
+	return lod;
+}
+
+// --------------------------------------------------------
+// Returns whichever of the two vertex shader variants reads
+// this mesh's vertex layout.  For compact vertices, it also
+// hands the shader the constants it needs to decode them.
+// --------------------------------------------------------
+std::shared_ptr<SimpleVertexShader> Mesh::PrepareVertexShader(std::shared_ptr<SimpleVertexShader> fullShader, std::shared_ptr<SimpleVertexShader> compactShader)
+{
+	if (this->vertexLayout != VertexLayout::Compact)
+		return fullShader;
+
+	compactShader->SetFloat3("quantizedPositionOffset", this->quantization.PositionOffset);
+	compactShader->SetFloat3("quantizedPositionScale", this->quantization.PositionScale);
+	compactShader->SetFloat2("quantizedUVOffset", this->quantization.UVOffset);
+	compactShader->SetFloat2("quantizedUVScale", this->quantization.UVScale);
+	return compactShader;
+}
+
+// --------------------------------------------------------
+// Sets the pool buffers that every submesh and level of
+// detail draws from.  The pool skips this when the last
+// mesh drawn already set them.  Returns false, and draws
+// do nothing, until the mesh is uploaded.
+// --------------------------------------------------------
+bool Mesh::Bind(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext)
+{
+	if (!this->uploaded)
+		return false;
+
+	this->pool->Bind(deviceContext, this->geometry);
+	return true;
+}
+
+// --------------------------------------------------------
+// Draws one submesh at one level of detail with the buffers
+// Bind() set, so a mesh with several parts (and materials)
+// only binds them once
+// --------------------------------------------------------
+void Mesh::DrawSubmesh(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, unsigned int submesh, unsigned int lod)
+{
+	if (!this->uploaded || submesh >= this->submeshes.size())
+		return;
+
+	const MeshLod& range = GetSubmeshLod(submesh, lod);
+	if (range.IndexCount > 0)
+		deviceContext->DrawIndexed(range.IndexCount, this->geometry.StartIndex + range.StartIndex, this->geometry.BaseVertex);
+}
+
 void Mesh::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext)
 {
 	// int indexCount = GetIndexCount();
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
 
 	// Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer = GetIndexBuffer();
 	// Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer = GetVertexBuffer();
 
-	deviceContext->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-	deviceContext->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	if (!Bind(deviceContext))
+		return;
 
 	deviceContext->DrawIndexed(
 		this->GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
-		0);    // Offset to add to each index when looking up vertices
+		this->geometry.StartIndex,     // Offset to the first index we want to use
+		this->geometry.BaseVertex);    // Offset to add to each index when looking up vertices
 }
 
-Mesh::Mesh(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device)
+// --------------------------------------------------------
+// Draws one level of detail, from its range of the shared
+// index buffer
+// --------------------------------------------------------
+void Mesh::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, unsigned int lod)
+{
+	if (lod >= this->lods.size())
+		lod = 0;
+
+	if (!Bind(deviceContext))
+		return;
+
+	deviceContext->DrawIndexed(this->lods[lod].IndexCount, this->geometry.StartIndex + this->lods[lod].StartIndex, this->geometry.BaseVertex);
+}
+
+// --------------------------------------------------------
+// Draws one level of detail from the position stream, for
+// passes whose vertex shader reads nothing but POSITION
+// (see MeshPositionInput in ShaderIncludes.hlsli).  Without
+// a stream, the same shader reads the positions from the
+// front of each full vertex instead.
+// --------------------------------------------------------
+void Mesh::DrawPositionOnly(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, unsigned int lod)
+{
+	if (!this->uploaded)
+		return;
+
+	if (lod >= this->lods.size())
+		lod = 0;
+
+	unsigned int baseVertex = this->pool->Bind(deviceContext, this->geometry, true);
+	deviceContext->DrawIndexed(this->lods[lod].IndexCount, this->geometry.StartIndex + this->lods[lod].StartIndex, baseVertex);
+}
+
+bool Mesh::HasPositionStream()
+{
+	return this->geometry.HasPositionStream;
+}
+
+// --------------------------------------------------------
+// Draws only the meshlets that pass CullMeshlet().  Runs of
+// consecutive visible meshlets are contiguous in the index
+// buffer, so each run costs a single DrawIndexed().
+// --------------------------------------------------------
+void Mesh::Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, const MeshletCullingView& view, MeshletCullingStats& stats)
+{
+	if (this->meshlets.empty())
+	{
+		stats.TrianglesTested += this->indicesCount / 3;
+		stats.DrawCalls++;
+		Draw(deviceContext);
+		return;
+	}
+
+	if (!Bind(deviceContext))
+		return;
+
+	unsigned int runStart = 0;
+	unsigned int runIndexCount = 0;
+	for (const Meshlet& m : this->meshlets)
+	{
+		stats.TrianglesTested += m.TriangleCount;
+
+		MeshletVisibility visibility = CullMeshlet(m, view);
+		if (visibility == MeshletVisibility::OutsideFrustum)
+			stats.TrianglesOutsideFrustum += m.TriangleCount;
+		else if (visibility == MeshletVisibility::BackFacing)
+			stats.TrianglesBackFacing += m.TriangleCount;
+
+		if (visibility != MeshletVisibility::Visible)
+			continue;
+
+		// Extend the current run, or flush it and start a new one
+		if (runIndexCount > 0 && runStart + runIndexCount == m.StartIndex)
+		{
+			runIndexCount += m.TriangleCount * 3;
+			continue;
+		}
+
+		if (runIndexCount > 0)
+		{
+			deviceContext->DrawIndexed(runIndexCount, this->geometry.StartIndex + runStart, this->geometry.BaseVertex);
+			stats.DrawCalls++;
+		}
+		runStart = m.StartIndex;
+		runIndexCount = m.TriangleCount * 3;
+	}
+
+	if (runIndexCount > 0)
+	{
+		deviceContext->DrawIndexed(runIndexCount, this->geometry.StartIndex + runStart, this->geometry.BaseVertex);
+		stats.DrawCalls++;
+	}
+}
+
+Mesh::Mesh(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount, std::shared_ptr<GeometryPool> pool, bool positionStream)
+	: positionStream(positionStream)
 {
 	/*
 	DirectX::XMFLOAT4 red = DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f);
@@ -81,381 +386,333 @@ Mesh::Mesh(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCo
 	// this->deviceContext = deviceContext;
 
 	CalculateTangents(vertices, vertexCount, indices, indexCount);
+	this->bounds = ComputeMeshBounds(vertices, vertexCount);
+	BuildMeshlets(vertices, vertexCount, indices, indexCount, this->meshlets);
 
-	CreateBuffers(vertices, vertexCount, indices, indexCount, device);
+	StageGeometry(vertices, sizeof(Vertex), vertexCount, indices, indexCount);
+	Upload(pool);
 }
 
-Mesh::Mesh(const std::wstring& fileName, Microsoft::WRL::ComPtr<ID3D11Device> device)
+Mesh::Mesh(const std::wstring& fileName, std::shared_ptr<GeometryPool> pool, bool positionStream)
+	: Mesh(fileName, positionStream)
 {
-	// Author: Chris Cascioli
-	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
-	// 
-	// - You are allowed to directly copy/paste this into your code base
-	//   for assignments, given that you clearly cite that this is not
-	//   code of your own design.
-	//
-	// - NOTE: You'll need to #include <fstream>
-
-
-	// File input object
-	std::ifstream obj(fileName);
+	Upload(pool);
+}
 
-	// Check for successful open
-	if (!obj.is_open())
+// --------------------------------------------------------
+// Does all of the loading that doesn't need the device, so
+// it can run on any thread.  Upload() finishes the job.
+// --------------------------------------------------------
+Mesh::Mesh(const std::wstring& fileName, bool positionStream)
+	: positionStream(positionStream)
+{
+	// Map the source; its hash tells us whether the binary cache is current
+	MappedFile source(fileName);
+	if (!source.IsOpen())
 		return;
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;	// Positions from the file
-	std::vector<XMFLOAT3> normals;		// Normals from the file
-	std::vector<XMFLOAT2> uvs;		// UVs from the file
-	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
-	int vertCounter = 0;			// Count of vertices
-	int indexCounter = 0;			// Count of indices
-	char chars[100];			// String for line reading
-
-	// Still have data left?
-	while (obj.good())
-	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
+	uint64_t sourceHash = HashContents(source.GetData(), source.GetSize());
+	std::wstring cachePath = GetMeshCachePath(fileName);
 
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
+	// A current cache is staged straight from its mapping
+	{
+		MappedFile cacheFile(cachePath);
+		MeshCacheContents cached;
+		if (ReadMeshCache(cacheFile, sourceHash, cached))
 		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			unsigned int i[12];
-			int numbersRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// If we only got the first number, chances are the OBJ
-			// file has no UV coordinates.  This isn't great, but we
-			// still want to load the model without crashing, so we
-			// need to re-read a different pattern (in which we assume
-			// there are no UVs denoted for any of the vertices)
-			if (numbersRead == 1)
+			this->optimizationStats = cached.Stats;
+			this->bounds = cached.Bounds;
+			this->vertexLayout = cached.Layout;
+			this->quantization = cached.Quantization;
+			this->quantizationReport = cached.QuantizationError;
+			this->meshlets.assign(cached.Meshlets, cached.Meshlets + cached.MeshletCount);
+			this->lods.assign(cached.Lods, cached.Lods + cached.LodCount);
+			this->submeshLods.assign(cached.SubmeshLods, cached.SubmeshLods + cached.LodCount * cached.SubmeshCount);
+
+			// Names are stored back to back, each followed by its material
+			const char* name = cached.SubmeshNames;
+			for (unsigned int i = 0; i < cached.SubmeshCount; i++)
 			{
-				// Re-read with a different pattern
-				numbersRead = sscanf_s(
-					chars,
-					"f %d//%d %d//%d %d//%d %d//%d",
-					&i[0], &i[2],
-					&i[3], &i[5],
-					&i[6], &i[8],
-					&i[9], &i[11]);
-
-				// The following indices are where the UVs should 
-				// have been, so give them a valid value
-				i[1] = 1;
-				i[4] = 1;
-				i[7] = 1;
-				i[10] = 1;
-
-				// If we have no UVs, create a single UV coordinate
-				// that will be used for all vertices
-				if (uvs.size() == 0)
-					uvs.push_back(XMFLOAT2(0, 0));
+				MeshSubmesh submesh;
+				submesh.Name = name;
+				name += submesh.Name.size() + 1;
+				submesh.Material = name;
+				name += submesh.Material.size() + 1;
+				this->submeshes.push_back(submesh);
 			}
+			this->loadedFromCache = true;
 
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal's Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-			vertCounter += 3;
-
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-
-			// Was there a 4th face?
-			// - 12 numbers read means 4 faces WITH uv's
-			// - 8 numbers read means 4 faces WITHOUT uv's
-			if (numbersRead == 12 || numbersRead == 8)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal's Z
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-				vertCounter += 3;
-
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-			}
+			StageGeometry(cached.VertexData, cached.VertexStride, cached.VertexCount, cached.Indices, cached.IndexCount);
+			return;
 		}
 	}
 
-	// Close the file and create the actual buffers
-	obj.close();
+	// Otherwise tokenize the OBJ in place (see ObjParser.cpp)
+	ObjMeshData meshData;
+	if (!ParseObj(source.GetData(), source.GetSize(), meshData))
+		return;
 
-	// - At this point, "verts" is a vector of Vertex structs, and can be used
-	//    directly to create a vertex buffer:  &verts[0] is the address of the first vert
-	//
-	// - The vector "indices" is similar. It's a vector of unsigned ints and
-	//    can be used directly for the index buffer: &indices[0] is the address of the first int
-	//
-	// - "vertCounter" is the number of vertices
-	// - "indexCounter" is the number of indices
-	// - Yes, these are effectively the same since OBJs do not index entire vertices!  This means
-	//    an index buffer isn't doing much for us.  We could try to optimize the mesh ourselves
-	//    and detect duplicate vertices, but at that point it would be better to use a more
-	//    sophisticated model loading library like TinyOBJLoader or The Open Asset Importer Library
+	// OBJs do not index entire vertices, so every triangle arrives with three
+	// unique vertices.  Collapse the copies so shared vertices are only
+	// stored (and transformed) once.
+	this->optimizationStats.Weld = WeldVertices(meshData.Vertices, meshData.Indices);
+
+	// Welding also merges vertices across mirror seams in the UVs, which
+	// have to stay apart to get a tangent frame for each side
+	this->optimizationStats.MirroredVertexSplits = SplitMirroredVertices(meshData.Vertices, meshData.Indices);
+
+	// Now that triangles share vertices, their order decides how often
+	// the GPU can reuse an already transformed one.  This and the overdraw
+	// pass below only shuffle triangles within their own submesh.
+	MeshOptimizationStats& stats = this->optimizationStats;
+	stats.CacheBefore = SimulateVertexCache(meshData.Indices, meshData.Vertices.size());
+	ForEachSubmeshRange(meshData.Indices, meshData.Submeshes, [&](std::vector<unsigned int>& range)
+	{
+		OptimizeVertexCache(range, meshData.Vertices.size());
+	});
+
+	// Then shuffle whole clusters of that order to cut down on overdraw,
+	// keeping the old order if the outward-first heuristic backfires
+	// (it can on very noisy surfaces)
+	stats.OverdrawBefore = AnalyzeOverdraw(meshData.Indices, meshData.Vertices);
+	std::vector<unsigned int> cacheOrder = meshData.Indices;
+	ForEachSubmeshRange(meshData.Indices, meshData.Submeshes, [&](std::vector<unsigned int>& range)
+	{
+		OptimizeOverdraw(range, meshData.Vertices);
+	});
+	stats.OverdrawAfter = AnalyzeOverdraw(meshData.Indices, meshData.Vertices);
+	if (stats.OverdrawAfter.GetOverdraw() > stats.OverdrawBefore.GetOverdraw())
+	{
+		meshData.Indices.swap(cacheOrder);
+		stats.OverdrawAfter = stats.OverdrawBefore;
+	}
 
-	CalculateTangents(&verts[0], vertCounter, &indices[0], indexCounter);
+	// Finally lay the vertices out in the order they're first read.  This
+	// too is only kept if it helps, as it can interleave the rows of a
+	// regular grid that were already laid out well.
+	stats.FetchBefore = AnalyzeVertexFetch(meshData.Indices, meshData.Vertices.size(), sizeof(Vertex));
+	ObjMeshData fetchOrder = meshData;
+	OptimizeVertexFetch(fetchOrder.Vertices, fetchOrder.Indices);
+	stats.FetchAfter = AnalyzeVertexFetch(fetchOrder.Indices, fetchOrder.Vertices.size(), sizeof(Vertex));
+	if (stats.FetchAfter.GetOverfetch() <= stats.FetchBefore.GetOverfetch())
+		meshData = std::move(fetchOrder);
+	else
+		stats.FetchAfter = stats.FetchBefore;
 
-	CreateBuffers(&verts[0], vertCounter, &indices[0], indexCounter, device);
-}
+	stats.CacheAfter = SimulateVertexCache(meshData.Indices, meshData.Vertices.size());
 
-void Mesh::CreateBuffers(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device)
-{
-	// Create a VERTEX BUFFER
-	// - This holds the vertex data of triangles for a single object
-	// - This buffer is created on the GPU, which is where the data needs to
-	//    be if we want the GPU to act on it (as in: draw it to the screen)
+	int vertCounter = (int)meshData.Vertices.size();
+	int indexCounter = (int)meshData.Indices.size();
+
+	CalculateTangents(&meshData.Vertices[0], vertCounter, &meshData.Indices[0], indexCounter);
+
+	this->bounds = ComputeMeshBounds(&meshData.Vertices[0], vertCounter);
+
+	// Every submesh draws from ranges of the same buffers
+	std::vector<MeshLod> submeshRanges;
+	for (const ObjSubmesh& s : meshData.Submeshes)
+	{
+		this->submeshes.push_back({ s.Name, s.Material });
+		submeshRanges.push_back({ s.StartIndex, s.IndexCount, 0.0f });
+	}
+
+	// Simplified levels of detail go after the full index list, in the
+	// same buffer.  Collapses that would move the surface by more than a
+	// quarter of the mesh's size are never worth making.
+	float boundsRadius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&this->bounds.Box.Extents)));
+	std::vector<unsigned int> lodIndices;
+	BuildLodChain(&meshData.Vertices[0], vertCounter, &meshData.Indices[0], indexCounter,
+		submeshRanges.data(), submeshRanges.size(), boundsRadius * 0.25f, lodIndices, this->lods, this->submeshLods);
+
+	// Use the 20 byte CompactVertex instead of the 48 byte Vertex
+	// whenever the mesh survives quantization within tolerance
+	this->quantization = ComputeVertexQuantization(&meshData.Vertices[0], vertCounter);
+	std::vector<CompactVertex> compactVertices;
+	QuantizeVertices(&meshData.Vertices[0], vertCounter, this->quantization, compactVertices);
+	this->quantizationReport = MeasureQuantizationError(&meshData.Vertices[0], &compactVertices[0], vertCounter, this->quantization);
+
+	const void* vertexData = &meshData.Vertices[0];
+	unsigned int vertexStride = sizeof(Vertex);
+	if (this->quantizationReport.IsWithin(QuantizationTolerance()))
+	{
+		this->vertexLayout = VertexLayout::Compact;
+		vertexData = &compactVertices[0];
+		vertexStride = sizeof(CompactVertex);
+	}
+
+	// Split the final triangle order into meshlets for finer culling.
+	// Their spheres, and the mesh's bounds, grow by the quantization
+	// error, as the GPU sees the decoded positions rather than these.
+	BuildMeshlets(&meshData.Vertices[0], vertCounter, &meshData.Indices[0], indexCounter, this->meshlets);
+	if (this->vertexLayout == VertexLayout::Compact)
 	{
-		// First, we need to describe the buffer we want Direct3D to make on the GPU
-		//  - Note that this variable is created on the stack since we only need it once
-		//  - After the buffer is created, this description variable is unnecessary
-		D3D11_BUFFER_DESC vbd = {};
-		vbd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
-		vbd.ByteWidth = sizeof(Vertex) * vertexCount;       // 3 = number of vertices in the buffer
-		vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; // Tells Direct3D this is a vertex buffer
-		vbd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
-		vbd.MiscFlags = 0;
-		vbd.StructureByteStride = 0;
-
-		// Create the proper struct to hold the initial vertex data
-		// - This is how we initially fill the buffer with data
-		// - Essentially, we're specifying a pointer to the data to copy
-		D3D11_SUBRESOURCE_DATA initialVertexData = {};
-		initialVertexData.pSysMem = vertices; // pSysMem = Pointer to System Memory
-
-		// Actually create the buffer on the GPU with the initial data
-		// - Once we do this, we'll NEVER CHANGE DATA IN THE BUFFER AGAIN
-		device->CreateBuffer(&vbd, &initialVertexData, this->vertexBuffer.GetAddressOf());
+		for (Meshlet& m : this->meshlets)
+			m.Radius += this->quantizationReport.MaxPositionError;
+		ExpandMeshBounds(this->bounds, this->quantizationReport.MaxPositionError);
 	}
 
-	// Create an INDEX BUFFER
-	// - This holds indices to elements in the vertex buffer
-	// - This is most useful when vertices are shared among neighboring triangles
-	// - This buffer is created on the GPU, which is where the data needs to
-	//    be if we want the GPU to act on it (as in: draw it to the screen)
+	StageGeometry(vertexData, vertexStride, vertCounter, &lodIndices[0], (int)lodIndices.size());
+
+	// Save the finished arrays so the next run can skip all of the above
+	MeshCacheContents contents;
+	contents.VertexData = vertexData;
+	contents.VertexStride = vertexStride;
+	contents.VertexCount = vertCounter;
+	contents.Layout = this->vertexLayout;
+	contents.Indices = &lodIndices[0];
+	contents.IndexCount = (unsigned int)lodIndices.size();
+	contents.Bounds = this->bounds;
+	contents.Quantization = this->quantization;
+	contents.QuantizationError = this->quantizationReport;
+	contents.Meshlets = this->meshlets.data();
+	contents.MeshletCount = (unsigned int)this->meshlets.size();
+	contents.Lods = this->lods.data();
+	contents.LodCount = (unsigned int)this->lods.size();
+	std::string submeshNames;
+	for (const MeshSubmesh& submesh : this->submeshes)
 	{
-		// Describe the buffer, as we did above, with two major differences
-		//  - Byte Width (3 unsigned integers vs. 3 whole vertices)
-		//  - Bind Flag (used as an index buffer instead of a vertex buffer) 
-		D3D11_BUFFER_DESC ibd = {};
-		ibd.Usage = D3D11_USAGE_IMMUTABLE;	// Will NEVER change
-		ibd.ByteWidth = sizeof(unsigned int) * indexCount;	// 3 = number of indices in the buffer
-		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;	// Tells Direct3D this is an index buffer
-		ibd.CPUAccessFlags = 0;	// Note: We cannot access the data from C++ (this is good)
-		ibd.MiscFlags = 0;
-		ibd.StructureByteStride = 0;
-
-		// Specify the initial data for this buffer, similar to above
-		D3D11_SUBRESOURCE_DATA initialIndexData = {};
-		initialIndexData.pSysMem = indices; // pSysMem = Pointer to System Memory
-
-		// Actually create the buffer with the initial data
-		// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
-		device->CreateBuffer(&ibd, &initialIndexData, this->indexBuffer.GetAddressOf());
-
-		this->indicesCount = indexCount;
+		submeshNames.append(submesh.Name).push_back('\0');
+		submeshNames.append(submesh.Material).push_back('\0');
 	}
+	contents.SubmeshLods = this->submeshLods.data();
+	contents.SubmeshCount = (unsigned int)this->submeshes.size();
+	contents.SubmeshNames = submeshNames.data();
+	contents.SubmeshNameBytes = (unsigned int)submeshNames.size();
+	contents.Stats = this->optimizationStats;
+	WriteMeshCache(cachePath, sourceHash, contents);
 }
 
 // --------------------------------------------------------
-// Author: Chris Cascioli
-// Purpose: Calculates the tangents of the vertices in a mesh
-// 
-// - You are allowed to directly copy/paste this into your code base
-//   for assignments, given that you clearly cite that this is not
-//   code of your own design.
-//
-// - Code originally adapted from: http://www.terathon.com/code/tangent.html
-//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
-//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
-//
-// - Note: For this code to work, your Vertex format must
-//         contain an XMFLOAT3 called Tangent
-//
-// - Be sure to call this BEFORE creating your D3D vertex/index buffers
+// Keeps copies of the final vertices and indices (and the
+// position stream) until Upload() moves them into the
+// shared geometry pool
 // --------------------------------------------------------
-void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+void Mesh::StageGeometry(const void* vertices, unsigned int vertexStride, int vertexCount, const unsigned int* indices, int indexCount)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
+	const unsigned char* vertexBytes = (const unsigned char*)vertices;
+	this->stagedVertices.assign(vertexBytes, vertexBytes + (size_t)vertexStride * vertexCount);
+
+	// Meshes with few enough vertices get 16-bit indices, halving their
+	// share of the index buffer (and the bandwidth the input assembler
+	// spends reading it).  Indices are relative to the mesh's base vertex,
+	// so this holds however full the pool's vertex buffer is.
+	UINT indexSize = sizeof(unsigned int);
+	this->indexFormat = DXGI_FORMAT_R32_UINT;
+	if (vertexCount <= 0x10000)
+	{
+		indexSize = sizeof(unsigned short);
+		this->indexFormat = DXGI_FORMAT_R16_UINT;
+	}
+
+	this->stagedIndices.resize((size_t)indexSize * indexCount);
+	if (indexSize == sizeof(unsigned short))
+	{
+		unsigned short* shortIndices = (unsigned short*)this->stagedIndices.data();
+		for (int i = 0; i < indexCount; i++)
+			shortIndices[i] = (unsigned short)indices[i];
+	}
+	else if (indexCount > 0)
 	{
-		verts[i].Tangent = XMFLOAT3(0, 0, 0);
+		memcpy(this->stagedIndices.data(), indices, this->stagedIndices.size());
 	}
 
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
+	// Both layouts lead with the position (the compact one with the
+	// tangent's handedness tucked in its w), so the stream is just the
+	// front of each vertex: 12 of 48 bytes, or 8 of 20
+	unsigned int positionStride = this->vertexLayout == VertexLayout::Compact ? sizeof(CompactVertex::Position) : sizeof(Vertex::Position);
+	if (this->positionStream)
 	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx;
-		v1->Tangent.y += ty;
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx;
-		v2->Tangent.y += ty;
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx;
-		v3->Tangent.y += ty;
-		v3->Tangent.z += tz;
+		this->stagedPositions.resize((size_t)positionStride * vertexCount);
+		for (int i = 0; i < vertexCount; i++)
+			memcpy(&this->stagedPositions[(size_t)i * positionStride], vertexBytes + (size_t)i * vertexStride, positionStride);
 	}
 
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
+	this->verticesCount = vertexCount;
+	this->vertexStride = vertexStride;
+	this->indexBufferBytes = indexSize * indexCount;
+
+	// Any levels of detail follow the full mesh in the same range
+	if (this->lods.empty())
+		this->lods.push_back({ 0, (unsigned int)indexCount, 0.0f });
+
+	// Meshes built in code are a single, unnamed submesh
+	if (this->submeshes.empty())
 	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].Tangent);
+		this->submeshes.push_back(MeshSubmesh());
+		this->submeshLods = this->lods;
+	}
+	this->indicesCount = this->lods[0].IndexCount;
+}
+
+// --------------------------------------------------------
+// Copies the staged geometry into the pool and lets the
+// copies go.  Uses the device context, so only call it on
+// the thread that owns it.  Nothing is bound per mesh; draws
+// offset into the pool's buffers with StartIndex and
+// BaseVertex.
+// --------------------------------------------------------
+bool Mesh::Upload(std::shared_ptr<GeometryPool> pool)
+{
+	if (this->uploaded || this->verticesCount == 0)
+		return this->uploaded;
+
+	unsigned int indexSize = this->indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int);
+	unsigned int indexCount = (unsigned int)(this->stagedIndices.size() / indexSize);
+	unsigned int positionStride = (unsigned int)(this->stagedPositions.size() / this->verticesCount);
+	if (!pool->Allocate(this->stagedVertices.data(), this->vertexStride, this->verticesCount, this->stagedIndices.data(), this->indexFormat, indexCount,
+		this->geometry, this->stagedPositions.empty() ? 0 : this->stagedPositions.data(), positionStride))
+		return false;
+
+	this->pool = pool;
+	this->uploaded = true;
+	std::vector<unsigned char>().swap(this->stagedVertices);
+	std::vector<unsigned char>().swap(this->stagedIndices);
+	std::vector<unsigned char>().swap(this->stagedPositions);
+	return true;
+}
 
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
+bool Mesh::IsUploaded()
+{
+	return this->uploaded;
+}
+
+// --------------------------------------------------------
+// Reads positions back out of the staged vertices, decoding
+// them if the mesh was quantized, so hits land on the same
+// surface the GPU draws
+// --------------------------------------------------------
+bool Mesh::BuildBvh()
+{
+	if (this->uploaded || this->verticesCount == 0)
+		return !this->bvh.IsEmpty();
 
-		// Store the tangent
-		XMStoreFloat3(&verts[i].Tangent, tangent);
+	std::vector<XMFLOAT3> positions(this->verticesCount);
+	for (int i = 0; i < this->verticesCount; i++)
+	{
+		const unsigned char* vertex = &this->stagedVertices[(size_t)i * this->vertexStride];
+		if (this->vertexLayout == VertexLayout::Compact)
+			positions[i] = DequantizeVertex(*(const CompactVertex*)vertex, this->quantization).Position;
+		else
+			memcpy(&positions[i], vertex, sizeof(XMFLOAT3));
+	}
+
+	// Only the full detail range; levels of detail follow it
+	std::vector<unsigned int> indices(this->lods[0].IndexCount);
+	const unsigned char* indexBytes = this->stagedIndices.data() + (this->indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int)) * this->lods[0].StartIndex;
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		if (this->indexFormat == DXGI_FORMAT_R16_UINT)
+			indices[i] = ((const unsigned short*)indexBytes)[i];
+		else
+			indices[i] = ((const unsigned int*)indexBytes)[i];
 	}
+
+	this->bvh.Build(positions.data(), (unsigned int)positions.size(), indices.data(), (unsigned int)indices.size());
+	return !this->bvh.IsEmpty();
 }
 
 Mesh::~Mesh()
 {
-
+	if (this->uploaded)
+		this->pool->Free(this->geometry);
 }
\ No newline at end of file
@@ -4,31 +4,106 @@
 #include <d3d11.h>
 #include <wrl/client.h> // Used for ComPtr - a smart pointer for COM objects
 #include "Vertex.h"
+#include "MeshOptimizer.h"
+#include "VertexQuantization.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "MeshBounds.h"
+#include "MeshBvh.h"
+#include "SimpleShader.h"
+#include "GeometryPool.h"
 #include <DirectXMath.h>
 #include <vector>
 #include <string>
+#include <memory>
+
+// One part of a mesh: an OBJ object or group, split by material.  Its
+// triangles are a range of every level of detail (see GetSubmeshLod()).
+struct MeshSubmesh
+{
+	std::string Name;
+	std::string Material;	// Material slot name, from "usemtl"
+};
 
 class Mesh
 {
 private:
-	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	// Vertices and indices live in the shared pool; this is where
+	std::shared_ptr<GeometryPool> pool;
+	GeometryAllocation geometry;
+	bool positionStream = true;	// Also keep a position-only copy, for DrawPositionOnly()
+	bool uploaded = false;
+
+	// The final geometry, held from loading until Upload()
+	std::vector<unsigned char> stagedVertices;
+	std::vector<unsigned char> stagedIndices;	// Already in indexFormat
+	std::vector<unsigned char> stagedPositions;
 	// Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
 	int indicesCount = 0;
+	int verticesCount = 0;
+	DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT;
+	unsigned int indexBufferBytes = 0;
+	MeshOptimizationStats optimizationStats;
+	bool loadedFromCache = false;
+	MeshBounds bounds;	// Local space
+	MeshBvh bvh;		// Local space too; only built on request
+	VertexLayout vertexLayout = VertexLayout::Full;
+	unsigned int vertexStride = sizeof(Vertex);
+	VertexQuantization quantization = {};
+	QuantizationReport quantizationReport;
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshLod> lods;
+	std::vector<MeshSubmesh> submeshes;
+	std::vector<MeshLod> submeshLods;	// [lod * submesh count + submesh]
 
-	void CreateBuffers(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device);
+	void StageGeometry(const void* vertices, unsigned int vertexStride, int vertexCount, const unsigned int* indices, int indexCount);
 
 public:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
 	int GetIndexCount();
+	int GetVertexCount();
+	DXGI_FORMAT GetIndexFormat();
+	unsigned int GetIndexBufferBytes();
+	MeshOptimizationStats GetOptimizationStats();
+	bool IsLoadedFromCache();
+	const DirectX::BoundingBox& GetBoundingBox();
+	const DirectX::BoundingSphere& GetBoundingSphere();
+	bool HasBvh();
+	const MeshBvh& GetBvh();
+	bool Raycast(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, float maxDistance, RayHit& hit);
+	VertexLayout GetVertexLayout();
+	QuantizationReport GetQuantizationReport();
+	const std::vector<Meshlet>& GetMeshlets();
+	const std::vector<MeshLod>& GetLods();
+	const std::vector<MeshSubmesh>& GetSubmeshes();
+	const MeshLod& GetSubmeshLod(unsigned int submesh, unsigned int lod);
+	unsigned int SelectLod(const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, float maxScreenError);
+	std::shared_ptr<SimpleVertexShader> PrepareVertexShader(std::shared_ptr<SimpleVertexShader> fullShader, std::shared_ptr<SimpleVertexShader> compactShader);
+	bool Bind(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext);
+	void DrawSubmesh(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, unsigned int submesh, unsigned int lod = 0);
 	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext);
-	Mesh(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount, Microsoft::WRL::ComPtr<ID3D11Device> device);
+	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, const MeshletCullingView& view, MeshletCullingStats& stats);
+	void Draw(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, unsigned int lod);
+	void DrawPositionOnly(Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext, unsigned int lod = 0);
+	bool HasPositionStream();
+	Mesh(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount, std::shared_ptr<GeometryPool> pool, bool positionStream = true);
 	~Mesh();
+
+	// Owns a range of the pool, so copies would free it twice
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
 	
 	// Assignment 6
-	Mesh(const std::wstring& fileName, Microsoft::WRL::ComPtr<ID3D11Device> device);
+	Mesh(const std::wstring& fileName, std::shared_ptr<GeometryPool> pool, bool positionStream = true);
+
+	// Loads without touching the device, for loading off the main thread;
+	// the mesh draws nothing until Upload() puts it in a pool
+	Mesh(const std::wstring& fileName, bool positionStream = true);
+	bool Upload(std::shared_ptr<GeometryPool> pool);
+	bool IsUploaded();
 
-	// Assignment 9
-	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	// Builds the BVH for Raycast() from the full detail triangles.  Needs
+	// the staged geometry, so it has to come before Upload().
+	bool BuildBvh();
 };
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "MeshBounds.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+
+using namespace DirectX;
+
+// Shrink-and-regrow attempts after the first Ritter pass
+#define RITTER_REFINEMENT_PASSES 8
+
+namespace
+{
+	// --------------------------------------------------------
+	// Min/max reduction over the positions.  Two independent
+	// pairs of accumulators keep consecutive iterations from
+	// waiting on each other.
+	// --------------------------------------------------------
+	void ReduceMinMax(const Vertex* vertices, unsigned int vertexCount, XMVECTOR& boundsMin, XMVECTOR& boundsMax)
+	{
+		XMVECTOR min0 = XMLoadFloat3(&vertices[0].Position);
+		XMVECTOR max0 = min0;
+		XMVECTOR min1 = min0;
+		XMVECTOR max1 = min0;
+
+		unsigned int i = 1;
+		for (; i + 1 < vertexCount; i += 2)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[i].Position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[i + 1].Position);
+			min0 = XMVectorMin(min0, p0);
+			max0 = XMVectorMax(max0, p0);
+			min1 = XMVectorMin(min1, p1);
+			max1 = XMVectorMax(max1, p1);
+		}
+		if (i < vertexCount)
+		{
+			XMVECTOR p = XMLoadFloat3(&vertices[i].Position);
+			min0 = XMVectorMin(min0, p);
+			max0 = XMVectorMax(max0, p);
+		}
+
+		boundsMin = XMVectorMin(min0, min1);
+		boundsMax = XMVectorMax(max0, max1);
+	}
+
+	// --------------------------------------------------------
+	// Moves and grows the sphere over every position in turn,
+	// starting at "first" and wrapping around.  Each point
+	// outside so far pulls the sphere over just far enough to
+	// reach it while still enclosing the old sphere, so once
+	// the pass is done every position is inside.
+	// --------------------------------------------------------
+	void GrowToFit(const Vertex* vertices, unsigned int vertexCount, unsigned int first, XMVECTOR& center, float& radius)
+	{
+		float radiusSq = radius * radius;
+		for (unsigned int n = 0, i = first; n < vertexCount; n++, i = (i + 1 == vertexCount ? 0 : i + 1))
+		{
+			XMVECTOR offset = XMLoadFloat3(&vertices[i].Position) - center;
+			float distanceSq = XMVectorGetX(XMVector3LengthSq(offset));
+			if (distanceSq <= radiusSq)
+				continue;
+
+			float distance = std::sqrt(distanceSq);
+			float newRadius = (radius + distance) * 0.5f;
+			center += offset * ((newRadius - radius) / distance);
+			radius = newRadius;
+			radiusSq = radius * radius;
+		}
+	}
+
+	// --------------------------------------------------------
+	// Ritter's bounding sphere, seeded with the most distant
+	// pair of axis extremes
+	// --------------------------------------------------------
+	BoundingSphere RitterSphere(const Vertex* vertices, unsigned int vertexCount)
+	{
+		// The vertices furthest along -x, +x, -y, +y, -z and +z
+		unsigned int extremes[6] = {};
+		for (unsigned int i = 1; i < vertexCount; i++)
+		{
+			const XMFLOAT3& p = vertices[i].Position;
+			const float* coordinates = &p.x;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (coordinates[axis] < (&vertices[extremes[axis * 2]].Position.x)[axis])
+					extremes[axis * 2] = i;
+				if (coordinates[axis] > (&vertices[extremes[axis * 2 + 1]].Position.x)[axis])
+					extremes[axis * 2 + 1] = i;
+			}
+		}
+
+		// Start from the pair that's furthest apart
+		XMVECTOR a = XMLoadFloat3(&vertices[extremes[0]].Position);
+		XMVECTOR b = XMLoadFloat3(&vertices[extremes[1]].Position);
+		for (int axis = 1; axis < 3; axis++)
+		{
+			XMVECTOR low = XMLoadFloat3(&vertices[extremes[axis * 2]].Position);
+			XMVECTOR high = XMLoadFloat3(&vertices[extremes[axis * 2 + 1]].Position);
+			if (XMVectorGetX(XMVector3LengthSq(high - low)) > XMVectorGetX(XMVector3LengthSq(b - a)))
+			{
+				a = low;
+				b = high;
+			}
+		}
+
+		XMVECTOR center = (a + b) * 0.5f;
+		float radius = XMVectorGetX(XMVector3Length(b - a)) * 0.5f;
+		GrowToFit(vertices, vertexCount, 0, center, radius);
+
+		// Ritter's sphere usually comes out 5-20% too big.  Shrinking it
+		// a little and growing it again, each time starting from a
+		// different vertex, often finds a tighter fit (Ericson's
+		// iterative refinement, in Real-Time Collision Detection).
+		for (unsigned int attempt = 1; attempt <= RITTER_REFINEMENT_PASSES; attempt++)
+		{
+			XMVECTOR tryCenter = center;
+			float tryRadius = radius * 0.95f;
+			GrowToFit(vertices, vertexCount, (unsigned int)((uint64_t)vertexCount * attempt / (RITTER_REFINEMENT_PASSES + 1)), tryCenter, tryRadius);
+			if (tryRadius < radius)
+			{
+				center = tryCenter;
+				radius = tryRadius;
+			}
+		}
+
+		// Rounding in the moves above can leave a point a hair outside
+		BoundingSphere sphere;
+		XMStoreFloat3(&sphere.Center, center);
+		sphere.Radius = radius * (1.0f + 4.0f * FLT_EPSILON);
+		return sphere;
+	}
+}
+
+MeshBounds ComputeMeshBounds(const Vertex* vertices, unsigned int vertexCount)
+{
+	MeshBounds bounds;
+	if (vertexCount == 0)
+	{
+		bounds.Box = BoundingBox(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0));
+		bounds.Sphere = BoundingSphere(XMFLOAT3(0, 0, 0), 0.0f);
+		return bounds;
+	}
+
+	XMVECTOR boundsMin;
+	XMVECTOR boundsMax;
+	ReduceMinMax(vertices, vertexCount, boundsMin, boundsMax);
+	// Rounding the center and extents can pull the box's faces in past
+	// the outermost positions, so give them a few ulps of slack
+	XMVECTOR center = (boundsMin + boundsMax) * 0.5f;
+	XMVECTOR extents = (boundsMax - boundsMin) * 0.5f;
+	extents += (XMVectorAbs(center) + extents) * (4.0f * FLT_EPSILON);
+	XMStoreFloat3(&bounds.Box.Center, center);
+	XMStoreFloat3(&bounds.Box.Extents, extents);
+
+	bounds.Sphere = RitterSphere(vertices, vertexCount);
+	float boxRadius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Box.Extents)));
+	if (boxRadius < bounds.Sphere.Radius)
+		bounds.Sphere = BoundingSphere(bounds.Box.Center, boxRadius);
+
+	return bounds;
+}
+
+void ExpandMeshBounds(MeshBounds& bounds, float margin)
+{
+	XMStoreFloat3(&bounds.Box.Extents, XMLoadFloat3(&bounds.Box.Extents) + XMVectorReplicate(margin));
+	bounds.Sphere.Radius += margin;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Vertex.h"
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+// --------------------------------------------------------
+// A mesh's local-space bounds, worked out once when it's
+// built (and kept in its binary cache) so culling, shadow
+// fitting and picking never need to read vertices again
+//
+// - Box: the exact axis-aligned bounds of the positions
+// - Sphere: Ritter's approximation, then a few rounds of
+//   shrinking and regrowing it to tighten the fit.  On the
+//   odd mesh where the box's own sphere is tighter, that
+//   one is kept instead.
+// --------------------------------------------------------
+struct MeshBounds
+{
+	DirectX::BoundingBox Box;
+	DirectX::BoundingSphere Sphere;
+};
+
+MeshBounds ComputeMeshBounds(const Vertex* vertices, unsigned int vertexCount);
+
+// Grows both by "margin" in every direction, to cover positions that
+// are only known to within that much (see QuantizationReport)
+void ExpandMeshBounds(MeshBounds& bounds, float margin);
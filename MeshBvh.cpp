@@ -0,0 +1,472 @@
+#include "MeshBvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// Centroid bins per axis when looking for the cheapest split
+#define MESH_BVH_BINS 16
+
+namespace
+{
+	// A leaf tests its (up to) four triangles in one go, so what a
+	// subtree costs to intersect goes by blocks of four, not triangles
+	float BlockCost(unsigned int triangleCount)
+	{
+		return (float)((triangleCount + 3) / 4);
+	}
+
+	float HalfSurfaceArea(FXMVECTOR boundsMin, FXMVECTOR boundsMax)
+	{
+		XMFLOAT3 size;
+		XMStoreFloat3(&size, XMVectorMax(boundsMax - boundsMin, XMVectorZero()));
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+
+	// --------------------------------------------------------
+	// Slab test against a node's box, giving the distance the
+	// ray enters it at.  Misses if that's past "closest".
+	// --------------------------------------------------------
+	bool IntersectBox(const MeshBvhNode& node, FXMVECTOR origin, FXMVECTOR inverseDirection, float closest, float& enter)
+	{
+		XMVECTOR t1 = (XMLoadFloat3(&node.Min) - origin) * inverseDirection;
+		XMVECTOR t2 = (XMLoadFloat3(&node.Max) - origin) * inverseDirection;
+		XMVECTOR tNear = XMVectorMin(t1, t2);
+		XMVECTOR tFar = XMVectorMax(t1, t2);
+
+		enter = std::max(std::max(XMVectorGetX(tNear), XMVectorGetY(tNear)), std::max(XMVectorGetZ(tNear), 0.0f));
+		float exit = std::min(std::min(XMVectorGetX(tFar), XMVectorGetY(tFar)), std::min(XMVectorGetZ(tFar), closest));
+		return enter <= exit;
+	}
+
+	// --------------------------------------------------------
+	// Widens a box by one float step on every side.  A ray
+	// running along an axis has an infinite reciprocal there,
+	// and starting on one of a box's faces gives zero times
+	// infinity, a NaN that fails the slab test.  Nothing inside
+	// a padded box touches its faces, so the ray that trips over
+	// one can't hit anything in there anyway.
+	// --------------------------------------------------------
+	void PadOutward(MeshBvhNode& node)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float& low = (&node.Min.x)[axis];
+			float& high = (&node.Max.x)[axis];
+			low = std::nextafter(low, -FLT_MAX);
+			high = std::nextafter(high, FLT_MAX);
+		}
+	}
+
+	// --------------------------------------------------------
+	// The same test against both children of a node at once,
+	// as they're next to each other.  Works in lanes laid out
+	// (left, left, right, right) so the horizontal min and max
+	// are a shuffle each.  Returns a bit per child hit (1 for
+	// the left, 2 for the right) and their entry distances.
+	// --------------------------------------------------------
+	unsigned int IntersectChildren(const MeshBvhNode* children, FXMVECTOR origin, FXMVECTOR inverseDirection, FXMVECTOR closest, float& enterLeft, float& enterRight)
+	{
+		XMVECTOR t1 = (XMLoadFloat3(&children[0].Min) - origin) * inverseDirection;
+		XMVECTOR t2 = (XMLoadFloat3(&children[0].Max) - origin) * inverseDirection;
+		XMVECTOR leftNear = XMVectorMin(t1, t2);
+		XMVECTOR leftFar = XMVectorMax(t1, t2);
+		t1 = (XMLoadFloat3(&children[1].Min) - origin) * inverseDirection;
+		t2 = (XMLoadFloat3(&children[1].Max) - origin) * inverseDirection;
+		XMVECTOR rightNear = XMVectorMin(t1, t2);
+		XMVECTOR rightFar = XMVectorMax(t1, t2);
+
+		// (x, y) against (z, z), then the two halves against each other
+		XMVECTOR enter = XMVectorMax(XMVectorPermute<0, 1, 4, 5>(leftNear, rightNear), XMVectorPermute<2, 2, 6, 6>(leftNear, rightNear));
+		XMVECTOR exit = XMVectorMin(XMVectorPermute<0, 1, 4, 5>(leftFar, rightFar), XMVectorPermute<2, 2, 6, 6>(leftFar, rightFar));
+		enter = XMVectorMax(XMVectorMax(enter, XMVectorSwizzle<1, 0, 3, 2>(enter)), XMVectorZero());
+		exit = XMVectorMin(XMVectorMin(exit, XMVectorSwizzle<1, 0, 3, 2>(exit)), closest);
+		XMVECTOR hit = XMVectorLessOrEqual(enter, exit);
+
+		enterLeft = XMVectorGetX(enter);
+		enterRight = XMVectorGetZ(enter);
+		return (XMVectorGetIntX(hit) & 1) | (XMVectorGetIntZ(hit) & 2);
+	}
+
+	// --------------------------------------------------------
+	// Moller-Trumbore against all four triangles of a block at
+	// once, each lane of every vector being one triangle
+	// --------------------------------------------------------
+	bool IntersectBlock(const MeshBvhTriangleBlock& block, FXMVECTOR originX, FXMVECTOR originY, FXMVECTOR originZ,
+		GXMVECTOR directionX, HXMVECTOR directionY, HXMVECTOR directionZ, RayHit& hit)
+	{
+		XMVECTOR edge1X = XMLoadFloat4A(&block.Edge1[0]);
+		XMVECTOR edge1Y = XMLoadFloat4A(&block.Edge1[1]);
+		XMVECTOR edge1Z = XMLoadFloat4A(&block.Edge1[2]);
+		XMVECTOR edge2X = XMLoadFloat4A(&block.Edge2[0]);
+		XMVECTOR edge2Y = XMLoadFloat4A(&block.Edge2[1]);
+		XMVECTOR edge2Z = XMLoadFloat4A(&block.Edge2[2]);
+
+		// p = direction x edge2, and the determinant edge1 . p
+		XMVECTOR pX = XMVectorNegativeMultiplySubtract(directionZ, edge2Y, XMVectorMultiply(directionY, edge2Z));
+		XMVECTOR pY = XMVectorNegativeMultiplySubtract(directionX, edge2Z, XMVectorMultiply(directionZ, edge2X));
+		XMVECTOR pZ = XMVectorNegativeMultiplySubtract(directionY, edge2X, XMVectorMultiply(directionX, edge2Y));
+		XMVECTOR determinant = XMVectorMultiplyAdd(edge1X, pX, XMVectorMultiplyAdd(edge1Y, pY, XMVectorMultiply(edge1Z, pZ)));
+		XMVECTOR inverseDeterminant = XMVectorReciprocal(determinant);
+
+		XMVECTOR toOriginX = XMVectorSubtract(originX, XMLoadFloat4A(&block.Vertex0[0]));
+		XMVECTOR toOriginY = XMVectorSubtract(originY, XMLoadFloat4A(&block.Vertex0[1]));
+		XMVECTOR toOriginZ = XMVectorSubtract(originZ, XMLoadFloat4A(&block.Vertex0[2]));
+		XMVECTOR u = XMVectorMultiply(inverseDeterminant,
+			XMVectorMultiplyAdd(toOriginX, pX, XMVectorMultiplyAdd(toOriginY, pY, XMVectorMultiply(toOriginZ, pZ))));
+
+		// q = toOrigin x edge1
+		XMVECTOR qX = XMVectorNegativeMultiplySubtract(toOriginZ, edge1Y, XMVectorMultiply(toOriginY, edge1Z));
+		XMVECTOR qY = XMVectorNegativeMultiplySubtract(toOriginX, edge1Z, XMVectorMultiply(toOriginZ, edge1X));
+		XMVECTOR qZ = XMVectorNegativeMultiplySubtract(toOriginY, edge1X, XMVectorMultiply(toOriginX, edge1Y));
+		XMVECTOR v = XMVectorMultiply(inverseDeterminant,
+			XMVectorMultiplyAdd(directionX, qX, XMVectorMultiplyAdd(directionY, qY, XMVectorMultiply(directionZ, qZ))));
+		XMVECTOR t = XMVectorMultiply(inverseDeterminant,
+			XMVectorMultiplyAdd(edge2X, qX, XMVectorMultiplyAdd(edge2Y, qY, XMVectorMultiply(edge2Z, qZ))));
+
+		// Degenerate lanes (including the unused ones) fail the first test
+		XMVECTOR zero = XMVectorZero();
+		XMVECTOR mask = XMVectorGreater(XMVectorAbs(determinant), XMVectorReplicate(1e-20f));
+		mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(u, zero));
+		mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(v, zero));
+		mask = XMVectorAndInt(mask, XMVectorLessOrEqual(XMVectorAdd(u, v), XMVectorSplatOne()));
+		mask = XMVectorAndInt(mask, XMVectorGreaterOrEqual(t, zero));
+		mask = XMVectorAndInt(mask, XMVectorLess(t, XMVectorReplicate(hit.Distance)));
+		if (XMVector4EqualInt(mask, zero))
+			return false;
+
+		XMFLOAT4A distances;
+		XMFLOAT4A us;
+		XMFLOAT4A vs;
+		XMStoreFloat4A(&distances, XMVectorSelect(XMVectorReplicate(FLT_MAX), t, mask));
+		XMStoreFloat4A(&us, u);
+		XMStoreFloat4A(&vs, v);
+
+		const float* laneDistances = &distances.x;
+		int lane = 0;
+		for (int i = 1; i < 4; i++)
+		{
+			if (laneDistances[i] < laneDistances[lane])
+				lane = i;
+		}
+
+		hit.Distance = laneDistances[lane];
+		hit.Triangle = block.Triangles[lane];
+		hit.U = (&us.x)[lane];
+		hit.V = (&vs.x)[lane];
+		return true;
+	}
+}
+
+void MeshBvh::Build(const XMFLOAT3* positions, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount)
+{
+	this->nodes.clear();
+	this->blocks.clear();
+	this->depth = 0;
+	this->triangleCount = indexCount / 3;
+	if (this->triangleCount == 0 || vertexCount == 0)
+		return;
+
+	std::vector<BuildTriangle> triangles(this->triangleCount);
+	for (unsigned int i = 0; i < this->triangleCount; i++)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&positions[indices[i * 3]]);
+		XMVECTOR p1 = XMLoadFloat3(&positions[indices[i * 3 + 1]]);
+		XMVECTOR p2 = XMLoadFloat3(&positions[indices[i * 3 + 2]]);
+		XMVECTOR triangleMin = XMVectorMin(p0, XMVectorMin(p1, p2));
+		XMVECTOR triangleMax = XMVectorMax(p0, XMVectorMax(p1, p2));
+
+		XMStoreFloat3(&triangles[i].Min, triangleMin);
+		XMStoreFloat3(&triangles[i].Max, triangleMax);
+		XMStoreFloat3(&triangles[i].Centroid, (triangleMin + triangleMax) * 0.5f);
+		triangles[i].Index = i;
+	}
+
+	// A leaf can hold a single triangle, so there can be as many leaves
+	// as triangles and, with two children to every split, 2n - 1 nodes.
+	// Leaves usually hold more, so the blocks start at half that.
+	this->nodes.reserve(this->triangleCount * 2 - 1);
+	this->blocks.reserve((this->triangleCount + 1) / 2);
+	this->nodes.push_back(MeshBvhNode());
+	BuildNode(0, triangles, 0, this->triangleCount, 1, positions, indices);
+}
+
+// --------------------------------------------------------
+// Children are appended as a pair before either is built,
+// so siblings always sit next to each other
+// --------------------------------------------------------
+void MeshBvh::BuildNode(unsigned int node, std::vector<BuildTriangle>& triangles, unsigned int first, unsigned int count, unsigned int nodeDepth, const XMFLOAT3* positions, const unsigned int* indices)
+{
+	XMVECTOR boundsMin = XMLoadFloat3(&triangles[first].Min);
+	XMVECTOR boundsMax = XMLoadFloat3(&triangles[first].Max);
+	for (unsigned int i = first + 1; i < first + count; i++)
+	{
+		boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&triangles[i].Min));
+		boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&triangles[i].Max));
+	}
+	XMStoreFloat3(&this->nodes[node].Min, boundsMin);
+	XMStoreFloat3(&this->nodes[node].Max, boundsMax);
+	PadOutward(this->nodes[node]);
+	this->depth = std::max(this->depth, nodeDepth);
+
+	if (count <= 4)
+	{
+		MakeLeaf(this->nodes[node], &triangles[first], count, positions, indices);
+		return;
+	}
+
+	unsigned int leftCount = Split(triangles, first, count, this->nodes[node], nodeDepth);
+	unsigned int left = (unsigned int)this->nodes.size();
+	this->nodes.push_back(MeshBvhNode());
+	this->nodes.push_back(MeshBvhNode());
+	this->nodes[node].First = left;
+	this->nodes[node].TriangleCount = 0;
+
+	BuildNode(left, triangles, first, leftCount, nodeDepth + 1, positions, indices);
+	BuildNode(left + 1, triangles, first + leftCount, count - leftCount, nodeDepth + 1, positions, indices);
+}
+
+// --------------------------------------------------------
+// Bins the triangles by centroid along each axis and takes
+// the boundary between bins with the lowest SAH cost.  The
+// triangles are partitioned to match, and the left side's
+// count is returned.
+//
+// Falls back to an even split along the widest axis when
+// the centroids can't be told apart, or when the tree is
+// deep enough that uneven splits could overrun the
+// traversal stack.
+// --------------------------------------------------------
+unsigned int MeshBvh::Split(std::vector<BuildTriangle>& triangles, unsigned int first, unsigned int count, const MeshBvhNode& bounds, unsigned int nodeDepth)
+{
+	BuildTriangle* begin = &triangles[first];
+	BuildTriangle* end = begin + count;
+
+	XMVECTOR centroidMin = XMLoadFloat3(&begin->Centroid);
+	XMVECTOR centroidMax = centroidMin;
+	for (BuildTriangle* t = begin + 1; t < end; t++)
+	{
+		centroidMin = XMVectorMin(centroidMin, XMLoadFloat3(&t->Centroid));
+		centroidMax = XMVectorMax(centroidMax, XMLoadFloat3(&t->Centroid));
+	}
+	XMFLOAT3 low;
+	XMFLOAT3 high;
+	XMStoreFloat3(&low, centroidMin);
+	XMStoreFloat3(&high, centroidMax);
+
+	// Even splits from here on would need this many more levels
+	unsigned int evenLevels = 1;
+	while ((4u << evenLevels) < count)
+		evenLevels++;
+
+	int bestAxis = -1;
+	int bestBin = 0;
+	float bestCost = FLT_MAX;
+	if (nodeDepth + evenLevels + 1 < MESH_BVH_MAX_DEPTH)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float axisLow = (&low.x)[axis];
+			float extent = (&high.x)[axis] - axisLow;
+			if (extent <= 0.0f)
+				continue;
+
+			struct Bin
+			{
+				XMVECTOR Min;
+				XMVECTOR Max;
+				unsigned int Count;
+			};
+			Bin bins[MESH_BVH_BINS];
+			for (Bin& bin : bins)
+			{
+				bin.Min = XMVectorReplicate(FLT_MAX);
+				bin.Max = XMVectorReplicate(-FLT_MAX);
+				bin.Count = 0;
+			}
+
+			float scale = MESH_BVH_BINS / extent;
+			for (BuildTriangle* t = begin; t < end; t++)
+			{
+				int b = std::min((int)(((&t->Centroid.x)[axis] - axisLow) * scale), MESH_BVH_BINS - 1);
+				bins[b].Min = XMVectorMin(bins[b].Min, XMLoadFloat3(&t->Min));
+				bins[b].Max = XMVectorMax(bins[b].Max, XMLoadFloat3(&t->Max));
+				bins[b].Count++;
+			}
+
+			// Sweep from the right for the costs of every right side, then
+			// from the left, pricing each boundary as it's passed
+			float rightCosts[MESH_BVH_BINS];
+			XMVECTOR sideMin = XMVectorReplicate(FLT_MAX);
+			XMVECTOR sideMax = XMVectorReplicate(-FLT_MAX);
+			unsigned int sideCount = 0;
+			for (int b = MESH_BVH_BINS - 1; b > 0; b--)
+			{
+				sideMin = XMVectorMin(sideMin, bins[b].Min);
+				sideMax = XMVectorMax(sideMax, bins[b].Max);
+				sideCount += bins[b].Count;
+				rightCosts[b] = sideCount > 0 ? HalfSurfaceArea(sideMin, sideMax) * BlockCost(sideCount) : 0.0f;
+			}
+
+			sideMin = XMVectorReplicate(FLT_MAX);
+			sideMax = XMVectorReplicate(-FLT_MAX);
+			sideCount = 0;
+			for (int b = 0; b < MESH_BVH_BINS - 1; b++)
+			{
+				sideMin = XMVectorMin(sideMin, bins[b].Min);
+				sideMax = XMVectorMax(sideMax, bins[b].Max);
+				sideCount += bins[b].Count;
+				if (sideCount == 0 || sideCount == count)
+					continue;
+
+				float cost = HalfSurfaceArea(sideMin, sideMax) * BlockCost(sideCount) + rightCosts[b + 1];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = b;
+				}
+			}
+		}
+	}
+
+	if (bestAxis >= 0)
+	{
+		float axisLow = (&low.x)[bestAxis];
+		float scale = MESH_BVH_BINS / ((&high.x)[bestAxis] - axisLow);
+		BuildTriangle* middle = std::partition(begin, end, [&](const BuildTriangle& t)
+		{
+			return std::min((int)(((&t.Centroid.x)[bestAxis] - axisLow) * scale), MESH_BVH_BINS - 1) <= bestBin;
+		});
+		return (unsigned int)(middle - begin);
+	}
+
+	XMFLOAT3 size;
+	XMStoreFloat3(&size, XMLoadFloat3(&bounds.Max) - XMLoadFloat3(&bounds.Min));
+	int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+	unsigned int half = count / 2;
+	std::nth_element(begin, begin + half, end, [axis](const BuildTriangle& a, const BuildTriangle& b)
+	{
+		return (&a.Centroid.x)[axis] < (&b.Centroid.x)[axis];
+	});
+	return half;
+}
+
+void MeshBvh::MakeLeaf(MeshBvhNode& node, const BuildTriangle* triangles, unsigned int count, const XMFLOAT3* positions, const unsigned int* indices)
+{
+	MeshBvhTriangleBlock block = {};
+	for (unsigned int lane = 0; lane < count; lane++)
+	{
+		unsigned int triangle = triangles[lane].Index;
+		const XMFLOAT3& p0 = positions[indices[triangle * 3]];
+		const XMFLOAT3& p1 = positions[indices[triangle * 3 + 1]];
+		const XMFLOAT3& p2 = positions[indices[triangle * 3 + 2]];
+
+		float* vertex0[3] = { &block.Vertex0[0].x, &block.Vertex0[1].x, &block.Vertex0[2].x };
+		float* edge1[3] = { &block.Edge1[0].x, &block.Edge1[1].x, &block.Edge1[2].x };
+		float* edge2[3] = { &block.Edge2[0].x, &block.Edge2[1].x, &block.Edge2[2].x };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			vertex0[axis][lane] = (&p0.x)[axis];
+			edge1[axis][lane] = (&p1.x)[axis] - (&p0.x)[axis];
+			edge2[axis][lane] = (&p2.x)[axis] - (&p0.x)[axis];
+		}
+		block.Triangles[lane] = triangle;
+	}
+
+	node.First = (unsigned int)this->blocks.size();
+	node.TriangleCount = count;
+	this->blocks.push_back(block);
+}
+
+// --------------------------------------------------------
+// Visits the nearer child first and stacks the other with
+// its entry distance, so it's skipped if a closer hit turns
+// up in the meantime
+// --------------------------------------------------------
+bool MeshBvh::Raycast(FXMVECTOR origin, FXMVECTOR direction, float maxDistance, RayHit& hit) const
+{
+	if (this->nodes.empty())
+		return false;
+
+	// Searches only up to the closer of the two; restored on a miss
+	float previousDistance = hit.Distance;
+	if (hit.Distance > maxDistance)
+		hit.Distance = maxDistance;
+
+	XMVECTOR inverseDirection = XMVectorReciprocal(direction);
+	float enter;
+	if (!IntersectBox(this->nodes[0], origin, inverseDirection, hit.Distance, enter))
+	{
+		hit.Distance = previousDistance;
+		return false;
+	}
+
+	XMVECTOR originX = XMVectorSplatX(origin);
+	XMVECTOR originY = XMVectorSplatY(origin);
+	XMVECTOR originZ = XMVectorSplatZ(origin);
+	XMVECTOR directionX = XMVectorSplatX(direction);
+	XMVECTOR directionY = XMVectorSplatY(direction);
+	XMVECTOR directionZ = XMVectorSplatZ(direction);
+
+	struct StackEntry
+	{
+		unsigned int Node;
+		float Enter;
+	};
+	StackEntry stack[MESH_BVH_MAX_DEPTH];
+	unsigned int stackSize = 0;
+	bool found = false;
+
+	unsigned int node = 0;
+	for (;;)
+	{
+		const MeshBvhNode& current = this->nodes[node];
+		if (current.TriangleCount > 0)
+		{
+			found |= IntersectBlock(this->blocks[current.First], originX, originY, originZ, directionX, directionY, directionZ, hit);
+		}
+		else
+		{
+			float enterLeft;
+			float enterRight;
+			unsigned int children = IntersectChildren(&this->nodes[current.First], origin, inverseDirection, XMVectorReplicate(hit.Distance), enterLeft, enterRight);
+			if (children == 3)
+			{
+				bool leftFirst = enterLeft <= enterRight;
+				stack[stackSize++] = { leftFirst ? current.First + 1 : current.First, leftFirst ? enterRight : enterLeft };
+				node = leftFirst ? current.First : current.First + 1;
+				continue;
+			}
+			if (children != 0)
+			{
+				node = children == 1 ? current.First : current.First + 1;
+				continue;
+			}
+		}
+
+		// Back up to the nearest stacked node still worth a look
+		while (stackSize > 0 && stack[stackSize - 1].Enter > hit.Distance)
+			stackSize--;
+		if (stackSize == 0)
+			break;
+		node = stack[--stackSize].Node;
+	}
+
+	if (!found)
+		hit.Distance = previousDistance;
+	return found;
+}
+
+unsigned int MeshBvh::Raycast(const Ray* rays, unsigned int rayCount, RayHit* hits) const
+{
+	unsigned int hitCount = 0;
+	for (unsigned int i = 0; i < rayCount; i++)
+	{
+		hits[i] = RayHit();
+		if (Raycast(XMLoadFloat3(&rays[i].Origin), XMLoadFloat3(&rays[i].Direction), rays[i].MaxDistance, hits[i]))
+			hitCount++;
+	}
+	return hitCount;
+}
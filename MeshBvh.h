@@ -0,0 +1,98 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cfloat>
+#include <vector>
+
+// --------------------------------------------------------
+// Bounding volume hierarchy over a mesh's triangles, for
+// raycasts and picking on the CPU (the GPU copy of the mesh
+// can't be read back)
+//
+// - Built top down with the surface area heuristic, binned
+//   along each axis
+// - Nodes live in one flat array, 32 bytes each, with both
+//   children of a node side by side
+// - Each leaf holds up to four triangles, stored so a ray
+//   is tested against all of them at once (Moller-Trumbore
+//   across the four lanes of an XMVECTOR)
+// - Triangles are two-sided; a hit reports which one (in
+//   the mesh's full detail index order) and where on it
+// --------------------------------------------------------
+
+// The deepest a tree gets; traversal keeps a stack this big
+#define MESH_BVH_MAX_DEPTH 64
+
+struct Ray
+{
+	DirectX::XMFLOAT3 Origin;
+	DirectX::XMFLOAT3 Direction;	// Needn't be normalized; distances are in its lengths
+	float MaxDistance = FLT_MAX;
+};
+
+struct RayHit
+{
+	float Distance = FLT_MAX;		// FLT_MAX if nothing was hit
+	unsigned int Triangle = 0;
+	float U = 0.0f;					// Barycentric weights of the triangle's
+	float V = 0.0f;					// second and third vertices
+
+	bool IsHit() const { return Distance < FLT_MAX; }
+};
+
+struct MeshBvhNode
+{
+	DirectX::XMFLOAT3 Min;
+	unsigned int First;				// Left child (the right one follows it), or a leaf's triangle block
+	DirectX::XMFLOAT3 Max;
+	unsigned int TriangleCount;		// 0 for interior nodes
+};
+
+// Four triangles, one per lane, as the first vertex and the two edges
+// leaving it.  Unused lanes have zero edges, which never hit.
+struct MeshBvhTriangleBlock
+{
+	DirectX::XMFLOAT4A Vertex0[3];	// x, y and z
+	DirectX::XMFLOAT4A Edge1[3];
+	DirectX::XMFLOAT4A Edge2[3];
+	unsigned int Triangles[4];
+};
+
+class MeshBvh
+{
+public:
+	// Triangles are read as index triples; the indices are into "positions"
+	void Build(const DirectX::XMFLOAT3* positions, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount);
+
+	// Finds the closest hit within maxDistance.  A hit already in "hit"
+	// bounds the search too, so several casts can share one result.
+	bool Raycast(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, float maxDistance, RayHit& hit) const;
+
+	// Casts each ray in turn into its own hit, returning how many hit
+	unsigned int Raycast(const Ray* rays, unsigned int rayCount, RayHit* hits) const;
+
+	bool IsEmpty() const { return nodes.empty(); }
+	unsigned int GetNodeCount() const { return (unsigned int)nodes.size(); }
+	unsigned int GetLeafCount() const { return (unsigned int)blocks.size(); }
+	unsigned int GetTriangleCount() const { return triangleCount; }
+	unsigned int GetDepth() const { return depth; }
+	size_t GetMemoryBytes() const { return nodes.size() * sizeof(MeshBvhNode) + blocks.size() * sizeof(MeshBvhTriangleBlock); }
+
+private:
+	struct BuildTriangle
+	{
+		DirectX::XMFLOAT3 Min;
+		DirectX::XMFLOAT3 Max;
+		DirectX::XMFLOAT3 Centroid;
+		unsigned int Index;
+	};
+
+	std::vector<MeshBvhNode> nodes;
+	std::vector<MeshBvhTriangleBlock> blocks;
+	unsigned int triangleCount = 0;
+	unsigned int depth = 0;
+
+	void BuildNode(unsigned int node, std::vector<BuildTriangle>& triangles, unsigned int first, unsigned int count, unsigned int nodeDepth, const DirectX::XMFLOAT3* positions, const unsigned int* indices);
+	unsigned int Split(std::vector<BuildTriangle>& triangles, unsigned int first, unsigned int count, const MeshBvhNode& bounds, unsigned int nodeDepth);
+	void MakeLeaf(MeshBvhNode& node, const BuildTriangle* triangles, unsigned int count, const DirectX::XMFLOAT3* positions, const unsigned int* indices);
+};
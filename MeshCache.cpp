@@ -0,0 +1,261 @@
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cstdlib>
+#endif
+
+namespace
+{
+	const char MeshCacheMagic[4] = { 'M', 'E', 'S', 'H' };
+
+	// Vertices start on a 16-byte boundary after the header
+	size_t GetVertexOffset()
+	{
+		return (sizeof(MeshCacheHeader) + 15) & ~(size_t)15;
+	}
+
+	size_t GetFileSize(const MeshCacheHeader& header)
+	{
+		return GetVertexOffset() +
+			header.VertexStride * (size_t)header.VertexCount +
+			sizeof(unsigned int) * (size_t)header.IndexCount +
+			sizeof(Meshlet) * (size_t)header.MeshletCount +
+			sizeof(MeshLod) * (size_t)header.LodCount +
+			sizeof(MeshLod) * (size_t)header.LodCount * header.SubmeshCount +
+			header.SubmeshNameBytes;
+	}
+
+	// Every submesh needs a name and a material, each null terminated
+	bool AreSubmeshNamesValid(const char* names, size_t size, uint32_t submeshCount)
+	{
+		size_t terminators = 0;
+		for (size_t i = 0; i < size; i++)
+			terminators += names[i] == '\0';
+		return terminators == submeshCount * (size_t)2 && (size == 0 || names[size - 1] == '\0');
+	}
+
+	// Ranges of the index buffer must lie inside it
+	bool IsIndexRangeValid(unsigned int start, uint64_t count, uint32_t indexCount)
+	{
+		return start + count <= indexCount;
+	}
+
+	// --------------------------------------------------------
+	// Everything the mesh later reads through, so a damaged
+	// file can't send it (or a draw) past the end of a
+	// buffer: every index names a vertex, every meshlet and
+	// level of detail covers indices that exist, and there is
+	// at least the full detail level
+	// --------------------------------------------------------
+	bool IsPayloadValid(const MeshCacheContents& contents)
+	{
+		if (contents.LodCount < 1)
+			return false;
+
+		for (uint32_t i = 0; i < contents.IndexCount; i++)
+			if (contents.Indices[i] >= contents.VertexCount)
+				return false;
+
+		for (uint32_t m = 0; m < contents.MeshletCount; m++)
+			if (!IsIndexRangeValid(contents.Meshlets[m].StartIndex, contents.Meshlets[m].TriangleCount * (uint64_t)3, contents.IndexCount))
+				return false;
+
+		size_t submeshLodCount = contents.LodCount * (size_t)contents.SubmeshCount;
+		for (uint32_t l = 0; l < contents.LodCount; l++)
+			if (!IsIndexRangeValid(contents.Lods[l].StartIndex, contents.Lods[l].IndexCount, contents.IndexCount))
+				return false;
+		for (size_t l = 0; l < submeshLodCount; l++)
+			if (!IsIndexRangeValid(contents.SubmeshLods[l].StartIndex, contents.SubmeshLods[l].IndexCount, contents.IndexCount))
+				return false;
+
+		return true;
+	}
+
+	// The stride each layout must have, which also catches struct changes
+	unsigned int GetLayoutStride(uint32_t layout)
+	{
+		switch ((VertexLayout)layout)
+		{
+		case VertexLayout::Full: return sizeof(Vertex);
+		case VertexLayout::Compact: return sizeof(CompactVertex);
+		}
+		return 0;
+	}
+
+#ifndef _WIN32
+	// Paths are wide strings everywhere else in the engine
+	bool NarrowPath(const std::wstring& wide, std::string& narrow)
+	{
+		narrow.assign(wide.size() * 4 + 1, '\0');
+		size_t length = wcstombs(&narrow[0], wide.c_str(), narrow.size());
+		if (length == (size_t)-1)
+			return false;
+		narrow.resize(length);
+		return true;
+	}
+#endif
+}
+
+// --------------------------------------------------------
+// The cache goes right next to the source file
+// --------------------------------------------------------
+std::wstring GetMeshCachePath(const std::wstring& sourceFileName)
+{
+	return sourceFileName + L".meshcache";
+}
+
+// --------------------------------------------------------
+// Hashes 8 bytes at a time with a multiply/xor-shift mix
+// per word, so even large files hash at close to memory
+// bandwidth.  Not cryptographic; it only has to notice
+// that a file changed.
+// --------------------------------------------------------
+uint64_t HashContents(const char* data, size_t size)
+{
+	const uint64_t prime1 = 0x9E3779B185EBCA87ull;
+	const uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+
+	uint64_t hash = prime1 ^ (size * prime2);
+
+	size_t wordCount = size / 8;
+	for (size_t i = 0; i < wordCount; i++)
+	{
+		uint64_t word;
+		memcpy(&word, data + i * 8, 8);
+
+		word *= prime2;
+		word ^= word >> 31;
+		hash = (hash ^ word) * prime1;
+		hash ^= hash >> 29;
+	}
+
+	// Leftover bytes, zero padded
+	uint64_t tail = 0;
+	memcpy(&tail, data + wordCount * 8, size - wordCount * 8);
+	hash = (hash ^ (tail * prime2)) * prime1;
+
+	hash ^= hash >> 33;
+	hash *= prime2;
+	hash ^= hash >> 29;
+	return hash;
+}
+
+// --------------------------------------------------------
+// Checks every header field (and the file size), and then
+// every offset and count in the data, before trusting it;
+// anything unexpected counts as stale
+// --------------------------------------------------------
+bool ReadMeshCache(MappedFile& file, uint64_t sourceHash, MeshCacheContents& contents)
+{
+	if (!file.IsOpen() || file.GetSize() < sizeof(MeshCacheHeader))
+		return false;
+
+	MeshCacheHeader header;
+	memcpy(&header, file.GetData(), sizeof(header));
+
+	if (memcmp(header.Magic, MeshCacheMagic, sizeof(MeshCacheMagic)) != 0 ||
+		header.Version != MeshCacheVersion ||
+		header.SourceHash != sourceHash ||
+		header.VertexStride != GetLayoutStride(header.Layout) ||
+		file.GetSize() != GetFileSize(header))
+		return false;
+
+	const char* vertexData = file.GetData() + GetVertexOffset();
+	contents.VertexData = vertexData;
+	contents.VertexStride = header.VertexStride;
+	contents.VertexCount = header.VertexCount;
+	contents.Layout = (VertexLayout)header.Layout;
+	contents.Indices = (const unsigned int*)(vertexData + header.VertexStride * (size_t)header.VertexCount);
+	contents.IndexCount = header.IndexCount;
+	contents.Meshlets = (const Meshlet*)(contents.Indices + header.IndexCount);
+	contents.MeshletCount = header.MeshletCount;
+	contents.Lods = (const MeshLod*)(contents.Meshlets + header.MeshletCount);
+	contents.LodCount = header.LodCount;
+	contents.SubmeshLods = contents.Lods + header.LodCount;
+	contents.SubmeshCount = header.SubmeshCount;
+	contents.SubmeshNames = (const char*)(contents.SubmeshLods + header.LodCount * (size_t)header.SubmeshCount);
+	contents.SubmeshNameBytes = header.SubmeshNameBytes;
+	if (!AreSubmeshNamesValid(contents.SubmeshNames, contents.SubmeshNameBytes, contents.SubmeshCount) ||
+		!IsPayloadValid(contents))
+		return false;
+
+	contents.Bounds = header.Bounds;
+	contents.Quantization = header.Quantization;
+	contents.QuantizationError = header.QuantizationError;
+	contents.Stats = header.Stats;
+	return true;
+}
+
+// --------------------------------------------------------
+// Writes to a temporary file and then swaps it in, so a
+// crash mid-write never leaves a truncated cache behind
+// --------------------------------------------------------
+bool WriteMeshCache(const std::wstring& fileName, uint64_t sourceHash, const MeshCacheContents& contents)
+{
+	MeshCacheHeader header = {};
+	memcpy(header.Magic, MeshCacheMagic, sizeof(MeshCacheMagic));
+	header.Version = MeshCacheVersion;
+	header.SourceHash = sourceHash;
+	header.Layout = (uint32_t)contents.Layout;
+	header.VertexStride = contents.VertexStride;
+	header.VertexCount = contents.VertexCount;
+	header.IndexCount = contents.IndexCount;
+	header.MeshletCount = contents.MeshletCount;
+	header.LodCount = contents.LodCount;
+	header.SubmeshCount = contents.SubmeshCount;
+	header.SubmeshNameBytes = contents.SubmeshNameBytes;
+	header.Bounds = contents.Bounds;
+	header.Quantization = contents.Quantization;
+	header.QuantizationError = contents.QuantizationError;
+	header.Stats = contents.Stats;
+
+	std::vector<char> padding(GetVertexOffset() - sizeof(header), 0);
+	std::wstring tempName = fileName + L".tmp";
+
+#ifdef _WIN32
+	FILE* file = 0;
+	if (_wfopen_s(&file, tempName.c_str(), L"wb") != 0)
+		return false;
+#else
+	std::string narrowTemp;
+	std::string narrowName;
+	if (!NarrowPath(tempName, narrowTemp) || !NarrowPath(fileName, narrowName))
+		return false;
+	FILE* file = fopen(narrowTemp.c_str(), "wb");
+#endif
+	if (!file)
+		return false;
+
+	bool written =
+		fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(padding.data(), 1, padding.size(), file) == padding.size() &&
+		fwrite(contents.VertexData, contents.VertexStride, contents.VertexCount, file) == contents.VertexCount &&
+		fwrite(contents.Indices, sizeof(unsigned int), contents.IndexCount, file) == contents.IndexCount &&
+		fwrite(contents.Meshlets, sizeof(Meshlet), contents.MeshletCount, file) == contents.MeshletCount &&
+		fwrite(contents.Lods, sizeof(MeshLod), contents.LodCount, file) == contents.LodCount &&
+		fwrite(contents.SubmeshLods, sizeof(MeshLod), contents.LodCount * contents.SubmeshCount, file) == contents.LodCount * contents.SubmeshCount &&
+		fwrite(contents.SubmeshNames, 1, contents.SubmeshNameBytes, file) == contents.SubmeshNameBytes;
+	written = fclose(file) == 0 && written;
+
+#ifdef _WIN32
+	if (!written)
+	{
+		DeleteFileW(tempName.c_str());
+		return false;
+	}
+	return MoveFileExW(tempName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	if (!written)
+	{
+		remove(narrowTemp.c_str());
+		return false;
+	}
+	return rename(narrowTemp.c_str(), narrowName.c_str()) == 0;
+#endif
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Vertex.h"
+#include "MeshOptimizer.h"
+#include "VertexQuantization.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "MeshBounds.h"
+#include "MappedFile.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+
+// --------------------------------------------------------
+// Binary mesh cache
+//
+// Holds a Mesh's final, ready-to-upload vertex and index
+// arrays so later runs can skip parsing and optimizing.
+// Each cache file sits next to its source and remembers a
+// hash of the source's contents, so edits invalidate it.
+//
+// Layout: MeshCacheHeader, then the vertices (16-byte
+// aligned, as Vertex or CompactVertex), then the 32-bit
+// indices (every level of detail), then the meshlets, then
+// the level of detail ranges, then each submesh's range of
+// every level, then the submesh names (each name and then
+// its material, null terminated).
+// --------------------------------------------------------
+
+// Bump whenever the layout, the Vertex struct or the
+// pipeline that produces the data changes
+const uint32_t MeshCacheVersion = 7;
+
+struct MeshCacheHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint64_t SourceHash;
+	uint32_t Layout;
+	uint32_t VertexStride;
+	uint32_t VertexCount;
+	uint32_t IndexCount;
+	uint32_t MeshletCount;
+	uint32_t LodCount;
+	uint32_t SubmeshCount;
+	uint32_t SubmeshNameBytes;
+	MeshBounds Bounds;
+	VertexQuantization Quantization;
+	QuantizationReport QuantizationError;
+	MeshOptimizationStats Stats;
+};
+
+// What a Mesh stores in (or gets back from) the cache.  When
+// read, the arrays point straight into the mapped file.
+struct MeshCacheContents
+{
+	const void* VertexData = 0;
+	unsigned int VertexStride = 0;
+	unsigned int VertexCount = 0;
+	VertexLayout Layout = VertexLayout::Full;
+	const unsigned int* Indices = 0;
+	unsigned int IndexCount = 0;
+	const Meshlet* Meshlets = 0;
+	unsigned int MeshletCount = 0;
+	const MeshLod* Lods = 0;
+	unsigned int LodCount = 0;
+	const MeshLod* SubmeshLods = 0;		// LodCount * SubmeshCount of them
+	unsigned int SubmeshCount = 0;
+	const char* SubmeshNames = 0;
+	unsigned int SubmeshNameBytes = 0;
+	MeshBounds Bounds;
+	VertexQuantization Quantization = {};
+	QuantizationReport QuantizationError;
+	MeshOptimizationStats Stats;
+};
+
+// Where the cache for a given source file lives
+std::wstring GetMeshCachePath(const std::wstring& sourceFileName);
+
+// 64-bit hash of a file's contents, used to spot stale caches
+uint64_t HashContents(const char* data, size_t size);
+
+// Validates a mapped cache file against the source's hash; on
+// success "contents" points into the mapping
+bool ReadMeshCache(MappedFile& file, uint64_t sourceHash, MeshCacheContents& contents);
+
+// Writes (or replaces) a cache file
+bool WriteMeshCache(const std::wstring& fileName, uint64_t sourceHash, const MeshCacheContents& contents);
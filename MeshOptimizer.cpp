@@ -0,0 +1,757 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// The attributes that make a vertex unique, as raw bits
+	struct WeldKey
+	{
+		uint32_t Words[8];
+
+		bool operator==(const WeldKey& other) const
+		{
+			return memcmp(Words, other.Words, sizeof(Words)) == 0;
+		}
+	};
+
+	WeldKey MakeWeldKey(const Vertex& v, float epsilon)
+	{
+		const float components[8] =
+		{
+			v.Position.x, v.Position.y, v.Position.z,
+			v.Normal.x, v.Normal.y, v.Normal.z,
+			v.UV.x, v.UV.y
+		};
+
+		WeldKey key;
+		for (int i = 0; i < 8; i++)
+		{
+			float value = components[i];
+			if (epsilon > 0.0f)
+				value = floorf(value / epsilon + 0.5f);
+
+			// Adding zero turns -0 into +0 so they weld together
+			value += 0.0f;
+			memcpy(&key.Words[i], &value, sizeof(float));
+		}
+		return key;
+	}
+
+	uint32_t HashWeldKey(const WeldKey& key)
+	{
+		// MurmurHash3-style mixing of each word
+		uint32_t hash = 0x9747b28c;
+		for (int i = 0; i < 8; i++)
+		{
+			uint32_t k = key.Words[i] * 0xcc9e2d51;
+			k = (k << 15) | (k >> 17);
+			hash ^= k * 0x1b873593;
+			hash = ((hash << 13) | (hash >> 19)) * 5 + 0xe6546b64;
+		}
+		hash ^= hash >> 16;
+		hash *= 0x85ebca6b;
+		hash ^= hash >> 13;
+		return hash;
+	}
+}
+
+// --------------------------------------------------------
+// Collapses duplicate vertices using an open-addressing hash
+// table keyed on position, normal and UV.
+//
+// - The first occurrence of each unique vertex is kept, so
+//   the output order follows the input order
+// - With a non-zero epsilon, components are snapped to a grid
+//   of that size before comparing; vertices closer than
+//   epsilon may still land in neighbouring cells and stay apart
+//
+// vertices - Replaced with the unique vertices
+// indices - Rewritten to point at the unique vertices
+// epsilon - Grid size for tolerant welding, or 0 for exact
+//
+// Returns the before/after vertex counts
+// --------------------------------------------------------
+WeldStats WeldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, float epsilon)
+{
+	WeldStats stats;
+	stats.OriginalVertexCount = (unsigned int)vertices.size();
+
+	// Power of two capacity at least twice the vertex count
+	size_t capacity = 1;
+	while (capacity < vertices.size() * 2)
+		capacity <<= 1;
+	const unsigned int empty = ~0u;
+	std::vector<unsigned int> table(capacity, empty);
+
+	std::vector<Vertex> unique;
+	std::vector<WeldKey> uniqueKeys;
+	std::vector<unsigned int> remap(vertices.size());
+	unique.reserve(vertices.size());
+	uniqueKeys.reserve(vertices.size());
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		WeldKey key = MakeWeldKey(vertices[i], epsilon);
+		size_t slot = HashWeldKey(key) & (capacity - 1);
+
+		// Linear probe until we find this key or an empty slot
+		while (table[slot] != empty && !(uniqueKeys[table[slot]] == key))
+			slot = (slot + 1) & (capacity - 1);
+
+		if (table[slot] == empty)
+		{
+			table[slot] = (unsigned int)unique.size();
+			unique.push_back(vertices[i]);
+			uniqueKeys.push_back(key);
+		}
+
+		remap[i] = table[slot];
+	}
+
+	for (unsigned int& index : indices)
+		index = remap[index];
+
+	vertices.swap(unique);
+	stats.WeldedVertexCount = (unsigned int)vertices.size();
+	return stats;
+}
+
+namespace
+{
+	// A FIFO cache that doesn't shift anything around: it remembers when
+	// each item last entered, and an item is still cached if fewer than
+	// "size" others have entered since then
+	class FifoCache
+	{
+	public:
+		FifoCache(size_t itemCount, unsigned int size)
+			: entryTime(itemCount, 0), size(size), time(size + 1)
+		{
+		}
+
+		// Returns true on a hit; a miss brings the item into the cache
+		bool Access(unsigned int item)
+		{
+			if (time - entryTime[item] <= size)
+				return true;
+
+			entryTime[item] = time++;
+			return false;
+		}
+
+		// Pushes everything out without touching every entry
+		void Flush()
+		{
+			time += size + 1;
+		}
+
+	private:
+		std::vector<unsigned int> entryTime;
+		unsigned int size;
+		unsigned int time;
+	};
+}
+
+// --------------------------------------------------------
+// Plays an index list through a FIFO vertex cache and counts
+// the misses (each miss is one vertex shader invocation)
+//
+// indices - Triangle list to simulate
+// vertexCount - Number of vertices the indices refer to
+// cacheSize - Number of post-transform cache entries
+// --------------------------------------------------------
+VertexCacheStats SimulateVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats;
+	stats.CacheSize = cacheSize;
+	stats.TriangleCount = (unsigned int)(indices.size() / 3);
+	stats.VertexCount = (unsigned int)vertexCount;
+
+	FifoCache cache(vertexCount, cacheSize);
+	for (unsigned int index : indices)
+		stats.TransformedVertexCount += cache.Access(index) ? 0 : 1;
+
+	return stats;
+}
+
+namespace
+{
+	// The cache the scoring function models; deliberately larger than real
+	// hardware so the result holds up across different GPUs
+	const int ForsythCacheSize = 32;
+	const unsigned int ForsythMaxValence = 32;
+
+	// Precomputed halves of Forsyth's vertex score
+	struct ForsythScoreTable
+	{
+		float Cache[ForsythCacheSize];
+		float Valence[ForsythMaxValence + 1];
+
+		ForsythScoreTable()
+		{
+			// Vertices used by the last triangle get a fixed score so the
+			// next triangle doesn't favour one of them over the others
+			for (int i = 0; i < ForsythCacheSize; i++)
+			{
+				if (i < 3)
+					Cache[i] = 0.75f;
+				else
+					Cache[i] = powf(1.0f - (float)(i - 3) / (ForsythCacheSize - 3), 1.5f);
+			}
+
+			// Boost vertices with few triangles left, so they get finished
+			// off rather than left behind as lone triangles
+			Valence[0] = 0.0f;
+			for (unsigned int i = 1; i <= ForsythMaxValence; i++)
+				Valence[i] = 2.0f * powf((float)i, -0.5f);
+		}
+
+		float Score(int cachePosition, unsigned int liveTriangles) const
+		{
+			// No triangles left means the vertex no longer matters
+			if (liveTriangles == 0)
+				return -1.0f;
+
+			float score = cachePosition >= 0 ? Cache[cachePosition] : 0.0f;
+			return score + Valence[liveTriangles < ForsythMaxValence ? liveTriangles : ForsythMaxValence];
+		}
+	};
+}
+
+// --------------------------------------------------------
+// Greedily emits triangles, always picking the one whose
+// vertices score best given the simulated cache contents
+//
+// - Only triangles touching cached vertices are considered,
+//   which keeps each step constant time
+// - When none are left (a new disconnected piece), the next
+//   unused triangle in the original order is taken
+//
+// indices - Triangle list to reorder in place
+// vertexCount - Number of vertices the indices refer to
+// --------------------------------------------------------
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	static const ForsythScoreTable scoreTable;
+
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles using each vertex, packed into one array; the first
+	// liveTriangles[v] entries of a vertex's range are not yet emitted
+	std::vector<unsigned int> liveTriangles(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		liveTriangles[indices[i]]++;
+
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+	std::vector<unsigned int> adjacency(adjacencyOffsets[vertexCount]);
+	{
+		std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++)
+			adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = scoreTable.Score(-1, liveTriangles[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScores[t] =
+			vertexScores[indices[t * 3 + 0]] +
+			vertexScores[indices[t * 3 + 1]] +
+			vertexScores[indices[t * 3 + 2]];
+	}
+
+	// Start with the best triangle anywhere in the mesh
+	size_t best = 0;
+	for (size_t t = 1; t < triangleCount; t++)
+	{
+		if (triangleScores[t] > triangleScores[best])
+			best = t;
+	}
+
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+
+	unsigned int cache[ForsythCacheSize + 3];
+	int cacheCount = 0;
+	size_t nextUnemitted = 0;
+
+	while (true)
+	{
+		const unsigned int* tri = &indices[best * 3];
+		output.insert(output.end(), tri, tri + 3);
+		emitted[best] = true;
+
+		// Take the triangle out of each of its vertices' live lists
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = tri[c];
+			unsigned int* live = &adjacency[adjacencyOffsets[v]];
+			for (unsigned int i = 0; i < liveTriangles[v]; i++)
+			{
+				if (live[i] == best)
+				{
+					live[i] = live[liveTriangles[v] - 1];
+					liveTriangles[v]--;
+					break;
+				}
+			}
+		}
+
+		// The triangle's vertices move to the front of the cache, and
+		// everything else shuffles back (possibly falling off the end)
+		unsigned int newCache[ForsythCacheSize + 3];
+		int newCount = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			if (newCount == 0 || (newCache[0] != tri[c] && (newCount == 1 || newCache[1] != tri[c])))
+				newCache[newCount++] = tri[c];
+		}
+		for (int i = 0; i < cacheCount; i++)
+		{
+			if (cache[i] != tri[0] && cache[i] != tri[1] && cache[i] != tri[2])
+				newCache[newCount++] = cache[i];
+		}
+
+		// Rescore everything whose cache position changed
+		for (int i = 0; i < newCount; i++)
+		{
+			unsigned int v = newCache[i];
+			cachePosition[v] = i < ForsythCacheSize ? i : -1;
+			vertexScores[v] = scoreTable.Score(cachePosition[v], liveTriangles[v]);
+		}
+
+		cacheCount = newCount < ForsythCacheSize ? newCount : ForsythCacheSize;
+		memcpy(cache, newCache, sizeof(unsigned int) * cacheCount);
+
+		// Rescore the triangles around the touched vertices and pick the
+		// best one for the next step
+		float bestScore = -1.0f;
+		for (int i = 0; i < newCount; i++)
+		{
+			unsigned int v = newCache[i];
+			const unsigned int* live = &adjacency[adjacencyOffsets[v]];
+			for (unsigned int j = 0; j < liveTriangles[v]; j++)
+			{
+				unsigned int t = live[j];
+				triangleScores[t] =
+					vertexScores[indices[t * 3 + 0]] +
+					vertexScores[indices[t * 3 + 1]] +
+					vertexScores[indices[t * 3 + 2]];
+
+				if (i < cacheCount && triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					best = t;
+				}
+			}
+		}
+
+		if (bestScore < 0.0f)
+		{
+			// Nothing connected to the cache; carry on from the input order
+			while (nextUnemitted < triangleCount && emitted[nextUnemitted])
+				nextUnemitted++;
+
+			if (nextUnemitted == triangleCount)
+				break;
+
+			best = nextUnemitted;
+		}
+	}
+
+	indices.swap(output);
+}
+
+namespace
+{
+	// Resolution of each AnalyzeOverdraw() view
+	const int OverdrawGridSize = 256;
+
+	// Post-transform cache and cache lines used by AnalyzeVertexFetch()
+	const unsigned int FetchVertexCacheSize = 16;
+	const unsigned int FetchCacheLineSize = 64;
+	const unsigned int FetchCacheLineCount = 16 * 1024 / FetchCacheLineSize;
+
+	struct RasterPoint
+	{
+		float X;
+		float Y;
+		float Z;
+	};
+
+	// Twice the signed area of the 2D triangle abp; positive when the
+	// points wind counter-clockwise in a y-up grid
+	float EdgeFunction(const RasterPoint& a, const RasterPoint& b, float px, float py)
+	{
+		return (b.X - a.X) * (py - a.Y) - (b.Y - a.Y) * (px - a.X);
+	}
+
+	// Top-left fill rule, so pixels on an edge shared by two triangles
+	// are only drawn once
+	bool IsTopLeftEdge(const RasterPoint& a, const RasterPoint& b)
+	{
+		float dx = b.X - a.X;
+		float dy = b.Y - a.Y;
+		return dy < 0.0f || (dy == 0.0f && dx < 0.0f);
+	}
+
+	// Rasterizes one counter-clockwise triangle with a less-than depth test,
+	// returning the number of pixels that passed (were "shaded")
+	unsigned int RasterizeTriangle(const RasterPoint& p0, const RasterPoint& p1, const RasterPoint& p2, float* depthBuffer)
+	{
+		float area = EdgeFunction(p0, p1, p2.X, p2.Y);
+		if (area <= 0.0f)
+			return 0;
+
+		int minX = (int)floorf(fminf(p0.X, fminf(p1.X, p2.X)));
+		int minY = (int)floorf(fminf(p0.Y, fminf(p1.Y, p2.Y)));
+		int maxX = (int)ceilf(fmaxf(p0.X, fmaxf(p1.X, p2.X)));
+		int maxY = (int)ceilf(fmaxf(p0.Y, fmaxf(p1.Y, p2.Y)));
+		if (minX < 0) minX = 0;
+		if (minY < 0) minY = 0;
+		if (maxX > OverdrawGridSize - 1) maxX = OverdrawGridSize - 1;
+		if (maxY > OverdrawGridSize - 1) maxY = OverdrawGridSize - 1;
+
+		bool topLeft0 = IsTopLeftEdge(p1, p2);
+		bool topLeft1 = IsTopLeftEdge(p2, p0);
+		bool topLeft2 = IsTopLeftEdge(p0, p1);
+
+		unsigned int shaded = 0;
+		for (int y = minY; y <= maxY; y++)
+		{
+			for (int x = minX; x <= maxX; x++)
+			{
+				// Sample at the pixel center
+				float px = x + 0.5f;
+				float py = y + 0.5f;
+				float w0 = EdgeFunction(p1, p2, px, py);
+				float w1 = EdgeFunction(p2, p0, px, py);
+				float w2 = EdgeFunction(p0, p1, px, py);
+
+				if ((w0 < 0.0f || (w0 == 0.0f && !topLeft0)) ||
+					(w1 < 0.0f || (w1 == 0.0f && !topLeft1)) ||
+					(w2 < 0.0f || (w2 == 0.0f && !topLeft2)))
+					continue;
+
+				float depth = (w0 * p0.Z + w1 * p1.Z + w2 * p2.Z) / area;
+				float& stored = depthBuffer[y * OverdrawGridSize + x];
+				if (depth < stored)
+				{
+					stored = depth;
+					shaded++;
+				}
+			}
+		}
+
+		return shaded;
+	}
+}
+
+// --------------------------------------------------------
+// Measures overdraw by drawing the mesh, in index order,
+// into a depth buffer from +X, -X, +Y, -Y, +Z and -Z
+//
+// - The mesh is scaled uniformly to fit the grid
+// - Looking from the opposite side mirrors the image, so
+//   back faces of one view are the front faces of the other
+// --------------------------------------------------------
+OverdrawStats AnalyzeOverdraw(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices)
+{
+	OverdrawStats stats;
+	if (vertices.empty() || indices.size() < 3)
+		return stats;
+
+	XMFLOAT3 minBounds = vertices[0].Position;
+	XMFLOAT3 maxBounds = vertices[0].Position;
+	for (const Vertex& v : vertices)
+	{
+		minBounds = XMFLOAT3(fminf(minBounds.x, v.Position.x), fminf(minBounds.y, v.Position.y), fminf(minBounds.z, v.Position.z));
+		maxBounds = XMFLOAT3(fmaxf(maxBounds.x, v.Position.x), fmaxf(maxBounds.y, v.Position.y), fmaxf(maxBounds.z, v.Position.z));
+	}
+
+	float extent = fmaxf(maxBounds.x - minBounds.x, fmaxf(maxBounds.y - minBounds.y, maxBounds.z - minBounds.z));
+	float scale = extent > 0.0f ? 1.0f / extent : 0.0f;
+
+	// Positions normalized to [0, 1] on every axis
+	std::vector<XMFLOAT3> normalized(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		normalized[i] = XMFLOAT3(
+			(vertices[i].Position.x - minBounds.x) * scale,
+			(vertices[i].Position.y - minBounds.y) * scale,
+			(vertices[i].Position.z - minBounds.z) * scale);
+	}
+
+	std::vector<float> depthBuffer(OverdrawGridSize * OverdrawGridSize);
+	const float gridScale = (float)(OverdrawGridSize - 1);
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (int flip = 0; flip < 2; flip++)
+		{
+			std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+
+			for (size_t i = 0; i + 2 < indices.size(); i += 3)
+			{
+				RasterPoint points[3];
+				for (int c = 0; c < 3; c++)
+				{
+					// Cycle the axes so the view axis ends up as depth
+					const XMFLOAT3& n = normalized[indices[i + c]];
+					float x = axis == 0 ? n.y : axis == 1 ? n.z : n.x;
+					float y = axis == 0 ? n.z : axis == 1 ? n.x : n.y;
+					float z = axis == 0 ? n.x : axis == 1 ? n.y : n.z;
+
+					points[c].X = x * gridScale;
+					points[c].Y = y * gridScale;
+					points[c].Z = flip ? 1.0f - z : z;
+				}
+
+				// Clockwise is front facing when looking down +depth, and
+				// counter-clockwise when looking back from the other side
+				if (!flip)
+					std::swap(points[1], points[2]);
+
+				stats.PixelsShaded += RasterizeTriangle(points[0], points[1], points[2], &depthBuffer[0]);
+			}
+
+			for (float depth : depthBuffer)
+				stats.PixelsCovered += depth < FLT_MAX ? 1 : 0;
+		}
+	}
+
+	return stats;
+}
+
+// --------------------------------------------------------
+// Measures how many bytes of vertex data get pulled from
+// memory when drawing the indices in order
+//
+// - Vertices still in the post-transform cache aren't read
+// - Everything else reads each 64-byte line it overlaps,
+//   unless the line is still in a small FIFO cache
+// --------------------------------------------------------
+VertexFetchStats AnalyzeVertexFetch(const std::vector<unsigned int>& indices, size_t vertexCount, size_t vertexSize)
+{
+	VertexFetchStats stats;
+	stats.VertexBufferBytes = (unsigned int)(vertexCount * vertexSize);
+
+	size_t lineCount = (vertexCount * vertexSize + FetchCacheLineSize - 1) / FetchCacheLineSize;
+	FifoCache vertexCache(vertexCount, FetchVertexCacheSize);
+	FifoCache lineCache(lineCount, FetchCacheLineCount);
+
+	for (unsigned int index : indices)
+	{
+		if (vertexCache.Access(index))
+			continue;
+
+		size_t firstLine = index * vertexSize / FetchCacheLineSize;
+		size_t lastLine = ((size_t)index * vertexSize + vertexSize - 1) / FetchCacheLineSize;
+		for (size_t line = firstLine; line <= lastLine; line++)
+		{
+			if (!lineCache.Access((unsigned int)line))
+				stats.BytesFetched += FetchCacheLineSize;
+		}
+	}
+
+	return stats;
+}
+
+namespace
+{
+	// Splits a vertex cache optimized triangle list into clusters that
+	// can be reordered freely, returning the first triangle of each
+	// cluster followed by the triangle count
+	std::vector<size_t> FindOverdrawClusters(const std::vector<unsigned int>& indices, size_t vertexCount, float threshold)
+	{
+		size_t triangleCount = indices.size() / 3;
+		FifoCache cache(vertexCount, 16);
+
+		auto triangleMisses = [&](size_t t)
+		{
+			unsigned int misses = 0;
+			for (int c = 0; c < 3; c++)
+				misses += cache.Access(indices[t * 3 + c]) ? 0 : 1;
+			return misses;
+		};
+
+		std::vector<size_t> hardBoundaries;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			if (triangleMisses(t) == 3 || t == 0)
+				hardBoundaries.push_back(t);
+		}
+		hardBoundaries.push_back(triangleCount);
+
+		std::vector<size_t> clusters;
+		for (size_t h = 0; h + 1 < hardBoundaries.size(); h++)
+		{
+			size_t start = hardBoundaries[h];
+			size_t end = hardBoundaries[h + 1];
+
+			cache.Flush();
+			unsigned int patchMisses = 0;
+			for (size_t t = start; t < end; t++)
+				patchMisses += triangleMisses(t);
+			float targetACMR = threshold * patchMisses / (end - start);
+
+			cache.Flush();
+			clusters.push_back(start);
+			unsigned int runningMisses = 0;
+			unsigned int runningTriangles = 0;
+			for (size_t t = start; t < end; t++)
+			{
+				runningMisses += triangleMisses(t);
+				runningTriangles++;
+
+				if ((float)runningMisses / runningTriangles <= targetACMR && t + 1 < end)
+				{
+					clusters.push_back(t + 1);
+					cache.Flush();
+					runningMisses = 0;
+					runningTriangles = 0;
+				}
+			}
+		}
+
+		clusters.push_back(triangleCount);
+		return clusters;
+	}
+}
+
+// --------------------------------------------------------
+// Sorts clusters of triangles from most to least outward
+// facing (Sander et al., "Fast Triangle Reordering for
+// Vertex Locality and Reduced Overdraw")
+//
+// - Hard boundaries: triangles that miss the cache on all
+//   three vertices, which is where the vertex cache order
+//   started a new patch anyway
+// - Soft boundaries: inside each patch, a new cluster starts
+//   as soon as the current one is within threshold of the
+//   patch's ACMR, with the cache flushed at each one
+// - Triangles keep their order within a cluster, so cache
+//   reuse only suffers at cluster starts
+// - If the whole list still ends up over the threshold, the
+//   clusters are made coarser until it isn't (or the input
+//   order is kept)
+// --------------------------------------------------------
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Area-weighted face normals and centroids
+	std::vector<XMFLOAT3> faceNormals(triangleCount);
+	std::vector<XMFLOAT3> faceCentroids(triangleCount);
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3 + 0]].Position);
+		XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t * 3 + 1]].Position);
+		XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t * 3 + 2]].Position);
+
+		// Clockwise winding is front facing, which puts this on the outside
+		XMVECTOR normal = XMVector3Cross(p1 - p0, p2 - p0);
+		XMVECTOR centroid = (p0 + p1 + p2) / 3.0f;
+		float area = XMVectorGetX(XMVector3Length(normal));
+
+		XMStoreFloat3(&faceNormals[t], normal);
+		XMStoreFloat3(&faceCentroids[t], centroid);
+		meshCentroid += centroid * area;
+		meshArea += area;
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	float maxACMR = SimulateVertexCache(indices, vertices.size()).GetACMR() * threshold;
+	float slack = threshold - 1.0f;
+
+	for (int attempt = 0; attempt < 4; attempt++, slack *= 0.5f)
+	{
+		std::vector<size_t> clusters = FindOverdrawClusters(indices, vertices.size(), 1.0f + slack);
+		size_t clusterCount = clusters.size() - 1;
+
+		// Clusters that sit far out along their own normal are likely in
+		// front of the rest of the mesh, whichever way it's viewed from
+		std::vector<float> sortKeys(clusterCount);
+		for (size_t c = 0; c < clusterCount; c++)
+		{
+			XMVECTOR normal = XMVectorZero();
+			XMVECTOR centroid = XMVectorZero();
+			float area = 0.0f;
+			for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+			{
+				XMVECTOR faceNormal = XMLoadFloat3(&faceNormals[t]);
+				float faceArea = XMVectorGetX(XMVector3Length(faceNormal));
+				normal += faceNormal;
+				centroid += XMLoadFloat3(&faceCentroids[t]) * faceArea;
+				area += faceArea;
+			}
+
+			if (area > 0.0f)
+				centroid /= area;
+
+			sortKeys[c] = XMVectorGetX(XMVector3Dot(centroid - meshCentroid, XMVector3Normalize(normal)));
+		}
+
+		std::vector<size_t> order(clusterCount);
+		for (size_t c = 0; c < clusterCount; c++)
+			order[c] = c;
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		std::vector<unsigned int> output;
+		output.reserve(indices.size());
+		for (size_t c : order)
+			output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+
+		if (SimulateVertexCache(output, vertices.size()).GetACMR() <= maxACMR)
+		{
+			indices.swap(output);
+			return;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Renumbers vertices in the order the index list first
+// touches them, then rewrites the indices to match
+// --------------------------------------------------------
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	const unsigned int unused = ~0u;
+	std::vector<unsigned int> remap(vertices.size(), unused);
+	std::vector<Vertex> ordered;
+	ordered.reserve(vertices.size());
+
+	for (unsigned int& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = (unsigned int)ordered.size();
+			ordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices.swap(ordered);
+}
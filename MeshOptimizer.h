@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Vertex.h"
+#include <vector>
+
+// --------------------------------------------------------
+// CPU-side passes that reshape Mesh data before it is
+// uploaded.  None of these touch Direct3D.
+// --------------------------------------------------------
+
+// Results of a WeldVertices() pass
+struct WeldStats
+{
+	unsigned int OriginalVertexCount = 0;
+	unsigned int WeldedVertexCount = 0;
+
+	// How many input vertices each output vertex replaced (1.0 = no change)
+	float GetReductionRatio() const
+	{
+		return WeldedVertexCount > 0 ? (float)OriginalVertexCount / WeldedVertexCount : 1.0f;
+	}
+};
+
+// Merges vertices that share a position, normal and UV, and
+// remaps the indices to match.  Tangents are ignored, so run
+// this before calculating them.
+//
+// epsilon - 0 merges only bit-identical vertices; anything larger
+//           snaps every component to a grid of that size first
+WeldStats WeldVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, float epsilon = 0.0f);
+
+// Results of running an index buffer through SimulateVertexCache()
+struct VertexCacheStats
+{
+	unsigned int CacheSize = 0;
+	unsigned int TriangleCount = 0;
+	unsigned int VertexCount = 0;
+	unsigned int TransformedVertexCount = 0;
+
+	// Average cache miss ratio: vertex shader runs per triangle (0.5 is ideal
+	// for a large regular grid, 3.0 means no reuse at all)
+	float GetACMR() const
+	{
+		return TriangleCount > 0 ? (float)TransformedVertexCount / TriangleCount : 0.0f;
+	}
+
+	// Average transformed vertex ratio: vertex shader runs per unique vertex
+	// (1.0 is ideal - every vertex transformed exactly once)
+	float GetATVR() const
+	{
+		return VertexCount > 0 ? (float)TransformedVertexCount / VertexCount : 0.0f;
+	}
+};
+
+// Counts how many vertex shader invocations a triangle list would cost
+// on hardware with a FIFO post-transform cache of the given size.
+// Pure CPU, so results are the same on any machine.
+VertexCacheStats SimulateVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = 16);
+
+// Reorders the triangles in an index list so that consecutive triangles
+// reuse recently transformed vertices (Tom Forsyth's "Linear-Speed Vertex
+// Cache Optimisation").  Vertices themselves are left where they are.
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+// Results of rendering a mesh with AnalyzeOverdraw()
+struct OverdrawStats
+{
+	unsigned int PixelsCovered = 0;
+	unsigned int PixelsShaded = 0;
+
+	// Pixel shader runs per visible pixel (1.0 = no overdraw at all)
+	float GetOverdraw() const
+	{
+		return PixelsCovered > 0 ? (float)PixelsShaded / PixelsCovered : 0.0f;
+	}
+};
+
+// Results of running an index buffer through AnalyzeVertexFetch()
+struct VertexFetchStats
+{
+	unsigned int BytesFetched = 0;
+	unsigned int VertexBufferBytes = 0;
+
+	// Bytes read from memory per byte of vertex data (1.0 = every byte read once)
+	float GetOverfetch() const
+	{
+		return VertexBufferBytes > 0 ? (float)BytesFetched / VertexBufferBytes : 0.0f;
+	}
+};
+
+// Draws the mesh with a small depth-tested software rasterizer from the six
+// axis directions (orthographic, back faces culled) and counts how many
+// pixels get shaded versus how many end up covered
+OverdrawStats AnalyzeOverdraw(const std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices);
+
+// Counts the memory traffic of reading vertices in index order through a
+// cache of 64-byte lines, like the input assembler does
+VertexFetchStats AnalyzeVertexFetch(const std::vector<unsigned int>& indices, size_t vertexCount, size_t vertexSize);
+
+// Reorders clusters of triangles so outward-facing ones are drawn first,
+// letting the depth test reject more of what's behind them.  Run this on
+// the output of OptimizeVertexCache().  The ACMR of the result stays
+// within "threshold" times the input's; otherwise the input is kept.
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+
+// Moves vertices into the order the indices first use them, so the vertex
+// buffer is read front to back.  Unreferenced vertices are dropped.
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+// Everything the Mesh pipeline measured while optimizing a mesh
+struct MeshOptimizationStats
+{
+	WeldStats Weld;
+	unsigned int MirroredVertexSplits = 0;	// Copies made by SplitMirroredVertices()
+	VertexCacheStats CacheBefore;
+	VertexCacheStats CacheAfter;
+	OverdrawStats OverdrawBefore;
+	OverdrawStats OverdrawAfter;
+	VertexFetchStats FetchBefore;
+	VertexFetchStats FetchAfter;
+};
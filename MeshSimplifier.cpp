@@ -0,0 +1,543 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// Sum of squared distances to a set of planes, stored as
+	// the upper half of a symmetric 4x4 matrix.  Doubles keep
+	// the large, nearly cancelling terms accurate.
+	// --------------------------------------------------------
+	struct Quadric
+	{
+		double A00, A01, A02, A11, A12, A22;
+		double B0, B1, B2;
+		double C;
+	};
+
+	void AddPlane(Quadric& q, double a, double b, double c, double d)
+	{
+		q.A00 += a * a; q.A01 += a * b; q.A02 += a * c;
+		q.A11 += b * b; q.A12 += b * c;
+		q.A22 += c * c;
+		q.B0 += a * d; q.B1 += b * d; q.B2 += c * d;
+		q.C += d * d;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& other)
+	{
+		q.A00 += other.A00; q.A01 += other.A01; q.A02 += other.A02;
+		q.A11 += other.A11; q.A12 += other.A12;
+		q.A22 += other.A22;
+		q.B0 += other.B0; q.B1 += other.B1; q.B2 += other.B2;
+		q.C += other.C;
+	}
+
+	double EvaluateQuadric(const Quadric& q, const XMFLOAT3& p)
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double result =
+			q.A00 * x * x + q.A11 * y * y + q.A22 * z * z +
+			2.0 * (q.A01 * x * y + q.A02 * x * z + q.A12 * y * z) +
+			2.0 * (q.B0 * x + q.B1 * y + q.B2 * z) +
+			q.C;
+
+		// Rounding can push a zero error slightly negative
+		return result > 0.0 ? result : 0.0;
+	}
+
+	enum class VertexKind
+	{
+		Manifold,	// Free to move anywhere along its edges
+		Border,		// On one open boundary; slides along it
+		Locked		// Corner or tangled boundary; never moves
+	};
+
+	// Directed edge between two positions, for sorting and searching
+	uint64_t EdgeKey(unsigned int from, unsigned int to)
+	{
+		return ((uint64_t)from << 32) | to;
+	}
+
+	bool HasEdge(const std::vector<uint64_t>& sortedEdges, unsigned int from, unsigned int to)
+	{
+		return std::binary_search(sortedEdges.begin(), sortedEdges.end(), EdgeKey(from, to));
+	}
+
+	// --------------------------------------------------------
+	// Groups the vertices that share an exact position (the
+	// copies along UV seams and hard edges).  Each vertex gets
+	// the id of its group's first member, and the members of
+	// a group are listed together in "members".
+	// --------------------------------------------------------
+	void FindPositionGroups(const Vertex* vertices, size_t vertexCount, std::vector<unsigned int>& positionOf, std::vector<unsigned int>& members, std::vector<unsigned int>& groupStart, std::vector<unsigned int>& groupSize)
+	{
+		std::vector<unsigned int> order(vertexCount);
+		for (size_t i = 0; i < vertexCount; i++)
+			order[i] = (unsigned int)i;
+
+		std::sort(order.begin(), order.end(), [vertices](unsigned int a, unsigned int b)
+		{
+			int compare = memcmp(&vertices[a].Position, &vertices[b].Position, sizeof(XMFLOAT3));
+			return compare < 0 || (compare == 0 && a < b);
+		});
+
+		positionOf.resize(vertexCount);
+		groupStart.assign(vertexCount, 0);
+		groupSize.assign(vertexCount, 0);
+		for (size_t i = 0; i < vertexCount; )
+		{
+			size_t end = i + 1;
+			while (end < vertexCount && memcmp(&vertices[order[i]].Position, &vertices[order[end]].Position, sizeof(XMFLOAT3)) == 0)
+				end++;
+
+			for (size_t j = i; j < end; j++)
+				positionOf[order[j]] = order[i];
+			groupStart[order[i]] = (unsigned int)i;
+			groupSize[order[i]] = (unsigned int)(end - i);
+			i = end;
+		}
+		members.swap(order);
+	}
+
+	// Every directed triangle edge, in position ids, sorted
+	void CollectEdges(const std::vector<unsigned int>& indices, const std::vector<unsigned int>& positionOf, std::vector<uint64_t>& edges)
+	{
+		edges.clear();
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned int a = positionOf[indices[i + e]];
+				unsigned int b = positionOf[indices[i + (e + 1) % 3]];
+				edges.push_back(EdgeKey(a, b));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+	}
+
+	XMVECTOR TriangleNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+	{
+		XMVECTOR a = XMLoadFloat3(&p0);
+		return XMVector3Cross(XMLoadFloat3(&p1) - a, XMLoadFloat3(&p2) - a);
+	}
+
+	struct Collapse
+	{
+		unsigned int From;
+		unsigned int To;
+		double Cost;
+	};
+
+	// --------------------------------------------------------
+	// Everything a simplification keeps between passes, so a
+	// LOD chain can carry on from one level to the next with
+	// the same quadrics
+	// --------------------------------------------------------
+	class Simplifier
+	{
+	public:
+		Simplifier(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+
+		// Simplifies the current result further; returns the largest error so far
+		float Run(size_t targetIndexCount, float maxError);
+
+		const std::vector<unsigned int>& GetResult() { return result; }
+
+		// Which input triangle each result triangle started out as.  Only
+		// collapsed triangles are ever dropped, so this stays ascending.
+		const std::vector<unsigned int>& GetOrigins() { return origins; }
+
+	private:
+		const Vertex* vertices;
+		size_t vertexCount;
+		std::vector<unsigned int> result;
+		std::vector<unsigned int> origins;
+
+		std::vector<unsigned int> positionOf;
+		std::vector<unsigned int> members;
+		std::vector<unsigned int> groupStart;
+		std::vector<unsigned int> groupSize;
+		std::vector<VertexKind> kind;
+		std::vector<Quadric> quadrics;
+		double largestCost = 0.0;
+
+		// Scratch space for each pass
+		std::vector<uint64_t> edges;
+		std::vector<unsigned int> triangleOffsets;
+		std::vector<unsigned int> vertexTriangles;
+		std::vector<Collapse> collapses;
+		std::vector<unsigned char> touched;
+		std::vector<unsigned int> partners;
+	};
+}
+
+// --------------------------------------------------------
+// Sorts the vertices into position groups, classifies the
+// borders and builds the starting quadrics
+// --------------------------------------------------------
+Simplifier::Simplifier(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+	: vertices(vertices), vertexCount(vertexCount), result(indices, indices + indexCount)
+{
+	FindPositionGroups(vertices, vertexCount, positionOf, members, groupStart, groupSize);
+
+	origins.resize(indexCount / 3);
+	for (size_t t = 0; t < origins.size(); t++)
+		origins[t] = (unsigned int)t;
+
+	// A position with exactly one outgoing and one incoming border
+	// edge lies on a simple boundary; anything more tangled is locked
+	CollectEdges(result, positionOf, edges);
+
+	std::vector<unsigned char> borderOut(vertexCount, 0);
+	std::vector<unsigned char> borderIn(vertexCount, 0);
+	for (uint64_t key : edges)
+	{
+		unsigned int a = (unsigned int)(key >> 32);
+		unsigned int b = (unsigned int)key;
+		if (!HasEdge(edges, b, a))
+		{
+			if (borderOut[a] < 255) borderOut[a]++;
+			if (borderIn[b] < 255) borderIn[b]++;
+		}
+	}
+
+	// Indexed by position id, like everything below
+	kind.assign(vertexCount, VertexKind::Manifold);
+	for (size_t p = 0; p < vertexCount; p++)
+	{
+		if (borderOut[p] == 1 && borderIn[p] == 1)
+			kind[p] = VertexKind::Border;
+		else if (borderOut[p] != 0 || borderIn[p] != 0)
+			kind[p] = VertexKind::Locked;
+	}
+
+	// Each position starts with the planes of the triangles around it.
+	// Border edges add a plane standing up along the edge, which keeps
+	// the outline from caving in as border vertices slide.
+	quadrics.assign(vertexCount, Quadric());
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		const XMFLOAT3* p[3] =
+		{
+			&vertices[indices[i]].Position,
+			&vertices[indices[i + 1]].Position,
+			&vertices[indices[i + 2]].Position
+		};
+
+		XMVECTOR normal = TriangleNormal(*p[0], *p[1], *p[2]);
+		float length = XMVectorGetX(XMVector3Length(normal));
+		if (length <= 0.0f)
+			continue;
+		normal /= length;
+
+		XMFLOAT3 n;
+		XMStoreFloat3(&n, normal);
+		double d = -(n.x * (double)p[0]->x + n.y * (double)p[0]->y + n.z * (double)p[0]->z);
+		for (int c = 0; c < 3; c++)
+			AddPlane(quadrics[positionOf[indices[i + c]]], n.x, n.y, n.z, d);
+
+		for (int e = 0; e < 3; e++)
+		{
+			unsigned int a = positionOf[indices[i + e]];
+			unsigned int b = positionOf[indices[i + (e + 1) % 3]];
+			if (HasEdge(edges, b, a))
+				continue;
+
+			XMVECTOR edge = XMLoadFloat3(p[(e + 1) % 3]) - XMLoadFloat3(p[e]);
+			XMVECTOR sideNormal = XMVector3Normalize(XMVector3Cross(edge, normal));
+			XMFLOAT3 s;
+			XMStoreFloat3(&s, sideNormal);
+			double sideD = -(s.x * (double)p[e]->x + s.y * (double)p[e]->y + s.z * (double)p[e]->z);
+			AddPlane(quadrics[a], s.x, s.y, s.z, sideD);
+			AddPlane(quadrics[b], s.x, s.y, s.z, sideD);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Runs in passes.  Each pass gathers every allowed edge
+// collapse, sorts them by error, and performs the cheapest
+// ones that don't touch a vertex changed earlier in the
+// same pass (so the flip checks stay valid).
+//
+// Collapses work on positions rather than vertices: every
+// copy of the moving position has to follow an edge to a
+// copy of the target.  A seam can therefore only move along
+// itself, and never gets torn open.
+// --------------------------------------------------------
+float Simplifier::Run(size_t targetIndexCount, float maxError)
+{
+	double maxCost = (double)maxError * maxError;
+
+	while (result.size() > targetIndexCount)
+	{
+		size_t triangleCount = result.size() / 3;
+
+		// Triangles around each vertex, as compressed rows
+		triangleOffsets.assign(vertexCount + 1, 0);
+		for (unsigned int index : result)
+			triangleOffsets[index + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			triangleOffsets[v + 1] += triangleOffsets[v];
+		vertexTriangles.resize(result.size());
+		{
+			std::vector<unsigned int> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); i++)
+				vertexTriangles[cursor[result[i]]++] = (unsigned int)(i / 3);
+		}
+		CollectEdges(result, positionOf, edges);
+
+		// Every edge between two positions, in whichever allowed
+		// direction is cheaper
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned int a = positionOf[result[i + e]];
+				unsigned int b = positionOf[result[i + (e + 1) % 3]];
+
+				// Interior edges show up (at least) twice; keep one copy
+				bool border = !HasEdge(edges, b, a);
+				if (a == b || (!border && a > b))
+					continue;
+
+				Collapse best = { 0, 0, -1.0 };
+				for (int direction = 0; direction < 2; direction++)
+				{
+					unsigned int from = direction == 0 ? a : b;
+					unsigned int to = direction == 0 ? b : a;
+
+					if (kind[from] == VertexKind::Locked || (kind[from] == VertexKind::Border && !border))
+						continue;
+
+					Quadric q = quadrics[from];
+					AddQuadric(q, quadrics[to]);
+					double cost = EvaluateQuadric(q, vertices[to].Position);
+					if (best.Cost < 0.0 || cost < best.Cost)
+						best = { from, to, cost };
+				}
+
+				if (best.Cost >= 0.0 && best.Cost <= maxCost)
+					collapses.push_back(best);
+			}
+		}
+
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.Cost < y.Cost; });
+
+		// Collapsing an interior edge removes two triangles.  Allow some
+		// slack past the cheapest "goal" collapses, as many get skipped.
+		size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+		size_t goal = std::min(collapses.size() - 1, (trianglesToRemove + 1) / 2);
+		double passLimit = collapses[goal].Cost * 1.5;
+
+		touched.assign(vertexCount, 0);
+		size_t removed = 0;
+		size_t performed = 0;
+		for (const Collapse& c : collapses)
+		{
+			if (removed >= trianglesToRemove || c.Cost > passLimit)
+				break;
+
+			const unsigned int* fromMembers = &members[groupStart[c.From]];
+			const unsigned int* toMembers = &members[groupStart[c.To]];
+			unsigned int fromCount = groupSize[c.From];
+			unsigned int toCount = groupSize[c.To];
+
+			bool blocked = false;
+			for (unsigned int m = 0; m < fromCount && !blocked; m++)
+				blocked = touched[fromMembers[m]] != 0;
+			for (unsigned int m = 0; m < toCount && !blocked; m++)
+				blocked = touched[toMembers[m]] != 0;
+			if (blocked)
+				continue;
+
+			// Pair each copy of the moving position with the copy of the
+			// target it shares a triangle with
+			partners.assign(fromCount, ~0u);
+			bool paired = true;
+			for (unsigned int m = 0; m < fromCount && paired; m++)
+			{
+				unsigned int v = fromMembers[m];
+				for (unsigned int t = triangleOffsets[v]; t < triangleOffsets[v + 1] && partners[m] == ~0u; t++)
+				{
+					const unsigned int* triangle = &result[vertexTriangles[t] * 3];
+					for (int k = 0; k < 3; k++)
+					{
+						if (positionOf[triangle[k]] == c.To)
+						{
+							partners[m] = triangle[k];
+							break;
+						}
+					}
+				}
+
+				// Copies no triangle uses any more don't need a partner
+				if (partners[m] == ~0u && triangleOffsets[v] != triangleOffsets[v + 1])
+					paired = false;
+			}
+			if (!paired)
+				continue;
+
+			// Reject collapses that would fold a surviving triangle over
+			bool flips = false;
+			for (unsigned int m = 0; m < fromCount && !flips; m++)
+			{
+				unsigned int v = fromMembers[m];
+				for (unsigned int t = triangleOffsets[v]; t < triangleOffsets[v + 1] && !flips; t++)
+				{
+					const unsigned int* triangle = &result[vertexTriangles[t] * 3];
+					if (positionOf[triangle[0]] == c.To || positionOf[triangle[1]] == c.To || positionOf[triangle[2]] == c.To)
+						continue;
+
+					const XMFLOAT3* before[3];
+					const XMFLOAT3* after[3];
+					for (int k = 0; k < 3; k++)
+					{
+						before[k] = &vertices[triangle[k]].Position;
+						after[k] = triangle[k] == v ? &vertices[c.To].Position : before[k];
+					}
+
+					XMVECTOR oldNormal = TriangleNormal(*before[0], *before[1], *before[2]);
+					XMVECTOR newNormal = TriangleNormal(*after[0], *after[1], *after[2]);
+					float dot = XMVectorGetX(XMVector3Dot(oldNormal, newNormal));
+					float lengths = XMVectorGetX(XMVector3Length(oldNormal)) * XMVectorGetX(XMVector3Length(newNormal));
+					if (lengths > 0.0f ? dot <= 0.25f * lengths : XMVectorGetX(XMVector3LengthSq(oldNormal)) > 0.0f)
+						flips = true;
+				}
+			}
+			if (flips)
+				continue;
+
+			// Move every copy, and lock the whole neighbourhood until the
+			// next pass rebuilds the adjacency
+			for (unsigned int m = 0; m < fromCount; m++)
+			{
+				unsigned int v = fromMembers[m];
+				for (unsigned int t = triangleOffsets[v]; t < triangleOffsets[v + 1]; t++)
+				{
+					unsigned int* triangle = &result[vertexTriangles[t] * 3];
+					bool hadTo = positionOf[triangle[0]] == c.To || positionOf[triangle[1]] == c.To || positionOf[triangle[2]] == c.To;
+					for (int k = 0; k < 3; k++)
+					{
+						touched[triangle[k]] = 1;
+						if (triangle[k] == v)
+							triangle[k] = partners[m];
+					}
+					if (hadTo)
+						removed++;
+				}
+				touched[v] = 1;
+			}
+			for (unsigned int m = 0; m < toCount; m++)
+				touched[toMembers[m]] = 1;
+
+			AddQuadric(quadrics[c.To], quadrics[c.From]);
+			largestCost = std::max(largestCost, c.Cost);
+			performed++;
+		}
+
+		if (performed == 0)
+			break;
+
+		// Drop the triangles that collapsed to a line
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			unsigned int a = result[i], b = result[i + 1], c = result[i + 2];
+			if (a == b || b == c || c == a)
+				continue;
+			origins[write / 3] = origins[i / 3];
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+		origins.resize(write / 3);
+	}
+
+	return (float)sqrt(largestCost);
+}
+
+// --------------------------------------------------------
+// A single simplification, straight from the full mesh
+// --------------------------------------------------------
+float SimplifyMesh(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, size_t targetIndexCount, float maxError, std::vector<unsigned int>& result)
+{
+	Simplifier simplifier(vertices, vertexCount, indices, indexCount);
+	float error = simplifier.Run(targetIndexCount, maxError);
+	result = simplifier.GetResult();
+	return error;
+}
+
+// --------------------------------------------------------
+// The whole index list as a single part
+// --------------------------------------------------------
+void BuildLodChain(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, float maxError, std::vector<unsigned int>& lodIndices, std::vector<MeshLod>& lods)
+{
+	MeshLod whole = { 0, (unsigned int)indexCount, 0.0f };
+	std::vector<MeshLod> partLods;
+	BuildLodChain(vertices, vertexCount, indices, indexCount, &whole, 1, maxError, lodIndices, lods, partLods);
+}
+
+// --------------------------------------------------------
+// Walks down the chain with one Simplifier, so each level
+// starts from the last and its error is still measured
+// against the full detail mesh.  Simplifying all the parts
+// together keeps the edges where they meet closed.
+// --------------------------------------------------------
+void BuildLodChain(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, const MeshLod* parts, size_t partCount, float maxError, std::vector<unsigned int>& lodIndices, std::vector<MeshLod>& lods, std::vector<MeshLod>& partLods)
+{
+	lodIndices.assign(indices, indices + indexCount);
+	lods.clear();
+	lods.push_back({ 0, (unsigned int)indexCount, 0.0f });
+	partLods.assign(parts, parts + partCount);
+
+	Simplifier simplifier(vertices, vertexCount, indices, indexCount);
+	std::vector<unsigned int> ordered;
+	const float ratios[] = MESH_LOD_RATIOS;
+	for (float ratio : ratios)
+	{
+		size_t target = (size_t)(indexCount * ratio) / 3 * 3;
+		float error = simplifier.Run(target, maxError);
+
+		// Levels that barely improve on the one before aren't worth
+		// their memory (everything left may be locked, or over the limit)
+		const std::vector<unsigned int>& level = simplifier.GetResult();
+		if (level.size() > lods.back().IndexCount * 0.8f)
+			break;
+
+		// Surviving triangles keep their order, so each part's are still
+		// a single run; reorder every run for the vertex cache separately
+		const std::vector<unsigned int>& origins = simplifier.GetOrigins();
+		unsigned int levelStart = (unsigned int)lodIndices.size();
+		size_t triangle = 0;
+		for (size_t p = 0; p < partCount; p++)
+		{
+			size_t first = triangle;
+			size_t partEnd = parts[p].StartIndex + (size_t)parts[p].IndexCount;
+			while (triangle < origins.size() && origins[triangle] * (size_t)3 < partEnd)
+				triangle++;
+
+			ordered.assign(level.begin() + first * 3, level.begin() + triangle * 3);
+			OptimizeVertexCache(ordered, vertexCount);
+
+			partLods.push_back({ (unsigned int)lodIndices.size(), (unsigned int)ordered.size(), error });
+			lodIndices.insert(lodIndices.end(), ordered.begin(), ordered.end());
+		}
+
+		lods.push_back({ levelStart, (unsigned int)lodIndices.size() - levelStart, error });
+	}
+}
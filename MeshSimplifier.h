@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Vertex.h"
+#include <vector>
+
+// --------------------------------------------------------
+// Quadric error metric simplification (Garland & Heckbert)
+// for building levels of detail
+//
+// Only the index list changes: every collapse moves one
+// vertex onto a neighbour that already exists, so all the
+// levels of a mesh can share a single vertex buffer.
+// --------------------------------------------------------
+
+// One level of detail: a range of the mesh's index buffer
+struct MeshLod
+{
+	unsigned int StartIndex;
+	unsigned int IndexCount;
+
+	// Model space distance the surface may have moved from the full
+	// detail mesh; 0 for the full detail level itself
+	float Error;
+};
+
+// The triangle ratios SimplifyMesh() is asked for, coarsest last
+#define MESH_LOD_RATIOS { 0.5f, 0.25f, 0.125f }
+
+// Collapses edges, cheapest first, until no more than targetIndexCount
+// indices remain or the next collapse would move the surface by more
+// than maxError.  Returns the largest error of any collapse made.
+//
+// - Positions shared by several Vertex entries (UV seams and hard normal
+//   edges) move all their copies together, and only along the seam
+// - Vertices on an open border only slide along that border
+float SimplifyMesh(
+	const Vertex* vertices,
+	size_t vertexCount,
+	const unsigned int* indices,
+	size_t indexCount,
+	size_t targetIndexCount,
+	float maxError,
+	std::vector<unsigned int>& result);
+
+// Simplifies to each of MESH_LOD_RATIOS in turn.  lodIndices gets the full
+// index list followed by every level's (each reordered for the vertex
+// cache), and lods gets their ranges, starting with the full mesh.  Levels
+// that can't get at least 20% below the one before are left out.
+void BuildLodChain(
+	const Vertex* vertices,
+	size_t vertexCount,
+	const unsigned int* indices,
+	size_t indexCount,
+	float maxError,
+	std::vector<unsigned int>& lodIndices,
+	std::vector<MeshLod>& lods);
+
+// BuildLodChain() for an index list made of several parts (submeshes),
+// given as consecutive ranges of it.  Every level keeps each triangle in
+// its part and the parts in order, so lods still covers whole levels,
+// and partLods gets each part's range of each level: the parts
+// themselves first, then level by level.
+void BuildLodChain(
+	const Vertex* vertices,
+	size_t vertexCount,
+	const unsigned int* indices,
+	size_t indexCount,
+	const MeshLod* parts,
+	size_t partCount,
+	float maxError,
+	std::vector<unsigned int>& lodIndices,
+	std::vector<MeshLod>& lods,
+	std::vector<MeshLod>& partLods);
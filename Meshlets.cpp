@@ -0,0 +1,234 @@
+#include "Meshlets.h"
+
+#include <DirectXCollision.h>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// Fills in the bounding sphere and normal cone of a
+	// meshlet whose index range is already set
+	// --------------------------------------------------------
+	void ComputeMeshletBounds(Meshlet& meshlet, const Vertex* vertices, const unsigned int* indices, const unsigned int* meshletVertices)
+	{
+		// Sphere around the unique vertices
+		XMFLOAT3 points[MESHLET_MAX_VERTICES];
+		unsigned int pointCount = meshlet.VertexCount < MESHLET_MAX_VERTICES ? meshlet.VertexCount : MESHLET_MAX_VERTICES;
+		for (unsigned int i = 0; i < pointCount; i++)
+			points[i] = vertices[meshletVertices[i]].Position;
+
+		BoundingSphere sphere;
+		BoundingSphere::CreateFromPoints(sphere, pointCount, points, sizeof(XMFLOAT3));
+		meshlet.Center = sphere.Center;
+		meshlet.Radius = sphere.Radius;
+
+		// Face normals (front faces are clockwise, which in a left-handed
+		// space makes the plain cross product point outwards)
+		XMVECTOR normals[MESHLET_MAX_TRIANGLES];
+		unsigned int normalCount = 0;
+		XMVECTOR axis = XMVectorZero();
+		const unsigned int* triangle = indices + meshlet.StartIndex;
+		for (unsigned int t = 0; t < meshlet.TriangleCount; t++, triangle += 3)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[triangle[0]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[triangle[1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&vertices[triangle[2]].Position);
+			XMVECTOR normal = XMVector3Cross(p1 - p0, p2 - p0);
+
+			// Degenerate triangles never get rasterized, so they can't
+			// make the cone any wider
+			float length = XMVectorGetX(XMVector3Length(normal));
+			if (length <= 0.0f)
+				continue;
+
+			normal /= length;
+			normals[normalCount++] = normal;
+			axis += normal;
+		}
+
+		meshlet.ConeApex = meshlet.Center;
+		meshlet.ConeAxis = XMFLOAT3(0, 0, 0);
+		meshlet.ConeCutoff = 1.0f;
+
+		float axisLength = XMVectorGetX(XMVector3Length(axis));
+		if (normalCount == 0 || axisLength <= 0.0f)
+			return;
+		axis /= axisLength;
+
+		// The cone has to contain every normal; past 90 degrees some
+		// triangle always faces the camera
+		float minDot = 1.0f;
+		for (unsigned int i = 0; i < normalCount; i++)
+			minDot = fminf(minDot, XMVectorGetX(XMVector3Dot(axis, normals[i])));
+		if (minDot <= 0.0f)
+			return;
+
+		// Move the apex back along the axis until it is behind every
+		// triangle's plane.  Any camera inside the cone behind the apex
+		// is then behind all of them too.
+		XMVECTOR center = XMLoadFloat3(&meshlet.Center);
+		float maxOffset = 0.0f;
+		triangle = indices + meshlet.StartIndex;
+		unsigned int n = 0;
+		for (unsigned int t = 0; t < meshlet.TriangleCount; t++, triangle += 3)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[triangle[0]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[triangle[1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&vertices[triangle[2]].Position);
+			if (XMVectorGetX(XMVector3LengthSq(XMVector3Cross(p1 - p0, p2 - p0))) <= 0.0f)
+				continue;
+
+			XMVECTOR normal = normals[n++];
+			float offset = XMVectorGetX(XMVector3Dot(center - p0, normal)) / XMVectorGetX(XMVector3Dot(axis, normal));
+			maxOffset = fmaxf(maxOffset, offset);
+		}
+
+		XMStoreFloat3(&meshlet.ConeApex, center - axis * maxOffset);
+		XMStoreFloat3(&meshlet.ConeAxis, axis);
+
+		// The view direction must be within (90 - spread) degrees of the
+		// axis, and cos(90 - spread) = sin(spread)
+		meshlet.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+	}
+}
+
+// --------------------------------------------------------
+// Walks the triangles in order, starting a new meshlet
+// whenever the next triangle would push the current one
+// past either limit
+// --------------------------------------------------------
+void BuildMeshlets(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, std::vector<Meshlet>& meshlets, unsigned int maxVertices, unsigned int maxTriangles)
+{
+	meshlets.clear();
+	if (maxVertices > MESHLET_MAX_VERTICES) maxVertices = MESHLET_MAX_VERTICES;
+	if (maxTriangles > MESHLET_MAX_TRIANGLES) maxTriangles = MESHLET_MAX_TRIANGLES;
+	if (maxVertices < 3 || maxTriangles < 1)
+		return;
+
+	// Which meshlet last used each vertex, so membership is a single lookup
+	const unsigned int unused = ~0u;
+	std::vector<unsigned int> vertexMeshlet(vertexCount, unused);
+	unsigned int meshletVertices[MESHLET_MAX_VERTICES];
+
+	Meshlet current = {};
+	unsigned int currentId = 0;
+
+	size_t triangleCount = indexCount / 3;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const unsigned int* triangle = indices + t * 3;
+
+		unsigned int newVertices = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			// Repeated corners of a degenerate triangle only count once
+			bool repeat = (corner > 0 && triangle[corner] == triangle[0]) || (corner > 1 && triangle[corner] == triangle[1]);
+			if (!repeat && vertexMeshlet[triangle[corner]] != currentId)
+				newVertices++;
+		}
+
+		if (current.TriangleCount > 0 &&
+			(current.VertexCount + newVertices > maxVertices || current.TriangleCount + 1 > maxTriangles))
+		{
+			ComputeMeshletBounds(current, vertices, indices, meshletVertices);
+			meshlets.push_back(current);
+
+			current = {};
+			current.StartIndex = (unsigned int)(t * 3);
+			currentId++;
+		}
+
+		for (int corner = 0; corner < 3; corner++)
+		{
+			unsigned int index = triangle[corner];
+			if (vertexMeshlet[index] != currentId)
+			{
+				vertexMeshlet[index] = currentId;
+				meshletVertices[current.VertexCount++] = index;
+			}
+		}
+		current.TriangleCount++;
+	}
+
+	if (current.TriangleCount > 0)
+	{
+		ComputeMeshletBounds(current, vertices, indices, meshletVertices);
+		meshlets.push_back(current);
+	}
+}
+
+// --------------------------------------------------------
+// Moves the camera into the mesh's model space, where the
+// meshlet bounds live
+//
+// - The frustum planes come straight from the combined
+//   world-view-projection matrix (Gribb & Hartmann), which
+//   stays exact even under non-uniform scale
+// - Back faces are only well defined for a perspective
+//   camera, and a mirroring world matrix flips them
+// --------------------------------------------------------
+MeshletCullingView GetMeshletCullingView(const XMFLOAT4X4& world, const XMFLOAT4X4& view, const XMFLOAT4X4& projection)
+{
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+	XMMATRIX worldView = XMMatrixMultiply(worldMatrix, XMLoadFloat4x4(&view));
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixMultiply(worldView, XMLoadFloat4x4(&projection)));
+
+	MeshletCullingView result = {};
+	XMFLOAT4 column0(m._11, m._21, m._31, m._41);
+	XMFLOAT4 column1(m._12, m._22, m._32, m._42);
+	XMFLOAT4 column2(m._13, m._23, m._33, m._43);
+	XMFLOAT4 column3(m._14, m._24, m._34, m._44);
+	XMVECTOR x = XMLoadFloat4(&column0);
+	XMVECTOR y = XMLoadFloat4(&column1);
+	XMVECTOR z = XMLoadFloat4(&column2);
+	XMVECTOR w = XMLoadFloat4(&column3);
+
+	XMVECTOR planes[6] =
+	{
+		w + x,	// Left
+		w - x,	// Right
+		w + y,	// Bottom
+		w - y,	// Top
+		z,		// Near (D3D clip space z starts at 0)
+		w - z	// Far
+	};
+	for (int i = 0; i < 6; i++)
+		XMStoreFloat4(&result.FrustumPlanes[i], XMPlaneNormalize(planes[i]));
+
+	// The camera sits at the origin of view space
+	XMVECTOR determinant;
+	XMMATRIX viewToModel = XMMatrixInverse(&determinant, worldView);
+	XMStoreFloat3(&result.CameraPosition, viewToModel.r[3]);
+
+	bool perspective = projection._34 != 0.0f;
+	bool mirrored = XMVectorGetX(XMMatrixDeterminant(worldMatrix)) < 0.0f;
+	result.ConeCulling = perspective && !mirrored;
+	return result;
+}
+
+// --------------------------------------------------------
+// Frustum first (it rejects more on a typical scene), then
+// the normal cone
+// --------------------------------------------------------
+MeshletVisibility CullMeshlet(const Meshlet& meshlet, const MeshletCullingView& view)
+{
+	XMVECTOR center = XMLoadFloat3(&meshlet.Center);
+	for (int i = 0; i < 6; i++)
+	{
+		float distance = XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&view.FrustumPlanes[i]), center));
+		if (distance < -meshlet.Radius)
+			return MeshletVisibility::OutsideFrustum;
+	}
+
+	if (view.ConeCulling && meshlet.ConeCutoff < 1.0f)
+	{
+		XMVECTOR direction = XMVector3Normalize(XMLoadFloat3(&meshlet.ConeApex) - XMLoadFloat3(&view.CameraPosition));
+		if (XMVectorGetX(XMVector3Dot(direction, XMLoadFloat3(&meshlet.ConeAxis))) > meshlet.ConeCutoff)
+			return MeshletVisibility::BackFacing;
+	}
+
+	return MeshletVisibility::Visible;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Vertex.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Meshlets: small, fixed-size clusters of a mesh's
+// triangles that can be culled individually on the CPU
+//
+// Each meshlet is a contiguous run of the mesh's index
+// buffer, so the visible ones can still be drawn with plain
+// DrawIndexed() calls on the original buffers
+// --------------------------------------------------------
+
+// Limits that match the usual mesh shader sweet spot
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+struct Meshlet
+{
+	unsigned int StartIndex;		// First index in the mesh's index buffer
+	unsigned int TriangleCount;
+	unsigned int VertexCount;		// Unique vertices referenced
+
+	// Bounding sphere, in model space
+	DirectX::XMFLOAT3 Center;
+	float Radius;
+
+	// Normal cone: every triangle faces away from any camera for which
+	// dot(normalize(ConeApex - camera), ConeAxis) > ConeCutoff.
+	// A cutoff of 1 means the normals are too spread out to ever cull.
+	DirectX::XMFLOAT3 ConeApex;
+	DirectX::XMFLOAT3 ConeAxis;
+	float ConeCutoff;
+};
+
+// Splits a triangle list into meshlets, in the order the triangles are
+// already in (so run it after the vertex cache and overdraw passes)
+void BuildMeshlets(
+	const Vertex* vertices,
+	size_t vertexCount,
+	const unsigned int* indices,
+	size_t indexCount,
+	std::vector<Meshlet>& meshlets,
+	unsigned int maxVertices = MESHLET_MAX_VERTICES,
+	unsigned int maxTriangles = MESHLET_MAX_TRIANGLES);
+
+// A camera as seen from one instance of a mesh, in that mesh's model space
+struct MeshletCullingView
+{
+	DirectX::XMFLOAT4 FrustumPlanes[6];	// Normalized, pointing inwards
+	DirectX::XMFLOAT3 CameraPosition;
+	bool ConeCulling;					// Off for orthographic or mirrored views
+};
+
+// Builds the culling view for a mesh drawn with these matrices
+MeshletCullingView GetMeshletCullingView(const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection);
+
+enum class MeshletVisibility
+{
+	Visible,
+	OutsideFrustum,
+	BackFacing
+};
+
+MeshletVisibility CullMeshlet(const Meshlet& meshlet, const MeshletCullingView& view);
+
+// Triangle counts gathered while drawing with meshlet culling
+struct MeshletCullingStats
+{
+	unsigned int TrianglesTested = 0;
+	unsigned int TrianglesOutsideFrustum = 0;
+	unsigned int TrianglesBackFacing = 0;
+	unsigned int DrawCalls = 0;
+
+	// Share of the tested triangles that never reached the GPU
+	float GetRejectedShare() const
+	{
+		return TrianglesTested > 0 ? (float)(TrianglesOutsideFrustum + TrianglesBackFacing) / TrianglesTested : 0.0f;
+	}
+};
@@ -0,0 +1,870 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "WorkerPool.h"
+
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Hand-written scanners used by the OBJ parser
+//
+// - They work directly on the mapped bytes with an explicit
+//   end pointer, so lines can be any length and the data
+//   never needs to be copied or null terminated
+// - Each scanner advances the cursor past what it consumed
+// --------------------------------------------------------
+namespace
+{
+	// Powers of ten that are exactly representable as doubles
+	const double ExactPowersOfTen[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	inline bool IsDigit(char c)
+	{
+		return (unsigned char)(c - '0') < 10;
+	}
+
+	inline bool IsBlank(char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	inline void SkipBlanks(const char*& p, const char* end)
+	{
+		while (p < end && IsBlank(*p))
+			p++;
+	}
+
+	// Moves to the first character of the next line
+	inline void SkipLine(const char*& p, const char* end)
+	{
+		const char* newLine = (const char*)memchr(p, '\n', end - p);
+		p = newLine ? newLine + 1 : end;
+	}
+
+	// Reads a decimal float such as "-1.25", "3" or "4.5e-3"
+	bool ScanFloat(const char*& p, const char* end, float& result)
+	{
+		const char* start = p;
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			p++;
+		}
+
+		// Gather up to 19 significant digits into an integer
+		uint64_t mantissa = 0;
+		int significantDigits = 0;
+		int exponent = 0;
+		bool anyDigits = false;
+		bool truncated = false;
+
+		while (p < end && IsDigit(*p))
+		{
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				if (mantissa) significantDigits++;
+			}
+			else
+			{
+				exponent++;
+				truncated = true;
+			}
+			anyDigits = true;
+			p++;
+		}
+
+		if (p < end && *p == '.')
+		{
+			p++;
+			while (p < end && IsDigit(*p))
+			{
+				if (significantDigits < 19)
+				{
+					mantissa = mantissa * 10 + (*p - '0');
+					if (mantissa) significantDigits++;
+					exponent--;
+				}
+				else
+				{
+					truncated = true;
+				}
+				anyDigits = true;
+				p++;
+			}
+		}
+
+		if (!anyDigits)
+		{
+			p = start;
+			return false;
+		}
+
+		// Optional exponent - only consumed if it is well formed
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			const char* exponentStart = p++;
+			bool exponentNegative = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				exponentNegative = *p == '-';
+				p++;
+			}
+
+			if (p < end && IsDigit(*p))
+			{
+				int value = 0;
+				while (p < end && IsDigit(*p))
+				{
+					if (value < 10000) value = value * 10 + (*p - '0');
+					p++;
+				}
+				exponent += exponentNegative ? -value : value;
+			}
+			else
+			{
+				p = exponentStart;
+			}
+		}
+
+		// Fast path: both the mantissa and the power of ten are exact
+		// doubles, so a single multiply or divide is correctly rounded
+		if (!truncated && mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22)
+		{
+			double value = (double)mantissa;
+			value = exponent < 0 ?
+				value / ExactPowersOfTen[-exponent] :
+				value * ExactPowersOfTen[exponent];
+
+			result = (float)(negative ? -value : value);
+			return true;
+		}
+
+		// Slow path for very long or extreme numbers, finished from the
+		// digits already scanned rather than the text (so no copy to cut
+		// short, and no locale).  Nineteen digits and a double's power of
+		// ten are well past what a float keeps.  Past a float's range the
+		// result is settled first: zero below its smallest denormal (even
+		// with all 19 digits), infinity above its largest.
+		double value = 0.0;
+		if (mantissa != 0 && exponent >= -70)
+		{
+			value = exponent > 39 ? HUGE_VAL :
+				exponent < 0 ?
+				mantissa / std::pow(10.0, -exponent) :
+				mantissa * std::pow(10.0, exponent);
+		}
+
+		result = (float)(negative ? -value : value);
+		return true;
+	}
+
+	// Reads a (possibly signed) decimal integer.  One too large for an
+	// int is still read to its end, but fails with "result" untouched.
+	bool ScanInt(const char*& p, const char* end, int& result)
+	{
+		const char* start = p;
+
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = *p == '-';
+			p++;
+		}
+
+		if (p >= end || !IsDigit(*p))
+		{
+			p = start;
+			return false;
+		}
+
+		int value = 0;
+		bool overflow = false;
+		while (p < end && IsDigit(*p))
+		{
+			int digit = *p - '0';
+			if (value > (INT_MAX - digit) / 10)
+				overflow = true;
+			else
+				value = value * 10 + digit;
+			p++;
+		}
+
+		if (overflow)
+			return false;
+
+		result = negative ? -value : value;
+		return true;
+	}
+
+	// One corner of a face: 1-based indices, negative ones counting back
+	// from the latest element read, or 0 if not present
+	struct ObjCorner
+	{
+		int Position;
+		int UV;
+		int Normal;
+	};
+
+	// Reads "v", "v/vt", "v//vn" or "v/vt/vn".  A corner with an index
+	// too large for an int still counts, but with position 0, so its
+	// face is dropped like any other that refers to missing data.
+	bool ScanCorner(const char*& p, const char* end, ObjCorner& corner)
+	{
+		corner = {};
+		const char* start = p;
+		bool valid = ScanInt(p, end, corner.Position);
+		if (p == start)
+			return false;
+
+		// Past the slashes, only a number that fails to fit is an error
+		if (p < end && *p == '/')
+		{
+			p++;
+			const char* uv = p;
+			valid &= ScanInt(p, end, corner.UV) || p == uv;
+
+			if (p < end && *p == '/')
+			{
+				p++;
+				const char* normal = p;
+				valid &= ScanInt(p, end, corner.Normal) || p == normal;
+			}
+		}
+
+		if (!valid)
+			corner.Position = 0;
+		return true;
+	}
+
+	// Reads the rest of the line as a name, minus the surrounding blanks
+	void ScanName(const char*& p, const char* end, const char*& name, size_t& length)
+	{
+		SkipBlanks(p, end);
+		name = p;
+		while (p < end && *p != '\n')
+			p++;
+
+		const char* nameEnd = p;
+		while (nameEnd > name && (IsBlank(nameEnd[-1]) || nameEnd[-1] == '\r'))
+			nameEnd--;
+		length = nameEnd - name;
+	}
+
+	// Reads up to "count" blank-separated floats, leaving the rest untouched
+	void ScanFloats(const char*& p, const char* end, float* values, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			SkipBlanks(p, end);
+			if (!ScanFloat(p, end, values[i]))
+				return;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Polygon triangulation
+//
+// - Convex faces (nearly all of them) become a fan from
+//   the first corner; concave ones are ear clipped
+// - Scratch arrays are owned by the caller and reused, so
+//   faces never allocate once they've grown large enough
+// --------------------------------------------------------
+namespace
+{
+	struct PolygonScratch
+	{
+		std::vector<Vertex> Corners;
+		std::vector<XMFLOAT2> Projected;
+		std::vector<unsigned int> Remaining;
+		std::vector<unsigned int> Triangles;
+	};
+
+	// Twice the signed area of the 2D triangle a, b, c (positive if counter-clockwise)
+	inline float Cross2D(const XMFLOAT2& a, const XMFLOAT2& b, const XMFLOAT2& c)
+	{
+		return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	}
+
+	// Flattens the polygon onto the plane its Newell normal is most aligned
+	// with, mirrored as needed so the polygon winds counter-clockwise
+	void ProjectPolygon(const Vertex* corners, unsigned int count, std::vector<XMFLOAT2>& projected)
+	{
+		XMFLOAT3 normal(0, 0, 0);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const XMFLOAT3& a = corners[i].Position;
+			const XMFLOAT3& b = corners[(i + 1) % count].Position;
+			normal.x += (a.y - b.y) * (a.z + b.z);
+			normal.y += (a.z - b.z) * (a.x + b.x);
+			normal.z += (a.x - b.x) * (a.y + b.y);
+		}
+
+		// Drop the dominant axis, keeping the other two right-handed
+		float ax = fabsf(normal.x), ay = fabsf(normal.y), az = fabsf(normal.z);
+		int u = 0, v = 1;
+		float sign = normal.z;
+		if (ax > ay && ax > az) { u = 1; v = 2; sign = normal.x; }
+		else if (ay > az) { u = 2; v = 0; sign = normal.y; }
+		if (sign < 0.0f)
+		{
+			int swap = u; u = v; v = swap;
+		}
+
+		projected.resize(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const float* p = &corners[i].Position.x;
+			projected[i] = XMFLOAT2(p[u], p[v]);
+		}
+	}
+
+	// Whether the corner at "remaining[current]" can be cut off without the
+	// new edge crossing the rest of the polygon
+	bool IsEar(const std::vector<XMFLOAT2>& points, const std::vector<unsigned int>& remaining, size_t previous, size_t current, size_t next)
+	{
+		const XMFLOAT2& a = points[remaining[previous]];
+		const XMFLOAT2& b = points[remaining[current]];
+		const XMFLOAT2& c = points[remaining[next]];
+		if (Cross2D(a, b, c) <= 0.0f)
+			return false;
+
+		for (size_t i = 0; i < remaining.size(); i++)
+		{
+			if (i == previous || i == current || i == next)
+				continue;
+
+			// Corners repeated at the same spot (bridged holes) don't block
+			const XMFLOAT2& p = points[remaining[i]];
+			if ((p.x == a.x && p.y == a.y) || (p.x == b.x && p.y == b.y) || (p.x == c.x && p.y == c.y))
+				continue;
+
+			if (Cross2D(a, b, p) >= 0.0f && Cross2D(b, c, p) >= 0.0f && Cross2D(c, a, p) >= 0.0f)
+				return false;
+		}
+		return true;
+	}
+
+	// Whether the triangles a, b, c and a, c, d face the same way, so the
+	// quad a, b, c, d can be split along a-c
+	bool IsQuadDiagonalInside(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c, const XMFLOAT3& d)
+	{
+		float ex = c.x - a.x, ey = c.y - a.y, ez = c.z - a.z;
+		float bx = b.x - a.x, by = b.y - a.y, bz = b.z - a.z;
+		float dx = d.x - a.x, dy = d.y - a.y, dz = d.z - a.z;
+
+		// (b - a) x diagonal, and diagonal x (d - a)
+		float n1x = by * ez - bz * ey, n1y = bz * ex - bx * ez, n1z = bx * ey - by * ex;
+		float n2x = ey * dz - ez * dy, n2y = ez * dx - ex * dz, n2z = ex * dy - ey * dx;
+		return n1x * n2x + n1y * n2y + n1z * n2z >= 0.0f;
+	}
+
+	// Fills scratch.Triangles with corner numbers, three per triangle, in
+	// the polygon's own winding
+	void TriangulatePolygon(unsigned int count, PolygonScratch& scratch)
+	{
+		std::vector<unsigned int>& triangles = scratch.Triangles;
+		triangles.clear();
+
+		// Convex polygons are a plain fan
+		ProjectPolygon(scratch.Corners.data(), count, scratch.Projected);
+
+		bool convex = true;
+		for (unsigned int i = 0; i < count && convex; i++)
+		{
+			convex = Cross2D(
+				scratch.Projected[(i + count - 1) % count],
+				scratch.Projected[i],
+				scratch.Projected[(i + 1) % count]) >= 0.0f;
+		}
+
+		if (convex)
+		{
+			for (unsigned int i = 1; i + 1 < count; i++)
+			{
+				triangles.push_back(0);
+				triangles.push_back(i);
+				triangles.push_back(i + 1);
+			}
+			return;
+		}
+
+		// Clip ears until a triangle is left.  Starting at the second
+		// corner, and moving on to the next one after each cut, keeps the
+		// result close to a fan where the polygon allows it.
+		std::vector<unsigned int>& remaining = scratch.Remaining;
+		remaining.resize(count);
+		for (unsigned int i = 0; i < count; i++)
+			remaining[i] = i;
+
+		size_t cursor = 1;
+		while (remaining.size() > 3)
+		{
+			size_t size = remaining.size();
+			size_t current = cursor % size;
+			size_t attempts = 0;
+			while (attempts < size && !IsEar(scratch.Projected, remaining, (current + size - 1) % size, current, (current + 1) % size))
+			{
+				current = (current + 1) % size;
+				attempts++;
+			}
+
+			// A self-intersecting face may have no ear at all; cut
+			// something anyway so the loop always finishes
+			if (attempts == size)
+				current = cursor % size;
+
+			triangles.push_back(remaining[(current + size - 1) % size]);
+			triangles.push_back(remaining[current]);
+			triangles.push_back(remaining[(current + 1) % size]);
+			remaining.erase(remaining.begin() + current);
+			cursor = current;
+		}
+
+		triangles.push_back(remaining[0]);
+		triangles.push_back(remaining[1]);
+		triangles.push_back(remaining[2]);
+	}
+}
+
+// --------------------------------------------------------
+// Chunked parsing helpers
+//
+// - The file is cut into line-aligned chunks which are
+//   tokenized independently, then merged in file order
+// --------------------------------------------------------
+namespace
+{
+	// An "o", "g" or "usemtl" record, and where it fell among the faces
+	struct ObjGroupRecord
+	{
+		size_t Face;			// How many of the chunk's faces came before it
+		size_t VertexOffset;	// How many triangle vertices those made (set by EmitChunk)
+		bool Material;			// "usemtl" rather than a name
+		const char* Name;		// Points into the OBJ text
+		size_t NameLength;
+	};
+
+	// A face with relative (negative) indices, and how many of each
+	// attribute the chunk had read when it got to it
+	struct ObjRelativeFace
+	{
+		size_t Face;
+		size_t PositionCount;
+		size_t UVCount;
+		size_t NormalCount;
+	};
+
+	// Everything read from one line-aligned slice of the file
+	struct ObjChunk
+	{
+		const char* Begin;
+		const char* End;
+
+		std::vector<XMFLOAT3> Positions;
+		std::vector<XMFLOAT3> Normals;
+		std::vector<XMFLOAT2> UVs;
+		std::vector<ObjCorner> Corners;		// Corners of every face, back to back
+		std::vector<unsigned int> FaceSizes;	// Corner count of each face
+		std::vector<ObjGroupRecord> Groups;
+		std::vector<ObjRelativeFace> RelativeFaces;
+
+		// How many of each attribute the chunks before this one read
+		size_t PositionBase = 0;
+		size_t UVBase = 0;
+		size_t NormalBase = 0;
+
+		std::vector<Vertex> Vertices;		// Assembled triangles (after the merge)
+	};
+
+	// Splits the text into roughly equal pieces that start at line boundaries
+	void SplitIntoChunks(const char* data, size_t size, unsigned int chunkCount, std::vector<ObjChunk>& chunks)
+	{
+		const char* end = data + size;
+		const char* begin = data;
+
+		for (unsigned int i = 0; i < chunkCount && begin < end; i++)
+		{
+			const char* chunkEnd = end;
+			if (i + 1 < chunkCount)
+			{
+				chunkEnd = data + size / chunkCount * (i + 1);
+				if (chunkEnd <= begin)
+					continue;
+				SkipLine(chunkEnd, end); // Finish the line we landed in
+			}
+
+			ObjChunk chunk;
+			chunk.Begin = begin;
+			chunk.End = chunkEnd;
+			chunks.push_back(std::move(chunk));
+			begin = chunkEnd;
+		}
+	}
+
+	// First pass: tokenize the chunk's records without resolving anything,
+	// since faces may refer to data that lives in earlier chunks
+	void ParseChunk(ObjChunk& chunk)
+	{
+		const char* p = chunk.Begin;
+		const char* end = chunk.End;
+
+		while (p < end)
+		{
+			SkipBlanks(p, end);
+			if (p >= end)
+				break;
+
+			const char* next = p + 1;
+			bool hasSecond = next < end;
+
+			if (p[0] == 'v' && hasSecond && IsBlank(*next))
+			{
+				p = next;
+				XMFLOAT3 pos(0, 0, 0);
+				ScanFloats(p, end, &pos.x, 3);
+				chunk.Positions.push_back(pos);
+			}
+			else if (p[0] == 'v' && hasSecond && *next == 'n')
+			{
+				p = next + 1;
+				XMFLOAT3 norm(0, 0, 0);
+				ScanFloats(p, end, &norm.x, 3);
+				chunk.Normals.push_back(norm);
+			}
+			else if (p[0] == 'v' && hasSecond && *next == 't')
+			{
+				p = next + 1;
+				XMFLOAT2 uv(0, 0);
+				ScanFloats(p, end, &uv.x, 2);
+				chunk.UVs.push_back(uv);
+			}
+			else if (p[0] == 'f' && hasSecond && IsBlank(*next))
+			{
+				p = next;
+
+				// Read every corner, however many the polygon has
+				unsigned int cornerCount = 0;
+				bool relative = false;
+				ObjCorner corner;
+				for (;;)
+				{
+					SkipBlanks(p, end);
+					if (!ScanCorner(p, end, corner))
+						break;
+					chunk.Corners.push_back(corner);
+					cornerCount++;
+					relative |= corner.Position < 0 || corner.UV < 0 || corner.Normal < 0;
+				}
+
+				// Negative indices count back from what has been read so
+				// far, which is only known in full once the chunks before
+				// this one are done
+				if (relative)
+					chunk.RelativeFaces.push_back({ chunk.FaceSizes.size(), chunk.Positions.size(), chunk.UVs.size(), chunk.Normals.size() });
+				chunk.FaceSizes.push_back(cornerCount);
+			}
+			else if ((p[0] == 'o' || p[0] == 'g') && hasSecond && IsBlank(*next))
+			{
+				p = next;
+				ObjGroupRecord record = { chunk.FaceSizes.size(), 0, false };
+				ScanName(p, end, record.Name, record.NameLength);
+				chunk.Groups.push_back(record);
+			}
+			else if (end - p > 6 && memcmp(p, "usemtl", 6) == 0 && IsBlank(p[6]))
+			{
+				p += 6;
+				ObjGroupRecord record = { chunk.FaceSizes.size(), 0, true };
+				ScanName(p, end, record.Name, record.NameLength);
+				chunk.Groups.push_back(record);
+			}
+
+			SkipLine(p, end);
+		}
+	}
+
+	// Second pass: assemble the chunk's faces into triangles using
+	// the merged attribute arrays from the whole file
+	void EmitChunk(ObjChunk& chunk,
+		const std::vector<XMFLOAT3>& positions,
+		const std::vector<XMFLOAT3>& normals,
+		const std::vector<XMFLOAT2>& uvs)
+	{
+		// Faces without UVs share a single UV coordinate
+		const XMFLOAT2 sharedUV = uvs.size() > 0 ? uvs[0] : XMFLOAT2(0, 0);
+
+		// Turns a face corner into a final vertex, or returns false
+		// if the corner refers to data that doesn't exist
+		auto makeVertex = [&](const ObjCorner& corner, Vertex& v)
+		{
+			if (corner.Position < 1 || corner.Position > (int)positions.size() ||
+				corner.UV < 0 || corner.UV > (int)uvs.size() ||
+				corner.Normal < 0 || corner.Normal > (int)normals.size())
+				return false;
+
+			v = {};
+			v.Position = positions[corner.Position - 1];
+			v.UV = corner.UV > 0 ? uvs[corner.UV - 1] : sharedUV;
+			if (corner.Normal > 0)
+				v.Normal = normals[corner.Normal - 1];
+
+			// The model is most likely in a right-handed space, so
+			// invert Z (position and normal) for DirectX's left-handed
+			// space, and flip the V coordinate since DirectX puts (0,0)
+			// at the top left of a texture
+			v.UV.y = 1.0f - v.UV.y;
+			v.Position.z *= -1.0f;
+			v.Normal.z *= -1.0f;
+			return true;
+		};
+
+		// Turns a relative index into an absolute one (or -1 if it
+		// reaches back past the start of the file)
+		auto resolve = [](int& index, size_t readSoFar)
+		{
+			if (index < 0)
+			{
+				index += (int)readSoFar + 1;
+				if (index < 1)
+					index = -1;
+			}
+		};
+
+		chunk.Vertices.reserve(chunk.Corners.size() * 3 / 2);
+
+		PolygonScratch scratch;
+		ObjCorner* corners = chunk.Corners.data();
+		size_t group = 0;
+		size_t relative = 0;
+		for (size_t face = 0; face < chunk.FaceSizes.size(); face++)
+		{
+			// Note where the records before this face fall in the output
+			for (; group < chunk.Groups.size() && chunk.Groups[group].Face <= face; group++)
+				chunk.Groups[group].VertexOffset = chunk.Vertices.size();
+
+			unsigned int cornerCount = chunk.FaceSizes[face];
+			if (relative < chunk.RelativeFaces.size() && chunk.RelativeFaces[relative].Face == face)
+			{
+				const ObjRelativeFace& counts = chunk.RelativeFaces[relative++];
+				for (unsigned int i = 0; i < cornerCount; i++)
+				{
+					resolve(corners[i].Position, chunk.PositionBase + counts.PositionCount);
+					resolve(corners[i].UV, chunk.UVBase + counts.UVCount);
+					resolve(corners[i].Normal, chunk.NormalBase + counts.NormalCount);
+				}
+			}
+
+			// Triangles and quads, by far the most common, skip the scratch arrays
+			Vertex v[4];
+			Vertex* polygon = v;
+			if (cornerCount > 4)
+			{
+				scratch.Corners.resize(cornerCount);
+				polygon = scratch.Corners.data();
+			}
+
+			bool valid = cornerCount >= 3;
+			for (unsigned int i = 0; valid && i < cornerCount; i++)
+				valid = makeVertex(corners[i], polygon[i]);
+			corners += cornerCount;
+
+			if (!valid)
+				continue;
+
+			// Add the triangle(s), flipping the winding order
+			if (cornerCount <= 4)
+			{
+				// A quad is cut along whichever diagonal keeps both halves
+				// facing the same way, which is 0-2 unless the quad is
+				// concave at corner 1 or 3
+				int first = 0;
+				if (cornerCount == 4 && !IsQuadDiagonalInside(v[0].Position, v[1].Position, v[2].Position, v[3].Position))
+					first = 1;
+
+				const Vertex& a = v[first];
+				const Vertex& b = v[first + 1];
+				const Vertex& c = v[first + 2];
+				chunk.Vertices.push_back(a);
+				chunk.Vertices.push_back(c);
+				chunk.Vertices.push_back(b);
+				if (cornerCount == 4)
+				{
+					const Vertex& d = v[(first + 3) % 4];
+					chunk.Vertices.push_back(a);
+					chunk.Vertices.push_back(d);
+					chunk.Vertices.push_back(c);
+				}
+				continue;
+			}
+
+			TriangulatePolygon(cornerCount, scratch);
+			const std::vector<unsigned int>& triangles = scratch.Triangles;
+			for (size_t i = 0; i < triangles.size(); i += 3)
+			{
+				chunk.Vertices.push_back(scratch.Corners[triangles[i]]);
+				chunk.Vertices.push_back(scratch.Corners[triangles[i + 2]]);
+				chunk.Vertices.push_back(scratch.Corners[triangles[i + 1]]);
+			}
+		}
+
+		for (; group < chunk.Groups.size(); group++)
+			chunk.Groups[group].VertexOffset = chunk.Vertices.size();
+	}
+
+	// Turns the chunks' group records into ranges of the final index
+	// list.  Runs without any faces are dropped, and neighbouring runs
+	// with the same name and material become one.
+	void BuildSubmeshes(const std::vector<ObjChunk>& chunks, size_t indexCount, std::vector<ObjSubmesh>& submeshes)
+	{
+		std::string name;
+		std::string material;
+		size_t start = 0;
+
+		auto finishRun = [&](size_t runEnd)
+		{
+			if (runEnd <= start)
+				return;
+
+			if (!submeshes.empty() && submeshes.back().Name == name && submeshes.back().Material == material)
+				submeshes.back().IndexCount += (unsigned int)(runEnd - start);
+			else
+				submeshes.push_back({ name, material, (unsigned int)start, (unsigned int)(runEnd - start) });
+			start = runEnd;
+		};
+
+		// Every triangle vertex is its own index at this point
+		size_t chunkOffset = 0;
+		for (const ObjChunk& chunk : chunks)
+		{
+			for (const ObjGroupRecord& record : chunk.Groups)
+			{
+				finishRun(chunkOffset + record.VertexOffset);
+				(record.Material ? material : name).assign(record.Name, record.NameLength);
+			}
+			chunkOffset += chunk.Vertices.size();
+		}
+		finishRun(indexCount);
+	}
+
+	// Appends every chunk's array (selected by "member") into one
+	// vector, each at its prefix-sum offset
+	template<typename T>
+	void MergeChunks(std::vector<ObjChunk>& chunks, std::vector<T> ObjChunk::* member, std::vector<T>& merged)
+	{
+		std::vector<size_t> offsets(chunks.size() + 1, 0);
+		for (size_t i = 0; i < chunks.size(); i++)
+			offsets[i + 1] = offsets[i] + (chunks[i].*member).size();
+
+		merged.resize(offsets.back());
+		WorkerPool::GetInstance().ParallelFor((unsigned int)chunks.size(), [&](unsigned int i)
+		{
+			const std::vector<T>& source = chunks[i].*member;
+			if (!source.empty())
+				memcpy(&merged[offsets[i]], source.data(), source.size() * sizeof(T));
+		});
+	}
+}
+
+// --------------------------------------------------------
+// Basic .OBJ parsing, supporting positions, uvs and normals
+//
+// - Conventions (and the handedness/UV conversion) follow the
+//   original getline/sscanf_s loader by Chris Cascioli, but the
+//   text is tokenized in place instead of line by line
+// - Faces can be any polygon, with corners given as "v",
+//   "v/vt", "v//vn" or "v/vt/vn"; concave ones are ear clipped
+// - Negative (relative) indices count back from the last
+//   position, UV or normal read before the face
+// - "o", "g" and "usemtl" records split the faces into
+//   submeshes, which all share the one vertex/index list
+// - The text is split on line boundaries and each piece is
+//   parsed on the WorkerPool; pieces are then stitched back
+//   together by prefix sums, so the output is identical no
+//   matter how many chunks were used
+//
+// data - Pointer to the first byte of the OBJ text
+// size - Number of bytes of text
+// meshData - Receives the assembled vertices and indices
+// chunkCount - How many pieces to split the work into
+//              (0 picks automatically, 1 parses serially)
+//
+// Returns true if any geometry was produced
+// --------------------------------------------------------
+bool ParseObj(const char* data, size_t size, ObjMeshData& meshData, unsigned int chunkCount)
+{
+	meshData.Vertices.clear();
+	meshData.Indices.clear();
+	meshData.Submeshes.clear();
+
+	WorkerPool& pool = WorkerPool::GetInstance();
+	if (chunkCount == 0)
+	{
+		// A few chunks per thread for balance, but not so small that
+		// the bookkeeping costs more than the parsing
+		const size_t minimumChunkSize = 256 * 1024;
+		size_t bySize = size / minimumChunkSize + 1;
+		size_t byThreads = (size_t)pool.GetThreadCount() * 4;
+		chunkCount = (unsigned int)(bySize < byThreads ? bySize : byThreads);
+	}
+
+	std::vector<ObjChunk> chunks;
+	SplitIntoChunks(data, size, chunkCount, chunks);
+	unsigned int count = (unsigned int)chunks.size();
+
+	// Tokenize every chunk independently
+	pool.ParallelFor(count, [&](unsigned int i) { ParseChunk(chunks[i]); });
+
+	// Merge the attribute arrays in file order
+	std::vector<XMFLOAT3> positions;	// Positions from the file
+	std::vector<XMFLOAT3> normals;		// Normals from the file
+	std::vector<XMFLOAT2> uvs;			// UVs from the file
+	MergeChunks(chunks, &ObjChunk::Positions, positions);
+	MergeChunks(chunks, &ObjChunk::Normals, normals);
+	MergeChunks(chunks, &ObjChunk::UVs, uvs);
+
+	// Where each chunk's attributes start, for resolving relative indices
+	for (unsigned int i = 1; i < count; i++)
+	{
+		chunks[i].PositionBase = chunks[i - 1].PositionBase + chunks[i - 1].Positions.size();
+		chunks[i].UVBase = chunks[i - 1].UVBase + chunks[i - 1].UVs.size();
+		chunks[i].NormalBase = chunks[i - 1].NormalBase + chunks[i - 1].Normals.size();
+	}
+
+	// Assemble triangles, then merge those in file order too
+	pool.ParallelFor(count, [&](unsigned int i) { EmitChunk(chunks[i], positions, normals, uvs); });
+	MergeChunks(chunks, &ObjChunk::Vertices, meshData.Vertices);
+
+	// OBJs don't index whole vertices, so every vertex is used once, in order
+	meshData.Indices.resize(meshData.Vertices.size());
+	for (size_t i = 0; i < meshData.Indices.size(); i++)
+		meshData.Indices[i] = (unsigned int)i;
+
+	BuildSubmeshes(chunks, meshData.Indices.size(), meshData.Submeshes);
+
+	return meshData.Vertices.size() > 0;
+}
+
+// --------------------------------------------------------
+// Maps the given file into memory and parses it in place
+//
+// Returns false if the file can't be opened or has no geometry
+// --------------------------------------------------------
+bool LoadObj(const std::wstring& fileName, ObjMeshData& meshData)
+{
+	MappedFile file(fileName);
+	if (!file.IsOpen())
+		return false;
+
+	return ParseObj(file.GetData(), file.GetSize(), meshData);
+}
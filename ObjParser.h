@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Vertex.h"
+#include <vector>
+#include <string>
+#include <cstddef>
+
+// A run of faces that share an object/group name and a
+// material, as a range of ObjMeshData::Indices
+struct ObjSubmesh
+{
+	std::string Name;		// From the last "o" or "g" record before the faces
+	std::string Material;	// From the last "usemtl" record before the faces
+	unsigned int StartIndex;
+	unsigned int IndexCount;
+};
+
+// --------------------------------------------------------
+// Geometry assembled from an .OBJ file, already converted
+// to a left-handed, top-left-UV space and ready for the
+// rest of the Mesh pipeline
+// --------------------------------------------------------
+struct ObjMeshData
+{
+	std::vector<Vertex> Vertices;
+	std::vector<unsigned int> Indices;
+	std::vector<ObjSubmesh> Submeshes;	// In file order, covering every index
+};
+
+// Parses OBJ text held in memory (does not need to be null terminated)
+// - chunkCount: 0 splits the work across the WorkerPool, 1 parses serially
+bool ParseObj(const char* data, size_t size, ObjMeshData& meshData, unsigned int chunkCount = 0);
+
+// Memory-maps the file and parses it in place
+bool LoadObj(const std::wstring& fileName, ObjMeshData& meshData);
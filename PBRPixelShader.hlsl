@@ -8,16 +8,14 @@ Texture2D ShadowMap			: register(t4);
 SamplerState BasicSampler	: register(s0);
 SamplerComparisonState ShadowSampler : register(s1);
 
-cbuffer ExternalData : register(b0)
+// Set by the Material; cameraPosition and lights are in PerFrame
+cbuffer PerMaterial : register(b5)
 {
 	float4 colorTint;
 	// float roughness;
-	float3 cameraPosition;
 	int gammaCorrection;
 	int usingAlbedo;
 	int usingMetal;
-
-	Light lights[5]; // 3 directional, 2 point IN THAT ORDER; MUST BE EXACT
 }
 
 float4 main(VertexToPixel input) : SV_TARGET
@@ -41,7 +39,7 @@ float4 main(VertexToPixel input) : SV_TARGET
 	float shadowAmount = ShadowMap.SampleCmpLevelZero(ShadowSampler, shadowUV, distToLight).r;
 
 	input.normal = normalize(input.normal);
-	input.tangent = normalize(input.tangent);
+	input.tangent.xyz = normalize(input.tangent.xyz);
 
 	// Specular Reflections (Task 7)
 	float3 viewVector = normalize(cameraPosition - input.worldPosition); // V
@@ -5,11 +5,11 @@ Texture2D SpecularMap		: register(t1);
 Texture2D NormalMap			: register(t2);
 SamplerState BasicSampler	: register(s0);
 
-cbuffer ExternalData : register(b0)
+// Set by the Material; cameraPosition and lights are in PerFrame
+cbuffer PerMaterial : register(b5)
 {
 	float4 colorTint;
 	float roughness;
-	float3 cameraPosition;
 	float3 ambient;
 	// Light directionalLight1;
 	// Light directionalLight2;
@@ -17,8 +17,6 @@ cbuffer ExternalData : register(b0)
 	// Light pointLight1;
 	// Light pointLight2;
 	int usingSpecularMap;
-
-	Light lights[5]; // 3 directional, 2 point IN THAT ORDER; MUST BE EXACT
 }
 
 /*
@@ -0,0 +1,106 @@
+#include "RangeAllocator.h"
+
+#include <iterator>
+
+RangeAllocator::RangeAllocator(unsigned int capacity)
+	: capacity(capacity)
+{
+	if (capacity > 0)
+		AddFreeRange(0, capacity);
+}
+
+// --------------------------------------------------------
+// Takes the smallest free range that fits (the lowest one
+// among equals) and keeps whatever is left of it free
+// --------------------------------------------------------
+bool RangeAllocator::Allocate(unsigned int size, unsigned int& offset)
+{
+	if (size == 0)
+	{
+		offset = 0;
+		return true;
+	}
+
+	auto fit = freeBySize.lower_bound(std::make_pair(size, 0u));
+	if (fit == freeBySize.end())
+		return false;
+
+	unsigned int rangeOffset = fit->second;
+	unsigned int rangeSize = fit->first;
+	RemoveFreeRange(freeByOffset.find(rangeOffset));
+	if (rangeSize > size)
+		AddFreeRange(rangeOffset + size, rangeSize - size);
+
+	used += size;
+	offset = rangeOffset;
+	return true;
+}
+
+// --------------------------------------------------------
+// Merges the range with the free ranges on either side of
+// it, if there are any
+// --------------------------------------------------------
+void RangeAllocator::Free(unsigned int offset, unsigned int size)
+{
+	if (size == 0)
+		return;
+
+	used -= size;
+
+	auto next = freeByOffset.lower_bound(offset);
+	if (next != freeByOffset.end() && offset + size == next->first)
+	{
+		size += next->second;
+		RemoveFreeRange(next);
+		next = freeByOffset.lower_bound(offset);
+	}
+
+	if (next != freeByOffset.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			RemoveFreeRange(previous);
+		}
+	}
+
+	AddFreeRange(offset, size);
+}
+
+void RangeAllocator::Grow(unsigned int newCapacity)
+{
+	if (newCapacity <= capacity)
+		return;
+
+	// Hand the new space back as if it had been allocated all along,
+	// so it joins a free range at the old end
+	unsigned int oldCapacity = capacity;
+	capacity = newCapacity;
+	used += newCapacity - oldCapacity;
+	Free(oldCapacity, newCapacity - oldCapacity);
+}
+
+unsigned int RangeAllocator::GetLargestFreeRange() const
+{
+	return freeBySize.empty() ? 0 : freeBySize.rbegin()->first;
+}
+
+float RangeAllocator::GetFragmentation() const
+{
+	unsigned int freeSpace = capacity - used;
+	return freeSpace > 0 ? 1.0f - (float)GetLargestFreeRange() / freeSpace : 0.0f;
+}
+
+void RangeAllocator::AddFreeRange(unsigned int offset, unsigned int size)
+{
+	freeByOffset[offset] = size;
+	freeBySize.insert(std::make_pair(size, offset));
+}
+
+void RangeAllocator::RemoveFreeRange(std::map<unsigned int, unsigned int>::iterator range)
+{
+	freeBySize.erase(std::make_pair(range->second, range->first));
+	freeByOffset.erase(range);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <utility>
+
+// --------------------------------------------------------
+// Hands out ranges of a linear space (the elements of a
+// GPU buffer, for the GeometryPool) and takes them back.
+//
+// - Best fit, so large free ranges stay whole as long as
+//   smaller ones can serve a request
+// - Freed ranges merge with free neighbours right away,
+//   so there are never two free ranges side by side
+// - Pure bookkeeping with no Direct3D, so it can be run
+//   and tested anywhere
+// --------------------------------------------------------
+class RangeAllocator
+{
+public:
+	explicit RangeAllocator(unsigned int capacity = 0);
+
+	// Finds room for "size" elements.  Returns false (leaving offset
+	// alone) if no free range is big enough.
+	bool Allocate(unsigned int size, unsigned int& offset);
+
+	// Returns a range that Allocate() handed out
+	void Free(unsigned int offset, unsigned int size);
+
+	// Adds free space at the end; the capacity never shrinks
+	void Grow(unsigned int newCapacity);
+
+	unsigned int GetCapacity() const { return capacity; }
+	unsigned int GetUsed() const { return used; }
+	unsigned int GetFreeRangeCount() const { return (unsigned int)freeByOffset.size(); }
+	unsigned int GetLargestFreeRange() const;
+
+	// Share of the free space outside the largest free range: 0 when it
+	// is all in one piece, approaching 1 as it scatters into slivers
+	float GetFragmentation() const;
+
+private:
+	unsigned int capacity;
+	unsigned int used = 0;
+
+	// Every free range, by offset (to find neighbours) and by size then
+	// offset (to find the best fit)
+	std::map<unsigned int, unsigned int> freeByOffset;
+	std::set<std::pair<unsigned int, unsigned int>> freeBySize;
+
+	void AddFreeRange(unsigned int offset, unsigned int size);
+	void RemoveFreeRange(std::map<unsigned int, unsigned int>::iterator range);
+};
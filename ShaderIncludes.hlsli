@@ -23,9 +23,105 @@ struct VertexShaderInput
 	// float4 color			: COLOR;        // RGBA color
 	float3 normal			: NORMAL;
 	float2 uv				: TEXCOORD;
-	float3 tangent			: TANGENT;
+	float4 tangent			: TANGENT;		// w: handedness, see NormalMapping()
 };
 
+// Compact vertices (CompactVertex in Vertex.h) arrive as raw uints,
+// two 16-bit values per uint, and are decoded by UnpackVertex()
+struct CompactVertexShaderInput
+{
+	uint2 packedPosition	: POSITION;		// snorm16 xyz relative to mesh bounds, w = tangent handedness
+	uint packedNormal		: NORMAL;		// octahedral snorm16 xy
+	uint packedUV			: TEXCOORD;		// unorm16 uv, relative to mesh UV range
+	uint packedTangent		: TANGENT;		// octahedral snorm16 xy
+};
+
+// Just the positions, for depth-only passes drawn with Mesh::DrawPositionOnly().
+// The input layout built from these reads nothing else, whether the mesh
+// binds its packed position stream or its full vertices.
+struct PositionVertexShaderInput
+{
+	float3 localPosition	: POSITION;
+};
+
+struct CompactPositionVertexShaderInput
+{
+	uint2 packedPosition	: POSITION;
+};
+
+// Low 16 bits to x, high 16 bits to y
+float2 UnpackSnorm16x2(uint packed)
+{
+	int2 values = int2((int)(packed << 16), (int)packed) >> 16;
+	return max(float2(values) / 32767.0f, -1.0f);
+}
+
+float2 UnpackUnorm16x2(uint packed)
+{
+	return float2(packed & 0xFFFF, packed >> 16) / 65535.0f;
+}
+
+// Inverse of the octahedral mapping in VertexQuantization.cpp
+float3 DecodeOctahedral(float2 encoded)
+{
+	float3 direction = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float fold = saturate(-direction.z);
+	direction.xy += (direction.xy >= 0.0f) ? -fold : fold;
+	return normalize(direction);
+}
+
+// Vertex shaders take a MeshVertexInput and run it through UnpackVertex()
+// (or a MeshPositionInput, through UnpackPosition()); defining
+// COMPACT_VERTEX_INPUT before including this file switches them over to
+// the compact layout (see the *Compact.hlsl shaders)
+#ifdef COMPACT_VERTEX_INPUT
+
+// Set per mesh by Mesh::PrepareVertexShader()
+cbuffer MeshQuantization : register(b1)
+{
+	float3 quantizedPositionOffset;
+	float3 quantizedPositionScale;
+	float2 quantizedUVOffset;
+	float2 quantizedUVScale;
+}
+
+typedef CompactVertexShaderInput MeshVertexInput;
+
+VertexShaderInput UnpackVertex(CompactVertexShaderInput input)
+{
+	VertexShaderInput output;
+	output.localPosition = quantizedPositionOffset + quantizedPositionScale * float3(UnpackSnorm16x2(input.packedPosition.x), UnpackSnorm16x2(input.packedPosition.y).x);
+	output.normal = DecodeOctahedral(UnpackSnorm16x2(input.packedNormal));
+	output.uv = quantizedUVOffset + quantizedUVScale * UnpackUnorm16x2(input.packedUV);
+	output.tangent = float4(DecodeOctahedral(UnpackSnorm16x2(input.packedTangent)), UnpackSnorm16x2(input.packedPosition.y).y < 0.0f ? -1.0f : 1.0f);
+	return output;
+}
+
+typedef CompactPositionVertexShaderInput MeshPositionInput;
+
+float3 UnpackPosition(CompactPositionVertexShaderInput input)
+{
+	return quantizedPositionOffset + quantizedPositionScale * float3(UnpackSnorm16x2(input.packedPosition.x), UnpackSnorm16x2(input.packedPosition.y).x);
+}
+
+#else
+
+typedef VertexShaderInput MeshVertexInput;
+
+VertexShaderInput UnpackVertex(VertexShaderInput input)
+{
+	return input;
+}
+
+typedef PositionVertexShaderInput MeshPositionInput;
+
+float3 UnpackPosition(PositionVertexShaderInput input)
+{
+	return input.localPosition;
+}
+
+#endif
+
 // ALL of your code pieces (structs, functions, etc.) go here!
 // Struct representing the data we're sending down the pipeline
 // - Should match our pixel shader's input (hence the name: Vertex to Pixel)
@@ -44,7 +140,7 @@ struct VertexToPixel
 	float2 uv				: TEXCOORD;
 	float3 normal			: NORMAL;
 	float3 worldPosition	: POSITION;
-	float3 tangent			: TANGENT;
+	float4 tangent			: TANGENT;
 	float4 shadowMapPos		: SHADOW_POSITION;
 };
 
@@ -67,6 +163,35 @@ struct Light
 	float3 Padding;		// purposefully padding to hit the 16-byte boundary
 };
 
+// Constant buffers shared by every shader, split by how often they change.
+// Their GPU copies belong to the C++ side (SimpleSharedBuffer), which
+// fills and binds each one once, however many draws read it.  b0 and b1
+// are left for each shader's own buffers, and b5 for each pixel shader's
+// PerMaterial buffer.
+
+// Set once a frame
+cbuffer PerFrame : register(b2)
+{
+	matrix lightView;
+	matrix lightProjection;
+	float3 cameraPosition;
+	Light lights[5]; // 3 directional, 2 point IN THAT ORDER; MUST BE EXACT
+}
+
+// Set once per pass (the shadow map, then the camera's view)
+cbuffer PerPass : register(b3)
+{
+	matrix view;
+	matrix projection;
+}
+
+// Set per entity, and only uploaded again when it moves
+cbuffer PerObject : register(b4)
+{
+	matrix world;
+	matrix worldInverseTranspose;
+}
+
 // make sure dirToLight is normalized
 // SHOULD BE INVERSE OF LIGHT DIRECTION
 float3 DiffuseBRDF(float3 normal, float3 dirToLight)
@@ -124,16 +249,18 @@ float3 PointLight(Light light, float3 normal, float3 worldPosition, float3 viewV
 }
 
 // normal and tangent get normalized when using this
-float3 NormalMapping(Texture2D normalMap, SamplerState basicSampler, float2 uv, float3 normal, float3 tangent)
+// tangent.w is the handedness from CalculateTangents(): -1 flips the
+// bitangent where the UVs are mirrored
+float3 NormalMapping(Texture2D normalMap, SamplerState basicSampler, float2 uv, float3 normal, float4 tangent)
 {
 	float3 unpackedNormal = normalMap.Sample(basicSampler, uv).rgb * 2.0f - 1.0f;
 	unpackedNormal = normalize(unpackedNormal);
 
 	// TBN Matrix
 	float3 N = normalize(normal);
-	float3 T = normalize(tangent);
+	float3 T = normalize(tangent.xyz);
 	T = normalize(T - N * dot(T, N));
-	float3 B = cross(T, N);
+	float3 B = cross(T, N) * (tangent.w < 0.0f ? -1.0f : 1.0f);
 	float3x3 TBN = float3x3(T, B, N);
 
 	return normalize(mul(unpackedNormal, TBN));
@@ -0,0 +1,475 @@
+#include "ShaderReflectionCache.h"
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cstdlib>
+#endif
+
+namespace
+{
+	const char ShaderReflectionMagic[4] = { 'S', 'R', 'E', 'F' };
+
+	uint64_t GetImageSize(const ShaderReflectionHeader& header)
+	{
+		return sizeof(ShaderReflectionHeader) +
+			sizeof(ShaderReflectionBuffer) * (uint64_t)header.BufferCount +
+			sizeof(SimpleShaderVariable) * (uint64_t)header.VariableCount +
+			sizeof(ShaderReflectionVariable) * (uint64_t)header.VariableCount +
+			sizeof(ShaderReflectionTexture) * (uint64_t)header.TextureCount +
+			sizeof(ShaderReflectionSampler) * (uint64_t)header.SamplerCount +
+			sizeof(ShaderReflectionUav) * (uint64_t)header.UavCount +
+			sizeof(ShaderReflectionParameter) * ((uint64_t)header.InputCount + header.OutputCount) +
+			header.NameBytes;
+	}
+
+	// Anything the loader couldn't create or bind (a size past what a
+	// constant buffer holds would also be a huge local data allocation)
+	bool IsBufferValid(const ShaderReflectionBuffer& buffer)
+	{
+		return buffer.Type <= D3D11_CT_TBUFFER &&
+			buffer.Size <= D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT * 16 &&
+			buffer.BindIndex < D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+	}
+
+	// A variable has to fit in its buffer, or setting it would write past
+	// the end of the local data
+	bool IsVariableValid(const SimpleShaderVariable& var, const ShaderReflectionBuffer* buffers, uint32_t bufferCount)
+	{
+		return var.ConstantBufferIndex < bufferCount &&
+			(uint64_t)var.ByteOffset + var.Size <= buffers[var.ConstantBufferIndex].Size;
+	}
+
+	// A signature entry has to make a format (or a stream out
+	// declaration) the loader knows, with a name
+	bool IsParameterValid(const ShaderReflectionParameter& parameter, uint32_t nameBytes)
+	{
+		return parameter.NameOffset < nameBytes &&
+			parameter.ComponentType <= D3D_REGISTER_COMPONENT_FLOAT32 &&
+			parameter.Mask <= 15 &&
+			parameter.PerInstance <= 1;
+	}
+
+	// Whether an input semantic ends in "_PER_INSTANCE", which
+	// SimpleVertexShader takes to mean it comes from slot 1, per instance
+	bool IsPerInstanceSemantic(const char* semantic)
+	{
+		const char suffix[] = "_PER_INSTANCE";
+		size_t length = strlen(semantic);
+		size_t suffixLength = sizeof(suffix) - 1;
+		return length >= suffixLength && strcmp(semantic + length - suffixLength, suffix) == 0;
+	}
+
+	// Appends a name (with its terminator), returning where it starts
+	uint32_t AddName(std::vector<char>& names, const char* name)
+	{
+		uint32_t offset = (uint32_t)names.size();
+		names.insert(names.end(), name, name + strlen(name) + 1);
+		return offset;
+	}
+
+	template<typename T>
+	void AppendRecords(std::vector<char>& image, const std::vector<T>& records)
+	{
+		const char* data = (const char*)records.data();
+		image.insert(image.end(), data, data + sizeof(T) * records.size());
+	}
+
+#ifndef _WIN32
+	// Paths are wide strings everywhere else in the engine
+	bool NarrowPath(const std::wstring& wide, std::string& narrow)
+	{
+		narrow.assign(wide.size() * 4 + 1, '\0');
+		size_t length = wcstombs(&narrow[0], wide.c_str(), narrow.size());
+		if (length == (size_t)-1)
+			return false;
+		narrow.resize(length);
+		return true;
+	}
+#endif
+
+	// --------------------------------------------------------
+	// Writes to a temporary file and then swaps it in, so a
+	// crash mid-write never leaves a truncated cache behind
+	// --------------------------------------------------------
+	bool WriteImage(const std::wstring& fileName, const std::vector<char>& image)
+	{
+		std::wstring tempName = fileName + L".tmp";
+
+#ifdef _WIN32
+		FILE* file = 0;
+		if (_wfopen_s(&file, tempName.c_str(), L"wb") != 0)
+			return false;
+#else
+		std::string narrowTemp;
+		std::string narrowName;
+		if (!NarrowPath(tempName, narrowTemp) || !NarrowPath(fileName, narrowName))
+			return false;
+		FILE* file = fopen(narrowTemp.c_str(), "wb");
+#endif
+		if (!file)
+			return false;
+
+		bool written = fwrite(image.data(), 1, image.size(), file) == image.size();
+		written = fclose(file) == 0 && written;
+
+#ifdef _WIN32
+		if (!written)
+		{
+			DeleteFileW(tempName.c_str());
+			return false;
+		}
+		return MoveFileExW(tempName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		if (!written)
+		{
+			remove(narrowTemp.c_str());
+			return false;
+		}
+		return rename(narrowTemp.c_str(), narrowName.c_str()) == 0;
+#endif
+	}
+}
+
+// --------------------------------------------------------
+// The cache goes right next to the compiled shader
+// --------------------------------------------------------
+std::wstring GetShaderReflectionCachePath(const std::wstring& shaderFileName)
+{
+	return shaderFileName + L".reflection";
+}
+
+// --------------------------------------------------------
+// Maps the cache if there is a valid one, and otherwise
+// reflects the bytecode and (re)writes the cache
+// --------------------------------------------------------
+bool ShaderReflectionCache::Load(const std::wstring& shaderFileName, const void* bytecode, size_t bytecodeSize)
+{
+	uint64_t sourceHash = HashContents((const char*)bytecode, bytecodeSize);
+	std::wstring cachePath = GetShaderReflectionCachePath(shaderFileName);
+
+	std::unique_ptr<MappedFile> mapped(new MappedFile(cachePath));
+	if (mapped->IsOpen() && Attach(mapped->GetData(), mapped->GetSize(), sourceHash))
+	{
+		file = std::move(mapped);
+		image.clear();
+		return true;
+	}
+	file.reset();
+
+	if (!Reflect(bytecode, bytecodeSize, sourceHash))
+		return false;
+
+	WriteImage(cachePath, image);
+	return true;
+}
+
+// --------------------------------------------------------
+// Checks every count (and the size) before trusting the
+// data, along with every name offset, variable range,
+// buffer size and bind point, since those get used as is
+// later; anything unexpected counts as stale
+// --------------------------------------------------------
+bool ShaderReflectionCache::Attach(const char* data, size_t size, uint64_t sourceHash)
+{
+	if (size < sizeof(ShaderReflectionHeader))
+		return false;
+
+	ShaderReflectionHeader fileHeader;
+	memcpy(&fileHeader, data, sizeof(fileHeader));
+
+	if (memcmp(fileHeader.Magic, ShaderReflectionMagic, sizeof(ShaderReflectionMagic)) != 0 ||
+		fileHeader.Version != ShaderReflectionCacheVersion ||
+		fileHeader.SourceHash != sourceHash ||
+		size != GetImageSize(fileHeader))
+		return false;
+
+	const ShaderReflectionBuffer* fileBuffers = (const ShaderReflectionBuffer*)(data + sizeof(ShaderReflectionHeader));
+	const SimpleShaderVariable* fileVariables = (const SimpleShaderVariable*)(fileBuffers + fileHeader.BufferCount);
+	const ShaderReflectionVariable* fileSorted = (const ShaderReflectionVariable*)(fileVariables + fileHeader.VariableCount);
+	const ShaderReflectionTexture* fileTextures = (const ShaderReflectionTexture*)(fileSorted + fileHeader.VariableCount);
+	const ShaderReflectionSampler* fileSamplers = (const ShaderReflectionSampler*)(fileTextures + fileHeader.TextureCount);
+	const ShaderReflectionUav* fileUavs = (const ShaderReflectionUav*)(fileSamplers + fileHeader.SamplerCount);
+	const ShaderReflectionParameter* fileInputs = (const ShaderReflectionParameter*)(fileUavs + fileHeader.UavCount);
+	const ShaderReflectionParameter* fileOutputs = fileInputs + fileHeader.InputCount;
+	const char* fileNames = (const char*)(fileOutputs + fileHeader.OutputCount);
+
+	// Every name has to end inside the names, which the last terminator ensures
+	uint32_t nameBytes = fileHeader.NameBytes;
+	if (nameBytes > 0 && fileNames[nameBytes - 1] != '\0')
+		return false;
+
+	for (uint32_t b = 0; b < fileHeader.BufferCount; b++)
+	{
+		const ShaderReflectionBuffer& buffer = fileBuffers[b];
+		if (!IsBufferValid(buffer) ||
+			buffer.NameOffset >= nameBytes ||
+			(uint64_t)buffer.FirstVariable + buffer.VariableCount > fileHeader.VariableCount)
+			return false;
+	}
+
+	for (uint32_t v = 0; v < fileHeader.VariableCount; v++)
+	{
+		if (!IsVariableValid(fileVariables[v], fileBuffers, fileHeader.BufferCount) ||
+			!IsVariableValid(fileSorted[v].Variable, fileBuffers, fileHeader.BufferCount) ||
+			fileSorted[v].NameOffset >= nameBytes ||
+			(v > 0 && fileSorted[v].Hash < fileSorted[v - 1].Hash))
+			return false;
+	}
+
+	for (uint32_t t = 0; t < fileHeader.TextureCount; t++)
+	{
+		if (fileTextures[t].NameOffset >= nameBytes ||
+			fileTextures[t].Texture.Index != t ||
+			fileTextures[t].Texture.BindIndex >= D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT)
+			return false;
+	}
+
+	for (uint32_t s = 0; s < fileHeader.SamplerCount; s++)
+	{
+		if (fileSamplers[s].NameOffset >= nameBytes ||
+			fileSamplers[s].Sampler.Index != s ||
+			fileSamplers[s].Sampler.BindIndex >= D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT)
+			return false;
+	}
+
+	for (uint32_t u = 0; u < fileHeader.UavCount; u++)
+	{
+		if (fileUavs[u].NameOffset >= nameBytes ||
+			fileUavs[u].BindIndex >= D3D11_1_UAV_SLOT_COUNT)
+			return false;
+	}
+
+	for (uint32_t p = 0; p < fileHeader.InputCount + fileHeader.OutputCount; p++)
+	{
+		if (!IsParameterValid(fileInputs[p], nameBytes))
+			return false;
+	}
+
+	header = fileHeader;
+	buffers = fileBuffers;
+	variables = fileVariables;
+	sortedVariables = fileSorted;
+	textures = fileTextures;
+	samplers = fileSamplers;
+	uavs = fileUavs;
+	inputs = fileInputs;
+	outputs = fileOutputs;
+	names = fileNames;
+	return true;
+}
+
+// --------------------------------------------------------
+// Reflects the bytecode once, laying the results out
+// exactly as the cache file does, so one Attach() serves
+// either way
+// --------------------------------------------------------
+bool ShaderReflectionCache::Reflect(const void* bytecode, size_t bytecodeSize, uint64_t sourceHash)
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
+	HRESULT hr = D3DReflect(
+		bytecode,
+		bytecodeSize,
+		IID_ID3D11ShaderReflection,
+		(void**)refl.GetAddressOf());
+	if (hr != S_OK || !refl)
+		return false;
+
+	D3D11_SHADER_DESC shaderDesc;
+	refl->GetDesc(&shaderDesc);
+
+	std::vector<ShaderReflectionBuffer> newBuffers;
+	std::vector<SimpleShaderVariable> newVariables;
+	std::vector<ShaderReflectionVariable> newSorted;
+	std::vector<ShaderReflectionTexture> newTextures;
+	std::vector<ShaderReflectionSampler> newSamplers;
+	std::vector<ShaderReflectionUav> newUavs;
+	std::vector<ShaderReflectionParameter> newInputs;
+	std::vector<ShaderReflectionParameter> newOutputs;
+	std::vector<char> newNames;
+
+	// Bound resources (textures, structured buffers, samplers and UAVs)
+	for (unsigned int r = 0; r < shaderDesc.BoundResources; r++)
+	{
+		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
+		refl->GetResourceBindingDesc(r, &resourceDesc);
+
+		switch (resourceDesc.Type)
+		{
+		case D3D_SIT_STRUCTURED: // Treat structured buffers as texture resources
+		case D3D_SIT_TEXTURE:
+		{
+			ShaderReflectionTexture texture = {};
+			texture.Hash = HashShaderName(resourceDesc.Name);
+			texture.NameOffset = AddName(newNames, resourceDesc.Name);
+			texture.Texture.BindIndex = resourceDesc.BindPoint;
+			texture.Texture.Index = (unsigned int)newTextures.size();
+			newTextures.push_back(texture);
+		}
+			break;
+
+		case D3D_SIT_SAMPLER:
+		{
+			ShaderReflectionSampler sampler = {};
+			sampler.Hash = HashShaderName(resourceDesc.Name);
+			sampler.NameOffset = AddName(newNames, resourceDesc.Name);
+			sampler.Sampler.BindIndex = resourceDesc.BindPoint;
+			sampler.Sampler.Index = (unsigned int)newSamplers.size();
+			newSamplers.push_back(sampler);
+		}
+			break;
+
+		case D3D_SIT_UAV_APPEND_STRUCTURED:
+		case D3D_SIT_UAV_CONSUME_STRUCTURED:
+		case D3D_SIT_UAV_RWBYTEADDRESS:
+		case D3D_SIT_UAV_RWSTRUCTURED:
+		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
+		case D3D_SIT_UAV_RWTYPED:
+		{
+			ShaderReflectionUav uav = {};
+			uav.NameOffset = AddName(newNames, resourceDesc.Name);
+			uav.BindIndex = resourceDesc.BindPoint;
+			newUavs.push_back(uav);
+		}
+			break;
+		}
+	}
+
+	// The input signature (what a vertex shader's input layout is built
+	// from) and the output signature (a geometry shader's stream out)
+	for (unsigned int i = 0; i < shaderDesc.InputParameters + shaderDesc.OutputParameters; i++)
+	{
+		bool isInput = i < shaderDesc.InputParameters;
+		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
+		if (isInput)
+			refl->GetInputParameterDesc(i, &paramDesc);
+		else
+			refl->GetOutputParameterDesc(i - shaderDesc.InputParameters, &paramDesc);
+
+		ShaderReflectionParameter parameter = {};
+		parameter.NameOffset = AddName(newNames, paramDesc.SemanticName);
+		parameter.SemanticIndex = paramDesc.SemanticIndex;
+		parameter.ComponentType = (uint32_t)paramDesc.ComponentType;
+		parameter.Mask = paramDesc.Mask;
+		parameter.Stream = isInput ? 0 : paramDesc.Stream;
+		parameter.PerInstance = isInput && IsPerInstanceSemantic(paramDesc.SemanticName);
+		(isInput ? newInputs : newOutputs).push_back(parameter);
+	}
+
+	// Constant buffers and their variables
+	for (unsigned int b = 0; b < shaderDesc.ConstantBuffers; b++)
+	{
+		ID3D11ShaderReflectionConstantBuffer* cb = refl->GetConstantBufferByIndex(b);
+
+		D3D11_SHADER_BUFFER_DESC bufferDesc;
+		cb->GetDesc(&bufferDesc);
+
+		// The binding tells exactly where the buffer goes in the shader
+		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
+		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
+
+		ShaderReflectionBuffer buffer = {};
+		buffer.NameOffset = AddName(newNames, bufferDesc.Name);
+		buffer.Type = (uint32_t)bufferDesc.Type;
+		buffer.Size = bufferDesc.Size;
+		buffer.BindIndex = bindDesc.BindPoint;
+		buffer.FirstVariable = (uint32_t)newVariables.size();
+		buffer.VariableCount = bufferDesc.Variables;
+		newBuffers.push_back(buffer);
+
+		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
+		{
+			D3D11_SHADER_VARIABLE_DESC varDesc;
+			cb->GetVariableByIndex(v)->GetDesc(&varDesc);
+
+			SimpleShaderVariable var = {};
+			var.ConstantBufferIndex = b;
+			var.ByteOffset = varDesc.StartOffset;
+			var.Size = varDesc.Size;
+			newVariables.push_back(var);
+
+			ShaderReflectionVariable entry = {};
+			entry.Hash = HashShaderName(varDesc.Name);
+			entry.NameOffset = AddName(newNames, varDesc.Name);
+			entry.Variable = var;
+			newSorted.push_back(entry);
+		}
+	}
+
+	// Sort for binary searches by hash.  Stable, so that the first buffer
+	// to declare a name is the one that gets set.
+	std::stable_sort(newSorted.begin(), newSorted.end(),
+		[](const ShaderReflectionVariable& a, const ShaderReflectionVariable& b) { return a.Hash < b.Hash; });
+
+	ShaderReflectionHeader newHeader = {};
+	memcpy(newHeader.Magic, ShaderReflectionMagic, sizeof(ShaderReflectionMagic));
+	newHeader.Version = ShaderReflectionCacheVersion;
+	newHeader.SourceHash = sourceHash;
+	newHeader.BufferCount = (uint32_t)newBuffers.size();
+	newHeader.VariableCount = (uint32_t)newVariables.size();
+	newHeader.TextureCount = (uint32_t)newTextures.size();
+	newHeader.SamplerCount = (uint32_t)newSamplers.size();
+	newHeader.UavCount = (uint32_t)newUavs.size();
+	newHeader.InputCount = (uint32_t)newInputs.size();
+	newHeader.OutputCount = (uint32_t)newOutputs.size();
+	refl->GetThreadGroupSize(&newHeader.ThreadGroupSize[0], &newHeader.ThreadGroupSize[1], &newHeader.ThreadGroupSize[2]);
+	newHeader.NameBytes = (uint32_t)newNames.size();
+
+	image.clear();
+	image.reserve((size_t)GetImageSize(newHeader));
+	image.insert(image.end(), (const char*)&newHeader, (const char*)&newHeader + sizeof(newHeader));
+	AppendRecords(image, newBuffers);
+	AppendRecords(image, newVariables);
+	AppendRecords(image, newSorted);
+	AppendRecords(image, newTextures);
+	AppendRecords(image, newSamplers);
+	AppendRecords(image, newUavs);
+	AppendRecords(image, newInputs);
+	AppendRecords(image, newOutputs);
+	image.insert(image.end(), newNames.begin(), newNames.end());
+
+	return Attach(image.data(), image.size(), sourceHash);
+}
+
+// --------------------------------------------------------
+// The first entry with the hash, then a compare of the
+// names themselves in case two hashes collide
+// --------------------------------------------------------
+const SimpleShaderVariable* ShaderReflectionCache::FindVariable(ShaderName name) const
+{
+	const ShaderReflectionVariable* end = sortedVariables + header.VariableCount;
+	const ShaderReflectionVariable* entry = std::lower_bound(sortedVariables, end, name.Hash,
+		[](const ShaderReflectionVariable& e, uint32_t hash) { return e.Hash < hash; });
+
+	for (; entry != end && entry->Hash == name.Hash; ++entry)
+	{
+		if (strcmp(names + entry->NameOffset, name.Name) == 0)
+			return &entry->Variable;
+	}
+	return 0;
+}
+
+const ShaderReflectionTexture* ShaderReflectionCache::FindTexture(ShaderName name) const
+{
+	for (uint32_t t = 0; t < header.TextureCount; t++)
+	{
+		if (textures[t].Hash == name.Hash && strcmp(names + textures[t].NameOffset, name.Name) == 0)
+			return &textures[t];
+	}
+	return 0;
+}
+
+const ShaderReflectionSampler* ShaderReflectionCache::FindSampler(ShaderName name) const
+{
+	for (uint32_t s = 0; s < header.SamplerCount; s++)
+	{
+		if (samplers[s].Hash == name.Hash && strcmp(names + samplers[s].NameOffset, name.Name) == 0)
+			return &samplers[s];
+	}
+	return 0;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "SimpleShader.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Binary shader reflection cache
+//
+// Holds what SimpleShader needs from D3DReflect() about a
+// compiled shader (its constant buffers and their
+// variables, textures, samplers and UAVs, with bind points
+// and names, its input and output signatures and its
+// thread group size) so later runs can skip reflecting.  Each cache
+// file sits next to its .cso and remembers a hash of the
+// bytecode, so a rebuilt shader invalidates it.
+//
+// Layout: ShaderReflectionHeader, then the buffers, then
+// every variable in declaration order (each buffer's back
+// to back), then the variables again sorted by name hash,
+// then the textures, then the samplers, then the UAVs,
+// then the input parameters, then the output parameters,
+// then the names (null terminated).  Every record is made of 32-bit
+// fields, so the file is used in place once mapped.
+// --------------------------------------------------------
+
+// Bump whenever the layout or the records change
+const uint32_t ShaderReflectionCacheVersion = 2;
+
+struct ShaderReflectionHeader
+{
+	char Magic[4];
+	uint32_t Version;
+	uint64_t SourceHash;
+	uint32_t BufferCount;
+	uint32_t VariableCount;
+	uint32_t TextureCount;
+	uint32_t SamplerCount;
+	uint32_t UavCount;
+	uint32_t InputCount;
+	uint32_t OutputCount;
+	uint32_t ThreadGroupSize[3];	// Compute shaders only, or 0
+	uint32_t NameBytes;
+	uint32_t Padding;
+};
+
+struct ShaderReflectionBuffer
+{
+	uint32_t NameOffset;
+	uint32_t Type;				// D3D_CBUFFER_TYPE
+	uint32_t Size;
+	uint32_t BindIndex;
+	uint32_t FirstVariable;		// Into the variables in declaration order
+	uint32_t VariableCount;
+};
+
+// A variable, texture or sampler along with its name, for lookups
+struct ShaderReflectionVariable
+{
+	uint32_t Hash;				// HashShaderName() of the name
+	uint32_t NameOffset;
+	SimpleShaderVariable Variable;
+};
+
+struct ShaderReflectionTexture
+{
+	uint32_t Hash;
+	uint32_t NameOffset;
+	SimpleSRV Texture;
+};
+
+struct ShaderReflectionSampler
+{
+	uint32_t Hash;
+	uint32_t NameOffset;
+	SimpleSampler Sampler;
+};
+
+struct ShaderReflectionUav
+{
+	uint32_t NameOffset;
+	uint32_t BindIndex;
+};
+
+// An input or output signature entry
+struct ShaderReflectionParameter
+{
+	uint32_t NameOffset;		// The semantic
+	uint32_t SemanticIndex;
+	uint32_t ComponentType;		// D3D_REGISTER_COMPONENT_TYPE
+	uint32_t Mask;
+	uint32_t Stream;			// Outputs only
+	uint32_t PerInstance;		// Inputs only: the semantic ends in _PER_INSTANCE
+};
+
+// Where the cache for a given compiled shader lives
+std::wstring GetShaderReflectionCachePath(const std::wstring& shaderFileName);
+
+// --------------------------------------------------------
+// One shader's reflection, read from its cache file or
+// (when that's missing or stale) reflected from the
+// bytecode and then written out for next time
+//
+// - Read from the cache, everything points straight into
+//   the mapped file; nothing is allocated per buffer,
+//   variable or resource
+// - Reflected, it all sits in one block of memory laid out
+//   just like the file
+// - Textures and samplers keep their declaration order, so
+//   their Index is their position; duplicate names resolve
+//   to the first, as do variables declared in two buffers
+// --------------------------------------------------------
+class ShaderReflectionCache
+{
+public:
+	// Returns false only if there's no cache and the bytecode can't be
+	// reflected.  Failing to write the cache just means reflecting again
+	// next time.
+	bool Load(const std::wstring& shaderFileName, const void* bytecode, size_t bytecodeSize);
+
+	// Whether Load() found a valid cache rather than reflecting
+	bool WasCached() const { return (bool)file; }
+
+	unsigned int GetBufferCount() const { return header.BufferCount; }
+	unsigned int GetVariableCount() const { return header.VariableCount; }
+	unsigned int GetTextureCount() const { return header.TextureCount; }
+	unsigned int GetSamplerCount() const { return header.SamplerCount; }
+	unsigned int GetUavCount() const { return header.UavCount; }
+	unsigned int GetInputCount() const { return header.InputCount; }
+	unsigned int GetOutputCount() const { return header.OutputCount; }
+
+	const ShaderReflectionBuffer* GetBuffers() const { return buffers; }
+	const SimpleShaderVariable* GetVariables() const { return variables; }
+	const ShaderReflectionTexture* GetTextures() const { return textures; }
+	const ShaderReflectionSampler* GetSamplers() const { return samplers; }
+	const ShaderReflectionUav* GetUavs() const { return uavs; }
+	const ShaderReflectionParameter* GetInputs() const { return inputs; }
+	const ShaderReflectionParameter* GetOutputs() const { return outputs; }
+	const uint32_t* GetThreadGroupSize() const { return header.ThreadGroupSize; }
+	const char* GetName(uint32_t nameOffset) const { return names + nameOffset; }
+
+	// Name lookups, or null.  Variables are a binary search on the hash;
+	// textures and samplers, a handful per shader, a scan of the hashes.
+	const SimpleShaderVariable* FindVariable(ShaderName name) const;
+	const ShaderReflectionTexture* FindTexture(ShaderName name) const;
+	const ShaderReflectionSampler* FindSampler(ShaderName name) const;
+
+private:
+	std::unique_ptr<MappedFile> file;	// Only kept if the cache was valid
+	std::vector<char> image;			// The reflected data otherwise
+
+	ShaderReflectionHeader header = {};
+	const ShaderReflectionBuffer* buffers = 0;
+	const SimpleShaderVariable* variables = 0;
+	const ShaderReflectionVariable* sortedVariables = 0;
+	const ShaderReflectionTexture* textures = 0;
+	const ShaderReflectionSampler* samplers = 0;
+	const ShaderReflectionUav* uavs = 0;
+	const ShaderReflectionParameter* inputs = 0;
+	const ShaderReflectionParameter* outputs = 0;
+	const char* names = 0;
+
+	bool Reflect(const void* bytecode, size_t bytecodeSize, uint64_t sourceHash);
+	bool Attach(const char* data, size_t size, uint64_t sourceHash);
+};
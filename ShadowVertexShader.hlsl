@@ -1,17 +1,14 @@
 #include "ShaderIncludes.hlsli"
 
-// Constant Buffer for external(C++) data
-cbuffer externalData : register(b0)
-{
-	matrix world;
-	matrix view;
-	matrix projection;
-};
+// view and projection are the light's, from the shadow pass's PerPass
+// buffer; world is from PerObject
 // --------------------------------------------------------
-// A simplified vertex shader for rendering to a shadow map
+// A simplified vertex shader for rendering to a shadow map.
+// It reads positions only, so Mesh::DrawPositionOnly() can
+// feed it the mesh's position stream.
 // --------------------------------------------------------
-float4 main(VertexShaderInput input) : SV_POSITION
+float4 main(MeshPositionInput meshInput) : SV_POSITION
 {
 	matrix wvp = mul(projection, mul(view, world));
-	return mul(wvp, float4(input.localPosition, 1.0f));
+	return mul(wvp, float4(UnpackPosition(meshInput), 1.0f));
 }
\ No newline at end of file
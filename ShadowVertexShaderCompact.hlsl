@@ -0,0 +1,3 @@
+// Same as ShadowVertexShader.hlsl, but reads the CompactVertex layout
+#define COMPACT_VERTEX_INPUT
+#include "ShadowVertexShader.hlsl"
@@ -1,8 +1,18 @@
 #include "SimpleShader.h"
+#include "ShaderReflectionCache.h"
+
+#include <algorithm>
+#include <cstring>
 
 // Default error reporting state
 bool ISimpleShader::ReportErrors = false;
 bool ISimpleShader::ReportWarnings = false;
+SimpleShaderUploadStats ISimpleShader::uploadStats;
+std::vector<std::string> ISimpleShader::externalBuffers;
+Microsoft::WRL::ComPtr<ID3D11Device> ISimpleShader::dynamicDevice;
+Microsoft::WRL::ComPtr<ID3D11DeviceContext1> ISimpleShader::dynamicContext;
+Microsoft::WRL::ComPtr<ID3D11Buffer> ISimpleShader::dynamicBuffer;
+LinearConstantAllocator ISimpleShader::dynamicAllocator;
 
 // To enable error reporting, use either or both 
 // of the following lines somewhere in your program, 
@@ -54,20 +64,104 @@ void ISimpleShader::CleanUp()
 	if (constantBuffers)
 	{
 		delete[] constantBuffers;
+		constantBuffers = 0;
 		constantBufferCount = 0;
 	}
 
-	for (unsigned int i = 0; i < shaderResourceViews.size(); i++)
-		delete shaderResourceViews[i];
-	
-	for (unsigned int i = 0; i < samplerStates.size(); i++)
-		delete samplerStates[i];
+	// The reflection stays: LoadShaderFile() replaces it before
+	// CreateShader() (which cleans up first) reads it
+}
+
+// --------------------------------------------------------
+// Names a constant buffer that shaders loaded from now on
+// should leave to its owner (see SimpleSharedBuffer)
+// --------------------------------------------------------
+void ISimpleShader::AddExternalBuffer(std::string bufferName)
+{
+	if (std::find(externalBuffers.begin(), externalBuffers.end(), bufferName) == externalBuffers.end())
+		externalBuffers.push_back(bufferName);
+}
+
+// --------------------------------------------------------
+// Resets the upload counts and starts the dynamic constant
+// buffer over.  If the last frame ran out of room, it's
+// replaced with one twice the size first.
+// --------------------------------------------------------
+void ISimpleShader::BeginFrame()
+{
+	uploadStats = SimpleShaderUploadStats();
+
+	if (!dynamicBuffer)
+		return;
+
+	if (dynamicAllocator.GetStats().Overflows > 0)
+	{
+		D3D11_BUFFER_DESC desc = {};
+		desc.ByteWidth = dynamicAllocator.GetCapacity() * 2;
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+		Microsoft::WRL::ComPtr<ID3D11Buffer> grown;
+		if (SUCCEEDED(dynamicDevice->CreateBuffer(&desc, 0, grown.GetAddressOf())))
+		{
+			dynamicBuffer = grown;
+			dynamicAllocator.Reset(desc.ByteWidth);
+		}
+	}
 
-	// Clean up tables
-	varTable.clear();
-	cbTable.clear();
-	samplerTable.clear();
-	textureTable.clear();
+	dynamicAllocator.BeginFrame();
+}
+
+// --------------------------------------------------------
+// Switches every shader's uploads over to one dynamic
+// buffer, if the device can bind part of a constant buffer
+// and map one with no-overwrite (both D3D 11.1)
+//
+// device - The device the shaders were loaded with
+// context - The immediate context they draw with
+// capacity - Starting size in bytes, for one frame
+// --------------------------------------------------------
+bool ISimpleShader::EnableDynamicConstants(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, unsigned int capacity)
+{
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (FAILED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) ||
+		!options.ConstantBufferOffsetting ||
+		!options.MapNoOverwriteOnDynamicConstantBuffer)
+		return false;
+
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> context1;
+	if (FAILED(context.As(&context1)))
+		return false;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = max(capacity, (unsigned int)CONSTANT_SLICE_MAX_SIZE) / CONSTANT_SLICE_ALIGNMENT * CONSTANT_SLICE_ALIGNMENT;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	if (FAILED(device->CreateBuffer(&desc, 0, buffer.GetAddressOf())))
+		return false;
+
+	dynamicDevice = device;
+	dynamicContext = context1;
+	dynamicBuffer = buffer;
+	dynamicAllocator.Reset(desc.ByteWidth);
+	return true;
+}
+
+// --------------------------------------------------------
+// Back to each buffer's own ConstantBuffer.  Buffers last
+// written to the dynamic one go up in full on their next
+// copy, since their own is out of date.  The allocator is
+// kept, so its slices stay expired if this is enabled again.
+// --------------------------------------------------------
+void ISimpleShader::DisableDynamicConstants()
+{
+	dynamicDevice.Reset();
+	dynamicContext.Reset();
+	dynamicBuffer.Reset();
 }
 
 // --------------------------------------------------------
@@ -94,6 +188,25 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
+	// Get information about this shader and its variables, buffers,
+	// signatures, etc., from the reflection cache next to the file.
+	// Only the first load (or one after the shader is rebuilt) calls
+	// D3DReflect().  This comes first, as creating the shader (an input
+	// layout, stream out or UAVs) reads it too.
+	reflection.reset(new ShaderReflectionCache());
+	if (!reflection->Load(shaderFile, shaderBlob->GetBufferPointer(), shaderBlob->GetBufferSize()))
+	{
+		if (ReportErrors)
+		{
+			LogError("SimpleShader::LoadShaderFile() - Error reflecting shader from file '");
+			LogW(shaderFile);
+			LogError("'.\n");
+		}
+
+		shaderValid = false;
+		return false;
+	}
+
 	// Create the shader - Calls an overloaded version of this abstract
 	// method in the appropriate child class
 	shaderValid = CreateShader(shaderBlob);
@@ -109,86 +222,24 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
-	// Set up shader reflection to get information about
-	// this shader and its variables,  buffers, etc.
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-	
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
 	// Create resource arrays
-	constantBufferCount = shaderDesc.ConstantBuffers;
+	constantBufferCount = reflection->GetBufferCount();
 	constantBuffers = new SimpleConstantBuffer[constantBufferCount];
-	
-	// Handle bound resources (like shaders and samplers)
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
-	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
-
-		// Check the type
-		switch (resourceDesc.Type)
-		{
-		case D3D_SIT_STRUCTURED: // Treat structured buffers as texture resources
-		case D3D_SIT_TEXTURE: // A texture resource
-		{
-			// Create the SRV wrapper
-			SimpleSRV* srv = new SimpleSRV();
-			srv->BindIndex = resourceDesc.BindPoint;				// Shader bind point
-			srv->Index = (unsigned int)shaderResourceViews.size();	// Raw index
-
-			textureTable.insert(std::pair<std::string, SimpleSRV*>(resourceDesc.Name, srv));
-			shaderResourceViews.push_back(srv);
-		}
-			break;
-
-		case D3D_SIT_SAMPLER: // A sampler resource
-		{
-			// Create the sampler wrapper
-			SimpleSampler* samp = new SimpleSampler();
-			samp->BindIndex = resourceDesc.BindPoint;			// Shader bind point
-			samp->Index = (unsigned int)samplerStates.size();	// Raw index
-
-			samplerTable.insert(std::pair<std::string, SimpleSampler*>(resourceDesc.Name, samp));
-			samplerStates.push_back(samp);
-		}
-			break;
-		}
-	}
 
 	// Loop through all constant buffers
 	for (unsigned int b = 0; b < constantBufferCount; b++)
 	{
-		// Get this buffer
-		ID3D11ShaderReflectionConstantBuffer* cb =
-			refl->GetConstantBufferByIndex(b);
-		
-		// Get the description of this buffer
-		D3D11_SHADER_BUFFER_DESC bufferDesc;
-		cb->GetDesc(&bufferDesc);
+		const ShaderReflectionBuffer& bufferDesc = reflection->GetBuffers()[b];
 
-		// Save the type, which we reference when setting these buffers
-		constantBuffers[b].Type = bufferDesc.Type;
-		
-		// Get the description of the resource binding, so
-		// we know exactly how it's bound in the shader
-		D3D11_SHADER_INPUT_BIND_DESC bindDesc;
-		refl->GetResourceBindingDescByName(bufferDesc.Name, &bindDesc);
-		
-		// Set up the buffer and put its pointer in the table
-		constantBuffers[b].BindIndex = bindDesc.BindPoint;
-		constantBuffers[b].Name = bufferDesc.Name;
-		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
+		// Save the type, which we reference when setting these buffers,
+		// and exactly how it's bound in the shader
+		constantBuffers[b].Type = (D3D_CBUFFER_TYPE)bufferDesc.Type;
+		constantBuffers[b].BindIndex = bufferDesc.BindIndex;
+		constantBuffers[b].Name = reflection->GetName(bufferDesc.NameOffset);
+		constantBuffers[b].External = std::find(externalBuffers.begin(), externalBuffers.end(), constantBuffers[b].Name) != externalBuffers.end();
 
-		// Create this constant buffer
+		// Create this constant buffer, unless something else owns it.  The
+		// local data and the variables are still set up, as the layout.
 		D3D11_BUFFER_DESC newBuffDesc = {};
 		newBuffDesc.Usage = D3D11_USAGE_DEFAULT;
 		newBuffDesc.ByteWidth = ((bufferDesc.Size + 15) / 16) * 16; // Quick and dirty 16-byte alignment using integer division
@@ -196,37 +247,21 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		newBuffDesc.CPUAccessFlags = 0;
 		newBuffDesc.MiscFlags = 0;
 		newBuffDesc.StructureByteStride = 0;
-		device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
+		if (!constantBuffers[b].External)
+			device->CreateBuffer(&newBuffDesc, 0, constantBuffers[b].ConstantBuffer.GetAddressOf());
 
 		// Set up the data buffer for this constant buffer
 		constantBuffers[b].Size = bufferDesc.Size;
 		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
 		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
 
-		// Loop through all variables in this buffer
-		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
-		{
-			// Get this variable
-			ID3D11ShaderReflectionVariable* var =
-				cb->GetVariableByIndex(v);
-			
-			// Get the description of the variable and its type
-			D3D11_SHADER_VARIABLE_DESC varDesc;
-			var->GetDesc(&varDesc);
-
-			// Create the variable struct
-			SimpleShaderVariable varStruct = {};
-			varStruct.ConstantBufferIndex = b;
-			varStruct.ByteOffset = varDesc.StartOffset;
-			varStruct.Size = varDesc.Size;
-			
-			// Get a string version
-			std::string varName(varDesc.Name);
-
-			// Add this variable to the table and the constant buffer
-			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
-			constantBuffers[b].Variables.push_back(varStruct);
-		}
+		// The buffer starts out uninitialized, so the first copy always goes up
+		constantBuffers[b].DirtyStart = 0;
+		constantBuffers[b].DirtyEnd = bufferDesc.Size;
+
+		// Its variables sit back to back in the reflection
+		constantBuffers[b].Variables = reflection->GetVariables() + bufferDesc.FirstVariable;
+		constantBuffers[b].VariableCount = bufferDesc.VariableCount;
 	}
 
 	// All set
@@ -239,19 +274,20 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 // 
 // name - the name of the variable to look for
 // size - the size of the variable (for verification), or -1 to bypass
+//
+// A binary search on the name's hash, then a compare of
+// the names themselves in case two hashes collide (see
+// ShaderReflectionCache)
 // --------------------------------------------------------
-SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
+const SimpleShaderVariable* ISimpleShader::FindVariable(ShaderName name, int size)
 {
-	// Look for the key
-	std::unordered_map<std::string, SimpleShaderVariable>::iterator result =
-		varTable.find(name);
-
-	// Did we find the key?
-	if (result == varTable.end())
+	if (!reflection)
 		return 0;
 
-	// Grab the result from the iterator
-	SimpleShaderVariable* var = &(result->second);
+	// Look for the variable
+	const SimpleShaderVariable* var = reflection->FindVariable(name);
+	if (!var)
+		return 0;
 
 	// Is the data size correct ?
 	if (size > 0 && var->Size != size)
@@ -266,16 +302,14 @@ SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
 // --------------------------------------------------------
 SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string name)
 {
-	// Look for the key
-	std::unordered_map<std::string, SimpleConstantBuffer*>::iterator result =
-		cbTable.find(name);
-
-	// Did we find the key?
-	if (result == cbTable.end())
-		return 0;
+	// Only a handful per shader, so a scan beats a table
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		if (constantBuffers[i].Name == name)
+			return &constantBuffers[i];
+	}
 
-	// Success
-	return result->second;
+	return 0;
 }
 
 // --------------------------------------------------------
@@ -345,13 +379,11 @@ void ISimpleShader::CopyAllBufferData()
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
-	// Loop through the constant buffers and copy all data
+	// Loop through the constant buffers and copy any that changed
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer.Get(), 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+		if (!constantBuffers[i].External && UploadBufferData(deviceContext.Get(), constantBuffers[i]))
+			BindConstantBuffer(constantBuffers[i]);
 	}
 }
 
@@ -377,12 +409,11 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 
 	// Check for the buffer
 	SimpleConstantBuffer* cb = &this->constantBuffers[index];
-	if (!cb) return;
+	if (!cb || cb->External) return;
 
-	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	// Copy the data (if it changed) and get out
+	if (UploadBufferData(deviceContext.Get(), *cb))
+		BindConstantBuffer(*cb);
 }
 
 // --------------------------------------------------------
@@ -399,12 +430,99 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 
 	// Check for the buffer
 	SimpleConstantBuffer* cb = this->FindConstantBuffer(bufferName);
-	if (!cb) return;
+	if (!cb || cb->External) return;
 
-	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	// Copy the data (if it changed) and get out
+	if (UploadBufferData(deviceContext.Get(), *cb))
+		BindConstantBuffer(*cb);
+}
+
+// --------------------------------------------------------
+// Copies data into a local data buffer, widening its dirty
+// range only if the bytes actually change.  Setting the
+// same value again (the lights, for every entity) leaves
+// the buffer clean.
+// --------------------------------------------------------
+void ISimpleShader::WriteBufferData(SimpleConstantBuffer& cb, unsigned int offset, const void* data, unsigned int size)
+{
+	unsigned char* destination = cb.LocalDataBuffer + offset;
+	if (memcmp(destination, data, size) == 0)
+		return;
+
+	memcpy(destination, data, size);
+	if (!cb.IsDirty())
+	{
+		cb.DirtyStart = offset;
+		cb.DirtyEnd = offset + size;
+	}
+	else
+	{
+		cb.DirtyStart = min(cb.DirtyStart, offset);
+		cb.DirtyEnd = max(cb.DirtyEnd, offset + size);
+	}
+}
+
+// --------------------------------------------------------
+// Copies a local data buffer to the GPU if it changed since
+// the last copy, and counts the bytes either way
+//
+// - With the dynamic buffer, changed data goes to a new
+//   slice of it.  Buffers too big for a slice, and whatever
+//   is left once the frame runs out of room, take the path
+//   below.
+// - Otherwise it's UpdateSubresource() into the buffer's own
+//   ConstantBuffer.  Constant buffers can only be updated
+//   whole that way, so a dirty buffer goes up in full.
+// - Data that sat still through a frame goes back to its
+//   own buffer when its slice expires, once, and stays there
+//   for free until it changes again
+//
+// Returns true if the data is now somewhere other than
+// where it was last bound
+// --------------------------------------------------------
+bool ISimpleShader::UploadBufferData(ID3D11DeviceContext* context, SimpleConstantBuffer& cb)
+{
+	bool inDynamicBuffer = IsInDynamicBuffer(cb);
+	bool ownBufferStale = cb.Slice.Generation != 0 && !inDynamicBuffer;
+	if (!cb.IsDirty() && !ownBufferStale)
+	{
+		uploadStats.BuffersSkipped++;
+		uploadStats.BytesSkipped += cb.Size;
+		return false;
+	}
+
+	uploadStats.BuffersUploaded++;
+	uploadStats.BytesUploaded += cb.Size;
+	uploadStats.BytesChanged += cb.DirtyEnd - cb.DirtyStart;
+
+	ConstantSlice slice;
+	ConstantMapMode mapMode;
+	if (cb.IsDirty() && dynamicBuffer && dynamicAllocator.Allocate(cb.Size, slice, mapMode))
+	{
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		if (SUCCEEDED(dynamicContext->Map(dynamicBuffer.Get(), 0,
+			mapMode == ConstantMapMode::Discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE,
+			0, &mapped)))
+		{
+			memcpy((unsigned char*)mapped.pData + slice.Offset, cb.LocalDataBuffer, cb.Size);
+			dynamicContext->Unmap(dynamicBuffer.Get(), 0);
+			cb.Slice = slice;
+			cb.DirtyStart = 0;
+			cb.DirtyEnd = 0;
+			return true;
+		}
+	}
+
+	context->UpdateSubresource(
+		cb.ConstantBuffer.Get(), 0, 0,
+		cb.LocalDataBuffer, 0, 0);
+
+	// Back in its own buffer, which is bound differently
+	bool moved = cb.Slice.Generation != 0;
+	cb.Slice = ConstantSlice();
+	cb.DirtyStart = 0;
+	cb.DirtyEnd = 0;
+	return moved;
 }
 
 
@@ -417,16 +535,16 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 //
 // Returns true if data is copied, false if variable doesn't exist
 // --------------------------------------------------------
-bool ISimpleShader::SetData(std::string name, const void* data, unsigned int size)
+bool ISimpleShader::SetData(ShaderName name, const void* data, unsigned int size)
 {
 	// Look for the variable and verify
-	SimpleShaderVariable* var = FindVariable(name, -1);
+	const SimpleShaderVariable* var = FindVariable(name, -1);
 	if (var == 0)
 	{
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleShader::SetData() - Shader variable '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' not found. Ensure the name is spelled correctly and that it exists in a constant buffer in the shader.\n");
 		}
 		return false;
@@ -439,15 +557,28 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		if (ReportWarnings)
 		{
 			LogWarning("SimpleShader::SetData() - Shader variable '");
-			Log(name);
+			Log(name.Name);
 			LogWarning("' is smaller than the size of the data being set. Ensure the variable is large enough for the specified data.\n");
 		}
 		return false;
 	}
 
+	// Data in external buffers is set on whatever owns them
+	if (constantBuffers[var->ConstantBufferIndex].External)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimpleShader::SetData() - Shader variable '");
+			Log(name.Name);
+			LogWarning("' is in an external constant buffer. Set it on the buffer's owner (such as a SimpleSharedBuffer) instead.\n");
+		}
+		return false;
+	}
+
 	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
+	WriteBufferData(
+		constantBuffers[var->ConstantBufferIndex],
+		var->ByteOffset,
 		data,
 		size);
 
@@ -458,7 +589,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 // --------------------------------------------------------
 // Sets INTEGER data
 // --------------------------------------------------------
-bool ISimpleShader::SetInt(std::string name, int data)
+bool ISimpleShader::SetInt(ShaderName name, int data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(int));
 }
@@ -466,7 +597,7 @@ bool ISimpleShader::SetInt(std::string name, int data)
 // --------------------------------------------------------
 // Sets a FLOAT variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat(std::string name, float data)
+bool ISimpleShader::SetFloat(ShaderName name, float data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(float));
 }
@@ -474,7 +605,7 @@ bool ISimpleShader::SetFloat(std::string name, float data)
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const float data[2])
+bool ISimpleShader::SetFloat2(ShaderName name, const float data[2])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 2);
 }
@@ -482,7 +613,7 @@ bool ISimpleShader::SetFloat2(std::string name, const float data[2])
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
+bool ISimpleShader::SetFloat2(ShaderName name, const DirectX::XMFLOAT2 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 2);
 }
@@ -490,7 +621,7 @@ bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const float data[3])
+bool ISimpleShader::SetFloat3(ShaderName name, const float data[3])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 3);
 }
@@ -498,7 +629,7 @@ bool ISimpleShader::SetFloat3(std::string name, const float data[3])
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
+bool ISimpleShader::SetFloat3(ShaderName name, const DirectX::XMFLOAT3 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 3);
 }
@@ -506,7 +637,7 @@ bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const float data[4])
+bool ISimpleShader::SetFloat4(ShaderName name, const float data[4])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 4);
 }
@@ -514,7 +645,7 @@ bool ISimpleShader::SetFloat4(std::string name, const float data[4])
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
+bool ISimpleShader::SetFloat4(ShaderName name, const DirectX::XMFLOAT4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 4);
 }
@@ -522,7 +653,7 @@ bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
+bool ISimpleShader::SetMatrix4x4(ShaderName name, const float data[16])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 16);
 }
@@ -530,16 +661,69 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data)
+bool ISimpleShader::SetMatrix4x4(ShaderName name, const DirectX::XMFLOAT4X4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
 
+// --------------------------------------------------------
+// Looks up a variable for the ShaderParam setters, which
+// then skip the search.  Worth it for anything set every
+// draw.  Check IsValid() for whether the variable exists.
+// --------------------------------------------------------
+ShaderParam ISimpleShader::GetParam(ShaderName name)
+{
+	ShaderParam param;
+	const SimpleShaderVariable* var = FindVariable(name, -1);
+	if (var == 0 || constantBuffers[var->ConstantBufferIndex].External)
+	{
+		if (ReportWarnings)
+		{
+			LogWarning("SimpleShader::GetParam() - Shader variable '");
+			Log(name.Name);
+			LogWarning("' not found, or is in an external constant buffer. Ensure the name is spelled correctly and that it exists in one of the shader's own constant buffers.\n");
+		}
+		return param;
+	}
+
+	param.Owner = this;
+	param.ConstantBufferIndex = var->ConstantBufferIndex;
+	param.ByteOffset = var->ByteOffset;
+	param.Size = var->Size;
+	return param;
+}
+
+// --------------------------------------------------------
+// Sets a variable looked up with GetParam() with arbitrary
+// data of the specified size
+//
+// Returns false if the param is invalid, came from another
+// shader or is too small for the data
+// --------------------------------------------------------
+bool ISimpleShader::SetData(const ShaderParam& param, const void* data, unsigned int size)
+{
+	if (param.Owner != this || size > param.Size)
+		return false;
+
+	WriteBufferData(constantBuffers[param.ConstantBufferIndex], param.ByteOffset, data, size);
+	return true;
+}
+
+// --------------------------------------------------------
+// Typed versions of the above, one per kind of variable
+// --------------------------------------------------------
+bool ISimpleShader::SetInt(const ShaderParam& param, int data) { return this->SetData(param, &data, sizeof(int)); }
+bool ISimpleShader::SetFloat(const ShaderParam& param, float data) { return this->SetData(param, &data, sizeof(float)); }
+bool ISimpleShader::SetFloat2(const ShaderParam& param, const DirectX::XMFLOAT2 data) { return this->SetData(param, &data, sizeof(float) * 2); }
+bool ISimpleShader::SetFloat3(const ShaderParam& param, const DirectX::XMFLOAT3 data) { return this->SetData(param, &data, sizeof(float) * 3); }
+bool ISimpleShader::SetFloat4(const ShaderParam& param, const DirectX::XMFLOAT4 data) { return this->SetData(param, &data, sizeof(float) * 4); }
+bool ISimpleShader::SetMatrix4x4(const ShaderParam& param, const DirectX::XMFLOAT4X4& data) { return this->SetData(param, &data, sizeof(float) * 16); }
+
 // --------------------------------------------------------
 // Determines if the shader contains the specified
 // variable within one of its constant buffers
 // --------------------------------------------------------
-bool ISimpleShader::HasVariable(std::string name)
+bool ISimpleShader::HasVariable(ShaderName name)
 {
 	return FindVariable(name, -1) != 0;
 }
@@ -563,7 +747,7 @@ bool ISimpleShader::HasSamplerState(std::string name)
 // --------------------------------------------------------
 // Gets info about a shader variable, if it exists
 // --------------------------------------------------------
-const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
+const SimpleShaderVariable* ISimpleShader::GetVariableInfo(ShaderName name)
 {
 	return FindVariable(name, -1);
 }
@@ -575,16 +759,12 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 // --------------------------------------------------------
 const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
 {
-	// Look for the key
-	std::unordered_map<std::string, SimpleSRV*>::iterator result =
-		textureTable.find(name);
-
-	// Did we find the key?
-	if (result == textureTable.end())
+	if (!reflection)
 		return 0;
 
-	// Success
-	return result->second;
+	// Look for the name
+	const ShaderReflectionTexture* texture = reflection->FindTexture(ShaderName(name));
+	return texture ? &texture->Texture : 0;
 }
 
 
@@ -596,10 +776,18 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
 const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 {
 	// Valid index?
-	if (index >= shaderResourceViews.size()) return 0;
+	if (index >= GetShaderResourceViewCount()) return 0;
 
 	// Grab the bind index
-	return shaderResourceViews[index];
+	return &reflection->GetTextures()[index].Texture;
+}
+
+// --------------------------------------------------------
+// Gets the number of SRVs in the shader
+// --------------------------------------------------------
+size_t ISimpleShader::GetShaderResourceViewCount()
+{
+	return reflection ? reflection->GetTextureCount() : 0;
 }
 
 
@@ -610,16 +798,12 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 // --------------------------------------------------------
 const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
 {
-	// Look for the key
-	std::unordered_map<std::string, SimpleSampler*>::iterator result =
-		samplerTable.find(name);
-
-	// Did we find the key?
-	if (result == samplerTable.end())
+	if (!reflection)
 		return 0;
 
-	// Success
-	return result->second;
+	// Look for the name
+	const ShaderReflectionSampler* sampler = reflection->FindSampler(ShaderName(name));
+	return sampler ? &sampler->Sampler : 0;
 }
 
 // --------------------------------------------------------
@@ -630,10 +814,18 @@ const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
 const SimpleSampler* ISimpleShader::GetSamplerInfo(unsigned int index)
 {
 	// Valid index?
-	if (index >= samplerStates.size()) return 0;
+	if (index >= GetSamplerCount()) return 0;
 
 	// Grab the bind index
-	return samplerStates[index];
+	return &reflection->GetSamplers()[index].Sampler;
+}
+
+// --------------------------------------------------------
+// Gets the number of samplers in the shader
+// --------------------------------------------------------
+size_t ISimpleShader::GetSamplerCount()
+{
+	return reflection ? reflection->GetSamplerCount() : 0;
 }
 
 
@@ -767,40 +959,23 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 		return true;
 
 	// Vertex shader was created successfully, so we now use the
-	// shader code to re-reflect and create an input layout that 
-	// matches what the vertex shader expects.  Code adapted from:
+	// input signature from its reflection to create an input layout
+	// that matches what the vertex shader expects.  Code adapted from:
 	// https://takinginitiative.wordpress.com/2011/12/11/directx-1011-basic-shader-reflection-automatic-input-layout-creation/
 
-	// Reflect shader info
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-	
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
-	// Read input layout description from shader info
+	// Read input layout description from the signature (the names point
+	// into the reflection, which outlives the CreateInputLayout() call)
 	std::vector<D3D11_INPUT_ELEMENT_DESC> inputLayoutDesc;
-	for (unsigned int i = 0; i< shaderDesc.InputParameters; i++)
+	for (unsigned int i = 0; i < reflection->GetInputCount(); i++)
 	{
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetInputParameterDesc(i, &paramDesc);
+		const ShaderReflectionParameter& paramDesc = reflection->GetInputs()[i];
 
-		// Check the semantic name for "_PER_INSTANCE"
-		std::string perInstanceStr = "_PER_INSTANCE";
-		std::string sem = paramDesc.SemanticName;
-		int lenDiff = (int)sem.size() - (int)perInstanceStr.size();
-		bool isPerInstance = 
-			lenDiff >= 0 &&
-			sem.compare(lenDiff, perInstanceStr.size(), perInstanceStr) == 0;
+		// Was the semantic name marked "_PER_INSTANCE"?
+		bool isPerInstance = paramDesc.PerInstance != 0;
 
 		// Fill out input element desc
 		D3D11_INPUT_ELEMENT_DESC elementDesc = {};
-		elementDesc.SemanticName = paramDesc.SemanticName;
+		elementDesc.SemanticName = reflection->GetName(paramDesc.NameOffset);
 		elementDesc.SemanticIndex = paramDesc.SemanticIndex;
 		elementDesc.InputSlot = 0;
 		elementDesc.AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
@@ -849,7 +1024,7 @@ bool SimpleVertexShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlo
 
 	// Try to create Input Layout
 	HRESULT hr = device->CreateInputLayout(
-		&inputLayoutDesc[0], 
+		inputLayoutDesc.data(), 
 		(unsigned int)inputLayoutDesc.size(), 
 		shaderBlob->GetBufferPointer(), 
 		shaderBlob->GetBufferSize(),
@@ -875,15 +1050,31 @@ void SimpleVertexShader::SetShaderAndCBs()
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
+		// Skip "buffers" that aren't true constant buffers, and
+		// the ones bound by whatever owns them
+		if (constantBuffers[i].Type != D3D11_CT_CBUFFER || constantBuffers[i].External)
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->VSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(constantBuffers[i]);
+	}
+}
+
+// --------------------------------------------------------
+// Binds one constant buffer, or its slice of the dynamic
+// constant buffer, to the vertex shader stage
+// --------------------------------------------------------
+void SimpleVertexShader::BindConstantBuffer(const SimpleConstantBuffer& cb)
+{
+	if (IsInDynamicBuffer(cb))
+	{
+		UINT firstConstant = cb.Slice.GetFirstConstant();
+		UINT constantCount = cb.Slice.GetConstantCount();
+		dynamicContext->VSSetConstantBuffers1(cb.BindIndex, 1, dynamicBuffer.GetAddressOf(), &firstConstant, &constantCount);
+	}
+	else
+	{
+		deviceContext->VSSetConstantBuffers(cb.BindIndex, 1, cb.ConstantBuffer.GetAddressOf());
 	}
 }
 
@@ -1017,15 +1208,31 @@ void SimplePixelShader::SetShaderAndCBs()
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
+		// Skip "buffers" that aren't true constant buffers, and
+		// the ones bound by whatever owns them
+		if (constantBuffers[i].Type != D3D11_CT_CBUFFER || constantBuffers[i].External)
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->PSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(constantBuffers[i]);
+	}
+}
+
+// --------------------------------------------------------
+// Binds one constant buffer, or its slice of the dynamic
+// constant buffer, to the pixel shader stage
+// --------------------------------------------------------
+void SimplePixelShader::BindConstantBuffer(const SimpleConstantBuffer& cb)
+{
+	if (IsInDynamicBuffer(cb))
+	{
+		UINT firstConstant = cb.Slice.GetFirstConstant();
+		UINT constantCount = cb.Slice.GetConstantCount();
+		dynamicContext->PSSetConstantBuffers1(cb.BindIndex, 1, dynamicBuffer.GetAddressOf(), &firstConstant, &constantCount);
+	}
+	else
+	{
+		deviceContext->PSSetConstantBuffers(cb.BindIndex, 1, cb.ConstantBuffer.GetAddressOf());
 	}
 }
 
@@ -1161,15 +1368,31 @@ void SimpleDomainShader::SetShaderAndCBs()
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
+		// Skip "buffers" that aren't true constant buffers, and
+		// the ones bound by whatever owns them
+		if (constantBuffers[i].Type != D3D11_CT_CBUFFER || constantBuffers[i].External)
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->DSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(constantBuffers[i]);
+	}
+}
+
+// --------------------------------------------------------
+// Binds one constant buffer, or its slice of the dynamic
+// constant buffer, to the domain shader stage
+// --------------------------------------------------------
+void SimpleDomainShader::BindConstantBuffer(const SimpleConstantBuffer& cb)
+{
+	if (IsInDynamicBuffer(cb))
+	{
+		UINT firstConstant = cb.Slice.GetFirstConstant();
+		UINT constantCount = cb.Slice.GetConstantCount();
+		dynamicContext->DSSetConstantBuffers1(cb.BindIndex, 1, dynamicBuffer.GetAddressOf(), &firstConstant, &constantCount);
+	}
+	else
+	{
+		deviceContext->DSSetConstantBuffers(cb.BindIndex, 1, cb.ConstantBuffer.GetAddressOf());
 	}
 }
 
@@ -1304,15 +1527,31 @@ void SimpleHullShader::SetShaderAndCBs()
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
+		// Skip "buffers" that aren't true constant buffers, and
+		// the ones bound by whatever owns them
+		if (constantBuffers[i].Type != D3D11_CT_CBUFFER || constantBuffers[i].External)
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->HSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(constantBuffers[i]);
+	}
+}
+
+// --------------------------------------------------------
+// Binds one constant buffer, or its slice of the dynamic
+// constant buffer, to the hull shader stage
+// --------------------------------------------------------
+void SimpleHullShader::BindConstantBuffer(const SimpleConstantBuffer& cb)
+{
+	if (IsInDynamicBuffer(cb))
+	{
+		UINT firstConstant = cb.Slice.GetFirstConstant();
+		UINT constantCount = cb.Slice.GetConstantCount();
+		dynamicContext->HSSetConstantBuffers1(cb.BindIndex, 1, dynamicBuffer.GetAddressOf(), &firstConstant, &constantCount);
+	}
+	else
+	{
+		deviceContext->HSSetConstantBuffers(cb.BindIndex, 1, cb.ConstantBuffer.GetAddressOf());
 	}
 }
 
@@ -1455,31 +1694,18 @@ bool SimpleGeometryShader::CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3D
 	// called more than once on the same object
 	this->CleanUp();
 
-	// Reflect shader info
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
-
-	// Get shader info
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-
-	// Set up the output signature
+	// Set up the output signature, from the reflection
 	streamOutVertexSize = 0;
 	std::vector<D3D11_SO_DECLARATION_ENTRY> soDecl;
-	for (unsigned int i = 0; i < shaderDesc.OutputParameters; i++)
+	for (unsigned int i = 0; i < reflection->GetOutputCount(); i++)
 	{
 		// Get the info about this entry
-		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
-		refl->GetOutputParameterDesc(i, &paramDesc);
+		const ShaderReflectionParameter& paramDesc = reflection->GetOutputs()[i];
 		
 		// Create the SO Declaration
 		D3D11_SO_DECLARATION_ENTRY entry = {};
 		entry.SemanticIndex  = paramDesc.SemanticIndex;
-		entry.SemanticName   = paramDesc.SemanticName;
+		entry.SemanticName   = reflection->GetName(paramDesc.NameOffset);
 		entry.Stream         = paramDesc.Stream;
 		entry.StartComponent = 0; // Assume starting at 0
 		entry.OutputSlot     = 0; // Assume the first output slot
@@ -1501,7 +1727,7 @@ bool SimpleGeometryShader::CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3D
 	HRESULT result = device->CreateGeometryShaderWithStreamOutput(
 		shaderBlob->GetBufferPointer(), // Shader blob pointer
 		shaderBlob->GetBufferSize(),    // Shader blob size
-		&soDecl[0],                     // Stream out declaration
+		soDecl.data(),                  // Stream out declaration
 		(unsigned int)soDecl.size(),    // Number of declaration entries
 		NULL,                           // Buffer strides (not used - assume tightly packed?)
 		0,                              // No buffer strides
@@ -1578,15 +1804,31 @@ void SimpleGeometryShader::SetShaderAndCBs()
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
+		// Skip "buffers" that aren't true constant buffers, and
+		// the ones bound by whatever owns them
+		if (constantBuffers[i].Type != D3D11_CT_CBUFFER || constantBuffers[i].External)
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->GSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(constantBuffers[i]);
+	}
+}
+
+// --------------------------------------------------------
+// Binds one constant buffer, or its slice of the dynamic
+// constant buffer, to the geometry shader stage
+// --------------------------------------------------------
+void SimpleGeometryShader::BindConstantBuffer(const SimpleConstantBuffer& cb)
+{
+	if (IsInDynamicBuffer(cb))
+	{
+		UINT firstConstant = cb.Slice.GetFirstConstant();
+		UINT constantCount = cb.Slice.GetConstantCount();
+		dynamicContext->GSSetConstantBuffers1(cb.BindIndex, 1, dynamicBuffer.GetAddressOf(), &firstConstant, &constantCount);
+	}
+	else
+	{
+		deviceContext->GSSetConstantBuffers(cb.BindIndex, 1, cb.ConstantBuffer.GetAddressOf());
 	}
 }
 
@@ -1730,43 +1972,18 @@ bool SimpleComputeShader::CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBl
 	if (result != S_OK)
 		return false;
 
-	// Set up shader reflection to get information about UAV's
-	Microsoft::WRL::ComPtr<ID3D11ShaderReflection> refl;
-	D3DReflect(
-		shaderBlob->GetBufferPointer(),
-		shaderBlob->GetBufferSize(),
-		IID_ID3D11ShaderReflection,
-		(void**)refl.GetAddressOf());
+	// Grab the thread info from the reflection
+	const uint32_t* threadGroupSize = reflection->GetThreadGroupSize();
+	threadsX = threadGroupSize[0];
+	threadsY = threadGroupSize[1];
+	threadsZ = threadGroupSize[2];
+	threadsTotal = threadsX * threadsY * threadsZ;
 
-	// Get the description of the shader
-	D3D11_SHADER_DESC shaderDesc;
-	refl->GetDesc(&shaderDesc);
-	
-	// Grab the thread info
-	threadsTotal = refl->GetThreadGroupSize(
-		&threadsX,
-		&threadsY,
-		&threadsZ);
-
-	// Loop and get all UAV resources
-	unsigned int resourceCount = shaderDesc.BoundResources;
-	for (unsigned int r = 0; r < resourceCount; r++)
+	// And all of the UAV resources
+	for (unsigned int u = 0; u < reflection->GetUavCount(); u++)
 	{
-		// Get this resource's description
-		D3D11_SHADER_INPUT_BIND_DESC resourceDesc;
-		refl->GetResourceBindingDesc(r, &resourceDesc);
-
-		// Check the type, looking for any kind of UAV
-		switch (resourceDesc.Type)
-		{
-		case D3D_SIT_UAV_APPEND_STRUCTURED:
-		case D3D_SIT_UAV_CONSUME_STRUCTURED:
-		case D3D_SIT_UAV_RWBYTEADDRESS:
-		case D3D_SIT_UAV_RWSTRUCTURED:
-		case D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER:
-		case D3D_SIT_UAV_RWTYPED:
-			uavTable.insert(std::pair<std::string, unsigned int>(resourceDesc.Name, resourceDesc.BindPoint));
-		}
+		const ShaderReflectionUav& uav = reflection->GetUavs()[u];
+		uavTable.insert(std::pair<std::string, unsigned int>(reflection->GetName(uav.NameOffset), uav.BindIndex));
 	}
 
 	// All set
@@ -1788,15 +2005,31 @@ void SimpleComputeShader::SetShaderAndCBs()
 	// Set the constant buffers?
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		// Skip "buffers" that aren't true constant buffers
-		if (constantBuffers[i].Type != D3D11_CT_CBUFFER)
+		// Skip "buffers" that aren't true constant buffers, and
+		// the ones bound by whatever owns them
+		if (constantBuffers[i].Type != D3D11_CT_CBUFFER || constantBuffers[i].External)
 			continue;
 
 		// This is a real constant buffer, so set it
-		deviceContext->CSSetConstantBuffers(
-			constantBuffers[i].BindIndex,
-			1,
-			constantBuffers[i].ConstantBuffer.GetAddressOf());
+		BindConstantBuffer(constantBuffers[i]);
+	}
+}
+
+// --------------------------------------------------------
+// Binds one constant buffer, or its slice of the dynamic
+// constant buffer, to the compute shader stage
+// --------------------------------------------------------
+void SimpleComputeShader::BindConstantBuffer(const SimpleConstantBuffer& cb)
+{
+	if (IsInDynamicBuffer(cb))
+	{
+		UINT firstConstant = cb.Slice.GetFirstConstant();
+		UINT constantCount = cb.Slice.GetConstantCount();
+		dynamicContext->CSSetConstantBuffers1(cb.BindIndex, 1, dynamicBuffer.GetAddressOf(), &firstConstant, &constantCount);
+	}
+	else
+	{
+		deviceContext->CSSetConstantBuffers(cb.BindIndex, 1, cb.ConstantBuffer.GetAddressOf());
 	}
 }
 
@@ -1967,4 +2200,168 @@ int SimpleComputeShader::GetUnorderedAccessViewIndex(std::string name)
 
 	// Success
 	return result->second;
-}
\ No newline at end of file
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ SIMPLE SHARED BUFFER ------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+// --------------------------------------------------------
+// Constructor takes the layout of the named buffer from a
+// shader that declares it, and creates the buffer itself
+//
+// declaringShader - A loaded shader with this buffer
+// bufferName - The name of the cbuffer in the shader
+// --------------------------------------------------------
+SimpleSharedBuffer::SimpleSharedBuffer(std::shared_ptr<ISimpleShader> declaringShader, std::string bufferName)
+{
+	this->declaringShader = declaringShader;
+	this->deviceContext = declaringShader->deviceContext;
+
+	// Find the buffer in the shader
+	SimpleConstantBuffer* declared = declaringShader->FindConstantBuffer(bufferName);
+	if (!declared)
+	{
+		if (ISimpleShader::ReportErrors)
+		{
+			declaringShader->LogError("SimpleSharedBuffer - Constant buffer '");
+			declaringShader->Log(bufferName);
+			declaringShader->LogError("' not found in the declaring shader. Ensure the shader uses at least one of its variables, or it will be compiled out.\n");
+		}
+		return;
+	}
+	this->declaredIndex = (unsigned int)(declared - declaringShader->constantBuffers);
+
+	// Same setup as a shader's own buffers
+	this->buffer.Name = declared->Name;
+	this->buffer.Type = declared->Type;
+	this->buffer.Size = declared->Size;
+	this->buffer.BindIndex = declared->BindIndex;
+	this->buffer.Variables = declared->Variables;
+	this->buffer.VariableCount = declared->VariableCount;
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.ByteWidth = ((declared->Size + 15) / 16) * 16;
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	declaringShader->device->CreateBuffer(&desc, 0, this->buffer.ConstantBuffer.GetAddressOf());
+
+	this->buffer.LocalDataBuffer = new unsigned char[declared->Size];
+	ZeroMemory(this->buffer.LocalDataBuffer, declared->Size);
+	this->buffer.DirtyStart = 0;
+	this->buffer.DirtyEnd = declared->Size;
+}
+
+// --------------------------------------------------------
+// Destructor
+// --------------------------------------------------------
+SimpleSharedBuffer::~SimpleSharedBuffer()
+{
+	delete[] this->buffer.LocalDataBuffer;
+}
+
+// --------------------------------------------------------
+// Copies the local data to the buffer if it changed since
+// the last copy
+// --------------------------------------------------------
+void SimpleSharedBuffer::CopyBufferData()
+{
+	if (IsValid())
+		ISimpleShader::UploadBufferData(this->deviceContext.Get(), this->buffer);
+}
+
+// --------------------------------------------------------
+// Binds the buffer (or its slice of the dynamic constant
+// buffer) for the vertex and pixel shader stages.  It stays
+// bound across shader changes, so this is needed once per
+// pass (or per material or object) rather than once per
+// shader.
+// --------------------------------------------------------
+void SimpleSharedBuffer::Bind()
+{
+	if (!IsValid()) return;
+
+	if (ISimpleShader::IsInDynamicBuffer(this->buffer))
+	{
+		UINT firstConstant = this->buffer.Slice.GetFirstConstant();
+		UINT constantCount = this->buffer.Slice.GetConstantCount();
+		ID3D11Buffer* dynamicBuffer = ISimpleShader::dynamicBuffer.Get();
+		ISimpleShader::dynamicContext->VSSetConstantBuffers1(this->buffer.BindIndex, 1, &dynamicBuffer, &firstConstant, &constantCount);
+		ISimpleShader::dynamicContext->PSSetConstantBuffers1(this->buffer.BindIndex, 1, &dynamicBuffer, &firstConstant, &constantCount);
+		return;
+	}
+
+	this->deviceContext->VSSetConstantBuffers(this->buffer.BindIndex, 1, this->buffer.ConstantBuffer.GetAddressOf());
+	this->deviceContext->PSSetConstantBuffers(this->buffer.BindIndex, 1, this->buffer.ConstantBuffer.GetAddressOf());
+}
+
+// --------------------------------------------------------
+// Looks up a variable in this buffer for the ShaderParam
+// setters.  Check IsValid() for whether it exists.
+// --------------------------------------------------------
+ShaderParam SimpleSharedBuffer::GetParam(ShaderName name)
+{
+	ShaderParam param;
+	if (!IsValid())
+		return param;
+
+	const SimpleShaderVariable* var = this->declaringShader->GetVariableInfo(name);
+	if (var == 0 || var->ConstantBufferIndex != this->declaredIndex)
+	{
+		if (ISimpleShader::ReportWarnings)
+		{
+			this->declaringShader->LogWarning("SimpleSharedBuffer::GetParam() - Variable '");
+			this->declaringShader->Log(name.Name);
+			this->declaringShader->LogWarning("' not found in shared buffer '");
+			this->declaringShader->Log(this->buffer.Name);
+			this->declaringShader->LogWarning("'.\n");
+		}
+		return param;
+	}
+
+	param.Owner = this;
+	param.ByteOffset = var->ByteOffset;
+	param.Size = var->Size;
+	return param;
+}
+
+// --------------------------------------------------------
+// Sets a variable by handle with arbitrary data of the
+// specified size
+//
+// Returns false if the param is invalid, came from
+// elsewhere or is too small for the data
+// --------------------------------------------------------
+bool SimpleSharedBuffer::SetData(const ShaderParam& param, const void* data, unsigned int size)
+{
+	if (param.Owner != this || size > param.Size)
+		return false;
+
+	ISimpleShader::WriteBufferData(this->buffer, param.ByteOffset, data, size);
+	return true;
+}
+
+// --------------------------------------------------------
+// Sets a variable by name, through a lookup each time
+// --------------------------------------------------------
+bool SimpleSharedBuffer::SetData(ShaderName name, const void* data, unsigned int size)
+{
+	return this->SetData(this->GetParam(name), data, size);
+}
+
+// --------------------------------------------------------
+// Typed versions of the above, one per kind of variable
+// --------------------------------------------------------
+bool SimpleSharedBuffer::SetInt(ShaderName name, int data) { return this->SetData(name, &data, sizeof(int)); }
+bool SimpleSharedBuffer::SetFloat(ShaderName name, float data) { return this->SetData(name, &data, sizeof(float)); }
+bool SimpleSharedBuffer::SetFloat3(ShaderName name, const DirectX::XMFLOAT3 data) { return this->SetData(name, &data, sizeof(float) * 3); }
+bool SimpleSharedBuffer::SetFloat4(ShaderName name, const DirectX::XMFLOAT4 data) { return this->SetData(name, &data, sizeof(float) * 4); }
+bool SimpleSharedBuffer::SetMatrix4x4(ShaderName name, const DirectX::XMFLOAT4X4& data) { return this->SetData(name, &data, sizeof(float) * 16); }
+
+bool SimpleSharedBuffer::SetInt(const ShaderParam& param, int data) { return this->SetData(param, &data, sizeof(int)); }
+bool SimpleSharedBuffer::SetFloat(const ShaderParam& param, float data) { return this->SetData(param, &data, sizeof(float)); }
+bool SimpleSharedBuffer::SetFloat3(const ShaderParam& param, const DirectX::XMFLOAT3 data) { return this->SetData(param, &data, sizeof(float) * 3); }
+bool SimpleSharedBuffer::SetFloat4(const ShaderParam& param, const DirectX::XMFLOAT4 data) { return this->SetData(param, &data, sizeof(float) * 4); }
+bool SimpleSharedBuffer::SetMatrix4x4(const ShaderParam& param, const DirectX::XMFLOAT4X4& data) { return this->SetData(param, &data, sizeof(float) * 16); }
@@ -2,15 +2,22 @@
 #pragma comment(lib, "dxguid.lib")
 #pragma comment(lib, "d3dcompiler.lib")
 
-#include <d3d11.h>
+#include <d3d11_1.h>
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
 #include <wrl/client.h>
 
+#include <cstdint>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include <string>
 
+#include "LinearConstantAllocator.h"
+
+// Starting size of the dynamic constant buffer, per frame (see
+// ISimpleShader::EnableDynamicConstants())
+#define SIMPLE_SHADER_DYNAMIC_CONSTANT_BYTES (256 * 1024)
 
 // --------------------------------------------------------
 // Used by simple shaders to store information about
@@ -23,6 +30,56 @@ struct SimpleShaderVariable
 	unsigned int ConstantBufferIndex;
 };
 
+// --------------------------------------------------------
+// 32-bit FNV-1a hash of a variable name.  It's constexpr,
+// so names written as literals hash at compile time.
+// --------------------------------------------------------
+constexpr uint32_t HashShaderName(const char* name)
+{
+	uint32_t hash = 2166136261u;
+	while (*name)
+		hash = (hash ^ (unsigned char)*name++) * 16777619u;
+	return hash;
+}
+
+// --------------------------------------------------------
+// A variable name along with its hash, which is what the
+// name lookups actually search by
+//
+// - String literals convert implicitly, hashed by the
+//   compiler, so SetFloat("roughness", ...) never builds a
+//   std::string
+// - std::strings convert too, and are hashed on the spot.
+//   This is the slow path, for names only known at runtime.
+// - Only points at the name, so it must not outlive it
+// --------------------------------------------------------
+struct ShaderName
+{
+	const char* Name;
+	uint32_t Hash;
+
+	template<size_t N>
+	constexpr ShaderName(const char (&name)[N]) : Name(name), Hash(HashShaderName(name)) {}
+	ShaderName(const std::string& name) : Name(name.c_str()), Hash(HashShaderName(name.c_str())) {}
+	explicit constexpr ShaderName(const char* name) : Name(name), Hash(HashShaderName(name)) {}
+};
+
+// --------------------------------------------------------
+// A variable looked up once, ahead of time (see
+// GetParam()), so that setting it is a copy straight to
+// its byte offset.  Only good for the shader (or shared
+// buffer) it came from.
+// --------------------------------------------------------
+struct ShaderParam
+{
+	const void* Owner = 0;				// The shader or shared buffer it was looked up in
+	unsigned int ConstantBufferIndex = 0;
+	unsigned int ByteOffset = 0;
+	unsigned int Size = 0;				// 0 if the shader has no such variable
+
+	bool IsValid() const { return Size > 0; }
+};
+
 // --------------------------------------------------------
 // Contains information about a specific
 // constant buffer in a shader, as well as
@@ -36,7 +93,37 @@ struct SimpleConstantBuffer
 	unsigned int BindIndex = 0;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBuffer = 0;
 	unsigned char* LocalDataBuffer = 0;
-	std::vector<SimpleShaderVariable> Variables;
+	const SimpleShaderVariable* Variables = 0;	// In the owning shader's reflection
+	unsigned int VariableCount = 0;
+
+	// Set for buffers named with ISimpleShader::AddExternalBuffer(), which
+	// the shader leaves alone: no ConstantBuffer, no copies and no binds
+	bool External = false;
+
+	// Bytes of LocalDataBuffer changed since the last upload, as the
+	// range [DirtyStart, DirtyEnd).  Empty once the GPU copy matches.
+	unsigned int DirtyStart = 0;
+	unsigned int DirtyEnd = 0;
+
+	bool IsDirty() const { return DirtyEnd > DirtyStart; }
+
+	// Where the data was last written in the dynamic constant buffer, if
+	// it's in use.  ConstantBuffer is left stale while the slice is set.
+	ConstantSlice Slice;
+};
+
+// --------------------------------------------------------
+// Constant buffer uploads made by every shader, and the
+// ones skipped because nothing had changed, since
+// ISimpleShader::BeginFrame()
+// --------------------------------------------------------
+struct SimpleShaderUploadStats
+{
+	unsigned int BuffersUploaded = 0;
+	unsigned int BuffersSkipped = 0;
+	size_t BytesUploaded = 0;
+	size_t BytesSkipped = 0;
+	size_t BytesChanged = 0;	// The dirty ranges of the uploaded buffers
 };
 
 // --------------------------------------------------------
@@ -57,6 +144,8 @@ struct SimpleSampler
 	unsigned int BindIndex; // The register of the Sampler
 };
 
+class ShaderReflectionCache;
+
 // --------------------------------------------------------
 // Base abstract class for simplifying shader handling
 // --------------------------------------------------------
@@ -76,38 +165,50 @@ public:
 	void CopyBufferData(std::string bufferName);
 
 	// Sets arbitrary shader data
-	bool SetData(std::string name, const void* data, unsigned int size);
-
-	bool SetInt(std::string name, int data);
-	bool SetFloat(std::string name, float data);
-	bool SetFloat2(std::string name, const float data[2]);
-	bool SetFloat2(std::string name, const DirectX::XMFLOAT2 data);
-	bool SetFloat3(std::string name, const float data[3]);
-	bool SetFloat3(std::string name, const DirectX::XMFLOAT3 data);
-	bool SetFloat4(std::string name, const float data[4]);
-	bool SetFloat4(std::string name, const DirectX::XMFLOAT4 data);
-	bool SetMatrix4x4(std::string name, const float data[16]);
-	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
+	bool SetData(ShaderName name, const void* data, unsigned int size);
+
+	bool SetInt(ShaderName name, int data);
+	bool SetFloat(ShaderName name, float data);
+	bool SetFloat2(ShaderName name, const float data[2]);
+	bool SetFloat2(ShaderName name, const DirectX::XMFLOAT2 data);
+	bool SetFloat3(ShaderName name, const float data[3]);
+	bool SetFloat3(ShaderName name, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(ShaderName name, const float data[4]);
+	bool SetFloat4(ShaderName name, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(ShaderName name, const float data[16]);
+	bool SetMatrix4x4(ShaderName name, const DirectX::XMFLOAT4X4 data);
+
+	// Looks a variable up once for the setters below, which skip the search
+	ShaderParam GetParam(ShaderName name);
+
+	bool SetData(const ShaderParam& param, const void* data, unsigned int size);
+
+	bool SetInt(const ShaderParam& param, int data);
+	bool SetFloat(const ShaderParam& param, float data);
+	bool SetFloat2(const ShaderParam& param, const DirectX::XMFLOAT2 data);
+	bool SetFloat3(const ShaderParam& param, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(const ShaderParam& param, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(const ShaderParam& param, const DirectX::XMFLOAT4X4& data);
 
 	// Setting shader resources
 	virtual bool SetShaderResourceView(std::string name, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv) = 0;
 	virtual bool SetSamplerState(std::string name, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState) = 0;
 
 	// Simple resource checking
-	bool HasVariable(std::string name);
+	bool HasVariable(ShaderName name);
 	bool HasShaderResourceView(std::string name);
 	bool HasSamplerState(std::string name);
 
 	// Getting data about variables and resources
-	const SimpleShaderVariable* GetVariableInfo(std::string name);
+	const SimpleShaderVariable* GetVariableInfo(ShaderName name);
 	
 	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
 	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
-	size_t GetShaderResourceViewCount() { return textureTable.size(); }
+	size_t GetShaderResourceViewCount();
 	
 	const SimpleSampler* GetSamplerInfo(std::string name);
 	const SimpleSampler* GetSamplerInfo(unsigned int index);
-	size_t GetSamplerCount() { return samplerTable.size(); }
+	size_t GetSamplerCount();
 
 	// Get data about constant buffers
 	unsigned int GetBufferCount();
@@ -122,8 +223,40 @@ public:
 	static bool ReportErrors;
 	static bool ReportWarnings;
 
+	// Upload counts across all shaders; call BeginFrame() once a frame.
+	// It also starts the dynamic constant buffer over, if there is one.
+	static void BeginFrame();
+	static const SimpleShaderUploadStats& GetUploadStats() { return uploadStats; }
+
+	// Changed constants go to slices of one big dynamic buffer instead,
+	// mapped with discard and then no-overwrite, and bound by offset.  Needs D3D 11.1;
+	// returns false (keeping UpdateSubresource() into each buffer) without
+	// it.  A frame that runs out finishes on the old path and the buffer
+	// doubles for the next one.  With this on, copy a shader's buffers
+	// only while it's set, since a copy may have to bind them again.
+	static bool EnableDynamicConstants(Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, unsigned int capacity = SIMPLE_SHADER_DYNAMIC_CONSTANT_BYTES);
+	static void DisableDynamicConstants();
+	static bool IsUsingDynamicConstants() { return (bool)dynamicBuffer; }
+	static const ConstantAllocatorStats& GetDynamicConstantStats() { return dynamicAllocator.GetStats(); }
+	static unsigned int GetDynamicConstantCapacity() { return dynamicAllocator.GetCapacity(); }
+
+	// Constant buffers by this name, in any shader loaded afterwards, are
+	// external: some other code (see SimpleSharedBuffer) owns, fills and
+	// binds them.  Call before loading shaders.
+	static void AddExternalBuffer(std::string bufferName);
+
 protected:
-	
+	friend class SimpleSharedBuffer;
+
+	static SimpleShaderUploadStats uploadStats;
+	static std::vector<std::string> externalBuffers;
+
+	// The dynamic constant buffer, shared by every shader
+	static Microsoft::WRL::ComPtr<ID3D11Device> dynamicDevice;
+	static Microsoft::WRL::ComPtr<ID3D11DeviceContext1> dynamicContext;
+	static Microsoft::WRL::ComPtr<ID3D11Buffer> dynamicBuffer;
+	static LinearConstantAllocator dynamicAllocator;
+
 	bool shaderValid;
 	Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
 	Microsoft::WRL::ComPtr<ID3D11Device> device;
@@ -132,14 +265,12 @@ protected:
 	// Resource counts
 	unsigned int constantBufferCount;
 	
-	// Maps for variables and buffers
-	SimpleConstantBuffer*		constantBuffers; // For index-based lookup
-	std::vector<SimpleSRV*>		shaderResourceViews;
-	std::vector<SimpleSampler*>	samplerStates;
-	std::unordered_map<std::string, SimpleConstantBuffer*> cbTable;
-	std::unordered_map<std::string, SimpleShaderVariable> varTable;
-	std::unordered_map<std::string, SimpleSRV*> textureTable;
-	std::unordered_map<std::string, SimpleSampler*> samplerTable;
+	// Constant buffers, in the order the shader declares them
+	SimpleConstantBuffer*		constantBuffers;
+
+	// Variables, textures and samplers by name, mapped from the cache
+	// next to the .cso (or reflected, the first time)
+	std::unique_ptr<ShaderReflectionCache> reflection;
 
 	// Initialization method
 	bool LoadShaderFile(LPCWSTR shaderFile);
@@ -147,13 +278,20 @@ protected:
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob) = 0;
 	virtual void SetShaderAndCBs() = 0;
+	virtual void BindConstantBuffer(const SimpleConstantBuffer& cb) = 0;
 
 	virtual void CleanUp();
 
 	// Helpers for finding data by name
-	SimpleShaderVariable* FindVariable(std::string name, int size);
+	const SimpleShaderVariable* FindVariable(ShaderName name, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
 
+	// Helpers for the local data buffers and their uploads.  An upload
+	// returns true if the data moved, and so must be bound again.
+	static void WriteBufferData(SimpleConstantBuffer& cb, unsigned int offset, const void* data, unsigned int size);
+	static bool UploadBufferData(ID3D11DeviceContext* context, SimpleConstantBuffer& cb);
+	static bool IsInDynamicBuffer(const SimpleConstantBuffer& cb) { return dynamicBuffer && dynamicAllocator.IsCurrent(cb.Slice); }
+
 	// Error logging
 	void Log(std::string message, WORD color);
 	void LogW(std::wstring message, WORD color);
@@ -187,6 +325,7 @@ protected:
 	 Microsoft::WRL::ComPtr<ID3D11VertexShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(const SimpleConstantBuffer& cb);
 	void CleanUp();
 };
 
@@ -208,6 +347,7 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(const SimpleConstantBuffer& cb);
 	void CleanUp();
 };
 
@@ -228,6 +368,7 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11DomainShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(const SimpleConstantBuffer& cb);
 	void CleanUp();
 };
 
@@ -248,6 +389,7 @@ protected:
 	Microsoft::WRL::ComPtr<ID3D11HullShader> shader;
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(const SimpleConstantBuffer& cb);
 	void CleanUp();
 };
 
@@ -280,6 +422,7 @@ protected:
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	bool CreateShaderWithStreamOut(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(const SimpleConstantBuffer& cb);
 	void CleanUp();
 
 	// Helpers
@@ -319,5 +462,62 @@ protected:
 
 	bool CreateShader(Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob);
 	void SetShaderAndCBs();
+	void BindConstantBuffer(const SimpleConstantBuffer& cb);
 	void CleanUp();
-};
\ No newline at end of file
+};
+// --------------------------------------------------------
+// A constant buffer that lives outside any one shader,
+// for data that changes at its own rate: once a frame,
+// once a pass, or with a material or an object
+//
+// - Every shader that reads it declares it the same way
+//   (same name, register and layout), and registers the
+//   name with ISimpleShader::AddExternalBuffer() so they
+//   leave it to this class
+// - Its layout comes from any one of those shaders
+// - Uploads are skipped while nothing changes, like a
+//   shader's own buffers, and count toward the same stats
+// --------------------------------------------------------
+class SimpleSharedBuffer
+{
+public:
+	SimpleSharedBuffer(std::shared_ptr<ISimpleShader> declaringShader, std::string bufferName);
+	~SimpleSharedBuffer();
+
+	// Owns (and frees) its local copy of the data, so it can't be copied
+	SimpleSharedBuffer(const SimpleSharedBuffer&) = delete;
+	SimpleSharedBuffer& operator=(const SimpleSharedBuffer&) = delete;
+
+	bool IsValid() { return this->buffer.LocalDataBuffer != 0; }
+	unsigned int GetBindIndex() { return this->buffer.BindIndex; }
+	unsigned int GetSize() { return this->buffer.Size; }
+
+	// Copies the data to the GPU if it changed since the last copy
+	void CopyBufferData();
+
+	// Binds the buffer at its register for the vertex and pixel shader stages
+	void Bind();
+
+	// Setting data, by name or by a handle from GetParam()
+	ShaderParam GetParam(ShaderName name);
+
+	bool SetData(ShaderName name, const void* data, unsigned int size);
+	bool SetInt(ShaderName name, int data);
+	bool SetFloat(ShaderName name, float data);
+	bool SetFloat3(ShaderName name, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(ShaderName name, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(ShaderName name, const DirectX::XMFLOAT4X4& data);
+
+	bool SetData(const ShaderParam& param, const void* data, unsigned int size);
+	bool SetInt(const ShaderParam& param, int data);
+	bool SetFloat(const ShaderParam& param, float data);
+	bool SetFloat3(const ShaderParam& param, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(const ShaderParam& param, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(const ShaderParam& param, const DirectX::XMFLOAT4X4& data);
+
+private:
+	std::shared_ptr<ISimpleShader> declaringShader;	// Kept for its variable table
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> deviceContext;
+	SimpleConstantBuffer buffer;
+	unsigned int declaredIndex = 0;		// The buffer's index in declaringShader
+};
@@ -6,6 +6,7 @@ using namespace DirectX;
 Sky::Sky(std::shared_ptr<Mesh> mesh, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerOptions,
 	Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context,
 	std::shared_ptr<SimplePixelShader> pixelShader, std::shared_ptr<SimpleVertexShader> vertexShader,
+	std::shared_ptr<SimpleVertexShader> compactVertexShader,
 	const wchar_t* right, const wchar_t* left, const wchar_t* up, const wchar_t* down, const wchar_t* front, const wchar_t* back)
 {
 	this->mesh = mesh;
@@ -14,6 +15,7 @@ Sky::Sky(std::shared_ptr<Mesh> mesh, Microsoft::WRL::ComPtr<ID3D11SamplerState>
 	this->context = context;
 	this->skyPixelShader = pixelShader;
 	this->skyVertexShader = vertexShader;
+	this->skyCompactVertexShader = compactVertexShader;
 
 	D3D11_RASTERIZER_DESC rasterizerDesc = {};
 	rasterizerDesc.FillMode = D3D11_FILL_SOLID;
@@ -30,21 +32,27 @@ Sky::Sky(std::shared_ptr<Mesh> mesh, Microsoft::WRL::ComPtr<ID3D11SamplerState>
 	this->cubeMapSRV = CreateCubemap(right, left, up, down, front, back);
 }
 
+void Sky::SetMesh(std::shared_ptr<Mesh> newMesh)
+{
+	this->mesh = newMesh;
+}
+
 void Sky::Draw(std::shared_ptr<Camera> camera)
 {
 	this->context->RSSetState(this->rasterizerOptions.Get());
 	this->context->OMSetDepthStencilState(this->depthBufferComparisonType.Get(), 0);
 
-	this->skyVertexShader->SetShader();
-	this->skyVertexShader->SetMatrix4x4("view", camera->GetView());
-	this->skyVertexShader->SetMatrix4x4("projection", camera->GetProjection());
+	std::shared_ptr<SimpleVertexShader> vertexShader = this->mesh->PrepareVertexShader(this->skyVertexShader, this->skyCompactVertexShader);
+	vertexShader->SetShader();
+	// The camera's view and projection come from the main pass's PerPass
+	// buffer, which is still bound
 
 	this->skyPixelShader->SetShader();
 	this->skyPixelShader->SetSamplerState("BasicSampler", this->samplerOptions);
 	this->skyPixelShader->SetShaderResourceView("SkyTexture", this->cubeMapSRV);
 
 	this->skyPixelShader->CopyAllBufferData();
-	this->skyVertexShader->CopyAllBufferData();
+	vertexShader->CopyAllBufferData();
 
 	this->mesh->Draw(this->context);
 
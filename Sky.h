@@ -14,9 +14,11 @@ public:
 	Sky(std::shared_ptr<Mesh> mesh, Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerOptions, 
 		Microsoft::WRL::ComPtr<ID3D11Device> device, Microsoft::WRL::ComPtr<ID3D11DeviceContext> context, 
 		std::shared_ptr<SimplePixelShader> pixelShader, std::shared_ptr<SimpleVertexShader> vertexShader,
+		std::shared_ptr<SimpleVertexShader> compactVertexShader,
 		const wchar_t* right, const wchar_t* left, const wchar_t* up, const wchar_t* down, const wchar_t* front, const wchar_t* back);
 
 	void Draw(std::shared_ptr<Camera> camera);
+	void SetMesh(std::shared_ptr<Mesh> newMesh);
 
 	// --------------------------------------------------------
 	// Author: Chris Cascioli
@@ -50,5 +52,6 @@ private:
 	std::shared_ptr<Mesh> mesh;
 	std::shared_ptr<SimplePixelShader> skyPixelShader;
 	std::shared_ptr<SimpleVertexShader> skyVertexShader;
+	std::shared_ptr<SimpleVertexShader> skyCompactVertexShader;
 };
 
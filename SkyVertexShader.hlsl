@@ -1,13 +1,11 @@
 #include "ShaderIncludes.hlsli"
 
-cbuffer ExternalData : register(b0)
-{
-	matrix view;
-	matrix projection;
-}
+// view and projection are the camera's, from the PerPass buffer
 
-VertexToPixelSky main(VertexShaderInput input)
+VertexToPixelSky main(MeshVertexInput meshInput)
 {
+	VertexShaderInput input = UnpackVertex(meshInput);
+
 	// Set up output struct
 	VertexToPixelSky output;
 
@@ -0,0 +1,3 @@
+// Same as SkyVertexShader.hlsl, but reads the CompactVertex layout
+#define COMPACT_VERTEX_INPUT
+#include "SkyVertexShader.hlsl"
@@ -0,0 +1,296 @@
+#include "TangentGeneration.h"
+#include "WorkerPool.h"
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Below this many triangles a single thread finishes before the
+	// others would have woken up
+	const size_t MinimumTrianglesPerChunk = 16 * 1024;
+
+	// A triangle's tangent, headed for a vertex in another chunk's range
+	struct Spill
+	{
+		unsigned int Range;
+		unsigned int Index;
+		XMFLOAT4 Tangent;
+	};
+
+	// Finds which range a vertex belongs to
+	unsigned int FindRange(const std::vector<size_t>& rangeStart, unsigned int index)
+	{
+		return (unsigned int)(std::upper_bound(rangeStart.begin(), rangeStart.end(), (size_t)index) - rangeStart.begin()) - 1;
+	}
+
+	// --------------------------------------------------------
+	// Tangents of triangles [first, last), four per iteration,
+	// added to the sums of the home range's vertices and
+	// spilled for any others
+	//
+	// The w lane carries each triangle's handedness: -1 where its
+	// UVs are mirrored (wound the other way round than its
+	// positions), +1 otherwise.
+	//
+	// Each lane holds one triangle: its edges and UV deltas are
+	// gathered as vectors and transposed into x/y/z (and s/t)
+	// registers.  The operations (and their order) are the same
+	// as the scalar version, so a serial run is bit-identical.
+	//
+	// Spills can only happen when there are several ranges;
+	// checking for them costs a serial run about 20%.
+	//
+	// Sums are full, aligned float4s: adding into the 12-byte
+	// Tangent in place costs two partial stores per corner,
+	// which stalls the next load of that vertex.
+	// --------------------------------------------------------
+	template<bool CheckRange>
+	void AccumulateTangents(
+		const Vertex* vertices,
+		const unsigned int* indices,
+		size_t first,
+		size_t last,
+		const std::vector<size_t>& rangeStart,
+		unsigned int home,
+		XMFLOAT4A* sums,
+		std::vector<Spill>& spills)
+	{
+		// One unsigned compare covers both ends of the range
+		size_t rangeBegin = rangeStart[home];
+		size_t rangeSize = rangeStart[home + 1] - rangeBegin;
+
+		for (size_t t = first; t < last; t += 4)
+		{
+			XMMATRIX edges1, edges2, uvEdges;
+			for (size_t lane = 0; lane < 4; lane++)
+			{
+				// Pad the last group by repeating its final triangle
+				size_t triangle = t + lane < last ? t + lane : last - 1;
+				const Vertex& v1 = vertices[indices[triangle * 3 + 0]];
+				const Vertex& v2 = vertices[indices[triangle * 3 + 1]];
+				const Vertex& v3 = vertices[indices[triangle * 3 + 2]];
+
+				XMVECTOR p1 = XMLoadFloat3(&v1.Position);
+				edges1.r[lane] = XMLoadFloat3(&v2.Position) - p1;
+				edges2.r[lane] = XMLoadFloat3(&v3.Position) - p1;
+
+				// (s1, s2, t1, t2)
+				XMVECTOR uv1 = XMLoadFloat2(&v1.UV);
+				uvEdges.r[lane] = XMVectorMergeXY(XMLoadFloat2(&v2.UV) - uv1, XMLoadFloat2(&v3.UV) - uv1);
+			}
+
+			// One component of four triangles per register
+			edges1 = XMMatrixTranspose(edges1);
+			edges2 = XMMatrixTranspose(edges2);
+			uvEdges = XMMatrixTranspose(uvEdges);
+			XMVECTOR s1 = uvEdges.r[0];
+			XMVECTOR s2 = uvEdges.r[1];
+			XMVECTOR t1 = uvEdges.r[2];
+			XMVECTOR t2 = uvEdges.r[3];
+
+			XMVECTOR determinant = s1 * t2 - s2 * t1;
+			XMVECTOR r = XMVectorReciprocal(determinant);
+
+			XMMATRIX tangents;
+			tangents.r[0] = (t2 * edges1.r[0] - t1 * edges2.r[0]) * r;
+			tangents.r[1] = (t2 * edges1.r[1] - t1 * edges2.r[1]) * r;
+			tangents.r[2] = (t2 * edges1.r[2] - t1 * edges2.r[2]) * r;
+			tangents.r[3] = XMVectorSelect(XMVectorSplatOne(), -XMVectorSplatOne(), XMVectorLess(determinant, XMVectorZero()));
+			tangents = XMMatrixTranspose(tangents);
+
+			// Back to one triangle at a time for the scattered adds
+			for (size_t lane = 0; lane < 4 && t + lane < last; lane++)
+			{
+				const unsigned int* corners = indices + (t + lane) * 3;
+				for (int corner = 0; corner < 3; corner++)
+				{
+					unsigned int index = corners[corner];
+					if (!CheckRange || index - rangeBegin < rangeSize)
+					{
+						XMStoreFloat4A(&sums[index], XMLoadFloat4A(&sums[index]) + tangents.r[lane]);
+					}
+					else
+					{
+						Spill spill = { FindRange(rangeStart, index), index };
+						XMStoreFloat4(&spill.Tangent, tangents.r[lane]);
+						spills.push_back(spill);
+					}
+				}
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Author: Chris Cascioli (original serial version)
+// Purpose: Calculates the tangents of the vertices in a mesh
+//
+// - Code originally adapted from: http://www.terathon.com/code/tangent.html
+//   - Updated version now found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
+//   - See listing 7.4 in section 7.5 (page 9 of the PDF)
+//
+// - Be sure to call this BEFORE creating your D3D vertex/index buffers
+// --------------------------------------------------------
+void CalculateTangents(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, unsigned int chunkCount)
+{
+	if (vertexCount == 0)
+		return;
+
+	size_t triangleCount = indexCount / 3;
+	WorkerPool& pool = WorkerPool::GetInstance();
+	if (chunkCount == 0)
+	{
+		size_t bySize = triangleCount / MinimumTrianglesPerChunk + 1;
+		size_t byThreads = pool.GetThreadCount() > 1 ? (size_t)pool.GetThreadCount() * 4 : 1;
+		chunkCount = (unsigned int)(bySize < byThreads ? bySize : byThreads);
+	}
+
+	std::vector<size_t> chunkStart(chunkCount + 1);
+	for (unsigned int i = 0; i <= chunkCount; i++)
+		chunkStart[i] = triangleCount * i / chunkCount;
+
+	// Each chunk's "home" range of vertices ends past the highest index
+	// any chunk up to it uses.  With vertices in first-use order (see
+	// OptimizeVertexFetch) those are exactly the vertices a chunk
+	// introduces, so almost every corner lands at home.
+	std::vector<size_t> rangeStart(chunkCount + 1, 0);
+	rangeStart[chunkCount] = vertexCount;
+	if (chunkCount > 1)
+	{
+		std::vector<size_t> chunkEnd(chunkCount, 0);
+		pool.ParallelFor(chunkCount, [&](unsigned int chunk)
+		{
+			unsigned int highest = 0;
+			for (size_t i = chunkStart[chunk] * 3; i < chunkStart[chunk + 1] * 3; i++)
+				highest = indices[i] > highest ? indices[i] : highest;
+			chunkEnd[chunk] = (size_t)highest + 1;
+		});
+
+		size_t largestRange = 0;
+		for (unsigned int i = 1; i <= chunkCount; i++)
+		{
+			if (i < chunkCount)
+				rangeStart[i] = std::max(rangeStart[i - 1], std::min(chunkEnd[i - 1], vertexCount));
+			largestRange = std::max(largestRange, rangeStart[i] - rangeStart[i - 1]);
+		}
+
+		// Vertices in some other order would leave one thread with all the
+		// work, so split them evenly instead and live with more spills
+		if (largestRange > vertexCount * 2 / chunkCount)
+		{
+			for (unsigned int i = 0; i <= chunkCount; i++)
+				rangeStart[i] = vertexCount * i / chunkCount;
+		}
+	}
+
+	// Each chunk adds its triangles to its home range directly, and
+	// leaves the rest as spills, sorted by the range they belong to
+	std::unique_ptr<XMFLOAT4A[]> sums(new XMFLOAT4A[vertexCount]);
+	std::vector<std::vector<Spill>> spills(chunkCount);
+	pool.ParallelFor(chunkCount, [&](unsigned int chunk)
+	{
+		for (size_t i = rangeStart[chunk]; i < rangeStart[chunk + 1]; i++)
+			XMStoreFloat4A(&sums[i], XMVectorZero());
+
+		if (chunkCount == 1)
+			AccumulateTangents<false>(vertices, indices, chunkStart[chunk], chunkStart[chunk + 1], rangeStart, chunk, sums.get(), spills[chunk]);
+		else
+			AccumulateTangents<true>(vertices, indices, chunkStart[chunk], chunkStart[chunk + 1], rangeStart, chunk, sums.get(), spills[chunk]);
+		std::stable_sort(spills[chunk].begin(), spills[chunk].end(),
+			[](const Spill& a, const Spill& b) { return a.Range < b.Range; });
+	});
+
+	pool.ParallelFor(chunkCount, [&](unsigned int range)
+	{
+		// Then every range collects what the other chunks spilled into it
+		for (unsigned int chunk = 0; chunk < chunkCount; chunk++)
+		{
+			const std::vector<Spill>& chunkSpills = spills[chunk];
+			auto s = std::lower_bound(chunkSpills.begin(), chunkSpills.end(), range,
+				[](const Spill& spill, unsigned int range) { return spill.Range < range; });
+			for (; s != chunkSpills.end() && s->Range == range; ++s)
+				XMStoreFloat4A(&sums[s->Index], XMLoadFloat4A(&sums[s->Index]) + XMLoadFloat4(&s->Tangent));
+		}
+
+		// Ensure all of the tangents are orthogonal to the normals
+		for (size_t i = rangeStart[range]; i < rangeStart[range + 1]; i++)
+		{
+			// Grab the two vectors
+			XMVECTOR normal = XMLoadFloat3(&vertices[i].Normal);
+			XMVECTOR tangent = XMLoadFloat4A(&sums[i]);
+
+			// Use Gram-Schmidt orthonormalize to ensure
+			// the normal and tangent are exactly 90 degrees apart
+			XMVECTOR orthogonal = XMVector3Normalize(
+				tangent - normal * XMVector3Dot(normal, tangent));
+
+			// Handedness goes by majority; after SplitMirroredVertices()
+			// all of a vertex's triangles agree anyway
+			float handedness = XMVectorGetW(tangent) < 0.0f ? -1.0f : 1.0f;
+
+			// Store the tangent
+			XMStoreFloat4(&vertices[i].Tangent, XMVectorSetW(orthogonal, handedness));
+		}
+	});
+}
+
+// --------------------------------------------------------
+// Gives the mirrored triangles around a vertex their own
+// copy of it, like MikkTSpace does, so both sides of a
+// mirror seam get a consistent tangent frame
+// --------------------------------------------------------
+unsigned int SplitMirroredVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+	// Bit 0: used by a regular triangle, bit 1: by a mirrored one.
+	// Triangles with degenerate UVs have no handedness to respect.
+	const unsigned char regular = 1;
+	const unsigned char mirrored = 2;
+	std::vector<unsigned char> handedness(indices.size() / 3);
+	std::vector<unsigned char> usage(vertices.size(), 0);
+	for (size_t t = 0; t < handedness.size(); t++)
+	{
+		const Vertex& v1 = vertices[indices[t * 3 + 0]];
+		const Vertex& v2 = vertices[indices[t * 3 + 1]];
+		const Vertex& v3 = vertices[indices[t * 3 + 2]];
+		float determinant =
+			(v2.UV.x - v1.UV.x) * (v3.UV.y - v1.UV.y) -
+			(v3.UV.x - v1.UV.x) * (v2.UV.y - v1.UV.y);
+
+		handedness[t] = determinant > 0.0f ? regular : (determinant < 0.0f ? mirrored : 0);
+		for (int corner = 0; corner < 3; corner++)
+			usage[indices[t * 3 + corner]] |= handedness[t];
+	}
+
+	// The mirrored side of any vertex used both ways moves to a copy
+	const unsigned int unsplit = ~0u;
+	std::vector<unsigned int> copies(vertices.size(), unsplit);
+	size_t originalCount = vertices.size();
+	for (size_t i = 0; i < originalCount; i++)
+	{
+		if (usage[i] == (regular | mirrored))
+		{
+			copies[i] = (unsigned int)vertices.size();
+			vertices.push_back(vertices[i]);
+		}
+	}
+
+	for (size_t t = 0; t < handedness.size(); t++)
+	{
+		if (handedness[t] != mirrored)
+			continue;
+
+		for (int corner = 0; corner < 3; corner++)
+		{
+			unsigned int& index = indices[t * 3 + corner];
+			if (copies[index] != unsplit)
+				index = copies[index];
+		}
+	}
+
+	return (unsigned int)(vertices.size() - originalCount);
+}
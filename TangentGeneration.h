@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Vertex.h"
+#include <vector>
+
+// --------------------------------------------------------
+// Per-vertex tangents from positions, normals and UVs
+//
+// Same math as the original Mesh::CalculateTangents()
+// (Lengyel's method, then Gram-Schmidt against the normal),
+// reorganized so that it vectorizes and spreads across the
+// WorkerPool:
+//
+// 1. Triangles are split into chunks, and each chunk gets a
+//    "home" range of vertices (the ones it introduces, when
+//    they're in first-use order)
+// 2. Each chunk computes its triangles' tangents, four at a
+//    time in SIMD lanes, and adds them to its home vertices;
+//    corners outside that range are binned as spills
+// 3. Each range then adds the spills other chunks binned for
+//    it, and orthonormalizes its vertices
+//
+// Every vertex is only ever written by one thread at a time,
+// so no atomics are needed.  A serial run matches the old
+// scalar code bit for bit; with several chunks, vertices on
+// chunk boundaries may sum in another order (within 1e-6).
+// --------------------------------------------------------
+
+// Overwrites the Tangent of every vertex: xyz is the direction, and w
+// the handedness (+1, or -1 where the UVs are mirrored), so that the
+// bitangent is w * cross(T, N).  Vertices no triangle uses end up with
+// a zero direction.
+//
+// chunkCount - How many pieces to split the work into
+//              (0 picks automatically, 1 runs serially)
+void CalculateTangents(
+	Vertex* vertices,
+	size_t vertexCount,
+	const unsigned int* indices,
+	size_t indexCount,
+	unsigned int chunkCount = 0);
+
+// MikkTSpace never shares a tangent frame between triangles of opposite
+// handedness.  This duplicates every vertex that is used both ways (by
+// mirrored and regular UVs) and points the mirrored triangles at the
+// copy, so a single CalculateTangents() pass gets both sides right.
+// Run it after welding, which would merge the copies back.
+//
+// Returns the number of vertices added
+unsigned int SplitMirroredVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
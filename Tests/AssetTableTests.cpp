@@ -0,0 +1,132 @@
+#include "AssetTable.h"
+#include "TestCheck.h"
+
+#include <memory>
+#include <string>
+
+// Usage: AssetTableTests
+//
+// Checks that NormalizeAssetPath() gives every spelling of a
+// path one key, and that an AssetTable shares one asset
+// between every path with the same bytes and evicts it with
+// all of them.  Handles are plain shared_ptrs, counted the
+// way AssetRegistry counts meshes.
+
+namespace
+{
+	typedef std::shared_ptr<int> Handle;
+	typedef AssetTable<Handle> Table;
+
+	bool IsUnused(const Handle& value)
+	{
+		return value.use_count() == 1;
+	}
+
+	void TestNormalize()
+	{
+		// Case and separators
+		CHECK(NormalizeAssetPath(L"Assets/Models/Cube.OBJ") == L"assets\\models\\cube.obj");
+		CHECK(NormalizeAssetPath(L"assets\\models/cube.obj") == L"assets\\models\\cube.obj");
+		CHECK(NormalizeAssetPath(L"ASSETS\\\\MODELS//cube.obj") == L"assets\\models\\cube.obj");
+		CHECK(NormalizeAssetPath(L"assets/models/") == L"assets\\models");
+
+		// "." goes, ".." takes the segment before it
+		CHECK(NormalizeAssetPath(L"./assets/./models/cube.obj") == L"assets\\models\\cube.obj");
+		CHECK(NormalizeAssetPath(L"assets/textures/../models/cube.obj") == L"assets\\models\\cube.obj");
+		CHECK(NormalizeAssetPath(L"assets/a/b/../../models/cube.obj") == L"assets\\models\\cube.obj");
+		CHECK(NormalizeAssetPath(L"assets/models/..") == L"assets");
+
+		// A ".." with nothing left to cancel stays, however many there are
+		CHECK(NormalizeAssetPath(L"../assets/cube.obj") == L"..\\assets\\cube.obj");
+		CHECK(NormalizeAssetPath(L"assets/../../cube.obj") == L"..\\cube.obj");
+		CHECK(NormalizeAssetPath(L"../../assets/../cube.obj") == L"..\\..\\cube.obj");
+
+		// Leading separators (a rooted or network path) are kept as backslashes
+		CHECK(NormalizeAssetPath(L"/assets/cube.obj") == L"\\assets\\cube.obj");
+		CHECK(NormalizeAssetPath(L"//Server/Share/cube.obj") == L"\\\\server\\share\\cube.obj");
+
+		CHECK(NormalizeAssetPath(L"") == L"");
+		CHECK(NormalizeAssetPath(L".") == L"");
+	}
+
+	// --------------------------------------------------------
+	// The same bytes under two names: the second path finds the
+	// first one's asset by content and leads to it from then on
+	// --------------------------------------------------------
+	void TestSharedContent()
+	{
+		Table table;
+		Handle cube = std::make_shared<int>(1);
+		CHECK(!table.FindPath(L"a\\cube.obj"));
+		table.Add(L"a\\cube.obj", 0x1234, 100, cube);
+
+		// Same hash but a different size is someone else's bytes
+		CHECK(!table.FindContent(L"b\\other.obj", 0x1234, 99));
+		CHECK(!table.FindContent(L"b\\other.obj", 0x5678, 100));
+		CHECK(!table.FindPath(L"b\\other.obj"));
+
+		Table::Asset* copy = table.FindContent(L"b\\copy.obj", 0x1234, 100);
+		CHECK(copy && copy->Value == cube && copy->Bytes == 100);
+		CHECK(table.GetAssetCount() == 1);
+		CHECK(table.GetPathCount() == 2);
+		CHECK(table.FindPath(L"b\\copy.obj") == table.FindPath(L"a\\cube.obj"));
+
+		// Listed once, under the first path in order
+		auto list = table.List();
+		CHECK(list.size() == 1);
+		CHECK(list.size() == 1 && list[0].first == L"a\\cube.obj" && list[0].second->Value == cube);
+
+		// Adding a path again leaves one entry for it
+		table.Add(L"a\\cube.obj", 0x1234, 100, cube);
+		CHECK(table.GetAssetCount() == 1);
+		CHECK(table.GetPathCount() == 2);
+	}
+
+	// --------------------------------------------------------
+	// An asset held outside the table stays, through any number
+	// of evictions; once it's let go it leaves with every path
+	// to it, and nothing else does
+	// --------------------------------------------------------
+	void TestEvict()
+	{
+		Table table;
+		Handle cube = std::make_shared<int>(1);
+		Handle sphere = std::make_shared<int>(2);
+		table.Add(L"cube.obj", 1, 10, cube);
+		CHECK(table.FindContent(L"models\\cube.obj", 1, 10));
+		CHECK(table.FindContent(L"copies\\box.obj", 1, 10));
+		table.Add(L"sphere.obj", 2, 20, sphere);
+		CHECK(table.GetAssetCount() == 2);
+		CHECK(table.GetPathCount() == 4);
+
+		CHECK(table.Evict(IsUnused) == 0);
+		CHECK(table.GetAssetCount() == 2);
+
+		cube.reset();
+		CHECK(table.Evict(IsUnused) == 1);
+		CHECK(table.GetAssetCount() == 1);
+		CHECK(table.GetPathCount() == 1);
+		CHECK(!table.FindPath(L"cube.obj"));
+		CHECK(!table.FindPath(L"models\\cube.obj"));
+		CHECK(!table.FindPath(L"copies\\box.obj"));
+		CHECK(table.FindPath(L"sphere.obj") && table.FindPath(L"sphere.obj")->Value == sphere);
+
+		// Its bytes are no longer known either, so they'd be loaded afresh
+		CHECK(!table.FindContent(L"cube.obj", 1, 10));
+		CHECK(!table.FindPath(L"cube.obj"));
+
+		sphere.reset();
+		CHECK(table.Evict(IsUnused) == 1);
+		CHECK(table.GetAssetCount() == 0);
+		CHECK(table.GetPathCount() == 0);
+		CHECK(table.List().empty());
+	}
+}
+
+int main()
+{
+	TestNormalize();
+	TestSharedContent();
+	TestEvict();
+	return TestResult("AssetTableTests");
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+
+// --------------------------------------------------------
+// Runs "work" several times and returns the fastest run in
+// milliseconds, which is the least disturbed by whatever
+// else the machine is doing.
+//
+// Off Windows the benchmarks build against the scalar
+// DirectXMath shim in Tests/Shims, so anything that leans
+// on DirectXMath's SIMD runs slower there than in the game:
+// compare numbers from the same machine and build only.
+// --------------------------------------------------------
+template<typename Work>
+double TimeBest(int runs, Work&& work)
+{
+	double best = DBL_MAX;
+	for (int run = 0; run < runs; run++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		work();
+		auto end = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+	}
+	return best;
+}
@@ -0,0 +1,113 @@
+#include "MeshBvh.h"
+#include "MeshOptimizer.h"
+#include "ObjParser.h"
+#include "WorkerPool.h"
+#include "BenchTimer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+// Usage: MeshBvhBench <file.obj>...
+//
+// Builds a MeshBvh for each model and casts a million rays at
+// it on one thread, twice: scattered rays from all around
+// (the worst case for the cache) and a pinhole camera's grid
+// (the usual case for picking and the like).  Reports the
+// build time, the tree's shape and millions of rays per
+// second.  MeshBvhTests checks the hits themselves.
+
+namespace
+{
+	const unsigned int RayCount = 1u << 20;
+
+	// Millions of rays per second over the best of three runs
+	double TimeRays(const MeshBvh& bvh, const std::vector<Ray>& rays, std::vector<RayHit>& hits, unsigned int& hitCount)
+	{
+		double best = TimeBest(3, [&]() {
+			std::fill(hits.begin(), hits.end(), RayHit());
+			hitCount = bvh.Raycast(rays.data(), (unsigned int)rays.size(), hits.data());
+		});
+		return rays.size() / (best / 1000.0) / 1e6;
+	}
+
+	void Benchmark(const std::string& path)
+	{
+		ObjMeshData mesh;
+		if (!LoadObj(std::wstring(path.begin(), path.end()), mesh))
+		{
+			printf("Can't load %s\n", path.c_str());
+			return;
+		}
+		WeldVertices(mesh.Vertices, mesh.Indices);
+
+		std::vector<XMFLOAT3> positions(mesh.Vertices.size());
+		for (size_t i = 0; i < positions.size(); i++)
+			positions[i] = mesh.Vertices[i].Position;
+
+		MeshBvh bvh;
+		double buildTime = TimeBest(3, [&]() {
+			bvh = MeshBvh();
+			bvh.Build(positions.data(), (unsigned int)positions.size(), mesh.Indices.data(), (unsigned int)mesh.Indices.size());
+		});
+
+		XMVECTOR lowest = XMLoadFloat3(&positions[0]);
+		XMVECTOR highest = lowest;
+		for (const XMFLOAT3& p : positions)
+		{
+			lowest = XMVectorMin(lowest, XMLoadFloat3(&p));
+			highest = XMVectorMax(highest, XMLoadFloat3(&p));
+		}
+		XMVECTOR center = (lowest + highest) * 0.5f;
+		float radius = XMVectorGetX(XMVector3Length(highest - lowest));
+
+		printf("%s: %zu triangles, built in %.2f ms: %u nodes, %u leaves, depth %u, %.1f KB\n",
+			path.c_str(), mesh.Indices.size() / 3, buildTime, bvh.GetNodeCount(), bvh.GetLeafCount(), bvh.GetDepth(), bvh.GetMemoryBytes() / 1024.0);
+
+		// Scattered: from random points on a sphere around the model to
+		// random points in its bounds
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::vector<Ray> rays(RayCount);
+		for (Ray& ray : rays)
+		{
+			float z = unit(rng) * 2.0f - 1.0f;
+			float angle = unit(rng) * XM_2PI;
+			float ring = std::sqrt(1.0f - z * z);
+			XMVECTOR origin = center + XMVectorSet(ring * cosf(angle), ring * sinf(angle), z, 0.0f) * radius;
+			XMVECTOR target = lowest + (highest - lowest) * XMVectorSet(unit(rng), unit(rng), unit(rng), 0.0f);
+			XMStoreFloat3(&ray.Origin, origin);
+			XMStoreFloat3(&ray.Direction, XMVector3Normalize(target - origin));
+		}
+
+		std::vector<RayHit> hits(RayCount);
+		unsigned int hitCount = 0;
+		double scattered = TimeRays(bvh, rays, hits, hitCount);
+		printf("  scattered     %7.2f Mrays/s (%.0f%% hit)\n", scattered, 100.0 * hitCount / RayCount);
+
+		// A 1024 x 1024 camera a model's width away, looking down +Z
+		for (unsigned int i = 0; i < RayCount; i++)
+		{
+			float x = ((i & 1023) + 0.5f) / 512.0f - 1.0f;
+			float y = ((i >> 10) + 0.5f) / 512.0f - 1.0f;
+			XMStoreFloat3(&rays[i].Origin, center - XMVectorSet(0.0f, 0.0f, radius, 0.0f));
+			XMStoreFloat3(&rays[i].Direction, XMVector3Normalize(XMVectorSet(x * 0.4f, y * 0.4f, 1.0f, 0.0f)));
+		}
+		double coherent = TimeRays(bvh, rays, hits, hitCount);
+		printf("  camera grid   %7.2f Mrays/s (%.0f%% hit)\n", coherent, 100.0 * hitCount / RayCount);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+		Benchmark(argv[i]);
+
+	delete &WorkerPool::GetInstance();
+	return 0;
+}
@@ -0,0 +1,198 @@
+#include "Meshlets.h"
+#include "MeshOptimizer.h"
+#include "ObjParser.h"
+#include "WorkerPool.h"
+#include "BenchTimer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+// Usage: MeshletCullingBench <file.obj>...
+//
+// Prepares each model as the Mesh pipeline does, then flies
+// two camera paths around it (an orbit from outside, and a
+// fly-by close in, looking along the path) and reports the
+// share of triangles CullMeshlet() keeps from the GPU.  Next
+// to it is the share a per-triangle test would reject, the
+// best any culling could do, and a count of triangles that
+// were culled but are actually visible, which must be 0.
+
+namespace
+{
+	const int StepsPerPath = 64;
+
+	struct PathResult
+	{
+		size_t Tested = 0;
+		size_t OutsideFrustum = 0;
+		size_t BackFacing = 0;
+		size_t IdealRejected = 0;
+		size_t WronglyCulled = 0;
+		size_t MeshletsCulled = 0;
+	};
+
+	// --------------------------------------------------------
+	// Whether a single triangle could show up: some of it is
+	// inside every plane of the clip volume, and it faces the
+	// camera
+	// --------------------------------------------------------
+	bool IsTriangleVisible(const XMVECTOR corners[3], FXMMATRIX viewProjection, FXMVECTOR eye)
+	{
+		bool outside[6] = { true, true, true, true, true, true };
+		for (int k = 0; k < 3; k++)
+		{
+			XMFLOAT4 h;
+			XMStoreFloat4(&h, XMVector3Transform(corners[k], viewProjection));
+			outside[0] &= h.x < -h.w;
+			outside[1] &= h.x > h.w;
+			outside[2] &= h.y < -h.w;
+			outside[3] &= h.y > h.w;
+			outside[4] &= h.z < 0.0f;
+			outside[5] &= h.z > h.w;
+		}
+		for (bool o : outside)
+			if (o)
+				return false;
+
+		XMVECTOR normal = XMVector3Cross(corners[1] - corners[0], corners[2] - corners[0]);
+		return XMVectorGetX(XMVector3Dot(normal, eye - corners[0])) > 0.0f;
+	}
+
+	void RunPath(int path, const ObjMeshData& mesh, const std::vector<Meshlet>& meshlets, FXMVECTOR center, float radius, PathResult& result)
+	{
+		size_t triangleCount = mesh.Indices.size() / 3;
+		std::vector<char> visible(triangleCount);
+
+		for (int step = 0; step < StepsPerPath; step++)
+		{
+			float angle = step * XM_2PI / StepsPerPath;
+			XMVECTOR eye;
+			XMVECTOR at;
+			if (path == 0)
+			{
+				eye = center + XMVectorSet(2.5f * radius * cosf(angle), 0.8f * radius, 2.5f * radius * sinf(angle), 0.0f);
+				at = center;
+			}
+			else
+			{
+				eye = center + XMVectorSet(0.9f * radius * cosf(angle), 0.35f * radius, 0.9f * radius * sinf(angle), 0.0f);
+				at = eye + XMVectorSet(-sinf(angle), -0.2f, cosf(angle), 0.0f);
+			}
+
+			XMFLOAT4X4 world;
+			XMFLOAT4X4 view;
+			XMFLOAT4X4 projection;
+			XMStoreFloat4x4(&world, XMMatrixIdentity());
+			XMStoreFloat4x4(&view, XMMatrixLookAtLH(eye, at, XMVectorSet(0, 1, 0, 0)));
+			XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.01f * radius, 100.0f * radius));
+			MeshletCullingView cullingView = GetMeshletCullingView(world, view, projection);
+			XMMATRIX viewProjection = XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection);
+
+			for (size_t t = 0; t < triangleCount; t++)
+			{
+				XMVECTOR corners[3];
+				for (int k = 0; k < 3; k++)
+					corners[k] = XMLoadFloat3(&mesh.Vertices[mesh.Indices[t * 3 + k]].Position);
+				visible[t] = IsTriangleVisible(corners, viewProjection, eye);
+				if (!visible[t])
+					result.IdealRejected++;
+			}
+
+			for (const Meshlet& m : meshlets)
+			{
+				result.Tested += m.TriangleCount;
+				MeshletVisibility visibility = CullMeshlet(m, cullingView);
+				if (visibility == MeshletVisibility::Visible)
+					continue;
+
+				result.MeshletsCulled++;
+				if (visibility == MeshletVisibility::OutsideFrustum)
+					result.OutsideFrustum += m.TriangleCount;
+				else
+					result.BackFacing += m.TriangleCount;
+				for (unsigned int t = 0; t < m.TriangleCount; t++)
+					if (visible[m.StartIndex / 3 + t])
+						result.WronglyCulled++;
+			}
+		}
+	}
+
+	void Benchmark(const std::string& path)
+	{
+		std::wstring widePath(path.begin(), path.end());
+		ObjMeshData mesh;
+		if (!LoadObj(widePath, mesh))
+		{
+			printf("Can't load %s\n", path.c_str());
+			return;
+		}
+
+		WeldVertices(mesh.Vertices, mesh.Indices);
+		OptimizeVertexCache(mesh.Indices, mesh.Vertices.size());
+		OptimizeOverdraw(mesh.Indices, mesh.Vertices);
+
+		std::vector<Meshlet> meshlets;
+		double buildTime = TimeBest(5, [&]() {
+			BuildMeshlets(mesh.Vertices.data(), mesh.Vertices.size(), mesh.Indices.data(), mesh.Indices.size(), meshlets);
+		});
+
+		XMVECTOR lowest = XMLoadFloat3(&mesh.Vertices[0].Position);
+		XMVECTOR highest = lowest;
+		for (const Vertex& v : mesh.Vertices)
+		{
+			lowest = XMVectorMin(lowest, XMLoadFloat3(&v.Position));
+			highest = XMVectorMax(highest, XMLoadFloat3(&v.Position));
+		}
+		XMVECTOR center = (lowest + highest) * 0.5f;
+		float radius = XMVectorGetX(XMVector3Length(highest - lowest)) * 0.5f;
+
+		printf("%s: %zu triangles in %zu meshlets, built in %.2f ms\n", path.c_str(), mesh.Indices.size() / 3, meshlets.size(), buildTime);
+
+		const char* pathNames[] = { "orbit", "fly-by" };
+		for (int p = 0; p < 2; p++)
+		{
+			PathResult result;
+			RunPath(p, mesh, meshlets, center, radius, result);
+			printf("  %-7s rejected %5.1f%% (frustum %5.1f%%, cone %5.1f%%), per-triangle best %5.1f%%, wrongly culled %zu\n",
+				pathNames[p],
+				100.0 * (result.OutsideFrustum + result.BackFacing) / result.Tested,
+				100.0 * result.OutsideFrustum / result.Tested,
+				100.0 * result.BackFacing / result.Tested,
+				100.0 * result.IdealRejected / result.Tested,
+				result.WronglyCulled);
+		}
+
+		// What the test costs per meshlet, for one view from the orbit
+		XMFLOAT4X4 world;
+		XMFLOAT4X4 view;
+		XMFLOAT4X4 projection;
+		XMStoreFloat4x4(&world, XMMatrixIdentity());
+		XMStoreFloat4x4(&view, XMMatrixLookAtLH(center + XMVectorSet(2.5f * radius, 0.8f * radius, 0, 0), center, XMVectorSet(0, 1, 0, 0)));
+		XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.01f * radius, 100.0f * radius));
+		MeshletCullingView cullingView = GetMeshletCullingView(world, view, projection);
+
+		const int repeats = 1000;
+		volatile unsigned int visibleCount = 0;
+		double cullTime = TimeBest(5, [&]() {
+			unsigned int count = 0;
+			for (int r = 0; r < repeats; r++)
+				for (const Meshlet& m : meshlets)
+					count += CullMeshlet(m, cullingView) == MeshletVisibility::Visible;
+			visibleCount = count;
+		});
+		printf("  CullMeshlet() %.1f ns per meshlet\n", cullTime * 1e6 / ((double)repeats * meshlets.size()));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+		Benchmark(argv[i]);
+
+	delete &WorkerPool::GetInstance();
+	return 0;
+}
@@ -0,0 +1,261 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "WorkerPool.h"
+#include "BenchTimer.h"
+
+#include <Windows.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+// Usage: ObjLoaderBench [--faces N] [file.obj...]
+//
+// Reports MB/s for the getline/sscanf_s loop Mesh used to
+// load with, the memory-mapped parser run serially, and the
+// parser split across the WorkerPool, for each file given and
+// for a generated grid of N triangles (2,000,000 by default)
+// written to the working directory.
+
+namespace
+{
+	const char* GridFile = "ObjLoaderBench.obj";
+
+	// --------------------------------------------------------
+	// The loop Mesh::Mesh() used before ObjParser, kept as it
+	// was apart from the Vertex setup, for comparison.  Lines
+	// past 99 characters are cut short, as they always were.
+	// --------------------------------------------------------
+	void LoadObjLegacy(const char* fileName, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		std::ifstream obj(fileName);
+		if (!obj.is_open())
+			return;
+
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT3> normals;
+		std::vector<XMFLOAT2> uvs;
+		unsigned int indexCounter = 0;
+		char chars[100];
+
+		while (obj.good())
+		{
+			obj.getline(chars, 100);
+
+			if (chars[0] == 'v' && chars[1] == 'n')
+			{
+				XMFLOAT3 norm;
+				sscanf_s(chars, "vn %f %f %f", &norm.x, &norm.y, &norm.z);
+				normals.push_back(norm);
+			}
+			else if (chars[0] == 'v' && chars[1] == 't')
+			{
+				XMFLOAT2 uv;
+				sscanf_s(chars, "vt %f %f", &uv.x, &uv.y);
+				uvs.push_back(uv);
+			}
+			else if (chars[0] == 'v')
+			{
+				XMFLOAT3 pos;
+				sscanf_s(chars, "v %f %f %f", &pos.x, &pos.y, &pos.z);
+				positions.push_back(pos);
+			}
+			else if (chars[0] == 'f')
+			{
+				unsigned int i[12];
+				int numbersRead = sscanf_s(
+					chars,
+					"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+					&i[0], &i[1], &i[2],
+					&i[3], &i[4], &i[5],
+					&i[6], &i[7], &i[8],
+					&i[9], &i[10], &i[11]);
+
+				if (numbersRead == 1)
+				{
+					numbersRead = sscanf_s(
+						chars,
+						"f %d//%d %d//%d %d//%d %d//%d",
+						&i[0], &i[2],
+						&i[3], &i[5],
+						&i[6], &i[8],
+						&i[9], &i[11]);
+					i[1] = i[4] = i[7] = i[10] = 1;
+					if (uvs.size() == 0)
+						uvs.push_back(XMFLOAT2(0, 0));
+				}
+
+				// Flipped into a left-handed, top-left-UV space
+				auto makeVertex = [&](int first) {
+					Vertex v = {};
+					v.Position = positions[i[first] - 1];
+					v.UV = uvs[i[first + 1] - 1];
+					v.Normal = normals[i[first + 2] - 1];
+					v.UV.y = 1.0f - v.UV.y;
+					v.Position.z *= -1.0f;
+					v.Normal.z *= -1.0f;
+					return v;
+				};
+
+				Vertex v1 = makeVertex(0);
+				Vertex v2 = makeVertex(3);
+				Vertex v3 = makeVertex(6);
+				verts.push_back(v1);
+				verts.push_back(v3);
+				verts.push_back(v2);
+				for (int k = 0; k < 3; k++)
+					indices.push_back(indexCounter++);
+
+				if (numbersRead == 12 || numbersRead == 8)
+				{
+					Vertex v4 = makeVertex(9);
+					verts.push_back(v1);
+					verts.push_back(v4);
+					verts.push_back(v3);
+					for (int k = 0; k < 3; k++)
+						indices.push_back(indexCounter++);
+				}
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Writes a wavy square grid of about faceCount triangles,
+	// with positions, UVs and normals, as an exporter would
+	// --------------------------------------------------------
+	bool WriteGrid(const char* fileName, size_t faceCount)
+	{
+		FILE* file = fopen(fileName, "w");
+		if (!file)
+			return false;
+
+		size_t side = 2;
+		while (2 * side * side < faceCount)
+			side++;
+		size_t columns = side + 1;
+
+		fprintf(file, "# %zu x %zu grid\n", side, side);
+		for (size_t y = 0; y < columns; y++)
+			for (size_t x = 0; x < columns; x++)
+				fprintf(file, "v %f %f %f\n", (float)x / side, 0.05f * sinf(x * 0.3f) * cosf(y * 0.2f), (float)y / side);
+		for (size_t y = 0; y < columns; y++)
+			for (size_t x = 0; x < columns; x++)
+				fprintf(file, "vt %f %f\n", (float)x / side, (float)y / side);
+		for (size_t y = 0; y < columns; y++)
+			for (size_t x = 0; x < columns; x++)
+				fprintf(file, "vn %f %f %f\n", 0.0f, 1.0f, 0.0f);
+
+		// Every corner uses the same number for all three
+		for (size_t y = 0; y < side; y++)
+		{
+			for (size_t x = 0; x < side; x++)
+			{
+				size_t a = y * columns + x + 1;
+				size_t b = a + 1;
+				size_t c = a + columns;
+				size_t d = c + 1;
+				fprintf(file, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", a, a, a, c, c, c, b, b, b);
+				fprintf(file, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", b, b, b, c, c, c, d, d, d);
+			}
+		}
+
+		fclose(file);
+		return true;
+	}
+
+	bool IsSameGeometry(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const ObjMeshData& mesh)
+	{
+		if (vertices.size() != mesh.Vertices.size() || indices != mesh.Indices)
+			return false;
+
+		// Only the parts the old loop filled in
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const Vertex& a = vertices[i];
+			const Vertex& b = mesh.Vertices[i];
+			if (memcmp(&a.Position, &b.Position, sizeof(a.Position)) != 0 ||
+				memcmp(&a.Normal, &b.Normal, sizeof(a.Normal)) != 0 ||
+				memcmp(&a.UV, &b.UV, sizeof(a.UV)) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	void Benchmark(const std::string& path)
+	{
+		std::wstring widePath(path.begin(), path.end());
+		size_t size = 0;
+		{
+			MappedFile file(widePath);
+			if (!file.IsOpen())
+			{
+				printf("Can't open %s\n", path.c_str());
+				return;
+			}
+			size = file.GetSize();
+		}
+
+		// Small files need many runs to time at all
+		double megabytes = size / 1e6;
+		int runs = megabytes < 16.0 ? 20 : 3;
+
+		std::vector<Vertex> legacyVertices;
+		std::vector<unsigned int> legacyIndices;
+		double legacy = TimeBest(runs, [&]() {
+			legacyVertices.clear();
+			legacyIndices.clear();
+			LoadObjLegacy(path.c_str(), legacyVertices, legacyIndices);
+		});
+
+		ObjMeshData serial;
+		double mappedSerial = TimeBest(runs, [&]() {
+			MappedFile file(widePath);
+			serial = ObjMeshData();
+			ParseObj(file.GetData(), file.GetSize(), serial, 1);
+		});
+
+		ObjMeshData parallel;
+		double mappedParallel = TimeBest(runs, [&]() {
+			parallel = ObjMeshData();
+			LoadObj(widePath, parallel);
+		});
+
+		printf("%s: %.1f MB, %zu triangles%s\n", path.c_str(), megabytes, parallel.Indices.size() / 3,
+			IsSameGeometry(legacyVertices, legacyIndices, parallel) ? "" : " (legacy loader disagrees)");
+		printf("  getline/sscanf_s  %9.2f ms  %8.1f MB/s\n", legacy, megabytes / (legacy / 1000.0));
+		printf("  mapped, serial    %9.2f ms  %8.1f MB/s\n", mappedSerial, megabytes / (mappedSerial / 1000.0));
+		printf("  mapped, parallel  %9.2f ms  %8.1f MB/s (%u threads)\n", mappedParallel, megabytes / (mappedParallel / 1000.0),
+			WorkerPool::GetInstance().GetThreadCount());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t faceCount = 2000000;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--faces") == 0 && i + 1 < argc)
+			faceCount = strtoull(argv[++i], 0, 10);
+		else
+			paths.push_back(argv[i]);
+	}
+
+	for (const std::string& path : paths)
+		Benchmark(path);
+
+	if (faceCount > 0 && WriteGrid(GridFile, faceCount))
+	{
+		Benchmark(GridFile);
+		remove(GridFile);
+	}
+
+	delete &WorkerPool::GetInstance();
+	return 0;
+}
@@ -0,0 +1,193 @@
+#include "SimpleShader.h"
+#include "FakeD3D.h"
+#include "BenchTimer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+using namespace DirectX;
+
+// Usage: ShaderParamBench
+//
+// Times the seven sets GameEntity::Draw() makes per entity
+// (four matrices and three material values) through each way
+// SimpleShader takes a variable: std::string names, string
+// literals, constexpr ShaderNames and GetParam() handles.
+// The path the std::string names took before ShaderName (a
+// copy of the string, then an unordered_map lookup) is
+// rebuilt below as the baseline.  The shaders come from the
+// fake device in Tests/FakeD3D, so only the CPU side is timed.
+
+namespace
+{
+	const wchar_t* VertexShaderFile = L"ShaderParamBenchVS.cso";
+	const wchar_t* PixelShaderFile = L"ShaderParamBenchPS.cso";
+	const char* ReflectionFiles[] = { "ShaderParamBenchVS.cso.reflection", "ShaderParamBenchPS.cso.reflection" };
+	const int DrawCount = 2000000;
+
+	// --------------------------------------------------------
+	// The old lookup: the name by value, hashed into a map of
+	// every variable, then copied into the local buffer
+	// --------------------------------------------------------
+	struct StringTable
+	{
+		std::unordered_map<std::string, SimpleShaderVariable> Variables;
+		unsigned char Buffer[512] = {};
+
+#if defined(_MSC_VER)
+		__declspec(noinline)
+#else
+		__attribute__((noinline))
+#endif
+		bool SetData(std::string name, const void* data, unsigned int size)
+		{
+			auto found = Variables.find(name);
+			if (found == Variables.end() || size > found->second.Size)
+				return false;
+			memcpy(Buffer + found->second.ByteOffset, data, size);
+			return true;
+		}
+	};
+
+	template<typename Draw>
+	double TimePerDraw(Draw&& draw)
+	{
+		double best = TimeBest(3, [&]() {
+			for (int i = 0; i < DrawCount; i++)
+				draw(i);
+		});
+		return best * 1e6 / DrawCount;
+	}
+}
+
+int main()
+{
+	for (const char* file : ReflectionFiles)
+		remove(file);
+	ISimpleShader::ReportWarnings = false;
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	FakeD3D::CreateDevice(device.GetAddressOf(), context.GetAddressOf());
+
+	// Laid out as VertexShader.hlsl and PixelShader.hlsl lay them out
+	FakeD3D::NextShader.Bytecode = "ShaderParamBench vertex shader";
+	FakeD3D::NextShader.ConstantBuffers = { { "ExternalData", 0, 384, {
+		{ "world", 0, 64 },
+		{ "view", 64, 64 },
+		{ "projection", 128, 64 },
+		{ "worldInverseTranspose", 192, 64 },
+		{ "lightView", 256, 64 },
+		{ "lightProjection", 320, 64 } } } };
+	SimpleVertexShader vs(device, context, VertexShaderFile);
+
+	FakeD3D::NextShader.Bytecode = "ShaderParamBench pixel shader";
+	FakeD3D::NextShader.ConstantBuffers = { { "ExternalData", 0, 368, {
+		{ "colorTint", 0, 16 },
+		{ "roughness", 16, 4 },
+		{ "cameraPosition", 20, 12 },
+		{ "ambient", 32, 12 },
+		{ "usingSpecularMap", 44, 4 },
+		{ "lights", 48, 320 } } } };
+	SimplePixelShader ps(device, context, PixelShaderFile);
+
+	StringTable oldVertex;
+	StringTable oldPixel;
+	for (const char* name : { "world", "view", "projection", "worldInverseTranspose" })
+		oldVertex.Variables[name] = *vs.GetVariableInfo(ShaderName(name));
+	for (const char* name : { "colorTint", "roughness", "cameraPosition" })
+		oldPixel.Variables[name] = *ps.GetVariableInfo(ShaderName(name));
+
+	XMFLOAT4X4 matrices[4];
+	for (int m = 0; m < 4; m++)
+		for (int e = 0; e < 16; e++)
+			(&matrices[m]._11)[e] = (float)(m * 16 + e);
+	XMFLOAT4 tint(1, 2, 3, 4);
+	XMFLOAT3 camera(5, 6, 7);
+	float roughness = 0.5f;
+
+	// A new world matrix every draw, as every entity has its own
+	double oldPath = TimePerDraw([&](int i) {
+		matrices[0]._11 = (float)i;
+		oldVertex.SetData("world", &matrices[0], 64);
+		oldVertex.SetData("view", &matrices[1], 64);
+		oldVertex.SetData("projection", &matrices[2], 64);
+		oldVertex.SetData("worldInverseTranspose", &matrices[3], 64);
+		oldPixel.SetData("colorTint", &tint, 16);
+		oldPixel.SetData("roughness", &roughness, 4);
+		oldPixel.SetData("cameraPosition", &camera, 12);
+	});
+
+	std::string world = "world", view = "view", projection = "projection", worldInverseTranspose = "worldInverseTranspose";
+	std::string colorTint = "colorTint", roughnessName = "roughness", cameraPosition = "cameraPosition";
+	double strings = TimePerDraw([&](int i) {
+		matrices[0]._11 = (float)i;
+		vs.SetMatrix4x4(world, matrices[0]);
+		vs.SetMatrix4x4(view, matrices[1]);
+		vs.SetMatrix4x4(projection, matrices[2]);
+		vs.SetMatrix4x4(worldInverseTranspose, matrices[3]);
+		ps.SetFloat4(colorTint, tint);
+		ps.SetFloat(roughnessName, roughness);
+		ps.SetFloat3(cameraPosition, camera);
+	});
+
+	double literals = TimePerDraw([&](int i) {
+		matrices[0]._11 = (float)i;
+		vs.SetMatrix4x4("world", matrices[0]);
+		vs.SetMatrix4x4("view", matrices[1]);
+		vs.SetMatrix4x4("projection", matrices[2]);
+		vs.SetMatrix4x4("worldInverseTranspose", matrices[3]);
+		ps.SetFloat4("colorTint", tint);
+		ps.SetFloat("roughness", roughness);
+		ps.SetFloat3("cameraPosition", camera);
+	});
+
+	static constexpr ShaderName worldName("world"), viewName("view"), projectionName("projection"), worldInverseTransposeName("worldInverseTranspose");
+	static constexpr ShaderName colorTintName("colorTint"), roughnessConstName("roughness"), cameraPositionName("cameraPosition");
+	double constants = TimePerDraw([&](int i) {
+		matrices[0]._11 = (float)i;
+		vs.SetMatrix4x4(worldName, matrices[0]);
+		vs.SetMatrix4x4(viewName, matrices[1]);
+		vs.SetMatrix4x4(projectionName, matrices[2]);
+		vs.SetMatrix4x4(worldInverseTransposeName, matrices[3]);
+		ps.SetFloat4(colorTintName, tint);
+		ps.SetFloat(roughnessConstName, roughness);
+		ps.SetFloat3(cameraPositionName, camera);
+	});
+
+	ShaderParam worldParam = vs.GetParam("world");
+	ShaderParam viewParam = vs.GetParam("view");
+	ShaderParam projectionParam = vs.GetParam("projection");
+	ShaderParam worldInverseTransposeParam = vs.GetParam("worldInverseTranspose");
+	ShaderParam colorTintParam = ps.GetParam("colorTint");
+	ShaderParam roughnessParam = ps.GetParam("roughness");
+	ShaderParam cameraPositionParam = ps.GetParam("cameraPosition");
+	double handles = TimePerDraw([&](int i) {
+		matrices[0]._11 = (float)i;
+		vs.SetMatrix4x4(worldParam, matrices[0]);
+		vs.SetMatrix4x4(viewParam, matrices[1]);
+		vs.SetMatrix4x4(projectionParam, matrices[2]);
+		vs.SetMatrix4x4(worldInverseTransposeParam, matrices[3]);
+		ps.SetFloat4(colorTintParam, tint);
+		ps.SetFloat(roughnessParam, roughness);
+		ps.SetFloat3(cameraPositionParam, camera);
+	});
+
+	// Every path ends with the same bytes in the local buffers
+	bool same =
+		memcmp(vs.GetBufferInfo(0u)->LocalDataBuffer, oldVertex.Buffer, 256) == 0 &&
+		memcmp(ps.GetBufferInfo(0u)->LocalDataBuffer, oldPixel.Buffer, 32) == 0;
+
+	printf("Seven sets per draw, %d draws%s\n", DrawCount, same ? "" : " (the paths disagree)");
+	printf("  std::string, unordered_map (old)  %6.1f ns\n", oldPath);
+	printf("  std::string names                 %6.1f ns\n", strings);
+	printf("  string literals                   %6.1f ns\n", literals);
+	printf("  constexpr ShaderNames             %6.1f ns\n", constants);
+	printf("  GetParam() handles                %6.1f ns\n", handles);
+
+	for (const char* file : ReflectionFiles)
+		remove(file);
+	return 0;
+}
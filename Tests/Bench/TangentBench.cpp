@@ -0,0 +1,126 @@
+#include "TangentGeneration.h"
+#include "MeshOptimizer.h"
+#include "ObjParser.h"
+#include "WorkerPool.h"
+#include "BenchTimer.h"
+#include "LegacyTangents.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+// Usage: TangentBench [file.obj...]
+//
+// Times the scalar loop Mesh::CalculateTangents() used to be
+// against CalculateTangents() run serially and across the
+// WorkerPool, on each model given (prepared as the Mesh
+// pipeline does) and on wavy grids of one and two million
+// triangles, and reports how far the results drift from the
+// scalar loop's.
+//
+// The speedup only means something on Windows: against the
+// scalar DirectXMath shim the four-lane code has no SIMD to use.
+
+namespace
+{
+	// Largest per-component difference in tangent direction
+	float GetLargestDifference(const std::vector<Vertex>& a, const std::vector<Vertex>& b)
+	{
+		float largest = 0.0f;
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			largest = std::max(largest, std::fabs(a[i].Tangent.x - b[i].Tangent.x));
+			largest = std::max(largest, std::fabs(a[i].Tangent.y - b[i].Tangent.y));
+			largest = std::max(largest, std::fabs(a[i].Tangent.z - b[i].Tangent.z));
+		}
+		return largest;
+	}
+
+	void Benchmark(const char* name, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+	{
+		int runs = indices.size() > 300000 ? 3 : 20;
+
+		std::vector<Vertex> legacy = vertices;
+		double legacyTime = TimeBest(runs, [&]() {
+			CalculateTangentsLegacy(legacy.data(), (int)legacy.size(), indices.data(), (int)indices.size());
+		});
+
+		std::vector<Vertex> serial = vertices;
+		double serialTime = TimeBest(runs, [&]() {
+			CalculateTangents(serial.data(), serial.size(), indices.data(), indices.size(), 1);
+		});
+
+		std::vector<Vertex> parallel = vertices;
+		double parallelTime = TimeBest(runs, [&]() {
+			CalculateTangents(parallel.data(), parallel.size(), indices.data(), indices.size());
+		});
+
+		printf("%s: %zu triangles, %zu vertices\n", name, indices.size() / 3, vertices.size());
+		printf("  scalar loop       %8.2f ms\n", legacyTime);
+		printf("  serial            %8.2f ms  %5.2fx  (differs by %.3g)\n", serialTime, legacyTime / serialTime, GetLargestDifference(legacy, serial));
+		printf("  parallel          %8.2f ms  %5.2fx  (differs by %.3g, %u threads)\n", parallelTime, legacyTime / parallelTime, GetLargestDifference(legacy, parallel),
+			WorkerPool::GetInstance().GetThreadCount());
+	}
+
+	// A wavy grid of size x size quads, in first-use order
+	void MakeGrid(unsigned int size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		for (unsigned int y = 0; y <= size; y++)
+		{
+			for (unsigned int x = 0; x <= size; x++)
+			{
+				Vertex v = {};
+				v.Position = XMFLOAT3(x * 0.01f, sinf(x * 0.05f) * cosf(y * 0.03f), y * 0.01f);
+				v.Normal = XMFLOAT3(0, 1, 0);
+				v.UV = XMFLOAT2((float)x / size, (float)y / size);
+				vertices.push_back(v);
+			}
+		}
+
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				unsigned int a = y * (size + 1) + x;
+				unsigned int c = a + size + 1;
+				unsigned int quad[] = { a, c, a + 1, a + 1, c, c + 1 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string path = argv[i];
+		ObjMeshData mesh;
+		if (!LoadObj(std::wstring(path.begin(), path.end()), mesh))
+		{
+			printf("Can't load %s\n", argv[i]);
+			continue;
+		}
+
+		WeldVertices(mesh.Vertices, mesh.Indices);
+		OptimizeVertexCache(mesh.Indices, mesh.Vertices.size());
+		OptimizeVertexFetch(mesh.Vertices, mesh.Indices);
+		Benchmark(argv[i], mesh.Vertices, mesh.Indices);
+	}
+
+	// About one and two million triangles
+	for (unsigned int size : { 708u, 1000u })
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		MakeGrid(size, vertices, indices);
+		Benchmark(size == 708 ? "grid, 1M" : "grid, 2M", vertices, indices);
+	}
+
+	delete &WorkerPool::GetInstance();
+	return 0;
+}
@@ -0,0 +1,345 @@
+#include "FakeD3D.h"
+
+#include <cstring>
+#include <memory>
+
+FakeShader FakeD3D::NextShader;
+bool FakeD3D::SupportsConstantOffsets = true;
+FakeD3DCounts FakeD3D::Counts;
+std::vector<FakeElement> FakeD3D::LastInputLayout;
+std::vector<FakeElement> FakeD3D::LastStreamOut;
+unsigned int FakeD3D::LastDispatch[3] = {};
+unsigned int FakeD3D::LastUpdateStart = 0;
+unsigned int FakeD3D::LastUpdateEnd = 0;
+FakeConstantBinding FakeD3D::VSConstantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+FakeConstantBinding FakeD3D::PSConstantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+
+const GUID IID_ID3D11ShaderReflection = { 0x8d536ca1 };
+
+void FakeD3D::CreateDevice(ID3D11Device** device, ID3D11DeviceContext** context)
+{
+	*device = new ID3D11Device();
+	*context = new ID3D11DeviceContext1();
+}
+
+namespace
+{
+	struct FakeBlob : ID3DBlob
+	{
+		std::string Contents;
+	};
+
+	struct FakeVariableReflection : ID3D11ShaderReflectionVariable
+	{
+		const FakeVariable* Variable;
+	};
+
+	struct FakeBufferReflection : ID3D11ShaderReflectionConstantBuffer
+	{
+		const FakeConstantBuffer* Buffer;
+		std::vector<FakeVariableReflection> Variables;
+	};
+
+	// Owns everything it hands out, as the real reflection does
+	struct FakeReflection : ID3D11ShaderReflection
+	{
+		FakeShader Shader;
+		std::vector<std::unique_ptr<FakeBufferReflection>> Buffers;
+	};
+
+	void Bind(FakeConstantBinding* slots, UINT slot, ID3D11Buffer* buffer, const UINT* firstConstant, const UINT* constantCount)
+	{
+		slots[slot].Buffer = buffer;
+		slots[slot].FirstConstant = firstConstant ? *firstConstant : 0;
+		slots[slot].ConstantCount = constantCount ? *constantCount : (unsigned int)((FakeBuffer*)buffer)->Memory.size() / 16;
+		FakeD3D::Counts.ConstantBufferBinds++;
+	}
+}
+
+// ------ Shader loading and reflection ----------------------------------------
+
+void* ID3DBlob::GetBufferPointer() { return &((FakeBlob*)this)->Contents[0]; }
+SIZE_T ID3DBlob::GetBufferSize() { return ((FakeBlob*)this)->Contents.size(); }
+
+HRESULT D3DReadFileToBlob(LPCWSTR, ID3DBlob** contents)
+{
+	FakeBlob* blob = new FakeBlob();
+	blob->Contents = FakeD3D::NextShader.Bytecode;
+	*contents = blob;
+	return S_OK;
+}
+
+HRESULT D3DReflect(const void*, SIZE_T, const GUID&, void** reflector)
+{
+	FakeD3D::Counts.Reflects++;
+	FakeReflection* reflection = new FakeReflection();
+	reflection->Shader = FakeD3D::NextShader;
+	for (const FakeConstantBuffer& buffer : reflection->Shader.ConstantBuffers)
+	{
+		std::unique_ptr<FakeBufferReflection> bufferReflection(new FakeBufferReflection());
+		bufferReflection->Buffer = &buffer;
+		for (const FakeVariable& variable : buffer.Variables)
+		{
+			FakeVariableReflection variableReflection;
+			variableReflection.Variable = &variable;
+			bufferReflection->Variables.push_back(variableReflection);
+		}
+		reflection->Buffers.push_back(std::move(bufferReflection));
+	}
+
+	*reflector = reflection;
+	return S_OK;
+}
+
+HRESULT ID3D11ShaderReflection::GetDesc(D3D11_SHADER_DESC* desc)
+{
+	const FakeShader& shader = ((FakeReflection*)this)->Shader;
+	*desc = {};
+	desc->ConstantBuffers = (UINT)shader.ConstantBuffers.size();
+	desc->BoundResources = (UINT)(shader.ConstantBuffers.size() + shader.Resources.size());
+	desc->InputParameters = (UINT)shader.Inputs.size();
+	desc->OutputParameters = (UINT)shader.Outputs.size();
+	return S_OK;
+}
+
+// Constant buffers first, then the other resources
+HRESULT ID3D11ShaderReflection::GetResourceBindingDesc(UINT index, D3D11_SHADER_INPUT_BIND_DESC* desc)
+{
+	const FakeShader& shader = ((FakeReflection*)this)->Shader;
+	*desc = {};
+	desc->BindCount = 1;
+	if (index < shader.ConstantBuffers.size())
+	{
+		desc->Name = shader.ConstantBuffers[index].Name.c_str();
+		desc->Type = D3D_SIT_CBUFFER;
+		desc->BindPoint = shader.ConstantBuffers[index].BindIndex;
+		return S_OK;
+	}
+
+	index -= (UINT)shader.ConstantBuffers.size();
+	if (index >= shader.Resources.size())
+		return E_FAIL;
+
+	desc->Name = shader.Resources[index].Name.c_str();
+	desc->Type = shader.Resources[index].Type;
+	desc->BindPoint = shader.Resources[index].BindIndex;
+	return S_OK;
+}
+
+HRESULT ID3D11ShaderReflection::GetResourceBindingDescByName(LPCSTR name, D3D11_SHADER_INPUT_BIND_DESC* desc)
+{
+	const FakeShader& shader = ((FakeReflection*)this)->Shader;
+	for (UINT i = 0; i < shader.ConstantBuffers.size() + shader.Resources.size(); i++)
+	{
+		GetResourceBindingDesc(i, desc);
+		if (strcmp(desc->Name, name) == 0)
+			return S_OK;
+	}
+	return E_FAIL;
+}
+
+ID3D11ShaderReflectionConstantBuffer* ID3D11ShaderReflection::GetConstantBufferByIndex(UINT index)
+{
+	return ((FakeReflection*)this)->Buffers[index].get();
+}
+
+namespace
+{
+	HRESULT GetParameterDesc(const std::vector<FakeParameter>& parameters, UINT index, D3D11_SIGNATURE_PARAMETER_DESC* desc)
+	{
+		if (index >= parameters.size())
+			return E_FAIL;
+
+		*desc = {};
+		desc->SemanticName = parameters[index].SemanticName.c_str();
+		desc->SemanticIndex = parameters[index].SemanticIndex;
+		desc->ComponentType = parameters[index].ComponentType;
+		desc->Mask = parameters[index].Mask;
+		return S_OK;
+	}
+}
+
+HRESULT ID3D11ShaderReflection::GetInputParameterDesc(UINT index, D3D11_SIGNATURE_PARAMETER_DESC* desc)
+{
+	return GetParameterDesc(((FakeReflection*)this)->Shader.Inputs, index, desc);
+}
+
+HRESULT ID3D11ShaderReflection::GetOutputParameterDesc(UINT index, D3D11_SIGNATURE_PARAMETER_DESC* desc)
+{
+	return GetParameterDesc(((FakeReflection*)this)->Shader.Outputs, index, desc);
+}
+
+UINT ID3D11ShaderReflection::GetThreadGroupSize(UINT* x, UINT* y, UINT* z)
+{
+	const FakeShader& shader = ((FakeReflection*)this)->Shader;
+	*x = shader.ThreadGroupSize[0];
+	*y = shader.ThreadGroupSize[1];
+	*z = shader.ThreadGroupSize[2];
+	return *x * *y * *z;
+}
+
+HRESULT ID3D11ShaderReflectionConstantBuffer::GetDesc(D3D11_SHADER_BUFFER_DESC* desc)
+{
+	const FakeConstantBuffer* buffer = ((FakeBufferReflection*)this)->Buffer;
+	*desc = {};
+	desc->Name = buffer->Name.c_str();
+	desc->Type = D3D11_CT_CBUFFER;
+	desc->Variables = (UINT)buffer->Variables.size();
+	desc->Size = buffer->Size;
+	return S_OK;
+}
+
+ID3D11ShaderReflectionVariable* ID3D11ShaderReflectionConstantBuffer::GetVariableByIndex(UINT index)
+{
+	return &((FakeBufferReflection*)this)->Variables[index];
+}
+
+HRESULT ID3D11ShaderReflectionVariable::GetDesc(D3D11_SHADER_VARIABLE_DESC* desc)
+{
+	const FakeVariable* variable = ((FakeVariableReflection*)this)->Variable;
+	*desc = {};
+	desc->Name = variable->Name.c_str();
+	desc->StartOffset = variable->Offset;
+	desc->Size = variable->Size;
+	return S_OK;
+}
+
+// ------ Device ---------------------------------------------------------------
+
+HRESULT ID3D11Device::CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer)
+{
+	FakeBuffer* fake = new FakeBuffer();
+	fake->Desc = *desc;
+	fake->Memory.assign(desc->ByteWidth, 0);
+	if (initialData)
+		memcpy(fake->Memory.data(), initialData->pSysMem, desc->ByteWidth);
+
+	*buffer = fake;
+	FakeD3D::Counts.BuffersCreated++;
+	return S_OK;
+}
+
+HRESULT ID3D11Device::CheckFeatureSupport(D3D11_FEATURE, void* data, UINT)
+{
+	D3D11_FEATURE_DATA_D3D11_OPTIONS* options = (D3D11_FEATURE_DATA_D3D11_OPTIONS*)data;
+	*options = {};
+	options->ConstantBufferOffsetting = FakeD3D::SupportsConstantOffsets;
+	options->MapNoOverwriteOnDynamicConstantBuffer = FakeD3D::SupportsConstantOffsets;
+	return S_OK;
+}
+
+HRESULT ID3D11Device::CreateTexture2D(const D3D11_TEXTURE2D_DESC*, const D3D11_SUBRESOURCE_DATA*, ID3D11Texture2D** texture) { *texture = new ID3D11Texture2D(); return S_OK; }
+HRESULT ID3D11Device::CreateShaderResourceView(ID3D11Resource*, const D3D11_SHADER_RESOURCE_VIEW_DESC*, ID3D11ShaderResourceView** view) { *view = new ID3D11ShaderResourceView(); return S_OK; }
+
+HRESULT ID3D11Device::CreateVertexShader(const void*, SIZE_T, void*, ID3D11VertexShader** shader) { *shader = new ID3D11VertexShader(); return S_OK; }
+HRESULT ID3D11Device::CreatePixelShader(const void*, SIZE_T, void*, ID3D11PixelShader** shader) { *shader = new ID3D11PixelShader(); return S_OK; }
+HRESULT ID3D11Device::CreateHullShader(const void*, SIZE_T, void*, ID3D11HullShader** shader) { *shader = new ID3D11HullShader(); return S_OK; }
+HRESULT ID3D11Device::CreateDomainShader(const void*, SIZE_T, void*, ID3D11DomainShader** shader) { *shader = new ID3D11DomainShader(); return S_OK; }
+HRESULT ID3D11Device::CreateGeometryShader(const void*, SIZE_T, void*, ID3D11GeometryShader** shader) { *shader = new ID3D11GeometryShader(); return S_OK; }
+HRESULT ID3D11Device::CreateComputeShader(const void*, SIZE_T, void*, ID3D11ComputeShader** shader) { *shader = new ID3D11ComputeShader(); return S_OK; }
+
+// Records what it's given, for tests to check
+HRESULT ID3D11Device::CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT count, const void*, SIZE_T, ID3D11InputLayout** layout)
+{
+	FakeD3D::LastInputLayout.clear();
+	for (UINT i = 0; i < count; i++)
+		FakeD3D::LastInputLayout.push_back({ elements[i].SemanticName, elements[i].SemanticIndex, (unsigned int)elements[i].Format, elements[i].InputSlot, elements[i].InputSlotClass == D3D11_INPUT_PER_INSTANCE_DATA });
+
+	*layout = new ID3D11InputLayout();
+	return S_OK;
+}
+
+HRESULT ID3D11Device::CreateGeometryShaderWithStreamOutput(const void*, SIZE_T, const D3D11_SO_DECLARATION_ENTRY* entries, UINT entryCount, const UINT*, UINT, UINT, void*, ID3D11GeometryShader** shader)
+{
+	FakeD3D::LastStreamOut.clear();
+	for (UINT i = 0; i < entryCount; i++)
+		FakeD3D::LastStreamOut.push_back({ entries[i].SemanticName, entries[i].SemanticIndex, entries[i].ComponentCount, entries[i].Stream, false });
+
+	*shader = new ID3D11GeometryShader();
+	return S_OK;
+}
+
+// ------ Context --------------------------------------------------------------
+
+// Discarding renames the buffer, so what was there is gone
+HRESULT ID3D11DeviceContext::Map(ID3D11Resource* resource, UINT, D3D11_MAP type, UINT, D3D11_MAPPED_SUBRESOURCE* mapped)
+{
+	FakeBuffer* buffer = (FakeBuffer*)resource;
+	if (type == D3D11_MAP_WRITE_DISCARD)
+	{
+		buffer->Memory.assign(buffer->Memory.size(), 0xCD);
+		FakeD3D::Counts.Discards++;
+	}
+	else if (type == D3D11_MAP_WRITE_NO_OVERWRITE)
+	{
+		FakeD3D::Counts.NoOverwrites++;
+	}
+
+	*mapped = {};
+	mapped->pData = buffer->Memory.data();
+	FakeD3D::Counts.Maps++;
+	return S_OK;
+}
+
+void ID3D11DeviceContext::Unmap(ID3D11Resource*, UINT) {}
+
+void ID3D11DeviceContext::UpdateSubresource(ID3D11Resource* resource, UINT, const D3D11_BOX* box, const void* data, UINT, UINT)
+{
+	FakeBuffer* buffer = (FakeBuffer*)resource;
+	unsigned int start = box ? box->left : 0;
+	unsigned int end = box ? box->right : (unsigned int)buffer->Memory.size();
+	memcpy(buffer->Memory.data() + start, data, end - start);
+
+	FakeD3D::LastUpdateStart = start;
+	FakeD3D::LastUpdateEnd = end;
+	FakeD3D::Counts.Updates++;
+	FakeD3D::Counts.UpdateBytes += end - start;
+}
+
+void ID3D11DeviceContext::VSSetConstantBuffers(UINT slot, UINT, ID3D11Buffer* const* buffers) { Bind(FakeD3D::VSConstantBuffers, slot, buffers[0], 0, 0); }
+void ID3D11DeviceContext::PSSetConstantBuffers(UINT slot, UINT, ID3D11Buffer* const* buffers) { Bind(FakeD3D::PSConstantBuffers, slot, buffers[0], 0, 0); }
+void ID3D11DeviceContext1::VSSetConstantBuffers1(UINT slot, UINT, ID3D11Buffer* const* buffers, const UINT* firstConstant, const UINT* constantCount) { Bind(FakeD3D::VSConstantBuffers, slot, buffers[0], firstConstant, constantCount); }
+void ID3D11DeviceContext1::PSSetConstantBuffers1(UINT slot, UINT, ID3D11Buffer* const* buffers, const UINT* firstConstant, const UINT* constantCount) { Bind(FakeD3D::PSConstantBuffers, slot, buffers[0], firstConstant, constantCount); }
+
+void ID3D11DeviceContext::Dispatch(UINT x, UINT y, UINT z)
+{
+	FakeD3D::LastDispatch[0] = x;
+	FakeD3D::LastDispatch[1] = y;
+	FakeD3D::LastDispatch[2] = z;
+}
+
+// Everything else is accepted and ignored
+void ID3D11DeviceContext::IASetInputLayout(ID3D11InputLayout*) {}
+void ID3D11DeviceContext::IASetVertexBuffers(UINT, UINT, ID3D11Buffer* const*, const UINT*, const UINT*) {}
+void ID3D11DeviceContext::IASetIndexBuffer(ID3D11Buffer*, DXGI_FORMAT, UINT) {}
+void ID3D11DeviceContext::Draw(UINT, UINT) {}
+void ID3D11DeviceContext::DrawIndexed(UINT, UINT, INT) {}
+void ID3D11DeviceContext::CopySubresourceRegion(ID3D11Resource*, UINT, UINT, UINT, UINT, ID3D11Resource*, UINT, const D3D11_BOX*) {}
+void ID3D11DeviceContext::GenerateMips(ID3D11ShaderResourceView*) {}
+void ID3D11DeviceContext::SOSetTargets(UINT, ID3D11Buffer* const*, const UINT*) {}
+void ID3D11DeviceContext::CSSetUnorderedAccessViews(UINT, UINT, ID3D11UnorderedAccessView* const*, const UINT*) {}
+
+#define FAKE_SHADER_STAGE(stage, shaderType) \
+	void ID3D11DeviceContext::stage##SetShader(shaderType*, void*, UINT) {} \
+	void ID3D11DeviceContext::stage##SetShaderResources(UINT, UINT, ID3D11ShaderResourceView* const*) {} \
+	void ID3D11DeviceContext::stage##SetSamplers(UINT, UINT, ID3D11SamplerState* const*) {}
+
+FAKE_SHADER_STAGE(VS, ID3D11VertexShader)
+FAKE_SHADER_STAGE(PS, ID3D11PixelShader)
+FAKE_SHADER_STAGE(HS, ID3D11HullShader)
+FAKE_SHADER_STAGE(DS, ID3D11DomainShader)
+FAKE_SHADER_STAGE(GS, ID3D11GeometryShader)
+FAKE_SHADER_STAGE(CS, ID3D11ComputeShader)
+
+#undef FAKE_SHADER_STAGE
+
+#define FAKE_CONSTANT_BUFFERS(stage) \
+	void ID3D11DeviceContext::stage##SetConstantBuffers(UINT, UINT, ID3D11Buffer* const*) {} \
+	void ID3D11DeviceContext1::stage##SetConstantBuffers1(UINT, UINT, ID3D11Buffer* const*, const UINT*, const UINT*) {}
+
+FAKE_CONSTANT_BUFFERS(HS)
+FAKE_CONSTANT_BUFFERS(DS)
+FAKE_CONSTANT_BUFFERS(GS)
+FAKE_CONSTANT_BUFFERS(CS)
+
+#undef FAKE_CONSTANT_BUFFERS
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <d3d11_1.h>
+#include <d3dcompiler.h>
+
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// A fake Direct3D device and context for host tests, on
+// top of the d3d11.h shim.  Buffers are plain memory,
+// shaders are whatever NextShader describes, and the calls
+// that move constants around are counted and recorded, so
+// a test can check what the engine sent to the GPU.
+// --------------------------------------------------------
+
+struct FakeVariable
+{
+	std::string Name;
+	unsigned int Offset;
+	unsigned int Size;
+};
+
+struct FakeConstantBuffer
+{
+	std::string Name;
+	unsigned int BindIndex;
+	unsigned int Size;
+	std::vector<FakeVariable> Variables;
+};
+
+struct FakeResource
+{
+	std::string Name;
+	D3D_SHADER_INPUT_TYPE Type;
+	unsigned int BindIndex;
+};
+
+// An input or output signature entry
+struct FakeParameter
+{
+	std::string SemanticName;
+	unsigned int SemanticIndex;
+	D3D_REGISTER_COMPONENT_TYPE ComponentType;
+	unsigned char Mask;
+};
+
+// What loading a shader file reads (Bytecode) and what
+// reflecting it describes.  Give each distinct shader its
+// own bytecode, or the engine's reflection cache may
+// answer for it.
+struct FakeShader
+{
+	std::string Bytecode;
+	std::vector<FakeConstantBuffer> ConstantBuffers;
+	std::vector<FakeResource> Resources;
+	std::vector<FakeParameter> Inputs;
+	std::vector<FakeParameter> Outputs;
+	unsigned int ThreadGroupSize[3] = { 1, 1, 1 };
+};
+
+// An input layout element or stream out entry as the engine
+// described it, with the name copied out
+struct FakeElement
+{
+	std::string SemanticName;
+	unsigned int SemanticIndex;
+	unsigned int Value;		// The format, or the component count
+	unsigned int Slot;		// The input slot, or the stream
+	bool PerInstance;
+};
+
+struct FakeBuffer : ID3D11Buffer
+{
+	D3D11_BUFFER_DESC Desc;
+	std::vector<unsigned char> Memory;
+};
+
+// A constant buffer slot as last bound, in 16-byte constants
+struct FakeConstantBinding
+{
+	ID3D11Buffer* Buffer = 0;
+	unsigned int FirstConstant = 0;
+	unsigned int ConstantCount = 0;
+};
+
+struct FakeD3DCounts
+{
+	unsigned int BuffersCreated = 0;
+	unsigned int Reflects = 0;
+	unsigned int Updates = 0;			// UpdateSubresource()
+	size_t UpdateBytes = 0;
+	unsigned int Maps = 0;
+	unsigned int Discards = 0;
+	unsigned int NoOverwrites = 0;
+	unsigned int ConstantBufferBinds = 0;
+};
+
+namespace FakeD3D
+{
+	extern FakeShader NextShader;
+	extern bool SupportsConstantOffsets;	// What CheckFeatureSupport() reports for 11.1
+	extern FakeD3DCounts Counts;
+
+	// What the last CreateInputLayout() and
+	// CreateGeometryShaderWithStreamOutput() were given
+	extern std::vector<FakeElement> LastInputLayout;
+	extern std::vector<FakeElement> LastStreamOut;
+
+	// The thread groups the last Dispatch() asked for
+	extern unsigned int LastDispatch[3];
+
+	// The range of the last UpdateSubresource(), in bytes
+	extern unsigned int LastUpdateStart;
+	extern unsigned int LastUpdateEnd;
+
+	extern FakeConstantBinding VSConstantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	extern FakeConstantBinding PSConstantBuffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+
+	// Each with one reference, handed to the caller, as D3D11CreateDevice()
+	void CreateDevice(ID3D11Device** device, ID3D11DeviceContext** context);
+}
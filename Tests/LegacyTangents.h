@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Vertex.h"
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// The scalar loop Mesh::CalculateTangents() used to be,
+// kept as it was (apart from the wider Tangent, whose w it
+// leaves at 0) as the reference CalculateTangents() is
+// checked and timed against
+// --------------------------------------------------------
+inline void CalculateTangentsLegacy(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices)
+{
+	using namespace DirectX;
+
+	for (int i = 0; i < numVerts; i++)
+		verts[i].Tangent = XMFLOAT4(0, 0, 0, 0);
+
+	for (int i = 0; i < numIndices;)
+	{
+		Vertex* v1 = &verts[indices[i++]];
+		Vertex* v2 = &verts[indices[i++]];
+		Vertex* v3 = &verts[indices[i++]];
+
+		float x1 = v2->Position.x - v1->Position.x;
+		float y1 = v2->Position.y - v1->Position.y;
+		float z1 = v2->Position.z - v1->Position.z;
+
+		float x2 = v3->Position.x - v1->Position.x;
+		float y2 = v3->Position.y - v1->Position.y;
+		float z2 = v3->Position.z - v1->Position.z;
+
+		float s1 = v2->UV.x - v1->UV.x;
+		float t1 = v2->UV.y - v1->UV.y;
+
+		float s2 = v3->UV.x - v1->UV.x;
+		float t2 = v3->UV.y - v1->UV.y;
+
+		float r = 1.0f / (s1 * t2 - s2 * t1);
+
+		float tx = (t2 * x1 - t1 * x2) * r;
+		float ty = (t2 * y1 - t1 * y2) * r;
+		float tz = (t2 * z1 - t1 * z2) * r;
+
+		for (Vertex* v : { v1, v2, v3 })
+		{
+			v->Tangent.x += tx;
+			v->Tangent.y += ty;
+			v->Tangent.z += tz;
+		}
+	}
+
+	for (int i = 0; i < numVerts; i++)
+	{
+		XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
+		XMVECTOR tangent = XMLoadFloat3((XMFLOAT3*)&verts[i].Tangent);
+		tangent = XMVector3Normalize(tangent - normal * XMVector3Dot(normal, tangent));
+		XMStoreFloat3((XMFLOAT3*)&verts[i].Tangent, tangent);
+	}
+}
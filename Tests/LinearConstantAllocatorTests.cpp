@@ -0,0 +1,199 @@
+#include "LinearConstantAllocator.h"
+#include "TestCheck.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Stands in for a dynamic buffer as the driver sees it:
+	// mapping with discard renames it, so everything written
+	// before is gone (filled with garbage here), while
+	// no-overwrite keeps the contents
+	// --------------------------------------------------------
+	struct FakeMapping
+	{
+		std::vector<unsigned char> Memory;
+		unsigned int Discards = 0;
+		unsigned int NoOverwrites = 0;
+
+		explicit FakeMapping(unsigned int size) : Memory(size, 0xCD) {}
+
+		unsigned char* Map(ConstantMapMode mode)
+		{
+			if (mode == ConstantMapMode::Discard)
+			{
+				Memory.assign(Memory.size(), 0xCD);
+				Discards++;
+			}
+			else
+			{
+				NoOverwrites++;
+			}
+			return Memory.data();
+		}
+	};
+
+	void TestAlignment()
+	{
+		LinearConstantAllocator allocator(4096 + 100);
+		CHECK(allocator.GetCapacity() == 4096);
+
+		allocator.BeginFrame();
+		ConstantSlice slice;
+		ConstantMapMode mode;
+		unsigned int sizes[] = { 1, 16, 255, 256, 257, 700 };
+		for (unsigned int size : sizes)
+		{
+			CHECK(allocator.Allocate(size, slice, mode));
+			CHECK(slice.Offset % CONSTANT_SLICE_ALIGNMENT == 0);
+			CHECK(slice.Size % CONSTANT_SLICE_ALIGNMENT == 0 && slice.Size >= size && slice.Size < size + CONSTANT_SLICE_ALIGNMENT);
+			CHECK(slice.GetFirstConstant() % 16 == 0 && slice.GetConstantCount() % 16 == 0);
+		}
+		CHECK(allocator.GetStats().BytesRequested == 1 + 16 + 255 + 256 + 257 + 700);
+		CHECK(allocator.GetStats().BytesAllocated == allocator.GetUsed());
+
+		// Nothing, or more than one binding can see
+		ConstantSlice untouched;
+		untouched.Offset = 12345;
+		slice = untouched;
+		CHECK(!allocator.Allocate(0, slice, mode) && slice.Offset == 12345);
+		CHECK(!allocator.Allocate(CONSTANT_SLICE_MAX_SIZE + 1, slice, mode) && slice.Offset == 12345);
+	}
+
+	void TestOverflow()
+	{
+		LinearConstantAllocator allocator(1024);
+		allocator.BeginFrame();
+		ConstantSlice slice;
+		ConstantMapMode mode;
+		CHECK(allocator.Allocate(700, slice, mode));
+
+		// 768 bytes used: a 512-byte slice doesn't fit, and fails rather
+		// than wrapping over what's already in use
+		ConstantSlice untouched;
+		untouched.Offset = 12345;
+		slice = untouched;
+		CHECK(!allocator.Allocate(300, slice, mode) && slice.Offset == 12345);
+		CHECK(allocator.GetStats().Overflows == 1 && allocator.GetUsed() == 768);
+
+		// What does fit still goes in
+		CHECK(allocator.Allocate(256, slice, mode) && slice.Offset == 768);
+		CHECK(allocator.GetUsed() == 1024);
+
+		// The next frame starts over with everything free
+		allocator.BeginFrame();
+		CHECK(allocator.Allocate(1024, slice, mode) && slice.Offset == 0 && mode == ConstantMapMode::Discard);
+	}
+
+	void TestGenerations()
+	{
+		LinearConstantAllocator allocator(4096);
+		ConstantSlice never;
+		CHECK(!allocator.IsCurrent(never));
+
+		allocator.BeginFrame();
+		ConstantSlice slice;
+		ConstantMapMode mode;
+		CHECK(allocator.Allocate(64, slice, mode) && allocator.IsCurrent(slice));
+
+		// A new frame expires it right away, before any new allocation
+		allocator.BeginFrame();
+		CHECK(!allocator.IsCurrent(slice));
+
+		ConstantSlice next;
+		CHECK(allocator.Allocate(64, next, mode) && allocator.IsCurrent(next));
+		CHECK(next.Generation > slice.Generation);
+
+		// So does moving to a new buffer, and the generation only counts up,
+		// so a slice from before can never match again
+		allocator.Reset(8192);
+		CHECK(allocator.GetCapacity() == 8192 && allocator.GetUsed() == 0);
+		CHECK(!allocator.IsCurrent(next) && !allocator.IsCurrent(slice));
+
+		// The new buffer is undefined, so its first write discards too
+		ConstantSlice afterReset;
+		CHECK(allocator.Allocate(64, afterReset, mode) && mode == ConstantMapMode::Discard);
+		CHECK(afterReset.Generation > next.Generation);
+	}
+
+	// --------------------------------------------------------
+	// Random frames against the fake mapping: only a frame's
+	// first slice discards, slices never overlap, and nothing
+	// written later in the frame touches what earlier slices
+	// (and so earlier draws) still read
+	// --------------------------------------------------------
+	void TestFramesAgainstMapping()
+	{
+		std::mt19937 rng(7);
+		LinearConstantAllocator allocator(4096);
+		FakeMapping mapping(4096);
+
+		struct Written
+		{
+			ConstantSlice Slice;
+			unsigned int Size;
+			unsigned char Value;
+		};
+
+		for (int frame = 0; frame < 200; frame++)
+		{
+			allocator.BeginFrame();
+			unsigned int discardsBefore = mapping.Discards;
+			std::vector<Written> written;
+
+			for (int i = 0; i < 20; i++)
+			{
+				unsigned int size = 16 + rng() % 700;
+				unsigned int used = allocator.GetUsed();
+				ConstantSlice slice;
+				ConstantMapMode mode;
+				bool allocated = allocator.Allocate(size, slice, mode);
+
+				unsigned int needed = (size + CONSTANT_SLICE_ALIGNMENT - 1) / CONSTANT_SLICE_ALIGNMENT * CONSTANT_SLICE_ALIGNMENT;
+				CHECK(allocated == (needed <= allocator.GetCapacity() - used));
+				if (!allocated)
+					continue;
+
+				CHECK((mode == ConstantMapMode::Discard) == written.empty());
+				CHECK(slice.Offset + slice.Size <= allocator.GetCapacity());
+
+				unsigned char value = (unsigned char)rng();
+				memset(mapping.Map(mode) + slice.Offset, value, size);
+				written.push_back({ slice, size, value });
+			}
+
+			CHECK(mapping.Discards - discardsBefore == (written.empty() ? 0u : 1u));
+			CHECK(allocator.GetStats().Discards == mapping.Discards - discardsBefore);
+			CHECK(allocator.GetStats().Allocations == written.size());
+
+			for (size_t i = 0; i < written.size(); i++)
+			{
+				const Written& w = written[i];
+				CHECK(allocator.IsCurrent(w.Slice));
+				for (unsigned int b = 0; b < w.Size; b++)
+				{
+					if (mapping.Memory[w.Slice.Offset + b] != w.Value)
+					{
+						CHECK(mapping.Memory[w.Slice.Offset + b] == w.Value);
+						break;
+					}
+				}
+				if (i > 0)
+					CHECK(written[i - 1].Slice.Offset + written[i - 1].Slice.Size <= w.Slice.Offset);
+			}
+		}
+	}
+}
+
+int main()
+{
+	TestAlignment();
+	TestOverflow();
+	TestGenerations();
+	TestFramesAgainstMapping();
+
+	return TestResult("LinearConstantAllocatorTests");
+}
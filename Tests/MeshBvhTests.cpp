@@ -0,0 +1,336 @@
+#include "MeshBvh.h"
+#include "MeshOptimizer.h"
+#include "ObjParser.h"
+#include "WorkerPool.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+// Usage: MeshBvhTests <file.obj>...
+//
+// Checks MeshBvh::Raycast() against a brute-force cast over
+// every triangle: scattered rays at each model, rays along
+// the axes (whose reciprocal directions are infinite, some
+// starting right on a box's face) over a grid, the distance
+// limits, and trees whose only leaf holds fewer than four
+// triangles.
+
+namespace
+{
+	// --------------------------------------------------------
+	// Scalar Moller-Trumbore against every triangle in turn:
+	// slow, but nothing to get wrong.  Returns the distance to
+	// the closest (two-sided) hit, or FLT_MAX.
+	// --------------------------------------------------------
+	float RaycastBruteForce(const std::vector<XMFLOAT3>& positions, const std::vector<unsigned int>& indices, const Ray& ray)
+	{
+		XMVECTOR origin = XMLoadFloat3(&ray.Origin);
+		XMVECTOR direction = XMLoadFloat3(&ray.Direction);
+		float closest = FLT_MAX;
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			XMVECTOR a = XMLoadFloat3(&positions[indices[t]]);
+			XMVECTOR edge1 = XMLoadFloat3(&positions[indices[t + 1]]) - a;
+			XMVECTOR edge2 = XMLoadFloat3(&positions[indices[t + 2]]) - a;
+
+			XMVECTOR p = XMVector3Cross(direction, edge2);
+			float determinant = XMVectorGetX(XMVector3Dot(edge1, p));
+			if (std::fabs(determinant) <= 1e-20f)
+				continue;
+			float inverse = 1.0f / determinant;
+
+			XMVECTOR toOrigin = origin - a;
+			float u = XMVectorGetX(XMVector3Dot(toOrigin, p)) * inverse;
+			if (u < 0.0f)
+				continue;
+			XMVECTOR q = XMVector3Cross(toOrigin, edge1);
+			float v = XMVectorGetX(XMVector3Dot(direction, q)) * inverse;
+			if (v < 0.0f || u + v > 1.0f)
+				continue;
+
+			float distance = XMVectorGetX(XMVector3Dot(edge2, q)) * inverse;
+			if (distance >= 0.0f && distance < closest)
+				closest = distance;
+		}
+		return closest;
+	}
+
+	MeshBvh Build(const std::vector<XMFLOAT3>& positions, const std::vector<unsigned int>& indices)
+	{
+		MeshBvh bvh;
+		bvh.Build(positions.data(), (unsigned int)positions.size(), indices.data(), (unsigned int)indices.size());
+		return bvh;
+	}
+
+	// Casts the ray both ways and counts it if they disagree
+	bool MatchesBruteForce(const MeshBvh& bvh, const std::vector<XMFLOAT3>& positions, const std::vector<unsigned int>& indices, const Ray& ray)
+	{
+		RayHit hit;
+		bool found = bvh.Raycast(XMLoadFloat3(&ray.Origin), XMLoadFloat3(&ray.Direction), ray.MaxDistance, hit);
+		float expected = RaycastBruteForce(positions, indices, ray);
+		if (expected == FLT_MAX)
+			return !found && !hit.IsHit();
+		return found && hit.IsHit() && hit.Triangle < indices.size() / 3 && std::fabs(hit.Distance - expected) <= 1e-4f * std::max(1.0f, expected);
+	}
+
+	// --------------------------------------------------------
+	// Rays from random points on a sphere around the model to
+	// random points in its bounds
+	// --------------------------------------------------------
+	void TestModel(const std::string& path)
+	{
+		ObjMeshData mesh;
+		CHECK(LoadObj(std::wstring(path.begin(), path.end()), mesh));
+		WeldVertices(mesh.Vertices, mesh.Indices);
+
+		std::vector<XMFLOAT3> positions(mesh.Vertices.size());
+		for (size_t i = 0; i < positions.size(); i++)
+			positions[i] = mesh.Vertices[i].Position;
+		MeshBvh bvh = Build(positions, mesh.Indices);
+		CHECK(bvh.GetTriangleCount() == mesh.Indices.size() / 3);
+		CHECK(bvh.GetNodeCount() <= 2 * bvh.GetTriangleCount() - 1);
+
+		XMVECTOR lowest = XMLoadFloat3(&positions[0]);
+		XMVECTOR highest = lowest;
+		for (const XMFLOAT3& p : positions)
+		{
+			lowest = XMVectorMin(lowest, XMLoadFloat3(&p));
+			highest = XMVectorMax(highest, XMLoadFloat3(&p));
+		}
+		XMVECTOR center = (lowest + highest) * 0.5f;
+		float radius = XMVectorGetX(XMVector3Length(highest - lowest));
+
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		unsigned int mismatches = 0;
+		unsigned int hits = 0;
+		const unsigned int RayCount = 5000;
+		for (unsigned int i = 0; i < RayCount; i++)
+		{
+			float z = unit(rng) * 2.0f - 1.0f;
+			float angle = unit(rng) * XM_2PI;
+			float ring = std::sqrt(1.0f - z * z);
+			XMVECTOR origin = center + XMVectorSet(ring * cosf(angle), ring * sinf(angle), z, 0.0f) * radius;
+			XMVECTOR target = lowest + (highest - lowest) * XMVectorSet(unit(rng), unit(rng), unit(rng), 0.0f);
+
+			Ray ray;
+			XMStoreFloat3(&ray.Origin, origin);
+			XMStoreFloat3(&ray.Direction, XMVector3Normalize(target - origin));
+			mismatches += !MatchesBruteForce(bvh, positions, mesh.Indices, ray);
+			hits += RaycastBruteForce(positions, mesh.Indices, ray) != FLT_MAX;
+		}
+
+		printf("%s: %u nodes, %u of %u rays hit, %u differ from brute force\n", path.c_str(), bvh.GetNodeCount(), hits, RayCount, mismatches);
+		CHECK(mismatches == 0);
+	}
+
+	// --------------------------------------------------------
+	// A size x size grid of unit quads facing down the Z axis,
+	// each at one of five heights, so neighbouring leaves'
+	// boxes share faces but not depths
+	// --------------------------------------------------------
+	void MakeGrid(unsigned int size, std::vector<XMFLOAT3>& positions, std::vector<unsigned int>& indices)
+	{
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				float z = ((x * 7 + y * 3) % 5) * 0.25f;
+				unsigned int first = (unsigned int)positions.size();
+				positions.push_back(XMFLOAT3((float)x, (float)y, z));
+				positions.push_back(XMFLOAT3(x + 1.0f, (float)y, z));
+				positions.push_back(XMFLOAT3((float)x, y + 1.0f, z));
+				positions.push_back(XMFLOAT3(x + 1.0f, y + 1.0f, z));
+				unsigned int quad[] = { first, first + 1, first + 2, first + 1, first + 3, first + 2 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Rays straight down each axis have two zero components, so
+	// the slab test sees infinite reciprocals.  Starting them on
+	// the grid's lines puts their origin on box faces too,
+	// where a zero offset times infinity would be NaN.
+	// --------------------------------------------------------
+	void TestAxisAligned()
+	{
+		const unsigned int Size = 16;
+		std::vector<XMFLOAT3> positions;
+		std::vector<unsigned int> indices;
+		MakeGrid(Size, positions, indices);
+		MeshBvh bvh = Build(positions, indices);
+		CHECK(bvh.GetLeafCount() > 1);
+
+		unsigned int mismatches = 0;
+		unsigned int hits = 0;
+		unsigned int rayCount = 0;
+		for (unsigned int i = 0; i <= Size * 4; i++)
+		{
+			for (unsigned int j = 0; j <= Size * 4; j++)
+			{
+				// Every fourth one along each line lies on a grid line
+				float x = i * 0.25f;
+				float y = j * 0.25f;
+				Ray down;
+				down.Origin = XMFLOAT3(x, y, 10.0f);
+				down.Direction = XMFLOAT3(0.0f, 0.0f, -1.0f);
+				Ray up;
+				up.Origin = XMFLOAT3(x, y, -10.0f);
+				up.Direction = XMFLOAT3(0.0f, 0.0f, 1.0f);
+				for (const Ray& ray : { down, up })
+				{
+					mismatches += !MatchesBruteForce(bvh, positions, indices, ray);
+					hits += RaycastBruteForce(positions, indices, ray) != FLT_MAX;
+					rayCount++;
+				}
+			}
+		}
+
+		// Sideways along each axis, through the quads' heights
+		for (unsigned int i = 0; i <= Size * 4; i++)
+		{
+			for (unsigned int level = 0; level < 5; level++)
+			{
+				float along = i * 0.25f;
+				float z = level * 0.25f;
+				Ray acrossX;
+				acrossX.Origin = XMFLOAT3(-1.0f, along, z);
+				acrossX.Direction = XMFLOAT3(1.0f, 0.0f, 0.0f);
+				Ray acrossY;
+				acrossY.Origin = XMFLOAT3(along, Size + 1.0f, z);
+				acrossY.Direction = XMFLOAT3(0.0f, -1.0f, 0.0f);
+				for (const Ray& ray : { acrossX, acrossY })
+				{
+					mismatches += !MatchesBruteForce(bvh, positions, indices, ray);
+					rayCount++;
+				}
+			}
+		}
+
+		printf("Axis-aligned: %u of %u rays hit, %u differ from brute force\n", hits, rayCount, mismatches);
+		CHECK(hits > 0);
+		CHECK(mismatches == 0);
+	}
+
+	// --------------------------------------------------------
+	// Hits past maxDistance, or past one already in hand, are
+	// not reported, and a miss leaves the hit as it was
+	// --------------------------------------------------------
+	void TestDistanceLimits()
+	{
+		// Two quads facing down the Z axis, at z = 5 and z = 8
+		std::vector<XMFLOAT3> positions = {
+			XMFLOAT3(-1, -1, 5), XMFLOAT3(1, -1, 5), XMFLOAT3(-1, 1, 5), XMFLOAT3(1, 1, 5),
+			XMFLOAT3(-1, -1, 8), XMFLOAT3(1, -1, 8), XMFLOAT3(-1, 1, 8), XMFLOAT3(1, 1, 8) };
+		std::vector<unsigned int> indices = { 0, 1, 2, 1, 3, 2, 4, 5, 6, 5, 7, 6 };
+		MeshBvh bvh = Build(positions, indices);
+		XMVECTOR origin = XMVectorSet(0.1f, 0.2f, 0.0f, 0.0f);
+		XMVECTOR forward = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
+
+		RayHit hit;
+		CHECK(bvh.Raycast(origin, forward, FLT_MAX, hit));
+		CHECK(std::fabs(hit.Distance - 5.0f) < 1e-5f && hit.Triangle < 2);
+
+		// Short of the first quad
+		hit = RayHit();
+		CHECK(!bvh.Raycast(origin, forward, 4.9f, hit));
+		CHECK(!hit.IsHit() && hit.Distance == FLT_MAX);
+
+		// From between the two, only the far one is in front
+		hit = RayHit();
+		CHECK(bvh.Raycast(XMVectorSet(0.1f, 0.2f, 6.0f, 0.0f), forward, FLT_MAX, hit));
+		CHECK(std::fabs(hit.Distance - 2.0f) < 1e-5f && hit.Triangle >= 2);
+		hit = RayHit();
+		CHECK(!bvh.Raycast(XMVectorSet(0.1f, 0.2f, 6.0f, 0.0f), forward, 1.5f, hit));
+
+		// A closer hit already in hand wins, and is left untouched
+		hit = RayHit();
+		hit.Distance = 3.0f;
+		hit.Triangle = 1234;
+		hit.U = 0.25f;
+		hit.V = 0.5f;
+		CHECK(!bvh.Raycast(origin, forward, FLT_MAX, hit));
+		CHECK(hit.Distance == 3.0f && hit.Triangle == 1234 && hit.U == 0.25f && hit.V == 0.5f);
+
+		// A farther one is replaced
+		hit.Distance = 6.0f;
+		CHECK(bvh.Raycast(origin, forward, FLT_MAX, hit));
+		CHECK(std::fabs(hit.Distance - 5.0f) < 1e-5f && hit.Triangle < 2);
+
+		// The closer of the two limits applies
+		hit = RayHit();
+		hit.Distance = 4.0f;
+		CHECK(!bvh.Raycast(origin, forward, 100.0f, hit));
+		CHECK(hit.Distance == 4.0f);
+
+		// The batch cast takes each ray's own limit
+		Ray rays[2];
+		rays[0].Origin = XMFLOAT3(0.1f, 0.2f, 0.0f);
+		rays[0].Direction = XMFLOAT3(0.0f, 0.0f, 1.0f);
+		rays[1] = rays[0];
+		rays[1].MaxDistance = 4.9f;
+		RayHit hits[2];
+		CHECK(bvh.Raycast(rays, 2, hits) == 1);
+		CHECK(hits[0].IsHit() && !hits[1].IsHit());
+	}
+
+	// --------------------------------------------------------
+	// One, two and three triangles: the root is the only leaf
+	// and its block has empty lanes, which must never hit
+	// --------------------------------------------------------
+	void TestSmallLeaves()
+	{
+		std::vector<XMFLOAT3> positions = {
+			XMFLOAT3(0, 0, 0), XMFLOAT3(1, 0, 0), XMFLOAT3(0, 1, 0),
+			XMFLOAT3(2, 0, 1), XMFLOAT3(3, 0, 1), XMFLOAT3(2, 1, 1),
+			XMFLOAT3(4, 0, 2), XMFLOAT3(5, 0, 2), XMFLOAT3(4, 1, 2) };
+
+		for (unsigned int triangleCount = 1; triangleCount <= 3; triangleCount++)
+		{
+			std::vector<unsigned int> indices;
+			for (unsigned int i = 0; i < triangleCount * 3; i++)
+				indices.push_back(i);
+			MeshBvh bvh = Build(positions, indices);
+			CHECK(bvh.GetNodeCount() == 1 && bvh.GetLeafCount() == 1);
+			CHECK(bvh.GetTriangleCount() == triangleCount);
+
+			for (unsigned int t = 0; t < 3; t++)
+			{
+				// Into the middle of each triangle, present or not
+				XMVECTOR target = (XMLoadFloat3(&positions[t * 3]) + XMLoadFloat3(&positions[t * 3 + 1]) + XMLoadFloat3(&positions[t * 3 + 2])) / 3.0f;
+				RayHit hit;
+				bool found = bvh.Raycast(target - XMVectorSet(0.0f, 0.0f, 4.0f, 0.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), FLT_MAX, hit);
+				CHECK(found == (t < triangleCount));
+				if (t < triangleCount)
+					CHECK(hit.Triangle == t && std::fabs(hit.Distance - 4.0f) < 1e-5f);
+			}
+
+			// Inside the leaf's box but past the first triangle's long edge
+			RayHit hit;
+			CHECK(!bvh.Raycast(XMVectorSet(0.9f, 0.9f, -4.0f, 0.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), FLT_MAX, hit));
+			CHECK(!hit.IsHit());
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	CHECK(argc > 1);
+	for (int i = 1; i < argc; i++)
+		TestModel(argv[i]);
+
+	TestAxisAligned();
+	TestDistanceLimits();
+	TestSmallLeaves();
+
+	delete &WorkerPool::GetInstance();
+	return TestResult("MeshBvhTests");
+}
@@ -0,0 +1,174 @@
+#include "MeshCache.h"
+#include "TestCheck.h"
+
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+namespace
+{
+	const wchar_t* CacheFile = L"MeshCacheTests.meshcache";
+	const char* CacheFileNarrow = "MeshCacheTests.meshcache";
+	const uint64_t SourceHash = 0x1234;
+
+	// --------------------------------------------------------
+	// A quad of two triangles in two submeshes, with a coarser
+	// level of detail and one meshlet: the smallest cache that
+	// has one of everything
+	// --------------------------------------------------------
+	struct TestMesh
+	{
+		std::vector<Vertex> Vertices = std::vector<Vertex>(4);
+		std::vector<unsigned int> Indices = { 0, 1, 2, 2, 1, 3, 0, 1, 2 };
+		std::vector<Meshlet> Meshlets = std::vector<Meshlet>(1);
+		std::vector<MeshLod> Lods = { { 0, 6, 0.0f }, { 6, 3, 0.5f } };
+		std::vector<MeshLod> SubmeshLods = { { 0, 3, 0.0f }, { 3, 3, 0.0f }, { 6, 3, 0.5f }, { 9, 0, 0.5f } };
+		std::vector<char> Names;
+
+		TestMesh()
+		{
+			for (size_t i = 0; i < Vertices.size(); i++)
+				Vertices[i].Position = DirectX::XMFLOAT3((float)(i & 1), (float)(i >> 1), 0.0f);
+			Meshlets[0].StartIndex = 0;
+			Meshlets[0].TriangleCount = 2;
+			Meshlets[0].VertexCount = 4;
+
+			const char names[] = "left\0brick\0right\0stone";
+			Names.assign(names, names + sizeof(names));
+		}
+
+		MeshCacheContents GetContents() const
+		{
+			MeshCacheContents contents;
+			contents.VertexData = Vertices.data();
+			contents.VertexStride = sizeof(Vertex);
+			contents.VertexCount = (unsigned int)Vertices.size();
+			contents.Layout = VertexLayout::Full;
+			contents.Indices = Indices.data();
+			contents.IndexCount = (unsigned int)Indices.size();
+			contents.Meshlets = Meshlets.data();
+			contents.MeshletCount = (unsigned int)Meshlets.size();
+			contents.Lods = Lods.data();
+			contents.LodCount = (unsigned int)Lods.size();
+			contents.SubmeshLods = SubmeshLods.data();
+			contents.SubmeshCount = 2;
+			contents.SubmeshNames = Names.data();
+			contents.SubmeshNameBytes = (unsigned int)Names.size();
+			return contents;
+		}
+	};
+
+	// Writes the mesh as changed by "damage", then tries to read it back
+	bool WriteAndRead(const std::function<void(TestMesh&, MeshCacheContents&)>& damage)
+	{
+		TestMesh mesh;
+		MeshCacheContents written = mesh.GetContents();
+		damage(mesh, written);
+		CHECK(WriteMeshCache(CacheFile, SourceHash, written));
+
+		MappedFile file(CacheFile);
+		MeshCacheContents read;
+		return ReadMeshCache(file, SourceHash, read);
+	}
+
+	void TestRoundTrip()
+	{
+		TestMesh mesh;
+		CHECK(WriteMeshCache(CacheFile, SourceHash, mesh.GetContents()));
+
+		MappedFile file(CacheFile);
+		MeshCacheContents read;
+		CHECK(ReadMeshCache(file, SourceHash, read));
+		CHECK(read.VertexCount == 4 && read.IndexCount == 9 && read.MeshletCount == 1 && read.LodCount == 2 && read.SubmeshCount == 2);
+		CHECK(memcmp(read.VertexData, mesh.Vertices.data(), sizeof(Vertex) * 4) == 0);
+		CHECK(memcmp(read.Indices, mesh.Indices.data(), sizeof(unsigned int) * 9) == 0);
+		CHECK(read.Lods[1].StartIndex == 6 && read.Lods[1].IndexCount == 3);
+		CHECK(read.SubmeshLods[3].StartIndex == 9 && read.SubmeshLods[3].IndexCount == 0);
+
+		// A different source is stale
+		MeshCacheContents stale;
+		CHECK(!ReadMeshCache(file, SourceHash + 1, stale));
+	}
+
+	// --------------------------------------------------------
+	// Payloads that pass every header check but would send
+	// the mesh, or a draw, past the end of a buffer
+	// --------------------------------------------------------
+	void TestDamagedPayloads()
+	{
+		// Ranges may end exactly at the end of the index buffer
+		CHECK(WriteAndRead([](TestMesh& mesh, MeshCacheContents&) {
+			mesh.Meshlets[0].StartIndex = 3;
+		}));
+
+		// An index past the last vertex, anywhere
+		CHECK(!WriteAndRead([](TestMesh& mesh, MeshCacheContents&) {
+			mesh.Indices[4] = 4;
+		}));
+		CHECK(!WriteAndRead([](TestMesh& mesh, MeshCacheContents&) {
+			mesh.Indices[8] = 0xFFFFFFFF;
+		}));
+
+		// A meshlet running off the end, or so long its count wraps
+		CHECK(!WriteAndRead([](TestMesh& mesh, MeshCacheContents&) {
+			mesh.Meshlets[0].StartIndex = 6;
+		}));
+		CHECK(!WriteAndRead([](TestMesh& mesh, MeshCacheContents&) {
+			mesh.Meshlets[0].TriangleCount = 0x55555556;
+		}));
+
+		// Level of detail ranges, whole mesh or per submesh
+		CHECK(!WriteAndRead([](TestMesh& mesh, MeshCacheContents&) {
+			mesh.Lods[1].IndexCount = 4;
+		}));
+		CHECK(!WriteAndRead([](TestMesh& mesh, MeshCacheContents&) {
+			mesh.Lods[0].StartIndex = 0xFFFFFFFF;
+		}));
+		CHECK(!WriteAndRead([](TestMesh& mesh, MeshCacheContents&) {
+			mesh.SubmeshLods[3].StartIndex = 10;
+		}));
+		CHECK(!WriteAndRead([](TestMesh& mesh, MeshCacheContents&) {
+			mesh.SubmeshLods[1].IndexCount = 0xFFFFFFFF;
+		}));
+
+		// Not even the full detail level
+		CHECK(!WriteAndRead([](TestMesh&, MeshCacheContents& contents) {
+			contents.LodCount = 0;
+		}));
+	}
+
+	// Cut short anywhere: the size no longer matches the header
+	void TestTruncated()
+	{
+		TestMesh mesh;
+		CHECK(WriteMeshCache(CacheFile, SourceHash, mesh.GetContents()));
+
+		std::vector<char> bytes;
+		{
+			MappedFile file(CacheFile);
+			bytes.assign(file.GetData(), file.GetData() + file.GetSize());
+		}
+
+		for (size_t size = 0; size < bytes.size(); size += 7)
+		{
+			FILE* file = fopen(CacheFileNarrow, "wb");
+			fwrite(bytes.data(), 1, size, file);
+			fclose(file);
+
+			MappedFile mapped(CacheFile);
+			MeshCacheContents read;
+			CHECK(!ReadMeshCache(mapped, SourceHash, read));
+		}
+	}
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestDamagedPayloads();
+	TestTruncated();
+
+	remove(CacheFileNarrow);
+	return TestResult("MeshCacheTests");
+}
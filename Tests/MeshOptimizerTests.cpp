@@ -0,0 +1,126 @@
+#include "MeshOptimizer.h"
+#include "ObjParser.h"
+#include "WorkerPool.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// Usage: MeshOptimizerTests <file.obj>...
+//
+// Welds each model as the Mesh pipeline does, then checks that
+// OptimizeVertexCache() keeps every triangle, never does worse
+// than the order it was given, and stays under the ACMR
+// recorded for that model below.
+
+namespace
+{
+	// --------------------------------------------------------
+	// ACMR (16-entry FIFO) each model must reach once
+	// optimized: what it reaches now plus a little slack.  A
+	// model with nothing to reuse stays at 2 or 3.  Add new
+	// models here when they're added to Assets/Models.
+	// --------------------------------------------------------
+	struct AcmrThreshold
+	{
+		const char* FileName;
+		float MaxACMR;
+	};
+
+	const AcmrThreshold Thresholds[] =
+	{
+		{ "cube.obj", 1.02f },
+		{ "cylinder.obj", 1.10f },
+		{ "helix.obj", 0.52f },
+		{ "quad.obj", 2.00f },
+		{ "quad_double_sided.obj", 2.00f },
+		{ "sphere.obj", 0.75f },
+		{ "torus.obj", 0.69f },
+	};
+
+	const AcmrThreshold* FindThreshold(const std::string& path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		std::string fileName = slash == std::string::npos ? path : path.substr(slash + 1);
+		for (const AcmrThreshold& threshold : Thresholds)
+			if (fileName == threshold.FileName)
+				return &threshold;
+		return 0;
+	}
+
+	std::vector<std::array<unsigned int, 3>> GetSortedTriangles(const std::vector<unsigned int>& indices)
+	{
+		std::vector<std::array<unsigned int, 3>> triangles;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+			triangles.push_back({ { indices[i], indices[i + 1], indices[i + 2] } });
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	// Optimizes a copy, checks it against the input and returns its ACMR
+	float CheckOptimized(const char* name, const std::vector<unsigned int>& input, size_t vertexCount)
+	{
+		std::vector<unsigned int> optimized = input;
+		OptimizeVertexCache(optimized, vertexCount);
+
+		// The same triangles, each with its winding intact
+		CHECK(GetSortedTriangles(optimized) == GetSortedTriangles(input));
+
+		float before = SimulateVertexCache(input, vertexCount).GetACMR();
+		float after = SimulateVertexCache(optimized, vertexCount).GetACMR();
+		if (after > before)
+		{
+			printf("%s: ACMR went from %.3f to %.3f\n", name, before, after);
+			CHECK(after <= before);
+		}
+		return after;
+	}
+
+	void TestModel(const std::string& path)
+	{
+		std::wstring widePath(path.begin(), path.end());
+		ObjMeshData mesh;
+		CHECK(LoadObj(widePath, mesh));
+		WeldVertices(mesh.Vertices, mesh.Indices);
+
+		// In file order, and with the triangles shuffled, which leaves the
+		// optimizer nothing to lean on
+		float inFileOrder = CheckOptimized(path.c_str(), mesh.Indices, mesh.Vertices.size());
+
+		std::vector<unsigned int> shuffled;
+		std::vector<size_t> order(mesh.Indices.size() / 3);
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = i;
+		std::shuffle(order.begin(), order.end(), std::mt19937(5));
+		for (size_t t : order)
+			shuffled.insert(shuffled.end(), mesh.Indices.begin() + t * 3, mesh.Indices.begin() + t * 3 + 3);
+		float fromShuffled = CheckOptimized(path.c_str(), shuffled, mesh.Vertices.size());
+
+		const AcmrThreshold* threshold = FindThreshold(path);
+		if (!threshold)
+		{
+			printf("%s: no ACMR threshold recorded (ACMR %.3f)\n", path.c_str(), inFileOrder);
+			CHECK(threshold);
+			return;
+		}
+
+		printf("%s: ACMR %.3f (%.3f from shuffled), threshold %.3f\n", path.c_str(), inFileOrder, fromShuffled, threshold->MaxACMR);
+		CHECK(inFileOrder <= threshold->MaxACMR);
+		CHECK(fromShuffled <= threshold->MaxACMR);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	CHECK(argc > 1);
+	for (int i = 1; i < argc; i++)
+		TestModel(argv[i]);
+
+	delete &WorkerPool::GetInstance();
+	return TestResult("MeshOptimizerTests");
+}
@@ -0,0 +1,349 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "ObjParser.h"
+#include "WorkerPool.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace DirectX;
+
+// Usage: MeshSimplifierTests <file.obj>...
+//
+// Simplifies each model (welded and optimized, as the Mesh
+// pipeline does) to every level of detail, and checks the
+// result's topology and that the surface moved no further
+// than the error SimplifyMesh() reports.  A flat grid and the
+// level of detail chains are checked on their own.
+
+namespace
+{
+	// Distance from p to the triangle a, b, c (Ericson, "Real-Time
+	// Collision Detection", 5.1.5)
+	float GetDistanceToTriangle(FXMVECTOR p, FXMVECTOR a, FXMVECTOR b, FXMVECTOR c)
+	{
+		auto dot = [](FXMVECTOR x, FXMVECTOR y) { return XMVectorGetX(XMVector3Dot(x, y)); };
+		auto length = [](FXMVECTOR x) { return XMVectorGetX(XMVector3Length(x)); };
+
+		XMVECTOR ab = b - a;
+		XMVECTOR ac = c - a;
+		XMVECTOR ap = p - a;
+		float d1 = dot(ab, ap);
+		float d2 = dot(ac, ap);
+		if (d1 <= 0 && d2 <= 0)
+			return length(p - a);
+
+		XMVECTOR bp = p - b;
+		float d3 = dot(ab, bp);
+		float d4 = dot(ac, bp);
+		if (d3 >= 0 && d4 <= d3)
+			return length(p - b);
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0 && d1 >= 0 && d3 <= 0)
+			return length(p - (a + ab * (d1 / (d1 - d3))));
+
+		XMVECTOR cp = p - c;
+		float d5 = dot(ab, cp);
+		float d6 = dot(ac, cp);
+		if (d6 >= 0 && d5 <= d6)
+			return length(p - c);
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0 && d2 >= 0 && d6 <= 0)
+			return length(p - (a + ac * (d2 / (d2 - d6))));
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+			return length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+
+		float denominator = 1.0f / (va + vb + vc);
+		return length(p - (a + ab * (vb * denominator) + ac * (vc * denominator)));
+	}
+
+	XMVECTOR GetPosition(const std::vector<Vertex>& vertices, unsigned int index)
+	{
+		return XMLoadFloat3(&vertices[index].Position);
+	}
+
+	// --------------------------------------------------------
+	// How far the surface "from" strays from "to": the largest
+	// distance from points spread over each triangle of "from"
+	// to the nearest triangle of "to"
+	// --------------------------------------------------------
+	float GetOneSidedDistance(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& from, const std::vector<unsigned int>& to)
+	{
+		float largest = 0.0f;
+		for (size_t t = 0; t < from.size(); t += 3)
+		{
+			XMVECTOR a = GetPosition(vertices, from[t]);
+			XMVECTOR b = GetPosition(vertices, from[t + 1]);
+			XMVECTOR c = GetPosition(vertices, from[t + 2]);
+			XMVECTOR samples[] = { a, b, c, (a + b) * 0.5f, (b + c) * 0.5f, (c + a) * 0.5f, (a + b + c) / 3.0f };
+
+			for (FXMVECTOR p : samples)
+			{
+				float nearest = FLT_MAX;
+				for (size_t u = 0; u < to.size() && nearest > largest; u += 3)
+					nearest = std::min(nearest, GetDistanceToTriangle(p, GetPosition(vertices, to[u]), GetPosition(vertices, to[u + 1]), GetPosition(vertices, to[u + 2])));
+				largest = std::max(largest, nearest);
+			}
+		}
+		return largest;
+	}
+
+	// Directed edges with no twin, between positions rather than vertices
+	size_t CountBorderEdges(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+	{
+		std::map<std::tuple<float, float, float>, unsigned int> positionIds;
+		auto getId = [&](unsigned int index) {
+			const XMFLOAT3& p = vertices[index].Position;
+			return positionIds.emplace(std::make_tuple(p.x, p.y, p.z), (unsigned int)positionIds.size()).first->second;
+		};
+
+		std::map<std::pair<unsigned int, unsigned int>, int> edges;
+		for (size_t t = 0; t < indices.size(); t += 3)
+			for (int k = 0; k < 3; k++)
+				edges[{ getId(indices[t + k]), getId(indices[t + (k + 1) % 3]) }]++;
+
+		size_t borders = 0;
+		for (const auto& edge : edges)
+			if (!edges.count({ edge.first.second, edge.first.first }))
+				borders += edge.second;
+		return borders;
+	}
+
+	// Every index names a vertex and no triangle has collapsed to a line
+	void CheckTopology(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+	{
+		CHECK(indices.size() % 3 == 0);
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			unsigned int a = indices[t];
+			unsigned int b = indices[t + 1];
+			unsigned int c = indices[t + 2];
+			if (a >= vertices.size() || b >= vertices.size() || c >= vertices.size() || a == b || b == c || c == a)
+			{
+				CHECK(!"bad triangle");
+				return;
+			}
+		}
+	}
+
+	float GetRadius(const std::vector<Vertex>& vertices)
+	{
+		XMVECTOR lowest = GetPosition(vertices, 0);
+		XMVECTOR highest = lowest;
+		for (unsigned int i = 0; i < vertices.size(); i++)
+		{
+			lowest = XMVectorMin(lowest, GetPosition(vertices, i));
+			highest = XMVectorMax(highest, GetPosition(vertices, i));
+		}
+		return XMVectorGetX(XMVector3Length(highest - lowest)) * 0.5f;
+	}
+
+	void TestModel(const std::string& path)
+	{
+		std::wstring widePath(path.begin(), path.end());
+		ObjMeshData mesh;
+		CHECK(LoadObj(widePath, mesh));
+		WeldVertices(mesh.Vertices, mesh.Indices);
+		OptimizeVertexCache(mesh.Indices, mesh.Vertices.size());
+
+		const std::vector<Vertex>& vertices = mesh.Vertices;
+		float maxError = GetRadius(vertices) * 0.25f;
+		size_t borders = CountBorderEdges(vertices, mesh.Indices);
+
+		float ratios[] = MESH_LOD_RATIOS;
+		for (float ratio : ratios)
+		{
+			size_t target = (size_t)(mesh.Indices.size() * ratio) / 3 * 3;
+			std::vector<unsigned int> simplified;
+			float error = SimplifyMesh(vertices.data(), vertices.size(), mesh.Indices.data(), mesh.Indices.size(), target, maxError, simplified);
+
+			CheckTopology(vertices, simplified);
+			CHECK(simplified.size() <= mesh.Indices.size() && !simplified.empty());
+			CHECK(error >= 0.0f && error <= maxError);
+
+			// Only stopping early (for the error bound) leaves it above the target
+			if (simplified.size() > target)
+				CHECK(error > 0.0f || simplified.size() == mesh.Indices.size());
+
+			// Borders can't open up: a closed model stays closed
+			CHECK(CountBorderEdges(vertices, simplified) <= borders);
+
+			// The surface moved no further than the error reported, both ways
+			float distance = std::max(
+				GetOneSidedDistance(vertices, simplified, mesh.Indices),
+				GetOneSidedDistance(vertices, mesh.Indices, simplified));
+			printf("%s: %.1f%% -> %zu of %zu triangles, error %.4f, measured %.4f\n",
+				path.c_str(), ratio * 100.0f, simplified.size() / 3, mesh.Indices.size() / 3, error, distance);
+			CHECK(distance <= error + maxError * 0.001f);
+		}
+	}
+
+	// A flat square grid of size x size quads, one unit across
+	void MakeGrid(unsigned int size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		vertices.clear();
+		indices.clear();
+		for (unsigned int y = 0; y <= size; y++)
+		{
+			for (unsigned int x = 0; x <= size; x++)
+			{
+				Vertex v = {};
+				v.Position = XMFLOAT3((float)x / size, (float)y / size, 0.0f);
+				v.Normal = XMFLOAT3(0, 0, -1);
+				v.UV = XMFLOAT2((float)x / size, (float)y / size);
+				vertices.push_back(v);
+			}
+		}
+
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				unsigned int corner = y * (size + 1) + x;
+				unsigned int quad[] = { corner, corner + size + 1, corner + 1, corner + 1, corner + size + 1, corner + size + 2 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	float GetArea(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+	{
+		float area = 0.0f;
+		for (size_t t = 0; t < indices.size(); t += 3)
+		{
+			XMVECTOR a = GetPosition(vertices, indices[t]);
+			XMVECTOR b = GetPosition(vertices, indices[t + 1]);
+			XMVECTOR c = GetPosition(vertices, indices[t + 2]);
+			area += XMVectorGetX(XMVector3Length(XMVector3Cross(b - a, c - a))) * 0.5f;
+		}
+		return area;
+	}
+
+	// --------------------------------------------------------
+	// A flat grid costs nothing to simplify, so it goes all the
+	// way down, while its border keeps its corners and so the
+	// grid keeps its area
+	// --------------------------------------------------------
+	void TestFlatGrid()
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		MakeGrid(16, vertices, indices);
+
+		std::vector<unsigned int> simplified;
+		float error = SimplifyMesh(vertices.data(), vertices.size(), indices.data(), indices.size(), 6, 0.01f, simplified);
+		CheckTopology(vertices, simplified);
+		CHECK(error < 1e-5f);
+		CHECK(simplified.size() < indices.size() / 10);
+		CHECK(std::fabs(GetArea(vertices, simplified) - 1.0f) < 1e-4f);
+		CHECK(CountBorderEdges(vertices, simplified) > 0);
+
+		// Every triangle still faces the same way
+		for (size_t t = 0; t < simplified.size(); t += 3)
+		{
+			XMVECTOR a = GetPosition(vertices, simplified[t]);
+			XMVECTOR b = GetPosition(vertices, simplified[t + 1]);
+			XMVECTOR c = GetPosition(vertices, simplified[t + 2]);
+			CHECK(XMVectorGetZ(XMVector3Cross(b - a, c - a)) < 0.0f);
+		}
+
+		// However much error is allowed, border vertices only slide along
+		// the border (cutting its corners, at most), so the border of a
+		// bumpy grid still runs around the square's outline
+		for (Vertex& v : vertices)
+			v.Position.z = 0.5f * std::sin(v.Position.x * 20.0f) * std::sin(v.Position.y * 20.0f);
+		SimplifyMesh(vertices.data(), vertices.size(), indices.data(), indices.size(), indices.size() / 2 / 3 * 3, 10.0f, simplified);
+		CheckTopology(vertices, simplified);
+		auto isOnOutline = [&](unsigned int index) {
+			const XMFLOAT3& p = vertices[index].Position;
+			return p.x == 0.0f || p.x == 1.0f || p.y == 0.0f || p.y == 1.0f;
+		};
+		std::set<std::pair<unsigned int, unsigned int>> edges;
+		for (size_t t = 0; t < simplified.size(); t += 3)
+			for (int k = 0; k < 3; k++)
+				edges.insert({ simplified[t + k], simplified[t + (k + 1) % 3] });
+		for (const auto& edge : edges)
+			if (!edges.count({ edge.second, edge.first }))
+				CHECK(isOnOutline(edge.first) && isOnOutline(edge.second));
+
+		// With no error allowed, nothing that moves the surface happens
+		MakeGrid(4, vertices, indices);
+		for (Vertex& v : vertices)
+			v.Position.z = std::sin(v.Position.x * 7.0f) * std::cos(v.Position.y * 5.0f);
+		float none = SimplifyMesh(vertices.data(), vertices.size(), indices.data(), indices.size(), 6, 0.0f, simplified);
+		CHECK(none == 0.0f && simplified.size() == indices.size());
+	}
+
+	// --------------------------------------------------------
+	// The chains the Mesh pipeline stores: the full mesh
+	// first, then each level smaller by at least a fifth with
+	// a growing error, back to back, and with parts each level's
+	// ranges of every part, in order
+	// --------------------------------------------------------
+	void TestLodChains()
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		MakeGrid(24, vertices, indices);
+		for (Vertex& v : vertices)
+			v.Position.z = 0.05f * std::sin(v.Position.x * 6.0f) * std::sin(v.Position.y * 6.0f);
+
+		std::vector<unsigned int> lodIndices;
+		std::vector<MeshLod> lods;
+		BuildLodChain(vertices.data(), vertices.size(), indices.data(), indices.size(), 0.1f, lodIndices, lods);
+
+		CHECK(lods.size() >= 2);
+		CHECK(lods.size() > 0 && lods[0].StartIndex == 0 && lods[0].IndexCount == indices.size() && lods[0].Error == 0.0f);
+		unsigned int next = 0;
+		for (size_t l = 0; l < lods.size(); l++)
+		{
+			CHECK(lods[l].StartIndex == next);
+			next = lods[l].StartIndex + lods[l].IndexCount;
+			if (l > 0)
+			{
+				CHECK(lods[l].IndexCount <= lods[l - 1].IndexCount * 0.8f);
+				CHECK(lods[l].Error >= lods[l - 1].Error);
+			}
+		}
+		CHECK(next == lodIndices.size());
+
+		// The same grid as two parts: its first and second halves
+		MeshLod parts[] = { { 0, (unsigned int)indices.size() / 2, 0.0f }, { (unsigned int)indices.size() / 2, (unsigned int)indices.size() / 2, 0.0f } };
+		std::vector<MeshLod> partLods;
+		BuildLodChain(vertices.data(), vertices.size(), indices.data(), indices.size(), parts, 2, 0.1f, lodIndices, lods, partLods);
+
+		CHECK(partLods.size() == lods.size() * 2);
+		for (size_t l = 0; l < lods.size() && partLods.size() == lods.size() * 2; l++)
+		{
+			const MeshLod& first = partLods[l * 2];
+			const MeshLod& second = partLods[l * 2 + 1];
+			CHECK(first.StartIndex == lods[l].StartIndex);
+			CHECK(second.StartIndex == first.StartIndex + first.IndexCount);
+			CHECK(second.StartIndex + second.IndexCount == lods[l].StartIndex + lods[l].IndexCount);
+			CHECK(first.IndexCount > 0 && second.IndexCount > 0);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	TestFlatGrid();
+	TestLodChains();
+	for (int i = 1; i < argc; i++)
+		TestModel(argv[i]);
+
+	delete &WorkerPool::GetInstance();
+	return TestResult("MeshSimplifierTests");
+}
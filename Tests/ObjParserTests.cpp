@@ -0,0 +1,222 @@
+#include "ObjParser.h"
+#include "WorkerPool.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+// Usage: ObjParserTests <file.obj>...
+//
+// Each file is parsed serially and then in every chunk count
+// below (0 being the automatic split), which must give the
+// same result byte for byte.  Tests/Data/parts.obj gets its
+// submeshes checked as well.
+
+namespace
+{
+	const unsigned int ChunkCounts[] = { 0, 2, 3, 4, 7, 16, 61, 500 };
+
+	bool ReadFile(const char* fileName, std::string& contents)
+	{
+		std::ifstream file(fileName, std::ios::binary);
+		if (!file)
+			return false;
+		contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	bool AreIdentical(const ObjMeshData& a, const ObjMeshData& b)
+	{
+		if (a.Vertices.size() != b.Vertices.size() ||
+			a.Indices != b.Indices ||
+			a.Submeshes.size() != b.Submeshes.size())
+			return false;
+
+		if (memcmp(a.Vertices.data(), b.Vertices.data(), sizeof(Vertex) * a.Vertices.size()) != 0)
+			return false;
+
+		for (size_t i = 0; i < a.Submeshes.size(); i++)
+		{
+			const ObjSubmesh& x = a.Submeshes[i];
+			const ObjSubmesh& y = b.Submeshes[i];
+			if (x.Name != y.Name || x.Material != y.Material || x.StartIndex != y.StartIndex || x.IndexCount != y.IndexCount)
+				return false;
+		}
+		return true;
+	}
+
+	// Submeshes cover every index, in order, with nothing left out
+	void CheckSubmeshesCoverIndices(const ObjMeshData& mesh)
+	{
+		unsigned int next = 0;
+		for (const ObjSubmesh& submesh : mesh.Submeshes)
+		{
+			CHECK(submesh.StartIndex == next && submesh.IndexCount > 0);
+			next = submesh.StartIndex + submesh.IndexCount;
+		}
+		CHECK(next == mesh.Indices.size());
+	}
+
+	void TestChunkedMatchesSerial(const std::string& name, const std::string& text)
+	{
+		ObjMeshData serial;
+		CHECK(ParseObj(text.data(), text.size(), serial, 1));
+		CheckSubmeshesCoverIndices(serial);
+
+		for (unsigned int chunkCount : ChunkCounts)
+		{
+			ObjMeshData chunked;
+			ParseObj(text.data(), text.size(), chunked, chunkCount);
+			if (!AreIdentical(serial, chunked))
+			{
+				printf("%s: %u chunks differ from a serial parse\n", name.c_str(), chunkCount);
+				CHECK(AreIdentical(serial, chunked));
+			}
+		}
+	}
+
+	void CheckSubmesh(const ObjSubmesh& submesh, const char* name, const char* material, unsigned int indexCount)
+	{
+		CHECK(submesh.Name == name && submesh.Material == material && submesh.IndexCount == indexCount);
+	}
+
+	// --------------------------------------------------------
+	// What parts.obj must come out as, relative indices and
+	// all, before anything is compared across chunk counts
+	// --------------------------------------------------------
+	void TestParts(const std::string& text)
+	{
+		ObjMeshData mesh;
+		CHECK(ParseObj(text.data(), text.size(), mesh, 1));
+
+		// The repeated "usemtl trim" doesn't split anything, and a bare "g"
+		// keeps the object's name
+		CHECK(mesh.Submeshes.size() == 4);
+		if (mesh.Submeshes.size() == 4)
+		{
+			CheckSubmesh(mesh.Submeshes[0], "Base", "stone", 6);
+			CheckSubmesh(mesh.Submeshes[1], "Rim", "trim", 15);
+			CheckSubmesh(mesh.Submeshes[2], "Arrow", "paint", 9);
+			CheckSubmesh(mesh.Submeshes[3], "Arrow", "stone", 6);
+		}
+
+		// "f -2//-1 -1//-1 2//1" is positions 5, 6 and 2 with the only
+		// normal so far, wound the other way round (5, 2, 6) with Z flipped
+		CHECK(mesh.Vertices.size() == 36);
+		if (mesh.Vertices.size() == 36)
+		{
+			const Vertex* triangle = &mesh.Vertices[6];
+			CHECK(triangle[0].Position.x == -1.0f && triangle[0].Position.y == 0.5f && triangle[0].Position.z == 1.0f);
+			CHECK(triangle[1].Position.x == 1.0f && triangle[1].Position.y == 0.0f && triangle[1].Position.z == 1.0f);
+			CHECK(triangle[2].Position.x == 1.0f && triangle[2].Position.y == 0.5f && triangle[2].Position.z == 1.0f);
+			CHECK(triangle[0].Normal.y == 1.0f && triangle[2].Normal.y == 1.0f);
+		}
+	}
+
+	// --------------------------------------------------------
+	// An index too large for an int drops its face, rather
+	// than wrapping round to one that happens to exist
+	// --------------------------------------------------------
+	void TestIndexOverflow()
+	{
+		const char text[] =
+			"v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nvn 0 0 1\n"
+			"f 1 2 3\n"
+			"f 1 2 4294967299\n"
+			"f 1/4294967297/1 2/1/1 3/1/1\n"
+			"f 1//1 2//1 3//99999999999999999999\n"
+			"f 1 2 3 2147483648\n"
+			"f 3 2 1\n"
+			"f 1/1/1 2/1/1 3/1/1\n";
+
+		ObjMeshData mesh;
+		CHECK(ParseObj(text, sizeof(text) - 1, mesh, 1));
+		CHECK(mesh.Indices.size() == 9);
+		TestChunkedMatchesSerial("overflowing indices", text);
+	}
+
+	// The x of a triangle's first corner written as "literal"
+	float ParseX(const std::string& literal)
+	{
+		std::string text = "v " + literal + " 0 0\nv 0 1 0\nv 0 0 1\nf 1 2 3\n";
+		ObjMeshData mesh;
+		if (!ParseObj(text.data(), text.size(), mesh, 1) || mesh.Vertices.empty())
+			return -12345.0f;
+		return mesh.Vertices[0].Position.x;
+	}
+
+	// --------------------------------------------------------
+	// Numbers past the fast path: more than 19 digits, and
+	// powers of ten beyond the exact ones, including those that
+	// end up denormal, zero or infinite as floats.  Each must
+	// round as the compiler rounds the same literal.
+	// --------------------------------------------------------
+	void TestLongFloats()
+	{
+		// Longer than any fixed buffer would hold, with the exponent last
+		std::string zeros(80, '0');
+		CHECK(ParseX("0.1" + zeros + "1e1") == 1.0f);
+		CHECK(ParseX("-1" + zeros + "e-80") == -1.0f);
+		CHECK(ParseX("2.5" + zeros + "E+2") == 250.0f);
+		CHECK(ParseX("0." + zeros + "75e82") == 75.0f);
+
+		CHECK(ParseX("123456789012345678901234567890e-28") == 12.3456789012345678901234567890f);
+		CHECK(ParseX("3.14159265358979323846264338327950288") == 3.14159265358979323846264338327950288f);
+		CHECK(ParseX("0.000000000000000000000000000000015") == 0.000000000000000000000000000000015f);
+		CHECK(ParseX("6.02214076e23") == 6.02214076e23f);
+		CHECK(ParseX("3.4028234e38") == 3.4028234e38f);
+		CHECK(ParseX("1.17549435e-38") == 1.17549435e-38f);
+		CHECK(ParseX("-2.5e-40") == -2.5e-40f);
+		CHECK(ParseX("1.5e-45") == 1.5e-45f);
+
+		CHECK(ParseX("1e-50") == 0.0f);
+		CHECK(ParseX("0e99") == 0.0f);
+		CHECK(ParseX("1e39") == INFINITY);
+		CHECK(ParseX("-1e400") == -INFINITY);
+	}
+
+	bool EndsWith(const std::string& text, const char* suffix)
+	{
+		size_t length = strlen(suffix);
+		return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string parts;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string text;
+		if (!ReadFile(argv[i], text))
+		{
+			printf("Can't read %s\n", argv[i]);
+			CHECK(false);
+			continue;
+		}
+
+		TestChunkedMatchesSerial(argv[i], text);
+		if (EndsWith(argv[i], "parts.obj"))
+			parts = text;
+	}
+
+	CHECK(!parts.empty());
+	TestParts(parts);
+
+	// Many copies back to back, so chunk boundaries land in every kind
+	// of record and between names, materials and the faces they cover
+	std::string repeated;
+	for (int i = 0; i < 500; i++)
+		repeated += parts;
+	TestChunkedMatchesSerial("parts.obj x500", repeated);
+
+	TestIndexOverflow();
+	TestLongFloats();
+
+	delete &WorkerPool::GetInstance();
+	return TestResult("ObjParserTests");
+}
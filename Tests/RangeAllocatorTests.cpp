@@ -0,0 +1,199 @@
+#include "RangeAllocator.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct Range
+	{
+		unsigned int Offset;
+		unsigned int Size;
+	};
+
+	// --------------------------------------------------------
+	// Rebuilds the free space from the live ranges alone and
+	// compares it to the allocator: the gaps between live
+	// ranges are exactly its free ranges (as they're always
+	// coalesced), so their count, total and largest must match
+	// --------------------------------------------------------
+	void CheckAgainstLive(const RangeAllocator& allocator, std::vector<Range> live)
+	{
+		std::sort(live.begin(), live.end(), [](const Range& a, const Range& b) { return a.Offset < b.Offset; });
+
+		unsigned int used = 0;
+		unsigned int gaps = 0;
+		unsigned int largestGap = 0;
+		unsigned int end = 0;
+		bool overlapping = false;
+		for (const Range& range : live)
+		{
+			overlapping |= range.Offset < end;
+			if (range.Offset > end)
+			{
+				gaps++;
+				largestGap = std::max(largestGap, range.Offset - end);
+			}
+			end = std::max(end, range.Offset + range.Size);
+			used += range.Size;
+		}
+		if (allocator.GetCapacity() > end)
+		{
+			gaps++;
+			largestGap = std::max(largestGap, allocator.GetCapacity() - end);
+		}
+
+		CHECK(!overlapping);
+		CHECK(end <= allocator.GetCapacity());
+		CHECK(allocator.GetUsed() == used);
+		CHECK(allocator.GetFreeRangeCount() == gaps);
+		CHECK(allocator.GetLargestFreeRange() == largestGap);
+	}
+
+	void TestAllocateAndFree()
+	{
+		RangeAllocator allocator(100);
+		unsigned int a, b, c, d;
+		CHECK(allocator.Allocate(30, a) && a == 0);
+		CHECK(allocator.Allocate(30, b) && b == 30);
+		CHECK(allocator.Allocate(30, c) && c == 60);
+		CHECK(allocator.GetUsed() == 90 && allocator.GetFreeRangeCount() == 1);
+
+		// Too big for what's left: fails and leaves the offset alone
+		d = 12345;
+		CHECK(!allocator.Allocate(20, d) && d == 12345);
+
+		// Zero-sized requests always succeed and take nothing
+		CHECK(allocator.Allocate(0, d) && allocator.GetUsed() == 90);
+
+		// Best fit: the 10-element tail serves a small request, keeping the
+		// 30-element hole whole
+		allocator.Free(b, 30);
+		CHECK(allocator.Allocate(5, d) && d == 90);
+		CHECK(allocator.GetLargestFreeRange() == 30);
+
+		// Among equal fits, the lowest offset
+		RangeAllocator equal(40);
+		unsigned int e[4];
+		for (unsigned int& offset : e)
+			equal.Allocate(10, offset);
+		equal.Free(e[2], 10);
+		equal.Free(e[0], 10);
+		unsigned int f;
+		CHECK(equal.Allocate(10, f) && f == e[0]);
+	}
+
+	void TestCoalescing()
+	{
+		RangeAllocator allocator(50);
+		unsigned int r[5];
+		for (unsigned int& offset : r)
+			allocator.Allocate(10, offset);
+		CHECK(allocator.GetFreeRangeCount() == 0 && allocator.GetLargestFreeRange() == 0);
+
+		// Two separate holes
+		allocator.Free(r[1], 10);
+		allocator.Free(r[3], 10);
+		CHECK(allocator.GetFreeRangeCount() == 2 && allocator.GetLargestFreeRange() == 10);
+
+		// Freeing between them merges all three into one
+		allocator.Free(r[2], 10);
+		CHECK(allocator.GetFreeRangeCount() == 1 && allocator.GetLargestFreeRange() == 30);
+
+		// With the previous neighbour only, then the next only
+		allocator.Free(r[0], 10);
+		CHECK(allocator.GetFreeRangeCount() == 1 && allocator.GetLargestFreeRange() == 40);
+		allocator.Free(r[4], 10);
+		CHECK(allocator.GetFreeRangeCount() == 1 && allocator.GetLargestFreeRange() == 50);
+		CHECK(allocator.GetUsed() == 0 && allocator.GetFragmentation() == 0.0f);
+	}
+
+	void TestGrow()
+	{
+		// Growing an empty allocator
+		RangeAllocator empty;
+		unsigned int offset;
+		CHECK(!empty.Allocate(1, offset));
+		empty.Grow(64);
+		CHECK(empty.GetCapacity() == 64 && empty.GetFreeRangeCount() == 1 && empty.GetLargestFreeRange() == 64);
+
+		// The new space joins a free range at the old end
+		RangeAllocator allocator(100);
+		unsigned int a, b;
+		allocator.Allocate(60, a);
+		allocator.Allocate(40, b);
+		allocator.Free(b, 40);
+		allocator.Grow(150);
+		CHECK(allocator.GetCapacity() == 150 && allocator.GetUsed() == 60);
+		CHECK(allocator.GetFreeRangeCount() == 1 && allocator.GetLargestFreeRange() == 90);
+
+		// Or starts its own after a live range, and live ranges stay put
+		unsigned int c;
+		CHECK(allocator.Allocate(90, c) && c == 60);
+		allocator.Grow(200);
+		CHECK(allocator.GetFreeRangeCount() == 1 && allocator.GetLargestFreeRange() == 50);
+		CheckAgainstLive(allocator, { { a, 60 }, { c, 90 } });
+
+		// Never shrinks
+		allocator.Grow(10);
+		CHECK(allocator.GetCapacity() == 200);
+	}
+
+	// --------------------------------------------------------
+	// Meshes of mixed sizes loaded and unloaded at random,
+	// growing by doubling like the GeometryPool, with the free
+	// space checked against the live ranges as it goes
+	// --------------------------------------------------------
+	void TestChurn(unsigned int seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_int_distribution<unsigned int> small(16, 2000);
+		std::uniform_int_distribution<unsigned int> large(20000, 200000);
+
+		RangeAllocator allocator(65536);
+		std::vector<Range> live;
+		for (int step = 0; step < 50000; step++)
+		{
+			bool load = live.size() < 50 || rng() % 100 < 52;
+			if (load)
+			{
+				unsigned int size = rng() % 10 == 0 ? large(rng) : small(rng);
+				unsigned int offset;
+				while (!allocator.Allocate(size, offset))
+					allocator.Grow(std::max(allocator.GetCapacity() * 2, allocator.GetCapacity() + size));
+				live.push_back({ offset, size });
+			}
+			else
+			{
+				size_t i = rng() % live.size();
+				allocator.Free(live[i].Offset, live[i].Size);
+				live[i] = live.back();
+				live.pop_back();
+			}
+
+			if (step % 500 == 0)
+				CheckAgainstLive(allocator, live);
+		}
+		CheckAgainstLive(allocator, live);
+		CHECK(allocator.GetFragmentation() >= 0.0f && allocator.GetFragmentation() < 1.0f);
+
+		// Everything back: one free range covering the whole capacity
+		for (const Range& range : live)
+			allocator.Free(range.Offset, range.Size);
+		CHECK(allocator.GetUsed() == 0);
+		CHECK(allocator.GetFreeRangeCount() == 1 && allocator.GetLargestFreeRange() == allocator.GetCapacity());
+	}
+}
+
+int main()
+{
+	TestAllocateAndFree();
+	TestCoalescing();
+	TestGrow();
+	for (unsigned int seed = 1; seed <= 3; seed++)
+		TestChurn(seed);
+
+	return TestResult("RangeAllocatorTests");
+}
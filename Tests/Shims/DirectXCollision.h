@@ -0,0 +1,79 @@
+#pragma once
+
+// --------------------------------------------------------
+// Host test shim: the bounding volumes the engine's CPU
+// code stores, on top of the scalar DirectXMath shim
+// --------------------------------------------------------
+
+#include "DirectXMath.h"
+#include <cstddef>
+
+namespace DirectX
+{
+	struct BoundingBox
+	{
+		XMFLOAT3 Center;
+		XMFLOAT3 Extents;
+
+		BoundingBox() : Center(0, 0, 0), Extents(1, 1, 1) {}
+		BoundingBox(const XMFLOAT3& center, const XMFLOAT3& extents) : Center(center), Extents(extents) {}
+	};
+
+	struct BoundingSphere
+	{
+		XMFLOAT3 Center;
+		float Radius;
+
+		BoundingSphere() : Center(0, 0, 0), Radius(1.0f) {}
+		BoundingSphere(const XMFLOAT3& center, float radius) : Center(center), Radius(radius) {}
+
+		// Ritter's sphere, as the real one: start from the most distant
+		// pair of axis extremes, then grow to take in every point
+		static void CreateFromPoints(BoundingSphere& out, size_t count, const XMFLOAT3* points, size_t stride)
+		{
+			auto point = [&](size_t i) { return XMLoadFloat3((const XMFLOAT3*)((const char*)points + i * stride)); };
+
+			size_t extremes[6] = {};
+			for (size_t i = 0; i < count; i++)
+			{
+				XMVECTOR p = point(i);
+				for (int axis = 0; axis < 3; axis++)
+				{
+					if (p.v[axis] < point(extremes[axis * 2]).v[axis])
+						extremes[axis * 2] = i;
+					if (p.v[axis] > point(extremes[axis * 2 + 1]).v[axis])
+						extremes[axis * 2 + 1] = i;
+				}
+			}
+
+			int widest = 0;
+			float widestSq = -1.0f;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float distanceSq = XMVectorGetX(XMVector3LengthSq(point(extremes[axis * 2 + 1]) - point(extremes[axis * 2])));
+				if (distanceSq > widestSq)
+				{
+					widestSq = distanceSq;
+					widest = axis;
+				}
+			}
+
+			XMVECTOR center = (point(extremes[widest * 2]) + point(extremes[widest * 2 + 1])) * 0.5f;
+			float radius = std::sqrt(widestSq) * 0.5f;
+			for (size_t i = 0; i < count; i++)
+			{
+				XMVECTOR p = point(i);
+				float distance = XMVectorGetX(XMVector3Length(p - center));
+				if (distance > radius)
+				{
+					float newRadius = (radius + distance) * 0.5f;
+					center = center + (p - center) * ((newRadius - radius) / distance);
+					radius = newRadius;
+				}
+			}
+
+			XMStoreFloat3(&out.Center, center);
+			out.Radius = count > 0 ? radius : 0.0f;
+		}
+	};
+}
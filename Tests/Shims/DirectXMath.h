@@ -0,0 +1,454 @@
+#pragma once
+
+// --------------------------------------------------------
+// Host test shim: a plain scalar version of the part of
+// DirectXMath the engine's CPU-side code uses, so those
+// modules build off Windows.  Same names and semantics
+// (row vectors, left-handed), none of the SIMD, so time
+// anything vectorized with the real headers instead.
+// --------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#define XM_CALLCONV
+#define XM_PI 3.141592654f
+#define XM_2PI 6.283185307f
+#define XM_PIDIV2 1.570796327f
+#define XM_PIDIV4 0.785398163f
+
+namespace DirectX
+{
+	struct XMFLOAT2
+	{
+		float x, y;
+		XMFLOAT2() = default;
+		constexpr XMFLOAT2(float x, float y) : x(x), y(y) {}
+	};
+
+	struct XMFLOAT3
+	{
+		float x, y, z;
+		XMFLOAT3() = default;
+		constexpr XMFLOAT3(float x, float y, float z) : x(x), y(y), z(z) {}
+	};
+
+	struct XMFLOAT4
+	{
+		float x, y, z, w;
+		XMFLOAT4() = default;
+		constexpr XMFLOAT4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+	};
+
+	struct alignas(16) XMFLOAT4A
+	{
+		float x, y, z, w;
+	};
+
+	struct XMFLOAT4X4
+	{
+		union
+		{
+			float m[4][4];
+			struct
+			{
+				float _11, _12, _13, _14;
+				float _21, _22, _23, _24;
+				float _31, _32, _33, _34;
+				float _41, _42, _43, _44;
+			};
+		};
+
+		XMFLOAT4X4() = default;
+		XMFLOAT4X4(float m11, float m12, float m13, float m14,
+			float m21, float m22, float m23, float m24,
+			float m31, float m32, float m33, float m34,
+			float m41, float m42, float m43, float m44)
+		{
+			float values[16] = { m11, m12, m13, m14, m21, m22, m23, m24, m31, m32, m33, m34, m41, m42, m43, m44 };
+			memcpy(m, values, sizeof(m));
+		}
+	};
+
+	struct alignas(16) XMVECTOR
+	{
+		float v[4];
+	};
+	typedef const XMVECTOR& FXMVECTOR;
+	typedef const XMVECTOR& GXMVECTOR;
+	typedef const XMVECTOR& HXMVECTOR;
+	typedef const XMVECTOR& CXMVECTOR;
+
+	struct XMMATRIX
+	{
+		XMVECTOR r[4];
+	};
+	typedef const XMMATRIX& FXMMATRIX;
+	typedef const XMMATRIX& CXMMATRIX;
+
+	// ------ Loads and stores ------------------------------------------------
+
+	inline XMVECTOR XMVectorSet(float x, float y, float z, float w) { return { { x, y, z, w } }; }
+	inline XMVECTOR XMVectorReplicate(float value) { return { { value, value, value, value } }; }
+	inline XMVECTOR XMVectorZero() { return XMVectorReplicate(0.0f); }
+	inline XMVECTOR XMVectorSplatOne() { return XMVectorReplicate(1.0f); }
+
+	inline XMVECTOR XMLoadFloat2(const XMFLOAT2* p) { return XMVectorSet(p->x, p->y, 0, 0); }
+	inline XMVECTOR XMLoadFloat3(const XMFLOAT3* p) { return XMVectorSet(p->x, p->y, p->z, 0); }
+	inline XMVECTOR XMLoadFloat4(const XMFLOAT4* p) { return XMVectorSet(p->x, p->y, p->z, p->w); }
+	inline XMVECTOR XMLoadFloat4A(const XMFLOAT4A* p) { return XMVectorSet(p->x, p->y, p->z, p->w); }
+
+	inline void XMStoreFloat2(XMFLOAT2* p, FXMVECTOR v) { p->x = v.v[0]; p->y = v.v[1]; }
+	inline void XMStoreFloat3(XMFLOAT3* p, FXMVECTOR v) { p->x = v.v[0]; p->y = v.v[1]; p->z = v.v[2]; }
+	inline void XMStoreFloat4(XMFLOAT4* p, FXMVECTOR v) { p->x = v.v[0]; p->y = v.v[1]; p->z = v.v[2]; p->w = v.v[3]; }
+	inline void XMStoreFloat4A(XMFLOAT4A* p, FXMVECTOR v) { p->x = v.v[0]; p->y = v.v[1]; p->z = v.v[2]; p->w = v.v[3]; }
+
+	inline float XMVectorGetX(FXMVECTOR v) { return v.v[0]; }
+	inline float XMVectorGetY(FXMVECTOR v) { return v.v[1]; }
+	inline float XMVectorGetZ(FXMVECTOR v) { return v.v[2]; }
+	inline float XMVectorGetW(FXMVECTOR v) { return v.v[3]; }
+	inline XMVECTOR XMVectorSetW(FXMVECTOR v, float w) { XMVECTOR r = v; r.v[3] = w; return r; }
+
+	inline uint32_t XMVectorGetIntX(FXMVECTOR v) { uint32_t bits; memcpy(&bits, &v.v[0], 4); return bits; }
+	inline uint32_t XMVectorGetIntZ(FXMVECTOR v) { uint32_t bits; memcpy(&bits, &v.v[2], 4); return bits; }
+
+	// ------ Per-lane arithmetic ---------------------------------------------
+
+#define SHIM_XM_LANES(name, expression) \
+	inline XMVECTOR name(FXMVECTOR a, FXMVECTOR b) \
+	{ \
+		XMVECTOR r; \
+		for (int i = 0; i < 4; i++) \
+			r.v[i] = (expression); \
+		return r; \
+	}
+
+	SHIM_XM_LANES(XMVectorAdd, a.v[i] + b.v[i])
+	SHIM_XM_LANES(XMVectorSubtract, a.v[i] - b.v[i])
+	SHIM_XM_LANES(XMVectorMultiply, a.v[i] * b.v[i])
+	SHIM_XM_LANES(XMVectorDivide, a.v[i] / b.v[i])
+	SHIM_XM_LANES(XMVectorMin, std::min(a.v[i], b.v[i]))
+	SHIM_XM_LANES(XMVectorMax, std::max(a.v[i], b.v[i]))
+
+#undef SHIM_XM_LANES
+
+	inline XMVECTOR XMVectorScale(FXMVECTOR v, float s) { return XMVectorMultiply(v, XMVectorReplicate(s)); }
+	inline XMVECTOR XMVectorMultiplyAdd(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c) { return XMVectorAdd(XMVectorMultiply(a, b), c); }
+	inline XMVECTOR XMVectorNegativeMultiplySubtract(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c) { return XMVectorSubtract(c, XMVectorMultiply(a, b)); }
+
+	inline XMVECTOR XMVectorAbs(FXMVECTOR v) { XMVECTOR r; for (int i = 0; i < 4; i++) r.v[i] = std::fabs(v.v[i]); return r; }
+	inline XMVECTOR XMVectorReciprocal(FXMVECTOR v) { XMVECTOR r; for (int i = 0; i < 4; i++) r.v[i] = 1.0f / v.v[i]; return r; }
+	inline XMVECTOR XMVectorSqrt(FXMVECTOR v) { XMVECTOR r; for (int i = 0; i < 4; i++) r.v[i] = std::sqrt(v.v[i]); return r; }
+
+	inline XMVECTOR XMVectorSplatX(FXMVECTOR v) { return XMVectorReplicate(v.v[0]); }
+	inline XMVECTOR XMVectorSplatY(FXMVECTOR v) { return XMVectorReplicate(v.v[1]); }
+	inline XMVECTOR XMVectorSplatZ(FXMVECTOR v) { return XMVectorReplicate(v.v[2]); }
+	inline XMVECTOR XMVectorSplatW(FXMVECTOR v) { return XMVectorReplicate(v.v[3]); }
+	inline XMVECTOR XMVectorMergeXY(FXMVECTOR a, FXMVECTOR b) { return XMVectorSet(a.v[0], b.v[0], a.v[1], b.v[1]); }
+
+	template<uint32_t X, uint32_t Y, uint32_t Z, uint32_t W>
+	inline XMVECTOR XMVectorPermute(FXMVECTOR a, FXMVECTOR b)
+	{
+		float lanes[8];
+		memcpy(lanes, a.v, 16);
+		memcpy(lanes + 4, b.v, 16);
+		return XMVectorSet(lanes[X], lanes[Y], lanes[Z], lanes[W]);
+	}
+
+	template<uint32_t X, uint32_t Y, uint32_t Z, uint32_t W>
+	inline XMVECTOR XMVectorSwizzle(FXMVECTOR v) { return XMVectorSet(v.v[X], v.v[Y], v.v[Z], v.v[W]); }
+
+	// ------ Comparisons: all bits set in lanes where they hold --------------
+
+#define SHIM_XM_COMPARE(name, op) \
+	inline XMVECTOR name(FXMVECTOR a, FXMVECTOR b) \
+	{ \
+		XMVECTOR r; \
+		for (int i = 0; i < 4; i++) \
+		{ \
+			uint32_t bits = (a.v[i] op b.v[i]) ? 0xFFFFFFFFu : 0u; \
+			memcpy(&r.v[i], &bits, 4); \
+		} \
+		return r; \
+	}
+
+	SHIM_XM_COMPARE(XMVectorLess, <)
+	SHIM_XM_COMPARE(XMVectorLessOrEqual, <=)
+	SHIM_XM_COMPARE(XMVectorGreater, >)
+	SHIM_XM_COMPARE(XMVectorGreaterOrEqual, >=)
+
+#undef SHIM_XM_COMPARE
+
+	inline XMVECTOR XMVectorAndInt(FXMVECTOR a, FXMVECTOR b)
+	{
+		XMVECTOR r;
+		for (int i = 0; i < 4; i++)
+		{
+			uint32_t x, y;
+			memcpy(&x, &a.v[i], 4);
+			memcpy(&y, &b.v[i], 4);
+			x &= y;
+			memcpy(&r.v[i], &x, 4);
+		}
+		return r;
+	}
+
+	// Lanes of b where the control's bits are set, of a elsewhere
+	inline XMVECTOR XMVectorSelect(FXMVECTOR a, FXMVECTOR b, FXMVECTOR control)
+	{
+		XMVECTOR r;
+		for (int i = 0; i < 4; i++)
+		{
+			uint32_t bits;
+			memcpy(&bits, &control.v[i], 4);
+			r.v[i] = bits ? b.v[i] : a.v[i];
+		}
+		return r;
+	}
+
+	inline bool XMVector4EqualInt(FXMVECTOR a, FXMVECTOR b) { return memcmp(a.v, b.v, 16) == 0; }
+
+	// ------ Operators -------------------------------------------------------
+
+	inline XMVECTOR operator+(FXMVECTOR a, FXMVECTOR b) { return XMVectorAdd(a, b); }
+	inline XMVECTOR operator-(FXMVECTOR a, FXMVECTOR b) { return XMVectorSubtract(a, b); }
+	inline XMVECTOR operator*(FXMVECTOR a, FXMVECTOR b) { return XMVectorMultiply(a, b); }
+	inline XMVECTOR operator/(FXMVECTOR a, FXMVECTOR b) { return XMVectorDivide(a, b); }
+	inline XMVECTOR operator*(FXMVECTOR v, float s) { return XMVectorScale(v, s); }
+	inline XMVECTOR operator*(float s, FXMVECTOR v) { return XMVectorScale(v, s); }
+	inline XMVECTOR operator/(FXMVECTOR v, float s) { return XMVectorDivide(v, XMVectorReplicate(s)); }
+	inline XMVECTOR operator-(FXMVECTOR v) { return XMVectorSubtract(XMVectorZero(), v); }
+	inline XMVECTOR& operator+=(XMVECTOR& a, FXMVECTOR b) { a = a + b; return a; }
+	inline XMVECTOR& operator-=(XMVECTOR& a, FXMVECTOR b) { a = a - b; return a; }
+	inline XMVECTOR& operator*=(XMVECTOR& a, FXMVECTOR b) { a = a * b; return a; }
+	inline XMVECTOR& operator*=(XMVECTOR& a, float s) { a = a * s; return a; }
+	inline XMVECTOR& operator/=(XMVECTOR& a, float s) { a = a / s; return a; }
+
+	// ------ Geometric -------------------------------------------------------
+
+	inline XMVECTOR XMVector3Dot(FXMVECTOR a, FXMVECTOR b) { return XMVectorReplicate(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2]); }
+	inline XMVECTOR XMVector4Dot(FXMVECTOR a, FXMVECTOR b) { return XMVectorReplicate(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2] + a.v[3] * b.v[3]); }
+	inline XMVECTOR XMVector3LengthSq(FXMVECTOR v) { return XMVector3Dot(v, v); }
+	inline XMVECTOR XMVector3Length(FXMVECTOR v) { return XMVectorReplicate(std::sqrt(XMVectorGetX(XMVector3Dot(v, v)))); }
+	inline XMVECTOR XMVector2Length(FXMVECTOR v) { return XMVectorReplicate(std::sqrt(v.v[0] * v.v[0] + v.v[1] * v.v[1])); }
+
+	inline XMVECTOR XMVector3Cross(FXMVECTOR a, FXMVECTOR b)
+	{
+		return XMVectorSet(
+			a.v[1] * b.v[2] - a.v[2] * b.v[1],
+			a.v[2] * b.v[0] - a.v[0] * b.v[2],
+			a.v[0] * b.v[1] - a.v[1] * b.v[0],
+			0.0f);
+	}
+
+	// Zero length stays zero, as with the real one
+	inline XMVECTOR XMVector3Normalize(FXMVECTOR v)
+	{
+		float length = std::sqrt(XMVectorGetX(XMVector3Dot(v, v)));
+		return length > 0.0f ? v / length : XMVectorZero();
+	}
+
+	inline XMVECTOR XMPlaneNormalize(FXMVECTOR plane)
+	{
+		float length = std::sqrt(plane.v[0] * plane.v[0] + plane.v[1] * plane.v[1] + plane.v[2] * plane.v[2]);
+		return plane / length;
+	}
+
+	inline XMVECTOR XMPlaneDotCoord(FXMVECTOR plane, FXMVECTOR point)
+	{
+		return XMVectorReplicate(plane.v[0] * point.v[0] + plane.v[1] * point.v[1] + plane.v[2] * point.v[2] + plane.v[3]);
+	}
+
+	inline float XMConvertToRadians(float degrees) { return degrees * (XM_PI / 180.0f); }
+	inline float XMConvertToDegrees(float radians) { return radians * (180.0f / XM_PI); }
+
+	// ------ Matrices --------------------------------------------------------
+
+	inline XMMATRIX XMMatrixIdentity()
+	{
+		XMMATRIX r = {};
+		for (int i = 0; i < 4; i++)
+			r.r[i].v[i] = 1.0f;
+		return r;
+	}
+
+	inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* p)
+	{
+		XMMATRIX r;
+		for (int i = 0; i < 4; i++)
+			r.r[i] = XMVectorSet(p->m[i][0], p->m[i][1], p->m[i][2], p->m[i][3]);
+		return r;
+	}
+
+	inline void XMStoreFloat4x4(XMFLOAT4X4* p, FXMMATRIX m)
+	{
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				p->m[i][j] = m.r[i].v[j];
+	}
+
+	inline XMMATRIX XMMatrixMultiply(FXMMATRIX a, CXMMATRIX b)
+	{
+		XMMATRIX r;
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				r.r[i].v[j] = a.r[i].v[0] * b.r[0].v[j] + a.r[i].v[1] * b.r[1].v[j] + a.r[i].v[2] * b.r[2].v[j] + a.r[i].v[3] * b.r[3].v[j];
+		return r;
+	}
+
+	inline XMMATRIX operator*(FXMMATRIX a, CXMMATRIX b) { return XMMatrixMultiply(a, b); }
+
+	inline XMMATRIX XMMatrixTranspose(FXMMATRIX m)
+	{
+		XMMATRIX r;
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				r.r[i].v[j] = m.r[j].v[i];
+		return r;
+	}
+
+	inline XMVECTOR XMMatrixDeterminant(FXMMATRIX m)
+	{
+		double determinant = 0.0;
+		for (int column = 0; column < 4; column++)
+		{
+			double minor[9];
+			int k = 0;
+			for (int i = 1; i < 4; i++)
+				for (int j = 0; j < 4; j++)
+					if (j != column)
+						minor[k++] = m.r[i].v[j];
+
+			double cofactor =
+				minor[0] * (minor[4] * minor[8] - minor[5] * minor[7]) -
+				minor[1] * (minor[3] * minor[8] - minor[5] * minor[6]) +
+				minor[2] * (minor[3] * minor[7] - minor[4] * minor[6]);
+			determinant += (column & 1 ? -1.0 : 1.0) * m.r[0].v[column] * cofactor;
+		}
+		return XMVectorReplicate((float)determinant);
+	}
+
+	// Gauss-Jordan with partial pivoting, in doubles
+	inline XMMATRIX XMMatrixInverse(XMVECTOR* determinant, FXMMATRIX m)
+	{
+		double augmented[4][8];
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 8; j++)
+				augmented[i][j] = j < 4 ? m.r[i].v[j] : (j - 4 == i ? 1.0 : 0.0);
+
+		for (int column = 0; column < 4; column++)
+		{
+			int pivot = column;
+			for (int i = column + 1; i < 4; i++)
+				if (std::fabs(augmented[i][column]) > std::fabs(augmented[pivot][column]))
+					pivot = i;
+			for (int j = 0; j < 8; j++)
+				std::swap(augmented[column][j], augmented[pivot][j]);
+
+			double scale = augmented[column][column];
+			for (int j = 0; j < 8; j++)
+				augmented[column][j] /= scale;
+			for (int i = 0; i < 4; i++)
+			{
+				if (i == column)
+					continue;
+				double factor = augmented[i][column];
+				for (int j = 0; j < 8; j++)
+					augmented[i][j] -= factor * augmented[column][j];
+			}
+		}
+
+		if (determinant)
+			*determinant = XMMatrixDeterminant(m);
+
+		XMMATRIX r;
+		for (int i = 0; i < 4; i++)
+			for (int j = 0; j < 4; j++)
+				r.r[i].v[j] = (float)augmented[i][j + 4];
+		return r;
+	}
+
+	inline XMVECTOR XMVector3TransformNormal(FXMVECTOR v, FXMMATRIX m)
+	{
+		return v.v[0] * m.r[0] + v.v[1] * m.r[1] + v.v[2] * m.r[2];
+	}
+
+	inline XMVECTOR XMVector3Transform(FXMVECTOR v, FXMMATRIX m)
+	{
+		return XMVector3TransformNormal(v, m) + m.r[3];
+	}
+
+	inline XMVECTOR XMVector3TransformCoord(FXMVECTOR v, FXMMATRIX m)
+	{
+		XMVECTOR r = XMVector3Transform(v, m);
+		return r / r.v[3];
+	}
+
+	inline XMMATRIX XMMatrixScaling(float x, float y, float z)
+	{
+		XMMATRIX r = XMMatrixIdentity();
+		r.r[0].v[0] = x;
+		r.r[1].v[1] = y;
+		r.r[2].v[2] = z;
+		return r;
+	}
+
+	inline XMMATRIX XMMatrixTranslation(float x, float y, float z)
+	{
+		XMMATRIX r = XMMatrixIdentity();
+		r.r[3] = XMVectorSet(x, y, z, 1.0f);
+		return r;
+	}
+
+	inline XMMATRIX XMMatrixRotationX(float angle)
+	{
+		float c = std::cos(angle), s = std::sin(angle);
+		XMMATRIX r = XMMatrixIdentity();
+		r.r[1] = XMVectorSet(0, c, s, 0);
+		r.r[2] = XMVectorSet(0, -s, c, 0);
+		return r;
+	}
+
+	inline XMMATRIX XMMatrixRotationY(float angle)
+	{
+		float c = std::cos(angle), s = std::sin(angle);
+		XMMATRIX r = XMMatrixIdentity();
+		r.r[0] = XMVectorSet(c, 0, -s, 0);
+		r.r[2] = XMVectorSet(s, 0, c, 0);
+		return r;
+	}
+
+	inline XMMATRIX XMMatrixPerspectiveFovLH(float fovY, float aspect, float nearZ, float farZ)
+	{
+		float height = 1.0f / std::tan(fovY * 0.5f);
+		float range = farZ / (farZ - nearZ);
+		XMMATRIX r = {};
+		r.r[0].v[0] = height / aspect;
+		r.r[1].v[1] = height;
+		r.r[2].v[2] = range;
+		r.r[2].v[3] = 1.0f;
+		r.r[3].v[2] = -range * nearZ;
+		return r;
+	}
+
+	inline XMMATRIX XMMatrixLookToLH(FXMVECTOR eye, FXMVECTOR direction, FXMVECTOR up)
+	{
+		XMVECTOR z = XMVector3Normalize(direction);
+		XMVECTOR x = XMVector3Normalize(XMVector3Cross(up, z));
+		XMVECTOR y = XMVector3Cross(z, x);
+
+		XMMATRIX r;
+		r.r[0] = XMVectorSet(x.v[0], y.v[0], z.v[0], 0);
+		r.r[1] = XMVectorSet(x.v[1], y.v[1], z.v[1], 0);
+		r.r[2] = XMVectorSet(x.v[2], y.v[2], z.v[2], 0);
+		r.r[3] = XMVectorSet(-XMVectorGetX(XMVector3Dot(x, eye)), -XMVectorGetX(XMVector3Dot(y, eye)), -XMVectorGetX(XMVector3Dot(z, eye)), 1);
+		return r;
+	}
+
+	inline XMMATRIX XMMatrixLookAtLH(FXMVECTOR eye, FXMVECTOR focus, FXMVECTOR up)
+	{
+		return XMMatrixLookToLH(eye, focus - eye, up);
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// --------------------------------------------------------
+// Host test shim: the Win32 types and helpers the engine's
+// CPU-side code uses, so it builds off Windows.  Console
+// colors and debug output do nothing.
+// --------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+typedef int BOOL;
+typedef int INT;
+typedef unsigned int UINT;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned long DWORD;
+typedef unsigned long ULONG;
+typedef uint64_t UINT64;
+typedef float FLOAT;
+typedef size_t SIZE_T;
+typedef long HRESULT;
+typedef void* HANDLE;
+typedef void* HWND;
+typedef void* HINSTANCE;
+typedef const char* LPCSTR;
+typedef const wchar_t* LPCWSTR;
+
+#define TRUE 1
+#define FALSE 0
+#define S_OK ((HRESULT)0)
+#define E_FAIL ((HRESULT)0x80004005L)
+#define E_NOINTERFACE ((HRESULT)0x80004002L)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+#define FOREGROUND_BLUE 0x1
+#define FOREGROUND_GREEN 0x2
+#define FOREGROUND_RED 0x4
+#define FOREGROUND_INTENSITY 0x8
+#define STD_OUTPUT_HANDLE ((DWORD)-11)
+
+inline HANDLE GetStdHandle(DWORD) { return 0; }
+inline BOOL SetConsoleTextAttribute(HANDLE, WORD) { return TRUE; }
+inline void OutputDebugStringA(LPCSTR) {}
+inline void OutputDebugStringW(LPCWSTR) {}
+
+#define printf_s printf
+#define wprintf_s wprintf
+#define sscanf_s sscanf
+#define ZeroMemory(destination, length) memset((destination), 0, (length))
+
+// Windows.h defines these as macros, which would break the standard
+// headers here, so functions that take mixed argument types instead
+template<typename A, typename B> inline A max(A a, B b) { return a > (A)b ? a : (A)b; }
+template<typename A, typename B> inline A min(A a, B b) { return a < (A)b ? a : (A)b; }
@@ -0,0 +1,208 @@
+#pragma once
+
+// --------------------------------------------------------
+// Host test shim: the Direct3D 11 types the engine's code
+// names.  The interfaces are plain classes whose methods a
+// test's fake device defines (see Tests/FakeD3D.cpp), so
+// only tests that link one can call them.
+// --------------------------------------------------------
+
+#include "Windows.h"
+
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN,
+	DXGI_FORMAT_R32G32B32A32_FLOAT,
+	DXGI_FORMAT_R32G32B32A32_UINT,
+	DXGI_FORMAT_R32G32B32A32_SINT,
+	DXGI_FORMAT_R32G32B32_FLOAT,
+	DXGI_FORMAT_R32G32B32_UINT,
+	DXGI_FORMAT_R32G32B32_SINT,
+	DXGI_FORMAT_R16G16B16A16_SINT,
+	DXGI_FORMAT_R32G32_FLOAT,
+	DXGI_FORMAT_R32G32_UINT,
+	DXGI_FORMAT_R32G32_SINT,
+	DXGI_FORMAT_R8G8B8A8_UNORM,
+	DXGI_FORMAT_R24G8_TYPELESS,
+	DXGI_FORMAT_D24_UNORM_S8_UINT,
+	DXGI_FORMAT_R24_UNORM_X8_TYPELESS,
+	DXGI_FORMAT_R32_FLOAT,
+	DXGI_FORMAT_R32_UINT,
+	DXGI_FORMAT_R32_SINT,
+	DXGI_FORMAT_R16_UINT,
+};
+
+struct DXGI_SAMPLE_DESC { UINT Count; UINT Quality; };
+
+enum D3D11_USAGE { D3D11_USAGE_DEFAULT, D3D11_USAGE_IMMUTABLE, D3D11_USAGE_DYNAMIC, D3D11_USAGE_STAGING };
+
+enum D3D11_BIND_FLAG
+{
+	D3D11_BIND_VERTEX_BUFFER = 0x1,
+	D3D11_BIND_INDEX_BUFFER = 0x2,
+	D3D11_BIND_CONSTANT_BUFFER = 0x4,
+	D3D11_BIND_SHADER_RESOURCE = 0x8,
+	D3D11_BIND_STREAM_OUTPUT = 0x10,
+	D3D11_BIND_RENDER_TARGET = 0x20,
+};
+
+enum D3D11_CPU_ACCESS_FLAG { D3D11_CPU_ACCESS_WRITE = 0x10000, D3D11_CPU_ACCESS_READ = 0x20000 };
+enum D3D11_RESOURCE_MISC_FLAG { D3D11_RESOURCE_MISC_GENERATE_MIPS = 0x1 };
+
+enum D3D11_MAP
+{
+	D3D11_MAP_READ = 1,
+	D3D11_MAP_WRITE = 2,
+	D3D11_MAP_READ_WRITE = 3,
+	D3D11_MAP_WRITE_DISCARD = 4,
+	D3D11_MAP_WRITE_NO_OVERWRITE = 5,
+};
+
+enum D3D_CBUFFER_TYPE { D3D11_CT_CBUFFER, D3D11_CT_TBUFFER };
+enum D3D11_INPUT_CLASSIFICATION { D3D11_INPUT_PER_VERTEX_DATA, D3D11_INPUT_PER_INSTANCE_DATA };
+enum D3D11_FEATURE { D3D11_FEATURE_D3D11_OPTIONS = 7 };
+
+#define D3D11_APPEND_ALIGNED_ELEMENT 0xffffffff
+#define D3D11_SO_NO_RASTERIZED_STREAM 0xffffffff
+#define D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT (4096)
+#define D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT (14)
+#define D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT (128)
+#define D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT (16)
+#define D3D11_1_UAV_SLOT_COUNT (64)
+
+struct D3D11_BUFFER_DESC { UINT ByteWidth; D3D11_USAGE Usage; UINT BindFlags; UINT CPUAccessFlags; UINT MiscFlags; UINT StructureByteStride; };
+struct D3D11_TEXTURE2D_DESC { UINT Width, Height, MipLevels, ArraySize; DXGI_FORMAT Format; DXGI_SAMPLE_DESC SampleDesc; D3D11_USAGE Usage; UINT BindFlags, CPUAccessFlags, MiscFlags; };
+struct D3D11_SUBRESOURCE_DATA { const void* pSysMem; UINT SysMemPitch; UINT SysMemSlicePitch; };
+struct D3D11_MAPPED_SUBRESOURCE { void* pData; UINT RowPitch; UINT DepthPitch; };
+struct D3D11_BOX { UINT left, top, front, right, bottom, back; };
+struct D3D11_INPUT_ELEMENT_DESC { LPCSTR SemanticName; UINT SemanticIndex; DXGI_FORMAT Format; UINT InputSlot; UINT AlignedByteOffset; D3D11_INPUT_CLASSIFICATION InputSlotClass; UINT InstanceDataStepRate; };
+struct D3D11_SO_DECLARATION_ENTRY { UINT Stream; LPCSTR SemanticName; UINT SemanticIndex; BYTE StartComponent; BYTE ComponentCount; BYTE OutputSlot; };
+struct D3D11_SHADER_RESOURCE_VIEW_DESC;
+
+struct D3D11_FEATURE_DATA_D3D11_OPTIONS
+{
+	BOOL OutputMergerLogicOp;
+	BOOL UAVOnlyRenderingForcedSampleCount;
+	BOOL DiscardAPIsSeenByDriver;
+	BOOL FlagsForUpdateAndCopySeenByDriver;
+	BOOL ClearView;
+	BOOL CopyWithOverlap;
+	BOOL ConstantBufferPartialUpdate;
+	BOOL ConstantBufferOffsetting;
+	BOOL MapNoOverwriteOnDynamicConstantBuffer;
+	BOOL MapNoOverwriteOnDynamicBufferSRV;
+	BOOL MultisampleRTVWithForcedSampleCountOne;
+	BOOL SAD4ShaderInstructions;
+	BOOL ExtendedDoublesShaderInstructions;
+	BOOL ExtendedResourceSharing;
+};
+
+// Reference counted like the real thing, so ComPtr frees what it holds
+struct IUnknown
+{
+	virtual ~IUnknown() {}
+
+	ULONG AddRef() { return ++referenceCount; }
+	ULONG Release()
+	{
+		ULONG count = --referenceCount;
+		if (count == 0)
+			delete this;
+		return count;
+	}
+
+private:
+	ULONG referenceCount = 1;
+};
+
+struct ID3D11Resource : IUnknown {};
+struct ID3D11Buffer : ID3D11Resource {};
+struct ID3D11Texture2D : ID3D11Resource {};
+struct ID3D11ShaderResourceView : IUnknown {};
+struct ID3D11UnorderedAccessView : IUnknown {};
+struct ID3D11RenderTargetView : IUnknown {};
+struct ID3D11DepthStencilView : IUnknown {};
+struct ID3D11SamplerState : IUnknown {};
+struct ID3D11RasterizerState : IUnknown {};
+struct ID3D11DepthStencilState : IUnknown {};
+struct ID3D11BlendState : IUnknown {};
+struct ID3D11InputLayout : IUnknown {};
+struct ID3D11VertexShader : IUnknown {};
+struct ID3D11PixelShader : IUnknown {};
+struct ID3D11HullShader : IUnknown {};
+struct ID3D11DomainShader : IUnknown {};
+struct ID3D11GeometryShader : IUnknown {};
+struct ID3D11ComputeShader : IUnknown {};
+
+struct ID3DBlob : IUnknown
+{
+	void* GetBufferPointer();
+	SIZE_T GetBufferSize();
+};
+
+struct ID3D11Device : IUnknown
+{
+	HRESULT CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer);
+	HRESULT CreateTexture2D(const D3D11_TEXTURE2D_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Texture2D** texture);
+	HRESULT CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc, ID3D11ShaderResourceView** view);
+	HRESULT CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, UINT count, const void* bytecode, SIZE_T length, ID3D11InputLayout** layout);
+	HRESULT CreateVertexShader(const void* bytecode, SIZE_T length, void* linkage, ID3D11VertexShader** shader);
+	HRESULT CreatePixelShader(const void* bytecode, SIZE_T length, void* linkage, ID3D11PixelShader** shader);
+	HRESULT CreateHullShader(const void* bytecode, SIZE_T length, void* linkage, ID3D11HullShader** shader);
+	HRESULT CreateDomainShader(const void* bytecode, SIZE_T length, void* linkage, ID3D11DomainShader** shader);
+	HRESULT CreateGeometryShader(const void* bytecode, SIZE_T length, void* linkage, ID3D11GeometryShader** shader);
+	HRESULT CreateGeometryShaderWithStreamOutput(const void* bytecode, SIZE_T length, const D3D11_SO_DECLARATION_ENTRY* entries, UINT entryCount,
+		const UINT* strides, UINT strideCount, UINT rasterizedStream, void* linkage, ID3D11GeometryShader** shader);
+	HRESULT CreateComputeShader(const void* bytecode, SIZE_T length, void* linkage, ID3D11ComputeShader** shader);
+	HRESULT CheckFeatureSupport(D3D11_FEATURE feature, void* data, UINT size);
+};
+
+struct ID3D11DeviceContext : IUnknown
+{
+	void IASetInputLayout(ID3D11InputLayout* layout);
+	void IASetVertexBuffers(UINT slot, UINT count, ID3D11Buffer* const* buffers, const UINT* strides, const UINT* offsets);
+	void IASetIndexBuffer(ID3D11Buffer* buffer, DXGI_FORMAT format, UINT offset);
+	void Draw(UINT vertexCount, UINT startVertex);
+	void DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex);
+	void Dispatch(UINT x, UINT y, UINT z);
+
+	HRESULT Map(ID3D11Resource* resource, UINT subresource, D3D11_MAP type, UINT flags, D3D11_MAPPED_SUBRESOURCE* mapped);
+	void Unmap(ID3D11Resource* resource, UINT subresource);
+	void UpdateSubresource(ID3D11Resource* resource, UINT subresource, const D3D11_BOX* box, const void* data, UINT rowPitch, UINT depthPitch);
+	void CopySubresourceRegion(ID3D11Resource* destination, UINT destinationSubresource, UINT x, UINT y, UINT z,
+		ID3D11Resource* source, UINT sourceSubresource, const D3D11_BOX* box);
+	void GenerateMips(ID3D11ShaderResourceView* view);
+
+	void VSSetShader(ID3D11VertexShader* shader, void* classInstances, UINT count);
+	void VSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* buffers);
+	void VSSetShaderResources(UINT slot, UINT count, ID3D11ShaderResourceView* const* views);
+	void VSSetSamplers(UINT slot, UINT count, ID3D11SamplerState* const* samplers);
+
+	void PSSetShader(ID3D11PixelShader* shader, void* classInstances, UINT count);
+	void PSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* buffers);
+	void PSSetShaderResources(UINT slot, UINT count, ID3D11ShaderResourceView* const* views);
+	void PSSetSamplers(UINT slot, UINT count, ID3D11SamplerState* const* samplers);
+
+	void HSSetShader(ID3D11HullShader* shader, void* classInstances, UINT count);
+	void HSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* buffers);
+	void HSSetShaderResources(UINT slot, UINT count, ID3D11ShaderResourceView* const* views);
+	void HSSetSamplers(UINT slot, UINT count, ID3D11SamplerState* const* samplers);
+
+	void DSSetShader(ID3D11DomainShader* shader, void* classInstances, UINT count);
+	void DSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* buffers);
+	void DSSetShaderResources(UINT slot, UINT count, ID3D11ShaderResourceView* const* views);
+	void DSSetSamplers(UINT slot, UINT count, ID3D11SamplerState* const* samplers);
+
+	void GSSetShader(ID3D11GeometryShader* shader, void* classInstances, UINT count);
+	void GSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* buffers);
+	void GSSetShaderResources(UINT slot, UINT count, ID3D11ShaderResourceView* const* views);
+	void GSSetSamplers(UINT slot, UINT count, ID3D11SamplerState* const* samplers);
+
+	void CSSetShader(ID3D11ComputeShader* shader, void* classInstances, UINT count);
+	void CSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* buffers);
+	void CSSetShaderResources(UINT slot, UINT count, ID3D11ShaderResourceView* const* views);
+	void CSSetSamplers(UINT slot, UINT count, ID3D11SamplerState* const* samplers);
+	void CSSetUnorderedAccessViews(UINT slot, UINT count, ID3D11UnorderedAccessView* const* views, const UINT* initialCounts);
+
+	void SOSetTargets(UINT count, ID3D11Buffer* const* buffers, const UINT* offsets);
+};
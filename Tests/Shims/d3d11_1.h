@@ -0,0 +1,18 @@
+#pragma once
+
+// --------------------------------------------------------
+// Host test shim: the Direct3D 11.1 context, for binding
+// part of a constant buffer
+// --------------------------------------------------------
+
+#include "d3d11.h"
+
+struct ID3D11DeviceContext1 : ID3D11DeviceContext
+{
+	void VSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstant, const UINT* constantCount);
+	void PSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstant, const UINT* constantCount);
+	void HSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstant, const UINT* constantCount);
+	void DSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstant, const UINT* constantCount);
+	void GSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstant, const UINT* constantCount);
+	void CSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* buffers, const UINT* firstConstant, const UINT* constantCount);
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+// --------------------------------------------------------
+// Host test shim: loading compiled shaders and reflecting
+// them, answered by a test's fake (see Tests/FakeD3D.cpp)
+// --------------------------------------------------------
+
+#include "d3d11.h"
+
+enum D3D_SHADER_INPUT_TYPE
+{
+	D3D_SIT_CBUFFER,
+	D3D_SIT_TBUFFER,
+	D3D_SIT_TEXTURE,
+	D3D_SIT_SAMPLER,
+	D3D_SIT_UAV_RWTYPED,
+	D3D_SIT_STRUCTURED,
+	D3D_SIT_UAV_RWSTRUCTURED,
+	D3D_SIT_BYTEADDRESS,
+	D3D_SIT_UAV_RWBYTEADDRESS,
+	D3D_SIT_UAV_APPEND_STRUCTURED,
+	D3D_SIT_UAV_CONSUME_STRUCTURED,
+	D3D_SIT_UAV_RWSTRUCTURED_WITH_COUNTER,
+};
+
+enum D3D_REGISTER_COMPONENT_TYPE { D3D_REGISTER_COMPONENT_UNKNOWN, D3D_REGISTER_COMPONENT_UINT32, D3D_REGISTER_COMPONENT_SINT32, D3D_REGISTER_COMPONENT_FLOAT32 };
+enum D3D_NAME { D3D_NAME_UNDEFINED };
+
+struct D3D11_SHADER_DESC { UINT Version; LPCSTR Creator; UINT Flags; UINT ConstantBuffers; UINT BoundResources; UINT InputParameters; UINT OutputParameters; };
+struct D3D11_SHADER_INPUT_BIND_DESC { LPCSTR Name; D3D_SHADER_INPUT_TYPE Type; UINT BindPoint; UINT BindCount; UINT uFlags; UINT ReturnType; UINT Dimension; UINT NumSamples; };
+struct D3D11_SHADER_BUFFER_DESC { LPCSTR Name; D3D_CBUFFER_TYPE Type; UINT Variables; UINT Size; UINT uFlags; };
+struct D3D11_SHADER_VARIABLE_DESC { LPCSTR Name; UINT StartOffset; UINT Size; UINT uFlags; void* DefaultValue; UINT StartTexture; UINT TextureSize; UINT StartSampler; UINT SamplerSize; };
+struct D3D11_SIGNATURE_PARAMETER_DESC { LPCSTR SemanticName; UINT SemanticIndex; UINT Register; D3D_NAME SystemValueType; D3D_REGISTER_COMPONENT_TYPE ComponentType; BYTE Mask; BYTE ReadWriteMask; UINT Stream; UINT MinPrecision; };
+
+// Not reference counted: owned by the reflection they came from
+struct ID3D11ShaderReflectionVariable
+{
+	HRESULT GetDesc(D3D11_SHADER_VARIABLE_DESC* desc);
+};
+
+struct ID3D11ShaderReflectionConstantBuffer
+{
+	HRESULT GetDesc(D3D11_SHADER_BUFFER_DESC* desc);
+	ID3D11ShaderReflectionVariable* GetVariableByIndex(UINT index);
+};
+
+struct ID3D11ShaderReflection : IUnknown
+{
+	HRESULT GetDesc(D3D11_SHADER_DESC* desc);
+	HRESULT GetResourceBindingDesc(UINT index, D3D11_SHADER_INPUT_BIND_DESC* desc);
+	HRESULT GetResourceBindingDescByName(LPCSTR name, D3D11_SHADER_INPUT_BIND_DESC* desc);
+	ID3D11ShaderReflectionConstantBuffer* GetConstantBufferByIndex(UINT index);
+	HRESULT GetInputParameterDesc(UINT index, D3D11_SIGNATURE_PARAMETER_DESC* desc);
+	HRESULT GetOutputParameterDesc(UINT index, D3D11_SIGNATURE_PARAMETER_DESC* desc);
+	UINT GetThreadGroupSize(UINT* x, UINT* y, UINT* z);
+};
+
+struct GUID { unsigned long Data1; };
+extern const GUID IID_ID3D11ShaderReflection;
+
+HRESULT D3DReadFileToBlob(LPCWSTR fileName, ID3DBlob** contents);
+HRESULT D3DReflect(const void* bytecode, SIZE_T length, const GUID& interfaceId, void** reflector);
@@ -0,0 +1,67 @@
+#pragma once
+
+// --------------------------------------------------------
+// Host test shim: a reference-counting ComPtr over the
+// IUnknown in the d3d11.h shim
+// --------------------------------------------------------
+
+#include <cstddef>
+
+namespace Microsoft
+{
+	namespace WRL
+	{
+		template<typename T>
+		class ComPtr
+		{
+		public:
+			ComPtr() {}
+			ComPtr(std::nullptr_t) {}
+			template<typename U> ComPtr(U* other) : ptr(other) { AddRef(); }
+			ComPtr(const ComPtr& other) : ptr(other.ptr) { AddRef(); }
+			template<typename U> ComPtr(const ComPtr<U>& other) : ptr(other.Get()) { AddRef(); }
+			ComPtr(ComPtr&& other) : ptr(other.ptr) { other.ptr = nullptr; }
+			~ComPtr() { Reset(); }
+
+			ComPtr& operator=(ComPtr other)
+			{
+				T* old = ptr;
+				ptr = other.ptr;
+				other.ptr = old;
+				return *this;
+			}
+
+			T* Get() const { return ptr; }
+			T* operator->() const { return ptr; }
+			explicit operator bool() const { return ptr != nullptr; }
+
+			// As with the real one, these don't release what's there first
+			T** GetAddressOf() { return &ptr; }
+			T* const* GetAddressOf() const { return &ptr; }
+			T** ReleaseAndGetAddressOf() { Reset(); return &ptr; }
+
+			void Reset()
+			{
+				if (ptr)
+				{
+					T* old = ptr;
+					ptr = nullptr;
+					old->Release();
+				}
+			}
+
+			template<typename U>
+			long As(ComPtr<U>* other) const
+			{
+				U* cast = dynamic_cast<U*>(ptr);
+				*other = cast;
+				return cast ? 0 : (long)0x80004002L;
+			}
+
+		private:
+			T* ptr = nullptr;
+
+			void AddRef() { if (ptr) ptr->AddRef(); }
+		};
+	}
+}
@@ -0,0 +1,371 @@
+#include "SimpleShader.h"
+#include "FakeD3D.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	const wchar_t* ShaderFile = L"SimpleShaderUploadTests.cso";
+	const char* ReflectionFile = "SimpleShaderUploadTests.cso.reflection";
+
+	// One per stage for TestReflectionCache()
+	const wchar_t* StageShaderFiles[] = { L"SimpleShaderUploadTestsVS.cso", L"SimpleShaderUploadTestsGS.cso", L"SimpleShaderUploadTestsCS.cso" };
+	const char* StageReflectionFiles[] = { "SimpleShaderUploadTestsVS.cso.reflection", "SimpleShaderUploadTestsGS.cso.reflection", "SimpleShaderUploadTestsCS.cso.reflection" };
+
+	// One 64-byte buffer of three float4s and a float, and a second
+	// buffer that's never touched after its first copy
+	FakeShader MakeShader()
+	{
+		FakeShader shader;
+		shader.Bytecode = "SimpleShaderUploadTests v1";
+		shader.ConstantBuffers.push_back({ "PerObject", 0, 64, {
+			{ "colorA", 0, 16 },
+			{ "colorB", 16, 16 },
+			{ "colorC", 32, 16 },
+			{ "scalar", 48, 4 } } });
+		shader.ConstantBuffers.push_back({ "PerFrame", 1, 32, {
+			{ "time", 0, 4 } } });
+		return shader;
+	}
+
+	bool IsSameElements(const std::vector<FakeElement>& a, const std::vector<FakeElement>& b)
+	{
+		if (a.size() != b.size())
+			return false;
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			if (a[i].SemanticName != b[i].SemanticName || a[i].SemanticIndex != b[i].SemanticIndex ||
+				a[i].Value != b[i].Value || a[i].Slot != b[i].Slot || a[i].PerInstance != b[i].PerInstance)
+				return false;
+		}
+		return true;
+	}
+
+	struct TestDevice
+	{
+		Microsoft::WRL::ComPtr<ID3D11Device> Device;
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> Context;
+
+		TestDevice() { FakeD3D::CreateDevice(Device.GetAddressOf(), Context.GetAddressOf()); }
+	};
+
+	FakeBuffer* GetFakeBuffer(SimplePixelShader& shader, unsigned int index)
+	{
+		return (FakeBuffer*)shader.GetBufferInfo(index)->ConstantBuffer.Get();
+	}
+
+	// --------------------------------------------------------
+	// Setting what's already there leaves the buffer clean,
+	// and a clean buffer is never copied
+	// --------------------------------------------------------
+	void TestUnchangedSkipsUpload()
+	{
+		TestDevice d;
+		SimplePixelShader shader(d.Device, d.Context, ShaderFile);
+		CHECK(shader.IsShaderValid());
+
+		// Everything starts dirty, since the GPU side starts undefined
+		ISimpleShader::BeginFrame();
+		FakeD3DCounts before = FakeD3D::Counts;
+		shader.CopyAllBufferData();
+		CHECK(FakeD3D::Counts.Updates == before.Updates + 2);
+		CHECK(ISimpleShader::GetUploadStats().BuffersUploaded == 2);
+
+		// The local data starts zeroed, so zeros change nothing
+		float zero[4] = {};
+		CHECK(shader.SetFloat4("colorA", zero));
+		CHECK(!shader.GetBufferInfo(0u)->IsDirty());
+
+		float color[4] = { 0.25f, 0.5f, 0.75f, 1.0f };
+		CHECK(shader.SetFloat4("colorB", color));
+		shader.CopyAllBufferData();
+
+		// And neither does the same value again, however often
+		ISimpleShader::BeginFrame();
+		before = FakeD3D::Counts;
+		for (int i = 0; i < 10; i++)
+		{
+			CHECK(shader.SetFloat4("colorB", color));
+			CHECK(!shader.GetBufferInfo(0u)->IsDirty());
+			shader.CopyAllBufferData();
+		}
+		CHECK(FakeD3D::Counts.Updates == before.Updates);
+		CHECK(FakeD3D::Counts.ConstantBufferBinds == before.ConstantBufferBinds);
+
+		const SimpleShaderUploadStats& stats = ISimpleShader::GetUploadStats();
+		CHECK(stats.BuffersUploaded == 0 && stats.BuffersSkipped == 20);
+		CHECK(stats.BytesUploaded == 0 && stats.BytesSkipped == 10 * (64 + 32) && stats.BytesChanged == 0);
+	}
+
+	// --------------------------------------------------------
+	// The dirty range grows to take in exactly the variables
+	// that changed, not the whole buffer
+	// --------------------------------------------------------
+	void TestDirtyRange()
+	{
+		TestDevice d;
+		SimplePixelShader shader(d.Device, d.Context, ShaderFile);
+		shader.CopyAllBufferData();
+		const SimpleConstantBuffer* buffer = shader.GetBufferInfo(0u);
+		CHECK(!buffer->IsDirty());
+
+		float color[4] = { 1, 2, 3, 4 };
+		shader.SetFloat4("colorB", color);
+		CHECK(buffer->DirtyStart == 16 && buffer->DirtyEnd == 32);
+
+		// Later in the buffer: grows to its end
+		shader.SetFloat("scalar", 5.0f);
+		CHECK(buffer->DirtyStart == 16 && buffer->DirtyEnd == 52);
+
+		// Inside the range already: no change
+		shader.SetFloat4("colorC", color);
+		CHECK(buffer->DirtyStart == 16 && buffer->DirtyEnd == 52);
+
+		// Earlier: grows to its start
+		shader.SetFloat4("colorA", color);
+		CHECK(buffer->DirtyStart == 0 && buffer->DirtyEnd == 52);
+
+		// The other buffer is still clean
+		CHECK(!shader.GetBufferInfo(1u)->IsDirty());
+
+		// Copying counts the dirty bytes, sends the buffer whole (the only
+		// way UpdateSubresource() takes a constant buffer) and leaves it clean
+		ISimpleShader::BeginFrame();
+		FakeD3DCounts before = FakeD3D::Counts;
+		shader.CopyAllBufferData();
+		CHECK(FakeD3D::Counts.Updates == before.Updates + 1);
+		CHECK(FakeD3D::LastUpdateStart == 0 && FakeD3D::LastUpdateEnd == 64);
+		CHECK(ISimpleShader::GetUploadStats().BytesChanged == 52);
+		CHECK(!buffer->IsDirty());
+		CHECK(memcmp(GetFakeBuffer(shader, 0)->Memory.data(), buffer->LocalDataBuffer, 64) == 0);
+
+		// A single variable, alone
+		shader.SetFloat("scalar", 6.0f);
+		CHECK(buffer->DirtyStart == 48 && buffer->DirtyEnd == 52);
+		shader.CopyAllBufferData();
+		CHECK(ISimpleShader::GetUploadStats().BytesChanged == 52 + 4);
+	}
+
+	// --------------------------------------------------------
+	// Random frames of sets and copies, with the stats checked
+	// against what the fake context actually received and
+	// against a model of which bytes changed
+	// --------------------------------------------------------
+	void TestStatsMatchUploads()
+	{
+		TestDevice d;
+		SimplePixelShader shader(d.Device, d.Context, ShaderFile);
+		shader.CopyAllBufferData();
+
+		const char* names[] = { "colorA", "colorB", "colorC" };
+		unsigned int offsets[] = { 0, 16, 32 };
+		std::mt19937 rng(11);
+
+		for (int frame = 0; frame < 300; frame++)
+		{
+			ISimpleShader::BeginFrame();
+			FakeD3DCounts before = FakeD3D::Counts;
+			unsigned int copies = 0;
+			unsigned int expectedUploads = 0;
+			size_t expectedChanged = 0;
+
+			for (int draw = 0; draw < 8; draw++)
+			{
+				// A few variables, often set to what they already hold
+				unsigned int lowest = 64;
+				unsigned int highest = 0;
+				std::vector<unsigned char> local(shader.GetBufferInfo(0u)->LocalDataBuffer, shader.GetBufferInfo(0u)->LocalDataBuffer + 64);
+				for (int set = 0; set < 3; set++)
+				{
+					int v = rng() % 3;
+					float value[4] = { (float)(rng() % 2), 0, 0, 1 };
+					shader.SetFloat4(ShaderName(names[v]), value);
+					if (memcmp(&local[offsets[v]], value, 16) != 0)
+					{
+						memcpy(&local[offsets[v]], value, 16);
+						lowest = std::min(lowest, offsets[v]);
+						highest = std::max(highest, offsets[v] + 16);
+					}
+				}
+
+				shader.CopyAllBufferData();
+				copies += 2;
+				if (highest > lowest)
+				{
+					expectedUploads++;
+					expectedChanged += highest - lowest;
+				}
+
+				// Uploaded or not, the GPU copy now matches
+				CHECK(memcmp(GetFakeBuffer(shader, 0)->Memory.data(), local.data(), 64) == 0);
+			}
+
+			const SimpleShaderUploadStats& stats = ISimpleShader::GetUploadStats();
+			CHECK(stats.BuffersUploaded == expectedUploads);
+			CHECK(stats.BuffersUploaded == FakeD3D::Counts.Updates - before.Updates);
+			CHECK(stats.BuffersUploaded + stats.BuffersSkipped == copies);
+			CHECK(stats.BytesUploaded == FakeD3D::Counts.UpdateBytes - before.UpdateBytes);
+			CHECK(stats.BytesUploaded + stats.BytesSkipped == (copies / 2) * (64 + 32));
+			CHECK(stats.BytesChanged == expectedChanged);
+		}
+	}
+
+	// --------------------------------------------------------
+	// With the dynamic buffer, changed data goes to a new
+	// slice instead, still only when something changed
+	// --------------------------------------------------------
+	void TestDynamicConstants()
+	{
+		TestDevice d;
+		CHECK(ISimpleShader::EnableDynamicConstants(d.Device, d.Context));
+		{
+			SimplePixelShader shader(d.Device, d.Context, ShaderFile);
+			shader.SetShader();
+
+			ISimpleShader::BeginFrame();
+			FakeD3DCounts before = FakeD3D::Counts;
+			float color[4] = { 1, 0, 0, 1 };
+			shader.SetFloat4("colorA", color);
+			shader.CopyAllBufferData();
+
+			// Both buffers went up (the second for the first time), the first
+			// discarding and the next not, and both were bound again
+			CHECK(FakeD3D::Counts.Updates == before.Updates);
+			CHECK(FakeD3D::Counts.Maps == before.Maps + 2);
+			CHECK(FakeD3D::Counts.Discards == before.Discards + 1 && FakeD3D::Counts.NoOverwrites == before.NoOverwrites + 1);
+			CHECK(ISimpleShader::GetUploadStats().BuffersUploaded == 2);
+
+			const FakeConstantBinding& binding = FakeD3D::PSConstantBuffers[0];
+			FakeBuffer* dynamic = (FakeBuffer*)binding.Buffer;
+			CHECK(dynamic && dynamic != GetFakeBuffer(shader, 0));
+			CHECK(binding.ConstantCount == CONSTANT_SLICE_ALIGNMENT / 16);
+			CHECK(memcmp(dynamic->Memory.data() + binding.FirstConstant * 16, color, 16) == 0);
+
+			// Unchanged: nothing mapped, nothing bound
+			before = FakeD3D::Counts;
+			shader.SetFloat4("colorA", color);
+			shader.CopyAllBufferData();
+			CHECK(FakeD3D::Counts.Maps == before.Maps && FakeD3D::Counts.ConstantBufferBinds == before.ConstantBufferBinds);
+			CHECK(ISimpleShader::GetUploadStats().BuffersSkipped == 2);
+		}
+		ISimpleShader::DisableDynamicConstants();
+	}
+
+	// --------------------------------------------------------
+	// What a vertex, geometry or compute shader needs to be
+	// created (its input layout, stream out declaration, UAVs
+	// and thread group size) comes from the cache too, so a
+	// second load reflects nothing and builds the same thing
+	// --------------------------------------------------------
+	void TestReflectionCache()
+	{
+		TestDevice d;
+		FakeShader saved = FakeD3D::NextShader;
+
+		// Vertex: three per-vertex inputs and one per instance
+		FakeD3D::NextShader = FakeShader();
+		FakeD3D::NextShader.Bytecode = "SimpleShaderUploadTests vertex shader";
+		FakeD3D::NextShader.ConstantBuffers.push_back({ "ExternalData", 0, 64, { { "world", 0, 64 } } });
+		FakeD3D::NextShader.Inputs = {
+			{ "POSITION", 0, D3D_REGISTER_COMPONENT_FLOAT32, 7 },
+			{ "TEXCOORD", 0, D3D_REGISTER_COMPONENT_FLOAT32, 3 },
+			{ "BLENDINDICES", 0, D3D_REGISTER_COMPONENT_UINT32, 15 },
+			{ "WORLD_PER_INSTANCE", 1, D3D_REGISTER_COMPONENT_FLOAT32, 15 } };
+
+		std::vector<FakeElement> layout;
+		for (int load = 0; load < 2; load++)
+		{
+			FakeD3DCounts before = FakeD3D::Counts;
+			FakeD3D::LastInputLayout.clear();
+			SimpleVertexShader vs(d.Device, d.Context, StageShaderFiles[0]);
+			CHECK(vs.IsShaderValid() && vs.GetInputLayout());
+			CHECK(vs.GetPerInstanceCompatible());
+			CHECK(vs.HasVariable("world"));
+			CHECK(FakeD3D::Counts.Reflects == before.Reflects + (load == 0 ? 1 : 0));
+
+			if (load == 0)
+				layout = FakeD3D::LastInputLayout;
+			else
+				CHECK(IsSameElements(FakeD3D::LastInputLayout, layout));
+		}
+
+		std::vector<FakeElement> expectedLayout = {
+			{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, false },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, false },
+			{ "BLENDINDICES", 0, DXGI_FORMAT_R32G32B32A32_UINT, 0, false },
+			{ "WORLD_PER_INSTANCE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, true } };
+		CHECK(IsSameElements(layout, expectedLayout));
+
+		// Geometry, streaming out two of its outputs
+		FakeD3D::NextShader = FakeShader();
+		FakeD3D::NextShader.Bytecode = "SimpleShaderUploadTests geometry shader";
+		FakeD3D::NextShader.Outputs = {
+			{ "SV_POSITION", 0, D3D_REGISTER_COMPONENT_FLOAT32, 15 },
+			{ "TEXCOORD", 2, D3D_REGISTER_COMPONENT_FLOAT32, 3 } };
+
+		for (int load = 0; load < 2; load++)
+		{
+			FakeD3DCounts before = FakeD3D::Counts;
+			FakeD3D::LastStreamOut.clear();
+			SimpleGeometryShader gs(d.Device, d.Context, StageShaderFiles[1], true);
+			CHECK(gs.IsShaderValid());
+			CHECK(FakeD3D::Counts.Reflects == before.Reflects + (load == 0 ? 1 : 0));
+
+			std::vector<FakeElement> expectedStreamOut = {
+				{ "SV_POSITION", 0, 4, 0, false },
+				{ "TEXCOORD", 2, 2, 0, false } };
+			CHECK(IsSameElements(FakeD3D::LastStreamOut, expectedStreamOut));
+		}
+
+		// Compute, with two UAVs among its resources
+		FakeD3D::NextShader = FakeShader();
+		FakeD3D::NextShader.Bytecode = "SimpleShaderUploadTests compute shader";
+		FakeD3D::NextShader.Resources = {
+			{ "input", D3D_SIT_TEXTURE, 0 },
+			{ "output", D3D_SIT_UAV_RWTYPED, 1 },
+			{ "particles", D3D_SIT_UAV_RWSTRUCTURED, 3 } };
+		FakeD3D::NextShader.ThreadGroupSize[0] = 8;
+		FakeD3D::NextShader.ThreadGroupSize[1] = 4;
+
+		for (int load = 0; load < 2; load++)
+		{
+			FakeD3DCounts before = FakeD3D::Counts;
+			SimpleComputeShader cs(d.Device, d.Context, StageShaderFiles[2]);
+			CHECK(cs.IsShaderValid());
+			CHECK(FakeD3D::Counts.Reflects == before.Reflects + (load == 0 ? 1 : 0));
+			CHECK(cs.GetUnorderedAccessViewIndex("output") == 1);
+			CHECK(cs.GetUnorderedAccessViewIndex("particles") == 3);
+			CHECK(!cs.HasUnorderedAccessView("input"));
+
+			cs.DispatchByThreads(64, 64, 1);
+			CHECK(FakeD3D::LastDispatch[0] == 8 && FakeD3D::LastDispatch[1] == 16 && FakeD3D::LastDispatch[2] == 1);
+		}
+
+		FakeD3D::NextShader = saved;
+	}
+}
+
+int main()
+{
+	remove(ReflectionFile);
+	for (const char* file : StageReflectionFiles)
+		remove(file);
+	ISimpleShader::ReportWarnings = false;
+	FakeD3D::NextShader = MakeShader();
+
+	TestUnchangedSkipsUpload();
+	TestDirtyRange();
+	TestStatsMatchUploads();
+	TestDynamicConstants();
+	TestReflectionCache();
+
+	remove(ReflectionFile);
+	for (const char* file : StageReflectionFiles)
+		remove(file);
+	return TestResult("SimpleShaderUploadTests");
+}
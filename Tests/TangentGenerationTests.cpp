@@ -0,0 +1,229 @@
+#include "TangentGeneration.h"
+#include "MeshOptimizer.h"
+#include "WorkerPool.h"
+#include "LegacyTangents.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+// Usage: TangentGenerationTests
+//
+// Checks CalculateTangents() against the scalar loop it
+// replaced: bit for bit when run serially, and within 1e-6
+// when split into chunks, both with vertices in fetch order
+// (so chunks add to their home ranges and spill across
+// their edges) and shuffled (so the ranges fall back to an
+// even split).  Then checks that SplitMirroredVertices()
+// duplicates exactly the vertices used both ways round.
+
+namespace
+{
+	const unsigned int ChunkCounts[] = { 1, 2, 3, 7, 16 };
+
+	// --------------------------------------------------------
+	// A wavy grid of size x size quads, with UVs bent a little
+	// so that no two triangles share a tangent
+	// --------------------------------------------------------
+	void MakeGrid(unsigned int size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		for (unsigned int y = 0; y <= size; y++)
+		{
+			for (unsigned int x = 0; x <= size; x++)
+			{
+				Vertex v = {};
+				v.Position = XMFLOAT3(x * 0.1f, sinf(x * 0.3f) * cosf(y * 0.2f), y * 0.1f);
+				XMStoreFloat3(&v.Normal, XMVector3Normalize(XMVectorSet(-0.3f * cosf(x * 0.3f), 1.0f, 0.2f * sinf(y * 0.2f), 0.0f)));
+				v.UV = XMFLOAT2((x + 0.3f * sinf(y * 0.7f)) / size, (y + 0.3f * cosf(x * 0.5f)) / size);
+				vertices.push_back(v);
+			}
+		}
+
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				unsigned int a = y * (size + 1) + x;
+				unsigned int c = a + size + 1;
+				unsigned int quad[] = { a, c, a + 1, a + 1, c, c + 1 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	// Moves every vertex somewhere random, keeping the triangles
+	void ShuffleVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		std::vector<unsigned int> order(vertices.size());
+		std::iota(order.begin(), order.end(), 0u);
+		std::shuffle(order.begin(), order.end(), std::mt19937(5));
+
+		std::vector<Vertex> shuffled(vertices.size());
+		for (size_t i = 0; i < order.size(); i++)
+			shuffled[order[i]] = vertices[i];
+		for (unsigned int& index : indices)
+			index = order[index];
+		vertices.swap(shuffled);
+	}
+
+	// Largest per-component difference in tangent direction
+	float GetLargestDifference(const std::vector<Vertex>& a, const std::vector<Vertex>& b)
+	{
+		float largest = 0.0f;
+		for (size_t i = 0; i < a.size(); i++)
+		{
+			largest = std::max(largest, std::fabs(a[i].Tangent.x - b[i].Tangent.x));
+			largest = std::max(largest, std::fabs(a[i].Tangent.y - b[i].Tangent.y));
+			largest = std::max(largest, std::fabs(a[i].Tangent.z - b[i].Tangent.z));
+		}
+		return largest;
+	}
+
+	bool IsSameDirection(const std::vector<Vertex>& a, const std::vector<Vertex>& b)
+	{
+		for (size_t i = 0; i < a.size(); i++)
+			if (memcmp(&a[i].Tangent, &b[i].Tangent, sizeof(float) * 3) != 0)
+				return false;
+		return true;
+	}
+
+	void TestMatchesLegacy(const char* name, const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+	{
+		std::vector<Vertex> legacy = vertices;
+		CalculateTangentsLegacy(legacy.data(), (int)legacy.size(), indices.data(), (int)indices.size());
+
+		for (unsigned int chunkCount : ChunkCounts)
+		{
+			std::vector<Vertex> result = vertices;
+			CalculateTangents(result.data(), result.size(), indices.data(), indices.size(), chunkCount);
+
+			float difference = GetLargestDifference(legacy, result);
+			printf("%s, %u chunks: differs by %.3g\n", name, chunkCount, difference);
+			if (chunkCount == 1)
+				CHECK(IsSameDirection(legacy, result));
+			CHECK(difference <= 1e-6f);
+
+			// The grid's UVs all run the same way round, so every vertex
+			// gets the same handedness
+			bool consistent = std::fabs(result[0].Tangent.w) == 1.0f;
+			for (const Vertex& v : result)
+				consistent &= v.Tangent.w == result[0].Tangent.w;
+			CHECK(consistent);
+		}
+	}
+
+	Vertex MakeVertex(float x, float y, float u, float v)
+	{
+		Vertex vertex = {};
+		vertex.Position = XMFLOAT3(x, y, 0.0f);
+		vertex.Normal = XMFLOAT3(0.0f, 0.0f, -1.0f);
+		vertex.UV = XMFLOAT2(u, v);
+		return vertex;
+	}
+
+	bool IsNear(const XMFLOAT4& tangent, float x, float y, float z, float w)
+	{
+		return std::fabs(tangent.x - x) < 1e-6f && std::fabs(tangent.y - y) < 1e-6f && std::fabs(tangent.z - z) < 1e-6f && tangent.w == w;
+	}
+
+	// --------------------------------------------------------
+	// Two quads side by side, the right one's UVs mirrored
+	// across the edge they share.  The two vertices on that
+	// edge are used both ways round, so only they are copied,
+	// and only the mirrored triangles move to the copies.
+	// --------------------------------------------------------
+	void TestMirroredQuads()
+	{
+		// 0 1 2 along the bottom, 3 4 5 along the top; u runs 0 -> 1 -> 0
+		std::vector<Vertex> vertices = {
+			MakeVertex(0, 0, 0, 0), MakeVertex(1, 0, 1, 0), MakeVertex(2, 0, 0, 0),
+			MakeVertex(0, 1, 0, 1), MakeVertex(1, 1, 1, 1), MakeVertex(2, 1, 0, 1) };
+		std::vector<unsigned int> indices = {
+			0, 1, 3, 1, 4, 3,		// Regular
+			1, 2, 4, 2, 5, 4 };		// Mirrored
+		std::vector<Vertex> original = vertices;
+
+		CHECK(SplitMirroredVertices(vertices, indices) == 2);
+		CHECK(vertices.size() == 8);
+		CHECK(memcmp(&vertices[6], &original[1], sizeof(Vertex)) == 0);
+		CHECK(memcmp(&vertices[7], &original[4], sizeof(Vertex)) == 0);
+
+		std::vector<unsigned int> expected = {
+			0, 1, 3, 1, 4, 3,
+			6, 2, 7, 2, 5, 7 };
+		CHECK(indices == expected);
+
+		// Each side gets its own frame: the tangent follows u, and w
+		// flips it back so the bitangent follows v on both sides
+		CalculateTangents(vertices.data(), vertices.size(), indices.data(), indices.size(), 1);
+		for (unsigned int i : { 0, 1, 3, 4 })
+			CHECK(IsNear(vertices[i].Tangent, 1, 0, 0, 1.0f));
+		for (unsigned int i : { 2, 5, 6, 7 })
+			CHECK(IsNear(vertices[i].Tangent, -1, 0, 0, -1.0f));
+
+		// Nothing is used both ways round any more
+		CHECK(SplitMirroredVertices(vertices, indices) == 0);
+		CHECK(vertices.size() == 8);
+	}
+
+	// --------------------------------------------------------
+	// Without any mirroring nothing changes, and neither does
+	// a triangle whose UVs have no area (it has no handedness)
+	// sharing vertices with regular ones
+	// --------------------------------------------------------
+	void TestNothingMirrored()
+	{
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		MakeGrid(16, vertices, indices);
+		std::vector<Vertex> originalVertices = vertices;
+		std::vector<unsigned int> originalIndices = indices;
+
+		CHECK(SplitMirroredVertices(vertices, indices) == 0);
+		CHECK(vertices.size() == originalVertices.size());
+		CHECK(memcmp(vertices.data(), originalVertices.data(), sizeof(Vertex) * vertices.size()) == 0);
+		CHECK(indices == originalIndices);
+
+		// A regular quad, plus a triangle off its bottom edge whose
+		// third corner's UV lies on that edge's UVs
+		vertices = {
+			MakeVertex(0, 0, 0, 0), MakeVertex(1, 0, 1, 0),
+			MakeVertex(0, 1, 0, 1), MakeVertex(1, 1, 1, 1),
+			MakeVertex(0.5f, -1, 0.5f, 0) };
+		indices = { 0, 1, 2, 1, 3, 2, 1, 0, 4 };
+		originalVertices = vertices;
+		originalIndices = indices;
+
+		CHECK(SplitMirroredVertices(vertices, indices) == 0);
+		CHECK(vertices.size() == originalVertices.size());
+		CHECK(indices == originalIndices);
+	}
+}
+
+int main()
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	MakeGrid(96, vertices, indices);
+
+	// As the Mesh pipeline leaves them
+	OptimizeVertexCache(indices, vertices.size());
+	OptimizeVertexFetch(vertices, indices);
+	TestMatchesLegacy("fetch order", vertices, indices);
+
+	ShuffleVertices(vertices, indices);
+	TestMatchesLegacy("shuffled", vertices, indices);
+
+	TestMirroredQuads();
+	TestNothingMirrored();
+
+	delete &WorkerPool::GetInstance();
+	return TestResult("TangentGenerationTests");
+}
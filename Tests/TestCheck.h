@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdio>
+
+// --------------------------------------------------------
+// All a host test needs: CHECK() reports a failed
+// expression and carries on, and TestResult() is what
+// main() returns (non-zero if anything failed)
+// --------------------------------------------------------
+inline int& TestFailures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(expression) \
+	do \
+	{ \
+		if (!(expression)) \
+		{ \
+			printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #expression); \
+			TestFailures()++; \
+		} \
+	} while (0)
+
+inline int TestResult(const char* name)
+{
+	printf("%s: %s (%d failed checks)\n", name, TestFailures() ? "FAILED" : "passed", TestFailures());
+	return TestFailures() ? 1 : 0;
+}
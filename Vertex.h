@@ -1,6 +1,7 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <cstdint>
 
 // --------------------------------------------------------
 // A custom vertex definition
@@ -13,5 +14,32 @@ struct Vertex
 	// DirectX::XMFLOAT4 Color;        // The color of the vertex
 	DirectX::XMFLOAT3 Normal;
 	DirectX::XMFLOAT2 UV;
-	DirectX::XMFLOAT3 Tangent;
-};
\ No newline at end of file
+	DirectX::XMFLOAT4 Tangent;		// w: handedness, bitangent = w * cross(Tangent, Normal)
+};
+
+// --------------------------------------------------------
+// A 20 byte alternative to Vertex, used when quantizing a
+// mesh stays within tolerance (see VertexQuantization.h)
+//
+// - Position: snorm16 xyz relative to the mesh bounds, with
+//   the tangent's handedness in the spare w
+// - Normal & Tangent: octahedral-encoded snorm16 pairs
+// - UV: unorm16 relative to the mesh's UV range
+//
+// Shaders read these as raw uints and decode them with
+// UnpackVertex() in ShaderIncludes.hlsli
+// --------------------------------------------------------
+struct CompactVertex
+{
+	int16_t Position[4];	// w is the tangent's handedness (+-32767)
+	int16_t Normal[2];
+	uint16_t UV[2];
+	int16_t Tangent[2];
+};
+
+// Which of the structs above a Mesh's vertex buffer holds
+enum class VertexLayout
+{
+	Full,
+	Compact
+};
@@ -0,0 +1,198 @@
+#include "VertexQuantization.h"
+
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	int16_t ToSnorm16(float value)
+	{
+		value = fminf(fmaxf(value, -1.0f), 1.0f);
+		return (int16_t)lroundf(value * 32767.0f);
+	}
+
+	float FromSnorm16(int16_t value)
+	{
+		return fmaxf(value / 32767.0f, -1.0f);
+	}
+
+	uint16_t ToUnorm16(float value)
+	{
+		value = fminf(fmaxf(value, 0.0f), 1.0f);
+		return (uint16_t)lroundf(value * 65535.0f);
+	}
+
+	float FromUnorm16(uint16_t value)
+	{
+		return value / 65535.0f;
+	}
+
+	// Maps a unit vector onto the octahedron |x| + |y| + |z| = 1 and
+	// unfolds the lower half over the corners, giving a 2D point in
+	// [-1, 1] with fairly even precision in every direction
+	void EncodeOctahedral(const XMFLOAT3& direction, int16_t encoded[2])
+	{
+		float length = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+		if (length == 0.0f)
+		{
+			encoded[0] = encoded[1] = 0;
+			return;
+		}
+
+		float x = direction.x / length;
+		float y = direction.y / length;
+		if (direction.z < 0.0f)
+		{
+			float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		encoded[0] = ToSnorm16(x);
+		encoded[1] = ToSnorm16(y);
+	}
+
+	XMFLOAT3 DecodeOctahedral(const int16_t encoded[2])
+	{
+		float x = FromSnorm16(encoded[0]);
+		float y = FromSnorm16(encoded[1]);
+		float z = 1.0f - fabsf(x) - fabsf(y);
+
+		float fold = fmaxf(-z, 0.0f);
+		x += x >= 0.0f ? -fold : fold;
+		y += y >= 0.0f ? -fold : fold;
+
+		XMFLOAT3 direction;
+		XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(x, y, z, 0.0f)));
+		return direction;
+	}
+
+	// Angle between two directions, ignoring their lengths
+	float AngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		XMVECTOR cosine = XMVector3Dot(XMVector3Normalize(XMLoadFloat3(&a)), XMVector3Normalize(XMLoadFloat3(&b)));
+		return XMConvertToDegrees(acosf(fminf(fmaxf(XMVectorGetX(cosine), -1.0f), 1.0f)));
+	}
+
+	bool HasDirection(const XMFLOAT3& v)
+	{
+		return XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&v))) > 0.25f;
+	}
+}
+
+// --------------------------------------------------------
+// Centers the quantization grid on the position bounds and
+// stretches it to the half extents (per axis, so flat meshes
+// don't waste precision), and does the same for UVs
+// --------------------------------------------------------
+VertexQuantization ComputeVertexQuantization(const Vertex* vertices, size_t vertexCount)
+{
+	VertexQuantization quantization = {};
+	if (vertexCount == 0)
+		return quantization;
+
+	XMVECTOR minPosition = XMLoadFloat3(&vertices[0].Position);
+	XMVECTOR maxPosition = minPosition;
+	XMVECTOR minUV = XMLoadFloat2(&vertices[0].UV);
+	XMVECTOR maxUV = minUV;
+	for (size_t i = 1; i < vertexCount; i++)
+	{
+		minPosition = XMVectorMin(minPosition, XMLoadFloat3(&vertices[i].Position));
+		maxPosition = XMVectorMax(maxPosition, XMLoadFloat3(&vertices[i].Position));
+		minUV = XMVectorMin(minUV, XMLoadFloat2(&vertices[i].UV));
+		maxUV = XMVectorMax(maxUV, XMLoadFloat2(&vertices[i].UV));
+	}
+
+	XMStoreFloat3(&quantization.PositionOffset, (minPosition + maxPosition) * 0.5f);
+	XMStoreFloat3(&quantization.PositionScale, (maxPosition - minPosition) * 0.5f);
+	XMStoreFloat2(&quantization.UVOffset, minUV);
+	XMStoreFloat2(&quantization.UVScale, maxUV - minUV);
+	return quantization;
+}
+
+// --------------------------------------------------------
+// Packs every vertex; axes with no extent (e.g. the quad's
+// depth) simply store zero
+// --------------------------------------------------------
+void QuantizeVertices(const Vertex* vertices, size_t vertexCount, const VertexQuantization& quantization, std::vector<CompactVertex>& compact)
+{
+	const XMFLOAT3& offset = quantization.PositionOffset;
+	const XMFLOAT3& scale = quantization.PositionScale;
+	const XMFLOAT2& uvOffset = quantization.UVOffset;
+	const XMFLOAT2& uvScale = quantization.UVScale;
+
+	compact.resize(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const Vertex& v = vertices[i];
+		CompactVertex& c = compact[i];
+
+		c.Position[0] = scale.x > 0.0f ? ToSnorm16((v.Position.x - offset.x) / scale.x) : 0;
+		c.Position[1] = scale.y > 0.0f ? ToSnorm16((v.Position.y - offset.y) / scale.y) : 0;
+		c.Position[2] = scale.z > 0.0f ? ToSnorm16((v.Position.z - offset.z) / scale.z) : 0;
+		c.Position[3] = v.Tangent.w < 0.0f ? -32767 : 32767;
+
+		EncodeOctahedral(v.Normal, c.Normal);
+		EncodeOctahedral(XMFLOAT3(v.Tangent.x, v.Tangent.y, v.Tangent.z), c.Tangent);
+
+		c.UV[0] = uvScale.x > 0.0f ? ToUnorm16((v.UV.x - uvOffset.x) / uvScale.x) : 0;
+		c.UV[1] = uvScale.y > 0.0f ? ToUnorm16((v.UV.y - uvOffset.y) / uvScale.y) : 0;
+	}
+}
+
+// --------------------------------------------------------
+// The CPU twin of UnpackVertex() in ShaderIncludes.hlsli
+// --------------------------------------------------------
+Vertex DequantizeVertex(const CompactVertex& compact, const VertexQuantization& quantization)
+{
+	const XMFLOAT3& offset = quantization.PositionOffset;
+	const XMFLOAT3& scale = quantization.PositionScale;
+
+	Vertex v;
+	v.Position = XMFLOAT3(
+		offset.x + scale.x * FromSnorm16(compact.Position[0]),
+		offset.y + scale.y * FromSnorm16(compact.Position[1]),
+		offset.z + scale.z * FromSnorm16(compact.Position[2]));
+	v.Normal = DecodeOctahedral(compact.Normal);
+	v.UV = XMFLOAT2(
+		quantization.UVOffset.x + quantization.UVScale.x * FromUnorm16(compact.UV[0]),
+		quantization.UVOffset.y + quantization.UVScale.y * FromUnorm16(compact.UV[1]));
+	XMFLOAT3 tangent = DecodeOctahedral(compact.Tangent);
+	v.Tangent = XMFLOAT4(tangent.x, tangent.y, tangent.z, compact.Position[3] < 0 ? -1.0f : 1.0f);
+	return v;
+}
+
+// --------------------------------------------------------
+// Decodes each vertex and records the worst error seen for
+// each attribute.  Position and UV errors are distances;
+// normal and tangent errors are angles.
+//
+// Tangents that are (near) zero, which happens where the UVs
+// are degenerate, carry no direction and are skipped
+// --------------------------------------------------------
+QuantizationReport MeasureQuantizationError(const Vertex* vertices, const CompactVertex* compact, size_t vertexCount, const VertexQuantization& quantization)
+{
+	QuantizationReport report;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const Vertex& original = vertices[i];
+		Vertex decoded = DequantizeVertex(compact[i], quantization);
+
+		float positionError = XMVectorGetX(XMVector3Length(XMLoadFloat3(&original.Position) - XMLoadFloat3(&decoded.Position)));
+		float uvError = XMVectorGetX(XMVector2Length(XMLoadFloat2(&original.UV) - XMLoadFloat2(&decoded.UV)));
+		report.MaxPositionError = fmaxf(report.MaxPositionError, positionError);
+		report.MaxUVError = fmaxf(report.MaxUVError, uvError);
+
+		if (HasDirection(original.Normal))
+			report.MaxNormalErrorDegrees = fmaxf(report.MaxNormalErrorDegrees, AngleDegrees(original.Normal, decoded.Normal));
+		// Handedness is stored exactly, so only the direction can drift
+		XMFLOAT3 originalTangent(original.Tangent.x, original.Tangent.y, original.Tangent.z);
+		XMFLOAT3 decodedTangent(decoded.Tangent.x, decoded.Tangent.y, decoded.Tangent.z);
+		if (HasDirection(originalTangent))
+			report.MaxTangentErrorDegrees = fmaxf(report.MaxTangentErrorDegrees, AngleDegrees(originalTangent, decodedTangent));
+	}
+
+	return report;
+}
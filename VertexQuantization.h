@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Vertex.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Conversion between Vertex and CompactVertex
+//
+// Positions and UVs are stored relative to the mesh's own
+// ranges, so a Mesh keeps one of these around to decode
+// them again (on the GPU, via the MeshQuantization cbuffer)
+//
+// decoded = Offset + Scale * stored, with stored in [-1, 1]
+// for positions and [0, 1] for UVs
+// --------------------------------------------------------
+struct VertexQuantization
+{
+	DirectX::XMFLOAT3 PositionOffset;
+	DirectX::XMFLOAT3 PositionScale;
+	DirectX::XMFLOAT2 UVOffset;
+	DirectX::XMFLOAT2 UVScale;
+};
+
+// The largest errors a mesh can pick up and still use CompactVertex
+struct QuantizationTolerance
+{
+	float Position = 0.0005f;			// Model space units
+	float NormalDegrees = 0.1f;			// Also applies to tangents
+	float UV = 1.0f / 16384.0f;			// A quarter texel at 4096x4096
+};
+
+// Worst-case differences between a quantized mesh and its float original
+struct QuantizationReport
+{
+	float MaxPositionError = 0.0f;
+	float MaxNormalErrorDegrees = 0.0f;
+	float MaxTangentErrorDegrees = 0.0f;
+	float MaxUVError = 0.0f;
+
+	bool IsWithin(const QuantizationTolerance& tolerance) const
+	{
+		return
+			MaxPositionError <= tolerance.Position &&
+			MaxNormalErrorDegrees <= tolerance.NormalDegrees &&
+			MaxTangentErrorDegrees <= tolerance.NormalDegrees &&
+			MaxUVError <= tolerance.UV;
+	}
+};
+
+// Fits the position and UV ranges of a set of vertices
+VertexQuantization ComputeVertexQuantization(const Vertex* vertices, size_t vertexCount);
+
+// Packs vertices into the compact layout
+void QuantizeVertices(const Vertex* vertices, size_t vertexCount, const VertexQuantization& quantization, std::vector<CompactVertex>& compact);
+
+// Unpacks a single vertex, exactly as UnpackVertex() in ShaderIncludes.hlsli does
+Vertex DequantizeVertex(const CompactVertex& compact, const VertexQuantization& quantization);
+
+// Compares every quantized vertex against its original
+QuantizationReport MeasureQuantizationError(const Vertex* vertices, const CompactVertex* compact, size_t vertexCount, const VertexQuantization& quantization);
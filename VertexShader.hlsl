@@ -1,15 +1,6 @@
 #include "ShaderIncludes.hlsli"
 
-cbuffer ExternalData : register(b0)
-{
-	// float4 colorTint;
-	matrix world;
-	matrix view;
-	matrix projection;
-	matrix worldInverseTranspose;
-	matrix lightView;
-	matrix lightProjection;
-}
+// Everything comes from the shared PerFrame, PerPass and PerObject buffers
 
 /*
 // Struct representing a single vertex worth of data
@@ -56,8 +47,10 @@ struct VertexToPixel
 // - Output is a single struct of data to pass down the pipeline
 // - Named "main" because that's the default the shader compiler looks for
 // --------------------------------------------------------
-VertexToPixel main( VertexShaderInput input )
+VertexToPixel main( MeshVertexInput meshInput )
 {
+	VertexShaderInput input = UnpackVertex(meshInput);
+
 	// Set up output struct
 	VertexToPixel output;
 
@@ -89,7 +82,7 @@ VertexToPixel main( VertexShaderInput input )
 	output.worldPosition = mul(world, float4(input.localPosition, 1)).xyz;
 
 	// Assignment 8
-	output.tangent = normalize(mul((float3x3)worldInverseTranspose, input.tangent));
+	output.tangent = float4(normalize(mul((float3x3)worldInverseTranspose, input.tangent.xyz)), input.tangent.w);
 
 	// Assignment 11
 	matrix shadowWVP = mul(lightProjection, mul(lightView, world));
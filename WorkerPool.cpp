@@ -0,0 +1,134 @@
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <memory>
+
+// Singleton requirement
+WorkerPool* WorkerPool::instance;
+
+// --------------------------------------------------------
+// Starts one worker per hardware thread, leaving one for
+// the thread that hands out the work
+// --------------------------------------------------------
+WorkerPool::WorkerPool()
+{
+	unsigned int hardwareThreads = std::thread::hardware_concurrency();
+	unsigned int workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.emplace_back(&WorkerPool::WorkerLoop, this);
+}
+
+// --------------------------------------------------------
+// Lets the workers finish what is queued, then joins them
+// --------------------------------------------------------
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+	queueCondition.notify_all();
+
+	for (std::thread& t : workers)
+		t.join();
+}
+
+// --------------------------------------------------------
+// Adds a job to the queue and wakes a worker
+// --------------------------------------------------------
+void WorkerPool::Enqueue(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		queue.push_back(std::move(job));
+	}
+	queueCondition.notify_one();
+}
+
+// --------------------------------------------------------
+// Body of each worker thread: pop and run jobs until stopped
+// --------------------------------------------------------
+void WorkerPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queueCondition.wait(lock, [this] { return stopping || !queue.empty(); });
+
+			if (queue.empty())
+				return;
+
+			job = std::move(queue.front());
+			queue.pop_front();
+		}
+
+		job();
+	}
+}
+
+// --------------------------------------------------------
+// Runs task(i) for every i in [0, count)
+//
+// - Indices are handed out dynamically, so uneven items
+//   balance themselves across threads
+// - The calling thread works too, and the call only returns
+//   once every index has finished
+// --------------------------------------------------------
+void WorkerPool::ParallelFor(unsigned int count, const std::function<void(unsigned int)>& task)
+{
+	if (count == 0)
+		return;
+
+	// Not worth waking anyone up for a single item
+	if (count == 1 || workers.empty())
+	{
+		for (unsigned int i = 0; i < count; i++)
+			task(i);
+		return;
+	}
+
+	// Shared between the caller and the helpers; the helpers may
+	// still be dequeued after the work is done, so it's ref-counted
+	struct SharedState
+	{
+		std::atomic<unsigned int> nextIndex{ 0 };
+		unsigned int remaining = 0;
+		std::mutex doneMutex;
+		std::condition_variable doneCondition;
+	};
+	std::shared_ptr<SharedState> state = std::make_shared<SharedState>();
+	state->remaining = count;
+
+	auto run = [state, count, &task]()
+	{
+		unsigned int finished = 0;
+		for (unsigned int i = state->nextIndex++; i < count; i = state->nextIndex++)
+		{
+			task(i);
+			finished++;
+		}
+
+		if (finished > 0)
+		{
+			std::lock_guard<std::mutex> lock(state->doneMutex);
+			state->remaining -= finished;
+			if (state->remaining == 0)
+				state->doneCondition.notify_all();
+		}
+	};
+
+	// Helpers only reference "task" while indices remain, and the
+	// caller doesn't return until every index is done
+	unsigned int helpers = (unsigned int)workers.size();
+	if (helpers > count - 1) helpers = count - 1;
+	for (unsigned int i = 0; i < helpers; i++)
+		Enqueue(run);
+
+	run();
+
+	std::unique_lock<std::mutex> lock(state->doneMutex);
+	state->doneCondition.wait(lock, [&state] { return state->remaining == 0; });
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// A fixed set of worker threads that run queued CPU work
+//
+// - Created on first use with one worker per hardware
+//   thread (minus the caller, who also helps out)
+// - Only for CPU-side work; never touch the device context
+//   from inside a task
+// - Submit() runs a task in the background; tasks may use
+//   ParallelFor() themselves
+// --------------------------------------------------------
+class WorkerPool
+{
+#pragma region Singleton
+public:
+	// Gets the one and only instance of this class
+	static WorkerPool& GetInstance()
+	{
+		if (!instance)
+		{
+			instance = new WorkerPool();
+		}
+
+		return *instance;
+	}
+
+	// Remove these functions (C++ 11 version)
+	WorkerPool(WorkerPool const&) = delete;
+	void operator=(WorkerPool const&) = delete;
+
+private:
+	static WorkerPool* instance;
+	WorkerPool();
+#pragma endregion
+
+public:
+	~WorkerPool();
+
+	// Number of threads that take part in ParallelFor (workers + caller)
+	unsigned int GetThreadCount() { return (unsigned int)workers.size() + 1; }
+
+	// Runs task(i) for every i in [0, count) and returns once all are done
+	void ParallelFor(unsigned int count, const std::function<void(unsigned int)>& task);
+
+	// Queues task() and returns right away with a future for its result.
+	// Without workers (a single core) the task runs before this returns.
+	template<typename Task>
+	std::future<typename std::result_of<Task()>::type> Submit(Task task)
+	{
+		typedef typename std::result_of<Task()>::type Result;
+
+		// std::function needs something copyable to hold
+		std::shared_ptr<std::packaged_task<Result()>> job = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+		std::future<Result> result = job->get_future();
+		if (workers.empty())
+			(*job)();
+		else
+			Enqueue([job]() { (*job)(); });
+		return result;
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> queue;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	bool stopping = false;
+
+	void Enqueue(std::function<void()> job);
+	void WorkerLoop();
+};